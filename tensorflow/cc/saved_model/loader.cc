@@ -15,7 +15,11 @@ limitations under the License.
 
 #include "tensorflow/cc/saved_model/loader.h"
 
+#include <atomic>
+#include <memory>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "tensorflow/cc/saved_model/constants.h"
 #include "tensorflow/cc/saved_model/loader_util.h"
@@ -34,11 +38,13 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/protobuf/graph_debug_info.pb.h"
 #include "tensorflow/core/protobuf/meta_graph.pb.h"
 #include "tensorflow/core/protobuf/saver.pb.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/tensor_bundle/naming.h"
 
 namespace tensorflow {
@@ -52,17 +58,19 @@ auto* load_latency = monitoring::Counter<1>::New(
     "/tensorflow/cc/saved_model/load_latency",
     "Latency in microseconds for SavedModels that were successfully loaded.",
     "model_path");
-auto* load_latency_by_stage = monitoring::Sampler<2>::New(
-    {
-        "/tensorflow/cc/saved_model/load_latency_by_stage",  // metric name
-        "Distribution of wall time spent (in microseconds) in each stage "
-        "(restore graph from disk, run init graph op, etc) when loading the "
-        "model",
-        "model_path",
-        "stage",
-    },
-    // Scale of 10, power of 1.8 with bucket count 33 (~20 minutes).
-    monitoring::Buckets::Exponential(10, 1.8, 33));
+
+// The stages of metrics::SavedModelLoadLatencyByStage().
+constexpr char kReadMetaGraphStage[] = "read_meta_graph";
+constexpr char kCreateSessionStage[] = "create_session";
+constexpr char kRestoreGraphStage[] = "restore_graph";
+constexpr char kInitGraphStage[] = "init_graph";
+constexpr char kCheckpointReadaheadStage[] = "checkpoint_readahead";
+
+// Set to true to read the checkpoint of a SavedModel ahead of its restore op.
+constexpr char kCheckpointReadaheadEnvVar[] =
+    "TF_SAVED_MODEL_CHECKPOINT_READAHEAD";
+// Size of the reads of CheckpointReadahead.
+constexpr size_t kReadaheadChunkBytes = 8 << 20;
 
 constexpr char kLoadAttemptFail[] = "fail";
 constexpr char kLoadAttemptSuccess[] = "success";
@@ -154,7 +162,8 @@ void AddAssetsTensorsToInputs(const StringPiece export_dir,
   }
 }
 
-// Like Session::Run(), but uses the Make/Run/ReleaseCallable() API to avoid
+// A step of restoring a session, such as running the restore op or the init
+// op. Like Session::Run(), but uses the Make/Run/ReleaseCallable() API to avoid
 // leaving behind non-GC'ed state.
 //
 // Detailed motivation behind this approach, from ashankar@:
@@ -170,55 +179,51 @@ void AddAssetsTensorsToInputs(const StringPiece export_dir,
 // right after ReleaseCallable returns.
 //
 // However, the resource manager state remains.
-Status RunOnce(const RunOptions& run_options,
-               const std::vector<std::pair<string, Tensor>>& inputs,
-               const std::vector<string>& output_tensor_names,
-               const std::vector<string>& target_node_names,
-               std::vector<Tensor>* outputs, RunMetadata* run_metadata,
-               Session* session) {
-  CallableOptions callable_options;
-  std::vector<Tensor> feed_tensors;
-  *callable_options.mutable_run_options() = run_options;
-  for (const auto& input : inputs) {
-    const string& name = input.first;
-    const Tensor& tensor = input.second;
-    callable_options.add_feed(name);
-    feed_tensors.push_back(tensor);
-  }
-  for (const string& output_tensor_name : output_tensor_names) {
-    callable_options.add_fetch(output_tensor_name);
-  }
-  for (const string& target_node_name : target_node_names) {
-    callable_options.add_target(target_node_name);
+//
+// Preparing a step (pruning, optimizing and partitioning its subgraph, and
+// creating its executors) does not depend on the state of the session, so a
+// step can be prepared while another one runs.
+class LoadStep {
+ public:
+  explicit LoadStep(Session* session) : session_(session) {}
+
+  ~LoadStep() {
+    // Be sure to call ReleaseCallable() regardless of the outcome of
+    // RunCallable().
+    if (prepared_) session_->ReleaseCallable(handle_).IgnoreError();
   }
 
-  Session::CallableHandle callable_handle;
-  TF_RETURN_IF_ERROR(session->MakeCallable(callable_options, &callable_handle));
-  const Status run_status = session->RunCallable(callable_handle, feed_tensors,
-                                                 outputs, run_metadata);
-  // Be sure to call ReleaseCallable() regardless of the outcome of
-  // RunCallable().
-  session->ReleaseCallable(callable_handle).IgnoreError();
-  return run_status;
-}
+  // Makes the callable that feeds `inputs` and runs `target_node_name`.
+  Status Prepare(const RunOptions& run_options,
+                 const std::vector<std::pair<string, Tensor>>& inputs,
+                 const string& target_node_name) {
+    CallableOptions callable_options;
+    *callable_options.mutable_run_options() = run_options;
+    for (const auto& input : inputs) {
+      callable_options.add_feed(input.first);
+      feed_tensors_.push_back(input.second);
+    }
+    callable_options.add_target(target_node_name);
+    TF_RETURN_IF_ERROR(session_->MakeCallable(callable_options, &handle_));
+    prepared_ = true;
+    return Status::OK();
+  }
 
-// RunInitOp will return OK if the initialization op was run successfully.
-// An empty init_op_name indicates that there are no init ops to run.
-Status RunInitOp(const RunOptions& run_options, const string& export_dir,
-                 const MetaGraphDef& meta_graph_def,
-                 const std::vector<AssetFileDef>& asset_file_defs,
-                 Session* session, const string& init_op_name) {
-  if (!init_op_name.empty()) {
-    LOG(INFO) << "Running initialization op on SavedModel bundle at path: "
-              << export_dir;
-    std::vector<std::pair<string, Tensor>> inputs;
-    AddAssetsTensorsToInputs(export_dir, asset_file_defs, &inputs);
+  // REQUIRES: Prepare() returned OK.
+  Status Run() {
     RunMetadata run_metadata;
-    return RunOnce(run_options, inputs, {}, {init_op_name},
-                   nullptr /* outputs */, &run_metadata, session);
+    return session_->RunCallable(handle_, feed_tensors_,
+                                 nullptr /* fetch_tensors */, &run_metadata);
   }
-  return Status::OK();
-}
+
+ private:
+  Session* const session_;
+  std::vector<Tensor> feed_tensors_;
+  Session::CallableHandle handle_;
+  bool prepared_ = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(LoadStep);
+};
 
 Status RunRestore(const RunOptions& run_options, const string& export_dir,
                   const StringPiece restore_op_name,
@@ -252,9 +257,132 @@ Status RunRestore(const RunOptions& run_options, const string& export_dir,
 
   AddAssetsTensorsToInputs(export_dir, asset_file_defs, &inputs);
 
-  RunMetadata run_metadata;
-  return RunOnce(run_options, inputs, {}, {string(restore_op_name)},
-                 nullptr /* outputs */, &run_metadata, session);
+  LoadStep restore_step(session);
+  TF_RETURN_IF_ERROR(
+      restore_step.Prepare(run_options, inputs, string(restore_op_name)));
+  return restore_step.Run();
+}
+
+// Reads the data files of the checkpoint of a SavedModel on a background
+// thread, so that the file system has them cached by the time the restore op
+// reads them, instead of only starting to read once the graph is imported and
+// the restore op prepared. Errors are left for the restore op to report.
+class CheckpointReadahead {
+ public:
+  explicit CheckpointReadahead(const string& export_dir)
+      : export_dir_(export_dir) {
+    thread_.reset(Env::Default()->StartThread(
+        ThreadOptions(), "saved_model_checkpoint_readahead",
+        [this]() { ReadDataFiles(); }));
+  }
+
+  ~CheckpointReadahead() {
+    Cancel();
+    thread_.reset();
+  }
+
+  // Stops reading, once the restore op is done.
+  void Cancel() { cancelled_ = true; }
+
+ private:
+  void ReadDataFiles() {
+    const uint64 start_microseconds = EnvTime::NowMicros();
+    Env* env = Env::Default();
+    const string pattern =
+        io::JoinPath(export_dir_, kSavedModelVariablesDirectory,
+                     strings::StrCat(kSavedModelVariablesFilename, ".data-*"));
+    std::vector<string> filenames;
+    env->GetMatchingPaths(pattern, &filenames).IgnoreError();
+    std::unique_ptr<char[]> scratch(new char[kReadaheadChunkBytes]);
+    uint64 bytes_read = 0;
+    for (const string& filename : filenames) {
+      std::unique_ptr<RandomAccessFile> file;
+      if (cancelled_ || !env->NewRandomAccessFile(filename, &file).ok()) {
+        continue;
+      }
+      StringPiece result;
+      uint64 offset = 0;
+      while (!cancelled_) {
+        const Status status =
+            file->Read(offset, kReadaheadChunkBytes, &result, scratch.get());
+        offset += result.size();
+        if (!status.ok() || result.size() < kReadaheadChunkBytes) break;
+      }
+      bytes_read += offset;
+    }
+    const uint64 latency = GetLatencyMicroseconds(start_microseconds);
+    VLOG(1) << "Read ahead " << bytes_read << " bytes of the checkpoint of "
+            << export_dir_ << " in " << latency << " microseconds"
+            << (cancelled_ ? ", stopped once the restore op was done." : ".");
+    metrics::SavedModelLoadLatencyByStage(export_dir_,
+                                          kCheckpointReadaheadStage)
+        .Add(latency);
+  }
+
+  const string export_dir_;
+  std::atomic<bool> cancelled_{false};
+  std::unique_ptr<Thread> thread_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(CheckpointReadahead);
+};
+
+// Like RestoreSession(), but also cancels `readahead`, if not null, once the
+// restore op is done.
+Status RestoreSessionInternal(const RunOptions& run_options,
+                              const MetaGraphDef& meta_graph,
+                              const string& export_dir,
+                              CheckpointReadahead* readahead,
+                              std::unique_ptr<Session>* session) {
+  const uint64 read_start_microseconds = Env::Default()->NowMicros();
+  std::vector<AssetFileDef> asset_file_defs;
+  TF_RETURN_IF_ERROR(internal::GetAssetFileDefs(meta_graph, &asset_file_defs));
+  string init_op_name;
+  TF_RETURN_IF_ERROR(
+      internal::GetInitOp(export_dir, meta_graph, &init_op_name));
+
+  // Prepare the init op while the restore op is prepared and runs. An empty
+  // init_op_name indicates that there are no init ops to run.
+  LoadStep init_step(session->get());
+  Status init_prepare_status;
+  std::unique_ptr<Thread> init_prepare_thread;
+  if (!init_op_name.empty()) {
+    init_prepare_thread.reset(Env::Default()->StartThread(
+        ThreadOptions(), "saved_model_prepare_init_op", [&]() {
+          std::vector<std::pair<string, Tensor>> inputs;
+          AddAssetsTensorsToInputs(export_dir, asset_file_defs, &inputs);
+          init_prepare_status =
+              init_step.Prepare(run_options, inputs, init_op_name);
+        }));
+  }
+  Status restore_status;
+  if (meta_graph.has_saver_def()) {
+    restore_status = RunRestore(run_options, export_dir,
+                                meta_graph.saver_def().restore_op_name(),
+                                meta_graph.saver_def().filename_tensor_name(),
+                                asset_file_defs, session->get());
+  }
+  if (readahead != nullptr) readahead->Cancel();
+  // Record walltime spent in restoring graph from disk, but postpone metric
+  // increments until graph init finishes.
+  const uint64 restore_graph_walltime =
+      GetLatencyMicroseconds(read_start_microseconds);
+
+  const uint64 graph_init_start_microseconds = Env::Default()->NowMicros();
+  // Joins the thread.
+  init_prepare_thread.reset();
+  TF_RETURN_IF_ERROR(restore_status);
+  TF_RETURN_IF_ERROR(init_prepare_status);
+  if (!init_op_name.empty()) {
+    LOG(INFO) << "Running initialization op on SavedModel bundle at path: "
+              << export_dir;
+    TF_RETURN_IF_ERROR(init_step.Run());
+  }
+  metrics::SavedModelLoadLatencyByStage(export_dir, kRestoreGraphStage)
+      .Add(restore_graph_walltime);
+  // Record wall time spent in init op.
+  metrics::SavedModelLoadLatencyByStage(export_dir, kInitGraphStage)
+      .Add(GetLatencyMicroseconds(graph_init_start_microseconds));
+  return Status::OK();
 }
 
 }  // namespace
@@ -276,15 +404,33 @@ Status LoadSavedModelInternal(const SessionOptions& session_options,
                               const string& export_dir,
                               const std::unordered_set<string>& tags,
                               SavedModelBundle* const bundle) {
+  bool readahead_enabled;
+  TF_RETURN_IF_ERROR(ReadBoolFromEnvVar(kCheckpointReadaheadEnvVar,
+                                        /*default_val=*/false,
+                                        &readahead_enabled));
+  // Reads the checkpoint while the MetaGraphDef is read, and the graph
+  // imported and prepared.
+  std::unique_ptr<CheckpointReadahead> readahead;
+  if (readahead_enabled) {
+    readahead = absl::make_unique<CheckpointReadahead>(export_dir);
+  }
+
+  uint64 stage_start_microseconds = Env::Default()->NowMicros();
   TF_RETURN_IF_ERROR(ReadMetaGraphDefFromSavedModel(export_dir, tags,
                                                     &bundle->meta_graph_def));
   TF_RETURN_IF_ERROR(
       ReadSavedModelDebugInfoIfPresent(export_dir, &bundle->debug_info));
+  metrics::SavedModelLoadLatencyByStage(export_dir, kReadMetaGraphStage)
+      .Add(GetLatencyMicroseconds(stage_start_microseconds));
+
+  stage_start_microseconds = Env::Default()->NowMicros();
   TF_RETURN_IF_ERROR(LoadMetagraphIntoSession(
       session_options, bundle->meta_graph_def, &bundle->session));
-  TF_RETURN_IF_ERROR(RestoreSession(run_options, bundle->meta_graph_def,
-                                    export_dir, &bundle->session));
-  return Status::OK();
+  metrics::SavedModelLoadLatencyByStage(export_dir, kCreateSessionStage)
+      .Add(GetLatencyMicroseconds(stage_start_microseconds));
+
+  return RestoreSessionInternal(run_options, bundle->meta_graph_def,
+                                export_dir, readahead.get(), &bundle->session);
 }
 
 Status LoadSavedModel(const SessionOptions& session_options,
@@ -425,32 +571,8 @@ class LiteSessionWrapper : public Session {
 Status RestoreSession(const RunOptions& run_options,
                       const MetaGraphDef& meta_graph, const string& export_dir,
                       std::unique_ptr<Session>* session) {
-  const uint64 read_start_microseconds = Env::Default()->NowMicros();
-  std::vector<AssetFileDef> asset_file_defs;
-  TF_RETURN_IF_ERROR(internal::GetAssetFileDefs(meta_graph, &asset_file_defs));
-  if (meta_graph.has_saver_def()) {
-    TF_RETURN_IF_ERROR(RunRestore(run_options, export_dir,
-                                  meta_graph.saver_def().restore_op_name(),
-                                  meta_graph.saver_def().filename_tensor_name(),
-                                  asset_file_defs, session->get()));
-  }
-  // Record walltime spent in restoring graph from disk, but postpone metric
-  // increments until graph init finishes.
-  const uint64 restore_graph_walltime =
-      GetLatencyMicroseconds(read_start_microseconds);
-
-  const uint64 graph_init_start_microseconds = Env::Default()->NowMicros();
-  string init_op_name;
-  TF_RETURN_IF_ERROR(
-      internal::GetInitOp(export_dir, meta_graph, &init_op_name));
-  TF_RETURN_IF_ERROR(RunInitOp(run_options, export_dir, meta_graph,
-                               asset_file_defs, session->get(), init_op_name));
-  load_latency_by_stage->GetCell(export_dir, "restore_graph")
-      ->Add(restore_graph_walltime);
-  // Record wall time spent in init op.
-  load_latency_by_stage->GetCell(export_dir, "init_graph")
-      ->Add(GetLatencyMicroseconds(graph_init_start_microseconds));
-  return Status::OK();
+  return RestoreSessionInternal(run_options, meta_graph, export_dir,
+                                nullptr /* readahead */, session);
 }
 
 Status LoadSavedModel(const SessionOptions& session_options,
@@ -50,6 +50,14 @@ monitoring::CounterCell& SavedModelWriteApi(absl::string_view api_label);
 // `foo` should be incremented when the read API `foo` is called.
 monitoring::CounterCell& SavedModelReadApi(absl::string_view api_label);
 
+// Returns "/tensorflow/cc/saved_model/load_latency_by_stage" cell belonging to
+// fields (`model_path`, `stage`). The stages of `tensorflow::LoadSavedModel`
+// are "read_meta_graph", "create_session", "restore_graph" and "init_graph",
+// which add up to the load latency, and "checkpoint_readahead", which runs in
+// the background.
+monitoring::SamplerCell& SavedModelLoadLatencyByStage(
+    absl::string_view model_path, absl::string_view stage);
+
 // Returns "/tensorflow/core/checkpoint/read/read_durations" cell belonging to
 // field `api_label`.
 monitoring::SamplerCell& CheckpointReadDuration(absl::string_view api_label);
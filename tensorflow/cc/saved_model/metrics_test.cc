@@ -43,6 +43,13 @@ TEST(MetricsTest, TestSavedModelRead) {
   EXPECT_EQ(SavedModelRead("2").value(), 2);
 }
 
+TEST(MetricsTest, TestSavedModelLoadLatencyByStage) {
+  EXPECT_EQ(SavedModelLoadLatencyByStage("foo", "bar").value().num(), 0);
+  SavedModelLoadLatencyByStage("foo", "bar").Add(100);
+  EXPECT_EQ(SavedModelLoadLatencyByStage("foo", "bar").value().num(), 1);
+  EXPECT_EQ(SavedModelLoadLatencyByStage("foo", "baz").value().num(), 0);
+}
+
 TEST(MetricsTest, TestCheckpointRead) {
   EXPECT_EQ(CheckpointReadDuration("foo").value().num(), 0);
   CheckpointReadDuration("foo").Add(100);
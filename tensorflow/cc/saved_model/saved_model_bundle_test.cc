@@ -385,5 +385,67 @@ TEST_F(LoaderTest, UpdateMetricsV1) {
   EXPECT_EQ(metrics::SavedModelReadApi(kCCLoadLabel).value(), api_count + 1);
 }
 
+TEST_F(LoaderTest, UpdateLoadLatencyByStage) {
+  SavedModelBundle bundle;
+  SessionOptions session_options;
+  RunOptions run_options;
+  const string export_dir =
+      io::JoinPath(testing::TensorFlowSrcRoot(), kTestDataSharded);
+  const std::vector<string> stages = {"read_meta_graph", "create_session",
+                                      "restore_graph", "init_graph"};
+  std::vector<double> counts;
+  for (const string& stage : stages) {
+    counts.push_back(
+        metrics::SavedModelLoadLatencyByStage(export_dir, stage).value().num());
+  }
+  const double readahead_count =
+      metrics::SavedModelLoadLatencyByStage(export_dir, "checkpoint_readahead")
+          .value()
+          .num();
+
+  TF_ASSERT_OK(LoadSavedModel(session_options, run_options, export_dir,
+                              {kSavedModelTagServe}, &bundle));
+  CheckSavedModelBundle(export_dir, bundle);
+  for (int i = 0; i < stages.size(); ++i) {
+    EXPECT_EQ(
+        metrics::SavedModelLoadLatencyByStage(export_dir, stages[i])
+            .value()
+            .num(),
+        counts[i] + 1)
+        << stages[i];
+  }
+  // The checkpoint is not read ahead by default.
+  EXPECT_EQ(
+      metrics::SavedModelLoadLatencyByStage(export_dir, "checkpoint_readahead")
+          .value()
+          .num(),
+      readahead_count);
+}
+
+TEST_F(LoaderTest, CheckpointReadahead) {
+  SavedModelBundle bundle;
+  SessionOptions session_options;
+  RunOptions run_options;
+  const string export_dir =
+      io::JoinPath(testing::TensorFlowSrcRoot(), kTestDataSharded);
+  const double readahead_count =
+      metrics::SavedModelLoadLatencyByStage(export_dir, "checkpoint_readahead")
+          .value()
+          .num();
+
+  setenv("TF_SAVED_MODEL_CHECKPOINT_READAHEAD", "true", 1 /* overwrite */);
+  const Status status = LoadSavedModel(session_options, run_options,
+                                       export_dir, {kSavedModelTagServe},
+                                       &bundle);
+  unsetenv("TF_SAVED_MODEL_CHECKPOINT_READAHEAD");
+  TF_ASSERT_OK(status);
+  CheckSavedModelBundle(export_dir, bundle);
+  EXPECT_EQ(
+      metrics::SavedModelLoadLatencyByStage(export_dir, "checkpoint_readahead")
+          .value()
+          .num(),
+      readahead_count + 1);
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -85,6 +85,36 @@ TEST(AttrTypeMap, CacheKey) {
   ASSERT_FALSE(cache_key == a.CacheKey("cpu:0"));
 }
 
+TEST(AttrTypeMap, CacheKeyAfterReset) {
+  AttrBuilder a("op_name");
+  a.Set("T", TF_FLOAT);
+  tensorflow::Fprint128 cache_key = a.CacheKey("cpu:0");
+
+  // Reusing the builder with identical attributes yields the same key.
+  a.Reset("op_name");
+  a.Set("T", TF_FLOAT);
+  ASSERT_TRUE(cache_key == a.CacheKey("cpu:0"));
+  ASSERT_FALSE(cache_key == a.CacheKey("cpu:1"));
+
+  // Any difference in op name or attributes yields a different key.
+  a.Reset("op_name");
+  a.Set("T", TF_INT32);
+  ASSERT_FALSE(cache_key == a.CacheKey("cpu:0"));
+
+  a.Reset("other_op_name");
+  a.Set("T", TF_FLOAT);
+  ASSERT_FALSE(cache_key == a.CacheKey("cpu:0"));
+
+  a.Reset("op_name");
+  a.Set("T", TF_FLOAT);
+  a.Set("x", 1.0);
+  ASSERT_FALSE(cache_key == a.CacheKey("cpu:0"));
+
+  AttrBuilder b("op_name");
+  b.Set("T", TF_FLOAT);
+  ASSERT_TRUE(cache_key == b.CacheKey("cpu:0"));
+}
+
 string ToString(const AttrValueMap& m) {
   std::vector<string> strs;
   for (const auto& e : m) {
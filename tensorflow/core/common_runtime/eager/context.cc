@@ -486,6 +486,7 @@ void EagerContext::ClearCachesAndDefaultExecutor() {
   mutex_lock ml(cache_mu_);
   default_executor_.WaitForAllPendingNodes().IgnoreError();
   kernel_cache_.clear();
+  kernel_cache_generation_.fetch_add(1, std::memory_order_release);
   for (auto& entry : registered_functions_) {
     entry.second->cached_kernel_keys->clear();
   }
@@ -983,6 +984,7 @@ Status EagerContext::RemoveFunction(const string& func) {
       for (auto& key : *registered_function->cached_kernel_keys) {
         kernel_cache_.erase(key);
       }
+      kernel_cache_generation_.fetch_add(1, std::memory_order_release);
       registered_functions_.erase(func);
     }
     registered_function->Unref();
@@ -1064,7 +1066,11 @@ void EagerContext::AddKernelToCache(Fprint128 cache_key,
   mutex_lock ml(cache_mu_);
   core::RefCountPtr<KernelAndDevice> new_ref(kernel);
   new_ref->Ref();
-  kernel_cache_[cache_key] = std::move(new_ref);
+  core::RefCountPtr<KernelAndDevice>& entry = kernel_cache_[cache_key];
+  if (entry != nullptr) {
+    kernel_cache_generation_.fetch_add(1, std::memory_order_release);
+  }
+  entry = std::move(new_ref);
   auto* registered_function =
       gtl::FindPtrOrNull(registered_functions_, kernel->name());
   // The kernel name can be either a primitive op or a function.
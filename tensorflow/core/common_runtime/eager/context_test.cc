@@ -17,6 +17,8 @@ limitations under the License.
 
 #include "absl/types/span.h"
 #include "tensorflow/core/common_runtime/eager/context_distributed_manager.h"
+#include "tensorflow/core/common_runtime/eager/eager_operation.h"
+#include "tensorflow/core/common_runtime/eager/kernel_and_device.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
@@ -365,5 +367,103 @@ TEST_F(EagerContextTest, ReuseGlobalRendezvous) {
   TestGlobalRendezvous(context(), true);
 }
 
+// Returns a kernel of the function "MyIdentity" that is not instantiated.
+core::RefCountPtr<KernelAndDevice> NewFunctionKernel(EagerContext* context) {
+  return core::RefCountPtr<KernelAndDevice>(new KernelAndDeviceFunc(
+      /*flr=*/nullptr, /*pflr=*/nullptr, /*input_devices=*/{},
+      /*composite_devices=*/{}, /*input_resource_dtypes_and_shapes=*/{},
+      /*runner=*/nullptr, /*collective_executor=*/nullptr, context->HostCPU(),
+      "MyIdentity", /*outputs_on_op_device=*/false,
+      /*allow_small_function_optimizations=*/false,
+      /*allow_control_flow_sync_execution=*/false,
+      /*shape_inference_on_tfe_dialect_import=*/true,
+      /*int_args_and_retvals_on_device=*/false, context->RendezvousCreator(),
+      [] { return 0; }));
+}
+
+TEST_F(EagerContextTest, KernelCacheReleasesKernels) {
+  InitContext(SessionOptions(), DEVICE_PLACEMENT_EXPLICIT);
+  const FunctionDef identity = FDH::Define(
+      // Name
+      "MyIdentity",
+      // Args
+      {"x: float"},
+      // Return values
+      {"y: float"},
+      // Attr def
+      {},
+      // Nodes
+      {{{"y"}, "Identity", {"x"}, {{"T", DT_FLOAT}}}});
+  TF_ASSERT_OK(context()->AddFunctionDef(identity));
+  const Fprint128 cache_key = {1, 2};
+  core::RefCountPtr<KernelAndDevice> first = NewFunctionKernel(context());
+  core::RefCountPtr<KernelAndDevice> second = NewFunctionKernel(context());
+
+  // Adding an entry keeps the generation, since it releases no kernel.
+  int64_t generation = context()->KernelCacheGeneration();
+  context()->AddKernelToCache(cache_key, first.get());
+  EXPECT_EQ(generation, context()->KernelCacheGeneration());
+
+  // Overwriting an entry releases the kernel it held.
+  context()->AddKernelToCache(cache_key, second.get());
+  EXPECT_TRUE(first->RefCountIsOne());
+  EXPECT_EQ(context()->GetCachedKernel(cache_key).get(), second.get());
+  EXPECT_LT(generation, context()->KernelCacheGeneration());
+  generation = context()->KernelCacheGeneration();
+
+  // Clearing the caches releases every kernel.
+  context()->ClearCachesAndDefaultExecutor();
+  EXPECT_TRUE(second->RefCountIsOne());
+  EXPECT_EQ(context()->GetCachedKernel(cache_key), nullptr);
+  EXPECT_LT(generation, context()->KernelCacheGeneration());
+  generation = context()->KernelCacheGeneration();
+
+  // Removing a function releases its kernels.
+  context()->AddKernelToCache(cache_key, first.get());
+  EXPECT_FALSE(first->RefCountIsOne());
+  TF_ASSERT_OK(context()->RemoveFunction("MyIdentity"));
+  EXPECT_TRUE(first->RefCountIsOne());
+  EXPECT_EQ(context()->GetCachedKernel(cache_key), nullptr);
+  EXPECT_LT(generation, context()->KernelCacheGeneration());
+}
+
+TEST_F(EagerContextTest, InlineKernelCache) {
+  InitContext(SessionOptions(), DEVICE_PLACEMENT_EXPLICIT);
+  std::vector<core::RefCountPtr<KernelAndDevice>> kernels;
+  for (int i = 0; i < 10; ++i) kernels.push_back(NewFunctionKernel(context()));
+  const int64_t generation = context()->KernelCacheGeneration();
+  EagerOperation* op = new EagerOperation(context());
+
+  // Keeps the kernels of the last 8 keys.
+  for (uint64 i = 0; i < 9; ++i) {
+    op->AddInlineCachedKernel({i, i}, generation, kernels[i].get());
+  }
+  EXPECT_EQ(op->GetInlineCachedKernel({0, 0}), nullptr);
+  EXPECT_TRUE(kernels[0]->RefCountIsOne());
+  EXPECT_EQ(op->GetInlineCachedKernel({1, 1}).get(), kernels[1].get());
+
+  // A hit makes the key the most recent one, so key 2 is evicted instead.
+  op->AddInlineCachedKernel({9, 9}, generation, kernels[9].get());
+  EXPECT_EQ(op->GetInlineCachedKernel({2, 2}), nullptr);
+  EXPECT_TRUE(kernels[2]->RefCountIsOne());
+  EXPECT_EQ(op->GetInlineCachedKernel({1, 1}).get(), kernels[1].get());
+
+  // The kernels are kept across Reset(), until the kernel cache of the context
+  // releases kernels.
+  TF_ASSERT_OK(op->Reset("Identity", nullptr));
+  EXPECT_EQ(op->GetInlineCachedKernel({9, 9}).get(), kernels[9].get());
+  context()->ClearCachesAndDefaultExecutor();
+  EXPECT_EQ(op->GetInlineCachedKernel({9, 9}), nullptr);
+  for (const auto& kernel : kernels) {
+    EXPECT_TRUE(kernel->RefCountIsOne());
+  }
+
+  // Kernels cached at an older generation are dropped when looked up.
+  op->AddInlineCachedKernel({1, 1}, generation, kernels[1].get());
+  EXPECT_EQ(op->GetInlineCachedKernel({1, 1}), nullptr);
+  EXPECT_TRUE(kernels[1]->RefCountIsOne());
+  delete op;
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/eager/eager_executor.h"
 
+#include <algorithm>
 #include <forward_list>
 
 #include "tensorflow/core/lib/core/errors.h"
@@ -29,6 +30,13 @@ bool IsAsyncWaitForRemoteFunctionEnabled() {
                                  true, &enabled));
   return enabled;
 }
+
+int64_t GetAsyncMaxBatchSize() {
+  int64_t max_batch_size = 1;
+  TF_CHECK_OK(ReadInt64FromEnvVar("TF_EAGER_ASYNC_MAX_BATCH_SIZE", 1,
+                                  &max_batch_size));
+  return std::max<int64_t>(max_batch_size, 1);
+}
 }  // namespace
 
 EagerExecutor::EagerExecutor(bool async)
@@ -40,7 +48,8 @@ EagerExecutor::EagerExecutor(bool async)
                     : nullptr),
       last_eager_client_(nullptr),
       enable_async_wait_for_remote_function_(
-          IsAsyncWaitForRemoteFunctionEnabled()) {}
+          IsAsyncWaitForRemoteFunctionEnabled()),
+      max_batch_size_(GetAsyncMaxBatchSize()) {}
 
 EagerExecutor::~EagerExecutor() {
   tensorflow::mutex_lock l(node_queue_mutex_);
@@ -149,7 +158,7 @@ Status EagerExecutor::AddOrExecute(std::unique_ptr<EagerNode> node) {
     } else {
       status = status_;
       if (status.ok()) {
-        node_queue_.push(std::move(item));
+        node_queue_.push_back(std::move(item));
         // If there were no previous nodes pending, wake the run thread to
         // start processing requests again.
         if (node_queue_.size() == 1) {
@@ -231,7 +240,7 @@ void EagerExecutor::NodeDone(const core::RefCountPtr<NodeItem>& item,
     if (from_queue) {
       // Since this was from the async queue, pop it from the front of the queue
       DCHECK(!node_queue_.empty() && item.get() == node_queue_.front().get());
-      node_queue_.pop();
+      node_queue_.pop_front();
     } else if (async) {
       // If it is an Async node then we will find the node in the unfinished
       // nodes list. However we only notify if we are at the front of the list
@@ -265,7 +274,7 @@ void EagerExecutor::NodeDone(const core::RefCountPtr<NodeItem>& item,
       }
       while (!node_queue_.empty()) {
         items_to_destroy.push_front(std::move(node_queue_.front()));
-        node_queue_.pop();
+        node_queue_.pop_front();
       }
       for (auto& it : unfinished_nodes_) {
         items_to_destroy.push_front(std::move(it.second));
@@ -320,6 +329,7 @@ void EagerExecutor::NotifyWaiters(uint64 id) {
 void EagerExecutor::Run() {
   auto thread_exited_notifier =
       gtl::MakeCleanup([this] { thread_exited_notification_.Notify(); });
+  std::vector<core::RefCountPtr<NodeItem>> batch;
   while (true) {
     core::RefCountPtr<NodeItem> curr_item;
     {
@@ -337,6 +347,27 @@ void EagerExecutor::Run() {
       // and register a notification for its completion.
       curr_item.reset(node_queue_.front().get());
       curr_item->Ref();
+      if (max_batch_size_ > 1 && curr_item->node->AsAsync() == nullptr) {
+        // Take the longest run of synchronous nodes (up to max_batch_size_)
+        // from the front of the queue. Asynchronous nodes are always run on
+        // their own.
+        batch.push_back(std::move(curr_item));
+        for (auto it = node_queue_.begin() + 1;
+             it != node_queue_.end() &&
+             static_cast<int64_t>(batch.size()) < max_batch_size_ &&
+             (*it)->node->AsAsync() == nullptr;
+             ++it) {
+          (*it)->Ref();
+          batch.emplace_back(it->get());
+        }
+      }
+    }
+    if (!batch.empty()) {
+      RunBatch(&batch);
+      // Release the references to the batch outside of node_queue_mutex_,
+      // since node destructors may enqueue more nodes.
+      batch.clear();
+      continue;
     }
     Status status = RunItem(std::move(curr_item), /*from_queue=*/true);
     if (!status.ok()) {
@@ -398,6 +429,42 @@ Status EagerExecutor::RunItem(core::RefCountPtr<NodeItem> item,
   return status();
 }
 
+void EagerExecutor::RunBatch(
+    std::vector<core::RefCountPtr<NodeItem>>* batch) {
+  size_t num_done = 0;
+  for (const core::RefCountPtr<NodeItem>& item : *batch) {
+    // Stop if another node failed in the meantime; that failure has already
+    // aborted the remaining nodes in the queue.
+    if (!ok()) break;
+    DVLOG(3) << "Running Node: [id " << item->id << "] "
+             << item->node->DebugString();
+    Status status = item->node->Run();
+    if (!status.ok()) {
+      BatchDone(absl::MakeConstSpan(*batch).first(num_done));
+      NodeDone(item, status, /*from_queue=*/true);
+      return;
+    }
+    ++num_done;
+  }
+  BatchDone(absl::MakeConstSpan(*batch).first(num_done));
+}
+
+void EagerExecutor::BatchDone(
+    absl::Span<const core::RefCountPtr<NodeItem>> items) {
+  if (items.empty()) return;
+  for (const core::RefCountPtr<NodeItem>& item : items) {
+    DCHECK(item->state != NodeState::kDONE);
+    item->state = NodeState::kDONE;
+  }
+  mutex_lock l(node_queue_mutex_);
+  if (!status_.ok()) return;
+  for (const core::RefCountPtr<NodeItem>& item : items) {
+    DCHECK(!node_queue_.empty() && item.get() == node_queue_.front().get());
+    node_queue_.pop_front();
+  }
+  NotifyWaiters(items.front()->id);
+}
+
 Status EagerExecutor::MoveToUnfinished(core::RefCountPtr<NodeItem> item,
                                        bool from_queue) {
   tensorflow::mutex_lock l(node_queue_mutex_);
@@ -407,7 +474,7 @@ Status EagerExecutor::MoveToUnfinished(core::RefCountPtr<NodeItem> item,
 
   if (from_queue) {
     DCHECK(!node_queue_.empty() && item.get() == node_queue_.front().get());
-    node_queue_.pop();
+    node_queue_.pop_front();
   }
 
   DVLOG(3) << "Add Node: [id " << item->id << "] to unfinished map.";
@@ -0,0 +1,145 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/eager/eager_executor.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+// Records the order in which nodes run or are aborted.
+struct NodeLog {
+  mutex mu;
+  std::vector<int> ran TF_GUARDED_BY(mu);
+  std::vector<int> aborted TF_GUARDED_BY(mu);
+};
+
+class TestNode : public EagerNode {
+ public:
+  TestNode(int id, NodeLog* log, Status status = Status::OK())
+      : id_(id), log_(log), status_(status) {}
+
+  Status Run() override {
+    mutex_lock l(log_->mu);
+    log_->ran.push_back(id_);
+    return status_;
+  }
+
+  void Abort(Status status) override {
+    mutex_lock l(log_->mu);
+    log_->aborted.push_back(id_);
+  }
+
+  string DebugString() const override { return "TestNode"; }
+
+ private:
+  const int id_;
+  NodeLog* const log_;
+  const Status status_;
+};
+
+class EagerExecutorBatchTest : public ::testing::TestWithParam<int> {
+ protected:
+  void SetUp() override {
+    setenv("TF_EAGER_ASYNC_MAX_BATCH_SIZE",
+           std::to_string(GetParam()).c_str(), /*overwrite=*/1);
+  }
+  void TearDown() override { unsetenv("TF_EAGER_ASYNC_MAX_BATCH_SIZE"); }
+};
+
+TEST_P(EagerExecutorBatchTest, RunsNodesInOrder) {
+  constexpr int kNumNodes = 100;
+  NodeLog log;
+  EagerExecutor executor(/*async=*/true);
+  for (int i = 0; i < kNumNodes; ++i) {
+    TF_ASSERT_OK(executor.AddOrExecute(absl::make_unique<TestNode>(i, &log)));
+  }
+  TF_ASSERT_OK(executor.WaitForAllPendingNodes());
+
+  mutex_lock l(log.mu);
+  ASSERT_EQ(log.ran.size(), kNumNodes);
+  for (int i = 0; i < kNumNodes; ++i) {
+    EXPECT_EQ(log.ran[i], i);
+  }
+  EXPECT_TRUE(log.aborted.empty());
+}
+
+TEST_P(EagerExecutorBatchTest, FailureAbortsRemainingNodes) {
+  constexpr int kNumNodes = 20;
+  constexpr int kFailingNode = 7;
+  NodeLog log;
+  EagerExecutor executor(/*async=*/true);
+  {
+    // Hold the log lock so that all nodes are enqueued before any of them
+    // finishes running.
+    mutex_lock l(log.mu);
+    for (int i = 0; i < kNumNodes; ++i) {
+      TF_ASSERT_OK(executor.AddOrExecute(absl::make_unique<TestNode>(
+          i, &log,
+          i == kFailingNode ? errors::Internal("failed") : Status::OK())));
+    }
+  }
+  EXPECT_FALSE(executor.WaitForAllPendingNodes().ok());
+  EXPECT_FALSE(executor.status().ok());
+
+  mutex_lock l(log.mu);
+  ASSERT_EQ(log.ran.size(), kFailingNode + 1);
+  for (int i = 0; i <= kFailingNode; ++i) {
+    EXPECT_EQ(log.ran[i], i);
+  }
+  EXPECT_EQ(log.aborted.size(), kNumNodes - kFailingNode - 1);
+}
+
+INSTANTIATE_TEST_SUITE_P(BatchSizes, EagerExecutorBatchTest,
+                         ::testing::Values(1, 4, 64));
+
+// A node that does nothing, so that only the scheduling cost is measured.
+class NoOpNode : public EagerNode {
+ public:
+  Status Run() override { return Status::OK(); }
+  void Abort(Status status) override {}
+  string DebugString() const override { return "NoOpNode"; }
+};
+
+// Runs bursts of 1000 small nodes through an async executor taking batches of
+// up to `state.range(0)` nodes.
+void BM_AsyncExecutorSmallNodes(::testing::benchmark::State& state) {
+  constexpr int kNumNodes = 1000;
+  setenv("TF_EAGER_ASYNC_MAX_BATCH_SIZE",
+         std::to_string(state.range(0)).c_str(), /*overwrite=*/1);
+  EagerExecutor executor(/*async=*/true);
+  unsetenv("TF_EAGER_ASYNC_MAX_BATCH_SIZE");
+  for (auto s : state) {
+    for (int i = 0; i < kNumNodes; ++i) {
+      TF_CHECK_OK(executor.AddOrExecute(absl::make_unique<NoOpNode>()));
+    }
+    TF_CHECK_OK(executor.WaitForAllPendingNodes());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumNodes);
+}
+BENCHMARK(BM_AsyncExecutorSmallNodes)->Arg(1)->Arg(16);
+
+}  // namespace
+}  // namespace tensorflow
@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/common_runtime/eager/eager_operation.h"
 
+#include <algorithm>
+
 #include "absl/types/span.h"
 #include "tensorflow/c/eager/abstract_operation.h"
 #include "tensorflow/c/eager/abstract_tensor_handle.h"
@@ -315,6 +317,10 @@ Status EagerOperation::Reset(
     const absl::optional<EagerFunctionParams> eager_func_params) {
   DCHECK(inputs_.empty());
   ClearInferenceState();
+  // Releases the kernels the context no longer caches.
+  if (inline_kernel_cache_generation_ != ctx_.KernelCacheGeneration()) {
+    ClearInlineKernelCache();
+  }
   bool is_function = false;
   TF_RETURN_IF_ERROR(AttrTypeMapForOp(op, &attr_types_, &is_function));
 
@@ -351,6 +357,48 @@ Status EagerOperation::Reset(
   return SetDeviceName(device_name);
 }
 
+core::RefCountPtr<KernelAndDevice> EagerOperation::GetInlineCachedKernel(
+    const Fprint128& cache_key) {
+  if (inline_kernel_cache_generation_ != ctx_.KernelCacheGeneration()) {
+    ClearInlineKernelCache();
+    return nullptr;
+  }
+  for (auto it = inline_kernel_cache_.begin(); it != inline_kernel_cache_.end();
+       ++it) {
+    if (it->cache_key == cache_key) {
+      std::rotate(inline_kernel_cache_.begin(), it, it + 1);
+      KernelAndDevice* kernel = inline_kernel_cache_.front().kernel.get();
+      kernel->Ref();
+      return core::RefCountPtr<KernelAndDevice>(kernel);
+    }
+  }
+  return nullptr;
+}
+
+void EagerOperation::AddInlineCachedKernel(const Fprint128& cache_key,
+                                           int64_t kernel_cache_generation,
+                                           KernelAndDevice* kernel) {
+  if (inline_kernel_cache_generation_ != kernel_cache_generation) {
+    ClearInlineKernelCache();
+    inline_kernel_cache_generation_ = kernel_cache_generation;
+  }
+  if (inline_kernel_cache_.empty()) {
+    ctx_.Ref();
+  } else if (inline_kernel_cache_.size() == kInlineKernelCacheSize) {
+    inline_kernel_cache_.pop_back();
+  }
+  kernel->Ref();
+  inline_kernel_cache_.insert(
+      inline_kernel_cache_.begin(),
+      {cache_key, core::RefCountPtr<KernelAndDevice>(kernel)});
+}
+
+void EagerOperation::ClearInlineKernelCache() {
+  if (inline_kernel_cache_.empty()) return;
+  inline_kernel_cache_.clear();
+  ctx_.Unref();
+}
+
 Status EagerOperation::MaybeInferSingleInputAttrs(
     ImmediateExecutionTensorHandle* handle) {
   if (!op_def_) return Status::OK();
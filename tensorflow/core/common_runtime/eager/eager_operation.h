@@ -42,6 +42,7 @@ class EagerOperation : public ImmediateExecutionOperation {
     for (ImmediateExecutionTensorHandle* h : inputs_) {
       h->Unref();
     }
+    ClearInlineKernelCache();
   }
 
   void Release() override { delete this; }
@@ -215,14 +216,33 @@ class EagerOperation : public ImmediateExecutionOperation {
   // Op name recorded for memory debugging purpose.
   const char* op_name() const { return op_name_; }
 
+  // The inline kernel cache of this operation, consulted before the kernel
+  // cache of the context. Operations are reused across Reset() for many ops
+  // (Python reuses one per thread), so it keeps the kernels of the last
+  // kInlineKernelCacheSize kernel cache keys executed, most recent first.
+  //
+  // Returns the kernel cached inline for `cache_key`, or nullptr.
+  core::RefCountPtr<KernelAndDevice> GetInlineCachedKernel(
+      const Fprint128& cache_key);
+  // Caches `kernel`, obtained from or added to the kernel cache of the context
+  // when its generation was `kernel_cache_generation`.
+  void AddInlineCachedKernel(const Fprint128& cache_key,
+                             int64_t kernel_cache_generation,
+                             KernelAndDevice* kernel);
+
   // For LLVM style RTTI.
   static bool classof(const AbstractOperation* ptr) {
     return ptr->getKind() == kEager;
   }
 
  private:
+  static constexpr int kInlineKernelCacheSize = 8;
+
   void AddTensorHandle(ImmediateExecutionTensorHandle* h);
 
+  // Releases the kernels cached inline, then the context.
+  void ClearInlineKernelCache();
+
   const tensorflow::OpDef* GetOpDef(Status* status);
 
   void ClearInferenceState() {
@@ -283,6 +303,18 @@ class EagerOperation : public ImmediateExecutionOperation {
   int inference_arg_idx_;  // arg definition index for the next input to be
                            // added
   gtl::FlatSet<std::string> inference_attrs_;  // attributes inferred so far
+
+  // Inline kernel cache, kept across Clear() and Reset(). Its kernels are
+  // dropped once the generation of the kernel cache of the context changes.
+  // While it holds kernels, the operation holds a reference to the context, so
+  // that the kernels are released before it.
+  struct InlineCachedKernel {
+    Fprint128 cache_key;
+    core::RefCountPtr<KernelAndDevice> kernel;
+  };
+  absl::InlinedVector<InlineCachedKernel, kInlineKernelCacheSize>
+      inline_kernel_cache_;
+  int64_t inline_kernel_cache_generation_ = -1;
 };
 
 inline void EagerOperation::UpdateInput(int i, TensorHandle* h) {
@@ -952,7 +952,20 @@ Status GetOrCreateKernelAndDevice(
       GetKernelCacheKey(*op, op->MutableAttrs()->CacheKey(op->DeviceName()),
                         input_dev_ptrs,
                         input_resource_variable_dtypes_and_shapes));
-  core::RefCountPtr<KernelAndDevice> kernel = ctx.GetCachedKernel(cache_key);
+  // Consults the inline kernel cache of the operation before the kernel cache
+  // of the context, which takes a lock and a hash table lookup. The generation
+  // is read first, so that kernels released meanwhile are not cached inline.
+  EagerOperation* const inline_cache_op = op;
+  const int64_t kernel_cache_generation = ctx.KernelCacheGeneration();
+  core::RefCountPtr<KernelAndDevice> kernel =
+      op->GetInlineCachedKernel(cache_key);
+  if (kernel == nullptr) {
+    kernel = ctx.GetCachedKernel(cache_key);
+    if (kernel != nullptr) {
+      op->AddInlineCachedKernel(cache_key, kernel_cache_generation,
+                                kernel.get());
+    }
+  }
   AbstractOperationPtr wrapped_op_releaser;
   // We can eliminate some overhead by running simple functions using regular
   // CallOp kernel. However, it is tricky to figure out which functions should
@@ -1116,6 +1129,8 @@ Status GetOrCreateKernelAndDevice(
 
     if (op->is_function()) {
       ctx.AddKernelToCache(cache_key, kernel.get());
+      inline_cache_op->AddInlineCachedKernel(
+          cache_key, kernel_cache_generation, kernel.get());
     } else {
       // Exclude tf.data op kernels from being cached. The reason for this is
       // that tf.data op kernels that accept a user-defined function will have a
@@ -1127,6 +1142,8 @@ Status GetOrCreateKernelAndDevice(
       TF_RETURN_IF_ERROR(OpDefForOp(op->Name().data(), &op_def));
       if (KernelCacheEnabled(*op_def)) {
         ctx.AddKernelToCache(cache_key, kernel.get());
+        inline_cache_op->AddInlineCachedKernel(
+            cache_key, kernel_cache_generation, kernel.get());
       }
     }
   }
@@ -692,4 +692,128 @@ BENCHMARK(BM_FunctionalWhileLoop)
     ->ArgPair(10, 100)
     ->ArgPair(100, 100)
     ->ArgPair(1000, 100);
+
+// Defines a graph to perform the following computation:
+//
+//     i = 0
+//     while (i < loop_iters)
+//       for k in range(num_conds):
+//         _ = i if (i < loop_iters) else i
+//       i += 1;
+//
+// ...using the `Switch`/`Merge`-style of control flow, with up to
+// `parallel_iterations` iterations in flight. Every conditional in the body
+// ends in a `Merge`, so each iteration performs `num_conds` activations
+// through the propagator's slow path.
+static std::unique_ptr<Graph> ParallelCondLoopGraph(int loop_iters,
+                                                    int num_conds,
+                                                    int parallel_iterations) {
+  Scope scope = Scope::NewRootScope().ExitOnError();
+  auto enter_attrs =
+      ops::internal::Enter::ParallelIterations(parallel_iterations);
+
+  auto dummy = ops::Placeholder(scope.WithOpName("dummy"), DT_INT32);
+  auto zero = ops::Const<int32>(scope.WithOpName("zero"), 0);
+  auto limit = ops::Const<int32>(scope.WithOpName("limit"), loop_iters);
+  auto enter = ops::internal::Enter(scope.WithOpName("while/Enter"), zero,
+                                    "loop", enter_attrs);
+  auto limit_enter = ops::internal::Enter(scope.WithOpName("while/Enter_1"),
+                                          limit, "loop",
+                                          enter_attrs.IsConstant(true));
+  auto merge = ops::Merge(scope.WithOpName("while/Merge"),
+                          std::initializer_list<Input>{enter, dummy});
+  auto less =
+      ops::Less(scope.WithOpName("while/Less"), merge.output, limit_enter);
+  auto loop_cond = ops::LoopCond(scope.WithOpName("while/LoopCond"), less);
+  auto switch_ =
+      ops::Switch(scope.WithOpName("while/Switch"), merge.output, loop_cond);
+  auto identity =
+      ops::Identity(scope.WithOpName("while/Identity"), switch_.output_true);
+  ops::internal::Exit(scope.WithOpName("while/Exit"), switch_.output_false);
+
+  for (int i = 0; i < num_conds; ++i) {
+    Scope cond_scope = scope.NewSubScope(strings::StrCat("while/cond_", i));
+    auto pred = ops::Less(cond_scope.WithOpName("pred"), identity, limit_enter);
+    auto cond_switch =
+        ops::Switch(cond_scope.WithOpName("Switch"), identity, pred);
+    auto then_branch =
+        ops::Identity(cond_scope.WithOpName("then"), cond_switch.output_true);
+    auto else_branch =
+        ops::Identity(cond_scope.WithOpName("else"), cond_switch.output_false);
+    ops::Merge(cond_scope.WithOpName("Merge"),
+               std::initializer_list<Input>{then_branch, else_branch});
+  }
+
+  auto one = ops::Const<int32>(
+      scope.WithOpName("while/add/y").WithControlDependencies(identity), 1);
+  auto add = ops::Add(scope.WithOpName("while/add"), identity, one);
+  auto next_iteration =
+      ops::NextIteration(scope.WithOpName("while/NextIteration"), add);
+
+  // Remove the dummy node and add the loop backedge.
+  scope.graph()->RemoveNode(dummy.node());
+  scope.graph()->AddEdge(next_iteration.node(), 0, merge.output.node(), 1);
+
+  std::unique_ptr<Graph> graph(new Graph(OpRegistry::Global()));
+  TF_CHECK_OK(scope.ToGraph(graph.get()));
+  FixupSourceAndSinkEdges(graph.get());
+  return graph;
+}
+
+// Measures how the propagator scales with the number of inter-op threads on
+// a loop with many parallel iterations, each of which activates merge nodes.
+static void BM_ParallelCondLoop(::testing::benchmark::State& state) {
+  const int num_threads = state.range(0);
+  const int parallel_iterations = state.range(1);
+  constexpr int kLoopIters = 1000;
+  constexpr int kNumConds = 16;
+
+  std::unique_ptr<Graph> graph =
+      ParallelCondLoopGraph(kLoopIters, kNumConds, parallel_iterations);
+  std::unique_ptr<Device> device(
+      DeviceFactory::NewDevice("CPU", {}, "/job:localhost/replica:0/task:0"));
+  thread::ThreadPool pool(Env::Default(), "executor_bm", num_threads);
+
+  const int version = graph->versions().producer();
+  LocalExecutorParams params;
+  params.device = device.get();
+  params.create_kernel =
+      [&device, version](const std::shared_ptr<const NodeProperties>& props,
+                         OpKernel** kernel) {
+        return CreateNonCachedKernel(device.get(), nullptr, props, version,
+                                     kernel);
+      };
+  params.delete_kernel = [](OpKernel* kernel) {
+    DeleteNonCachedKernel(kernel);
+  };
+  Executor* exec = nullptr;
+  TF_CHECK_OK(NewLocalExecutor(params, *graph, &exec));
+  std::unique_ptr<Executor> exec_holder(exec);
+
+  Rendezvous* rendez = NewLocalRendezvous();
+  Executor::Args args;
+  args.rendezvous = rendez;
+  args.runner = [&pool](std::function<void()> fn) {
+    pool.Schedule(std::move(fn));
+  };
+  for (auto s : state) {
+    TF_CHECK_OK(exec->Run(args));
+  }
+  rendez->Unref();
+
+  state.SetLabel(strings::StrCat("Threads = ", num_threads,
+                                 ", Parallel iterations = ",
+                                 parallel_iterations));
+  state.SetItemsProcessed(static_cast<int64_t>(kLoopIters) * kNumConds *
+                          state.iterations());
+}
+BENCHMARK(BM_ParallelCondLoop)
+    ->UseRealTime()
+    ->ArgPair(1, 1)
+    ->ArgPair(1, 32)
+    ->ArgPair(2, 32)
+    ->ArgPair(4, 32)
+    ->ArgPair(8, 32)
+    ->ArgPair(16, 32)
+    ->ArgPair(32, 32);
 }  // namespace tensorflow
@@ -757,8 +757,10 @@ Status ProcessFunctionLibraryRuntime::InstantiateMultiDevice(
     const FunctionLibraryRuntime::InstantiateOptions& options,
     FunctionLibraryRuntime::Handle* handle) {
   // Check if this function has already been instantiated.
-  const string& function_key = Canonicalize(function_name, attrs, options);
+  const string function_key = Canonicalize(function_name, attrs, options);
 
+  std::shared_ptr<PendingInstantiation> pending;
+  bool is_owner = false;
   {
     mutex_lock l(mu_);
     const auto& it = table_.find(function_key);
@@ -767,8 +769,55 @@ Status ProcessFunctionLibraryRuntime::InstantiateMultiDevice(
       ++mdevice_data_[*handle]->instantiation_counter_;
       return Status::OK();
     }
+    std::shared_ptr<PendingInstantiation>& slot =
+        pending_instantiations_[function_key];
+    if (slot == nullptr) {
+      slot = std::make_shared<PendingInstantiation>();
+      is_owner = true;
+    }
+    pending = slot;
+  }
+
+  if (!is_owner) {
+    // Another thread is instantiating the same function. Wait for it rather
+    // than repeating placement, optimization and partitioning.
+    VLOG(1) << "Waiting for in-flight instantiation of MultiDevice function \""
+            << function_name << "\"";
+    pending->done.WaitForNotification();
+    TF_RETURN_IF_ERROR(pending->status);
+    {
+      mutex_lock l(mu_);
+      const auto& it = table_.find(function_key);
+      if (it != table_.end()) {
+        *handle = it->second;
+        ++mdevice_data_[*handle]->instantiation_counter_;
+        return Status::OK();
+      }
+    }
+    // The handle was released before we could take a reference to it.
+    return InstantiateMultiDevice(function_name, attrs, options, handle);
+  }
+
+  const uint64 start_time_usecs = Env::Default()->NowMicros();
+  Status s = InstantiateMultiDeviceInternal(function_name, attrs, options,
+                                            function_key, handle);
+  if (s.ok()) {
+    metrics::UpdateFunctionInstantiationTime(Env::Default()->NowMicros() -
+                                             start_time_usecs);
   }
+  {
+    mutex_lock l(mu_);
+    pending_instantiations_.erase(function_key);
+  }
+  pending->status = s;
+  pending->done.Notify();
+  return s;
+}
 
+Status ProcessFunctionLibraryRuntime::InstantiateMultiDeviceInternal(
+    const string& function_name, AttrSlice attrs,
+    const FunctionLibraryRuntime::InstantiateOptions& options,
+    const string& function_key, FunctionLibraryRuntime::Handle* handle) {
   VLOG(1) << "Instantiating MultiDevice function \"" << function_name
           << "\" on default device \"" << options.target << "\"";
   if (VLOG_IS_ON(3)) {
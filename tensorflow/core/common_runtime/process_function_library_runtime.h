@@ -16,6 +16,7 @@ limitations under the License.
 #define TENSORFLOW_CORE_COMMON_RUNTIME_PROCESS_FUNCTION_LIBRARY_RUNTIME_H_
 
 #include <functional>
+#include <memory>
 #include <unordered_map>
 
 // clang-format off
@@ -388,6 +389,15 @@ class ProcessFunctionLibraryRuntime {
       const FunctionLibraryRuntime::InstantiateOptions& options,
       FunctionLibraryRuntime::Handle* handle);
 
+  // Runs placement, graph optimization passes and partitioning for a
+  // multi-device function that is not present in `table_`, and registers the
+  // result under `function_key`. Callers must ensure that at most one
+  // instantiation per `function_key` is in flight.
+  Status InstantiateMultiDeviceInternal(
+      const string& function_name, AttrSlice attrs,
+      const FunctionLibraryRuntime::InstantiateOptions& options,
+      const string& function_key, FunctionLibraryRuntime::Handle* handle);
+
   void InstantiateRemote(
       const string& function_name, AttrSlice attrs,
       const FunctionLibraryRuntime::InstantiateOptions& options,
@@ -498,6 +508,14 @@ class ProcessFunctionLibraryRuntime {
     Notification init_done_;
   };
 
+  // Tracks a multi-device instantiation that is in progress, so that
+  // concurrent callers requesting the same function key wait for its result
+  // instead of repeating placement, optimization and partitioning.
+  struct PendingInstantiation {
+    Notification done;
+    Status status;
+  };
+
   mutable mutex mu_;
 
   Env* const env_;
@@ -529,6 +547,11 @@ class ProcessFunctionLibraryRuntime {
                      std::unique_ptr<MultiDeviceFunctionData>>
       mdevice_data_ TF_GUARDED_BY(mu_);
 
+  // Multi-device instantiations that are in flight, keyed by function_key.
+  // Distinct keys are instantiated concurrently.
+  std::unordered_map<string, std::shared_ptr<PendingInstantiation>>
+      pending_instantiations_ TF_GUARDED_BY(mu_);
+
   std::unique_ptr<
       std::unordered_map<Device*, std::unique_ptr<FunctionLibraryRuntime>>>
       flr_map_;
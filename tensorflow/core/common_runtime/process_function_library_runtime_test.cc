@@ -554,6 +554,49 @@ TEST_F(ProcessFunctionLibraryRuntimeTest, ClusterFLRParallelTest) {
   delete tp;
 }
 
+TEST_F(ProcessFunctionLibraryRuntimeTest, MultiDeviceParallelInstantiation) {
+  Init({test::function::XTimesTwo(), test::function::XTimesFour()});
+  FunctionLibraryRuntime::InstantiateOptions instantiate_opts;
+  instantiate_opts.target = "/job:a/replica:0/task:0/device:CPU:0";
+  instantiate_opts.input_devices = {instantiate_opts.target};
+  instantiate_opts.is_multi_device_function = true;
+
+  constexpr int kNumCalls = 32;
+  std::vector<FunctionLibraryRuntime::Handle> handles(
+      2 * kNumCalls, FunctionLibraryRuntime::kInvalidHandle);
+  {
+    thread::ThreadPool tp(Env::Default(), "test", 8);
+    for (int i = 0; i < 2 * kNumCalls; ++i) {
+      tp.Schedule([this, i, &instantiate_opts, &handles]() {
+        const string name = i % 2 == 0 ? "XTimesTwo" : "XTimesFour";
+        TF_CHECK_OK(Instantiate(name, {{"T", DT_FLOAT}}, instantiate_opts,
+                                &handles[i]));
+      });
+    }
+  }
+
+  // Concurrent requests for the same function share a single instantiation.
+  for (int i = 2; i < 2 * kNumCalls; ++i) {
+    EXPECT_EQ(handles[i % 2], handles[i]);
+  }
+  EXPECT_NE(handles[0], handles[1]);
+
+  // Every caller holds a reference to the shared handle, so it stays
+  // registered until the last of them releases it.
+  for (int i = 0; i < kNumCalls - 1; ++i) {
+    TF_EXPECT_OK(proc_flr_->ReleaseHandle(handles[0]));
+  }
+  FunctionLibraryRuntime::Handle h;
+  TF_CHECK_OK(
+      Instantiate("XTimesTwo", {{"T", DT_FLOAT}}, instantiate_opts, &h));
+  EXPECT_EQ(handles[0], h);
+  TF_EXPECT_OK(proc_flr_->ReleaseHandle(h));
+  TF_EXPECT_OK(proc_flr_->ReleaseHandle(h));
+  TF_CHECK_OK(
+      Instantiate("XTimesTwo", {{"T", DT_FLOAT}}, instantiate_opts, &h));
+  EXPECT_NE(handles[0], h);
+}
+
 bool IsCUDATensor(const Tensor& t) {
 #if GOOGLE_CUDA
   cudaPointerAttributes attributes;
@@ -448,7 +448,8 @@ int PropagatorState::FrameState::ActivateNodesFastPathInternal(
 #undef MAYBE_ADD_TO_READY
 }
 
-int PropagatorState::FrameState::ActivateNodesSlowPath(
+template <bool atomic>
+int PropagatorState::FrameState::ActivateNodesSlowPathInternal(
     const NodeItem* item, const bool is_dead, IterationState* iter_state,
     EntryVector* outputs, TaggedNodeSeq* ready) {
   // If any of the edge destinations is a merge or a control trigger node,
@@ -513,7 +514,10 @@ int PropagatorState::FrameState::ActivateNodesSlowPath(
       const bool increment_dead =
           (is_dead || ((*outputs)[src_slot].state == Entry::State::NO_VALUE));
       const PendingCounts::AdjustResult adjust_result =
-          iter_state->adjust_for_activation(dst_pending_id, increment_dead);
+          atomic ? iter_state->adjust_for_activation_atomic(dst_pending_id,
+                                                            increment_dead)
+                 : iter_state->adjust_for_activation(dst_pending_id,
+                                                     increment_dead);
       dst_dead = adjust_result.any_dead;
       dst_ready = !adjust_result.any_pending;
     }
@@ -551,7 +555,10 @@ int PropagatorState::FrameState::ActivateNodesSlowPath(
     } else {
       // Handle all other (non-merge) nodes.
       const PendingCounts::AdjustResult adjust_result =
-          iter_state->adjust_for_activation(dst_pending_id, is_dead);
+          atomic
+              ? iter_state->adjust_for_activation_atomic(dst_pending_id,
+                                                         is_dead)
+              : iter_state->adjust_for_activation(dst_pending_id, is_dead);
       dst_dead = adjust_result.any_dead;
       dst_ready = !adjust_result.any_pending;
     }
@@ -564,16 +571,14 @@ int PropagatorState::FrameState::ActivateNodesSlowPath(
 bool PropagatorState::FrameState::ActivateNodesAndAdjustOutstanding(
     const NodeItem* item, const bool is_dead, IterationState* iter_state,
     EntryVector* outputs, TaggedNodeSeq* ready) {
-  if (TF_PREDICT_FALSE(item->is_any_consumer_merge_or_control_trigger)) {
-    mutex_lock l(mu);
-    int activated =
-        ActivateNodesSlowPath(item, is_dead, iter_state, outputs, ready);
-    return AdjustOutstandingOpsLocked(iter_state, activated - 1, ready);
-  }
   {
     tf_shared_lock l(mu);
     int activated =
-        ActivateNodesFastPathShared(item, is_dead, iter_state, outputs, ready);
+        TF_PREDICT_FALSE(item->is_any_consumer_merge_or_control_trigger)
+            ? ActivateNodesSlowPathShared(item, is_dead, iter_state, outputs,
+                                          ready)
+            : ActivateNodesFastPathShared(item, is_dead, iter_state, outputs,
+                                          ready);
     bool iter_done = AdjustOutstandingOpsFastPath(iter_state, activated - 1);
     if (!iter_done) return false;
   }
@@ -180,6 +180,14 @@ class PropagatorState {
 
     ~IterationState() { delete[] input_tensors; }
 
+    // Serializes the non-atomic updates to the pending counts of merge nodes
+    // in this iteration when the owning frame's `mu` is only held in shared
+    // mode. This lets activations that feed merge or control trigger nodes in
+    // different iterations of the same frame proceed in parallel.
+    //
+    // Lock ordering: FrameState.mu < IterationState.mu.
+    mutex mu;
+
    private:
     PendingCounts counts;
   };
@@ -353,9 +361,10 @@ class PropagatorState {
     // Activate the successors of a node. Contents of *outputs are left in an
     // indeterminate state after returning from this method.
     //
-    // In the case that 'item' is a simple node (no merge/control outputs) this
-    // will acquire a shared lock and can run concurrently with other
-    // invocations.
+    // This acquires a shared lock and can run concurrently with other
+    // invocations. In the case that 'item' has merge or control trigger
+    // outputs, it additionally serializes with other such activations in the
+    // same iteration (but not in other iterations of this frame).
     //
     // Return true if the frame is done after activation.
     bool ActivateNodesAndAdjustOutstanding(const NodeItem* item,
@@ -419,10 +428,35 @@ class PropagatorState {
                                       EntryVector* outputs,
                                       TaggedNodeSeq* ready);
 
+    // REQUIRES: `item->is_any_consumer_merge_or_control_trigger`.
+    // This variant does not use atomic operations to modify the pending counts
+    // and thus must hold the exclusive lock.
     int ActivateNodesSlowPath(const NodeItem* item, const bool is_dead,
                               IterationState* iter_state, EntryVector* outputs,
                               TaggedNodeSeq* ready)
-        TF_EXCLUSIVE_LOCKS_REQUIRED(mu);
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu) {
+      return ActivateNodesSlowPathInternal<false>(item, is_dead, iter_state,
+                                                  outputs, ready);
+    }
+
+    // REQUIRES: `item->is_any_consumer_merge_or_control_trigger`.
+    // This variant holds `iter_state->mu` to serialize updates to merge nodes,
+    // and uses atomic operations to modify the pending counts of all other
+    // nodes, which may be concurrently activated by the fast path.
+    int ActivateNodesSlowPathShared(const NodeItem* item, const bool is_dead,
+                                    IterationState* iter_state,
+                                    EntryVector* outputs, TaggedNodeSeq* ready)
+        TF_SHARED_LOCKS_REQUIRED(mu) {
+      mutex_lock l(iter_state->mu);
+      return ActivateNodesSlowPathInternal<true>(item, is_dead, iter_state,
+                                                 outputs, ready);
+    }
+
+    template <bool atomic>
+    int ActivateNodesSlowPathInternal(const NodeItem* item, const bool is_dead,
+                                      IterationState* iter_state,
+                                      EntryVector* outputs,
+                                      TaggedNodeSeq* ready);
   };
 
  public:
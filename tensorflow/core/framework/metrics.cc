@@ -209,6 +209,25 @@ auto* build_graph_time_usecs = monitoring::Counter<0>::New(
     "spent optimizing the graph with Grappler, and time spent pruning the "
     "sub-graph.");
 
+auto* function_instantiations = monitoring::Counter<0>::New(
+    "/tensorflow/core/function_instantiations",
+    "The number of multi-device functions instantiated by the process "
+    "function library runtime.");
+
+auto* function_instantiation_time_usecs = monitoring::Counter<0>::New(
+    "/tensorflow/core/function_instantiation_time_usecs",
+    "The amount of time spent instantiating multi-device functions in "
+    "microseconds. It includes time spent placing, optimizing and "
+    "partitioning the function graph.");
+
+auto* function_instantiation_time_usecs_histogram =
+    monitoring::Sampler<0>::New(
+        {"/tensorflow/core/function_instantiation_time_usecs_histogram",
+         "The wall-clock time spent instantiating multi-device functions in "
+         "microseconds."},
+        // Power of 2 with bucket count 20 (> 17 minutes)
+        {monitoring::Buckets::Exponential(1000, 2, 20)});
+
 auto* xla_compilations = monitoring::Counter<0>::New(
     "/tensorflow/core/xla_compilations",
     "The number of XLA compilations used to collect "
@@ -452,6 +471,20 @@ void UpdateGraphBuildTime(const uint64 running_time_usecs) {
   }
 }
 
+void UpdateFunctionInstantiationTime(const uint64 running_time_usecs) {
+  if (running_time_usecs > 0) {
+    static auto* function_instantiations_cell =
+        function_instantiations->GetCell();
+    static auto* function_instantiation_time_usecs_cell =
+        function_instantiation_time_usecs->GetCell();
+    static auto* function_instantiation_time_usecs_histogram_cell =
+        function_instantiation_time_usecs_histogram->GetCell();
+    function_instantiations_cell->IncrementBy(1);
+    function_instantiation_time_usecs_cell->IncrementBy(running_time_usecs);
+    function_instantiation_time_usecs_histogram_cell->Add(running_time_usecs);
+  }
+}
+
 void UpdateTpuVariableDistributionTime(const uint64 distribution_time_usecs) {
   if (distribution_time_usecs > 0) {
     tpu_variable_distribution_time_usecs->GetCell()->IncrementBy(
@@ -186,6 +186,11 @@ void RecordUnusedOutput(const string& op_name);
 // TODO(jtkeeling): Should we record building/optimizing tf.functions?
 void UpdateGraphBuildTime(const uint64 running_time_usecs);
 
+// Updates the metrics stored about time spent successfully instantiating
+// multi-device functions, which includes placement, graph optimization passes
+// and partitioning.
+void UpdateFunctionInstantiationTime(const uint64 running_time_usecs);
+
 // Records the status of a graph passing through various states/stages of
 // TfMlirGraphOptimizationPass processing using
 // tf_metadata.tf_mlir_update_graph_optimization_pass_state_counter metric.
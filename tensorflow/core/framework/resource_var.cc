@@ -15,11 +15,54 @@ limitations under the License.
 
 #include "tensorflow/core/framework/resource_var.h"
 
+#include <algorithm>
+
 #include "tensorflow/core/framework/resource_handle.h"
 #include "tensorflow/core/graph/graph_def_builder.h"
 
 namespace tensorflow {
 
+std::atomic<int64_t> Var::num_tracking_dirty_rows_{0};
+
+Var::~Var() {
+  if (tracks_dirty_rows()) {
+    num_tracking_dirty_rows_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  delete row_mutexes_.load(std::memory_order_relaxed);
+}
+
+void Var::SetSparseUpdateMode(SparseUpdateMode mode) {
+  mutex_lock l(mu_);
+  if (mode == SparseUpdateMode::kRowLocks && row_mutexes() == nullptr) {
+    row_mutexes_.store(new RowMutexes, std::memory_order_release);
+  }
+  sparse_update_mode_.store(mode, std::memory_order_release);
+}
+
+void Var::MarkAllRowsDirty() {
+  if (!tracks_dirty_rows()) return;
+  mutex_lock l(dirty_rows_mu_);
+  all_rows_dirty_ = true;
+  dirty_rows_.clear();
+}
+
+void Var::TakeDirtyRows(std::vector<int64_t>* rows, bool* all_rows) {
+  rows->clear();
+  mutex_lock l(dirty_rows_mu_);
+  if (!tracks_dirty_rows_.exchange(true, std::memory_order_acq_rel)) {
+    num_tracking_dirty_rows_.fetch_add(1, std::memory_order_relaxed);
+    *all_rows = true;
+    return;
+  }
+  *all_rows = all_rows_dirty_;
+  if (!all_rows_dirty_) {
+    rows->assign(dirty_rows_.begin(), dirty_rows_.end());
+    std::sort(rows->begin(), rows->end());
+  }
+  all_rows_dirty_ = false;
+  dirty_rows_.clear();
+}
+
 Status Var::AsGraphDef(GraphDefBuilder* builder, Node** out) const {
   Node* var = ops::SourceOp(
       "VarHandleOp",
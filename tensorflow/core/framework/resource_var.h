@@ -16,9 +16,15 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_FRAMEWORK_RESOURCE_VAR_H_
 #define TENSORFLOW_CORE_FRAMEWORK_RESOURCE_VAR_H_
 
+#include <atomic>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/framework/resource_base.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 
 // Forward declarations to avoid introducing a dependency on headers in
 // "tensorflow/core/graph/...".
@@ -26,6 +32,27 @@ class GraphDefBuilder;
 
 namespace tensorflow {
 
+// Mutexes that serialize the concurrent updates of the rows of a variable,
+// i.e. of its indices in the first dimension.  Rows are hashed onto a fixed
+// number of mutexes, so unrelated rows may share a mutex.
+class RowMutexes {
+ public:
+  RowMutexes() = default;
+
+  mutex* ForRow(int64_t row) {
+    // Fibonacci hashing spreads consecutive rows over distant mutexes, which
+    // avoids false sharing between threads updating neighboring rows.
+    const uint64 hash = static_cast<uint64>(row) * 0x9E3779B97F4A7C15ull;
+    return &mutexes_[hash >> (64 - kLogNumMutexes)];
+  }
+
+ private:
+  static constexpr int kLogNumMutexes = 9;
+  mutex mutexes_[1 << kLogNumMutexes];
+
+  TF_DISALLOW_COPY_AND_ASSIGN(RowMutexes);
+};
+
 // Resource stored by variables in the resource manager (new, resource-style
 // version).
 //
@@ -63,6 +90,9 @@ namespace tensorflow {
 // mutex as desired. To access the variable in dense mode grab the mutex either
 // directly or via `MaybeLockVariableInputMutexesInOrder` on all variables being
 // modified and then call `PrepareToUpdateVariable` on them in any order.
+//
+// The sparse update mode of a variable overrides how the sparse training ops
+// lock it, see `SparseUpdateMode`.
 class Var : public ResourceBase {
  public:
   explicit Var(DataType dtype) : tensor_(dtype) {}
@@ -103,14 +133,78 @@ class Var : public ResourceBase {
   // so desired.
   std::atomic<bool> copy_on_read_mode{false};
 
+  // Tracking of the rows, i.e. the indices in the first dimension, that were
+  // updated since the last TakeDirtyRows(), for delta checkpoints.  Tracking
+  // starts with the first TakeDirtyRows(), which reports every row as dirty.
+  // Until then, MarkRowsDirty() and MarkAllRowsDirty() do nothing.  These
+  // methods are thread-safe and do not require mu().
+  bool tracks_dirty_rows() const {
+    return tracks_dirty_rows_.load(std::memory_order_acquire);
+  }
+  template <typename Index>
+  void MarkRowsDirty(const Index* rows, int64_t num_rows);
+  void MarkAllRowsDirty();
+  // Returns the sorted dirty rows in "rows", or sets "*all_rows" if every
+  // row may be dirty, and starts tracking anew.
+  void TakeDirtyRows(std::vector<int64_t>* rows, bool* all_rows);
+
+  // The number of live variables that track dirty rows.  Updates may skip
+  // looking up their variables when it is 0.
+  static int64_t NumTrackingDirtyRows() {
+    return num_tracking_dirty_rows_.load(std::memory_order_relaxed);
+  }
+
+  // How the sparse training ops (e.g. ResourceSparseApplyAdagrad) synchronize
+  // their updates of the variable with each other:
+  //  - kDefault: as the `use_locking` attribute of the op says, by holding mu()
+  //    exclusively for the whole update, or shared ("hogwild").
+  //  - kRowLocks: by holding mu() shared, and the row mutexes of the updated
+  //    rows while updating them.  Updates of distinct rows run concurrently,
+  //    but a row is never updated by two ops at a time.
+  //  - kLockFree: by holding mu() shared only, regardless of `use_locking`.
+  // The slots of the variable (e.g. the Adagrad accumulator) are updated under
+  // the locks of the variable.
+  enum class SparseUpdateMode { kDefault, kRowLocks, kLockFree };
+  SparseUpdateMode sparse_update_mode() const {
+    return sparse_update_mode_.load(std::memory_order_acquire);
+  }
+  // Takes mu() exclusively, so that no update is in flight.
+  void SetSparseUpdateMode(SparseUpdateMode mode);
+  // The row mutexes, once the variable was switched to kRowLocks mode, and
+  // nullptr before.  They live as long as the variable.
+  RowMutexes* row_mutexes() {
+    return row_mutexes_.load(std::memory_order_acquire);
+  }
+
  private:
   mutex mu_;
   Tensor tensor_;
 
-  ~Var() override {}
+  std::atomic<SparseUpdateMode> sparse_update_mode_{
+      SparseUpdateMode::kDefault};
+  // Owned.  Allocated by the first switch to kRowLocks mode, and released by
+  // the destructor only, so that updates that read an older mode can still
+  // use them.
+  std::atomic<RowMutexes*> row_mutexes_{nullptr};
+
+  std::atomic<bool> tracks_dirty_rows_{false};
+  mutex dirty_rows_mu_;
+  bool all_rows_dirty_ TF_GUARDED_BY(dirty_rows_mu_) = false;
+  absl::flat_hash_set<int64_t> dirty_rows_ TF_GUARDED_BY(dirty_rows_mu_);
+  static std::atomic<int64_t> num_tracking_dirty_rows_;
+
+  ~Var() override;
   TF_DISALLOW_COPY_AND_ASSIGN(Var);
 };
 
+template <typename Index>
+void Var::MarkRowsDirty(const Index* rows, int64_t num_rows) {
+  if (!tracks_dirty_rows()) return;
+  mutex_lock l(dirty_rows_mu_);
+  if (all_rows_dirty_) return;
+  dirty_rows_.insert(rows, rows + num_rows);
+}
+
 // Does unlock and unref automatically when going out of scope, and also
 // supports early manual release.
 class TF_SCOPED_LOCKABLE ScopedUnlockUnrefVar {
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/framework/resource_var.h"
 
+#include <vector>
+
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
 
@@ -34,5 +36,59 @@ TEST(ResourceVarTest, Uninitialize) {
   EXPECT_FALSE(var->is_initialized);
   EXPECT_TRUE(var->tensor()->data() == nullptr);
 }
+
+TEST(ResourceVarTest, DirtyRows) {
+  RefCountPtr<Var> var{new Var(DT_FLOAT)};
+  const int64_t rows[] = {5, 1, 5, 3};
+  std::vector<int64_t> dirty_rows;
+  bool all_rows;
+
+  // Not tracked until the first TakeDirtyRows(), which reports every row.
+  var->MarkRowsDirty(rows, 2);
+  EXPECT_FALSE(var->tracks_dirty_rows());
+  const int64_t num_tracking = Var::NumTrackingDirtyRows();
+  var->TakeDirtyRows(&dirty_rows, &all_rows);
+  EXPECT_TRUE(var->tracks_dirty_rows());
+  EXPECT_EQ(num_tracking + 1, Var::NumTrackingDirtyRows());
+  EXPECT_TRUE(all_rows);
+
+  var->MarkRowsDirty(rows, 4);
+  var->TakeDirtyRows(&dirty_rows, &all_rows);
+  EXPECT_FALSE(all_rows);
+  EXPECT_EQ(dirty_rows, std::vector<int64_t>({1, 3, 5}));
+
+  var->TakeDirtyRows(&dirty_rows, &all_rows);
+  EXPECT_FALSE(all_rows);
+  EXPECT_TRUE(dirty_rows.empty());
+
+  var->MarkRowsDirty(rows, 1);
+  var->MarkAllRowsDirty();
+  var->MarkRowsDirty(rows, 1);
+  var->TakeDirtyRows(&dirty_rows, &all_rows);
+  EXPECT_TRUE(all_rows);
+  EXPECT_TRUE(dirty_rows.empty());
+
+  var.reset();
+  EXPECT_EQ(num_tracking, Var::NumTrackingDirtyRows());
+}
+
+TEST(ResourceVarTest, SparseUpdateMode) {
+  RefCountPtr<Var> var{new Var(DT_FLOAT)};
+  EXPECT_EQ(var->sparse_update_mode(), Var::SparseUpdateMode::kDefault);
+  EXPECT_EQ(var->row_mutexes(), nullptr);
+
+  var->SetSparseUpdateMode(Var::SparseUpdateMode::kRowLocks);
+  EXPECT_EQ(var->sparse_update_mode(), Var::SparseUpdateMode::kRowLocks);
+  RowMutexes* row_mutexes = var->row_mutexes();
+  ASSERT_NE(row_mutexes, nullptr);
+  EXPECT_EQ(row_mutexes->ForRow(7), row_mutexes->ForRow(7));
+  EXPECT_NE(row_mutexes->ForRow(7), row_mutexes->ForRow(8));
+
+  // The row mutexes outlive switches to other modes.
+  var->SetSparseUpdateMode(Var::SparseUpdateMode::kLockFree);
+  EXPECT_EQ(var->sparse_update_mode(), Var::SparseUpdateMode::kLockFree);
+  var->SetSparseUpdateMode(Var::SparseUpdateMode::kRowLocks);
+  EXPECT_EQ(var->row_mutexes(), row_mutexes);
+}
 }  // namespace core
 }  // namespace tensorflow
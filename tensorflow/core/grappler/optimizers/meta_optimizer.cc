@@ -53,7 +53,9 @@ limitations under the License.
 #include "tensorflow/core/grappler/verifiers/structure_verifier.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/util/dump_graph.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/ptr_util.h"
 #include "tensorflow/core/util/util.h"
 #include "tensorflow/core/util/xla_config_registry.h"
@@ -87,6 +89,20 @@ string PrintSizesBeforeAfter(const GraphDef& before, const GraphDef& after) {
                          NumEdges(after) - NumEdges(before), ")");
 }
 
+// Returns the number of threads used to optimize independent function bodies
+// of the function library. Function optimization is sequential by default.
+int64_t NumFunctionOptimizationThreads() {
+  int64_t num_threads;
+  Status status = ReadInt64FromEnvVar(
+      "TF_GRAPPLER_FUNCTION_OPTIMIZATION_THREADS", 1, &num_threads);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to read TF_GRAPPLER_FUNCTION_OPTIMIZATION_THREADS: "
+               << status;
+    return 1;
+  }
+  return std::max<int64_t>(num_threads, 1);
+}
+
 int NumIterations(const RewriterConfig& cfg) {
   return cfg.meta_optimizer_iterations() == RewriterConfig::DEFAULT_NUM_ITERS
              ? kDefaultNumberOfIterations
@@ -701,6 +717,13 @@ void MetaOptimizer::PrintUserAndPluginConfigs(
 
 Status MetaOptimizer::OptimizeGraph(Cluster* cluster, GrapplerItem&& item,
                                     GraphDef* optimized_graph) {
+  return OptimizeGraph(cluster, std::move(item), optimized_graph,
+                       &optimization_results_);
+}
+
+Status MetaOptimizer::OptimizeGraph(
+    Cluster* cluster, GrapplerItem&& item, GraphDef* optimized_graph,
+    std::vector<GraphOptimizationResult>* optimization_results) {
   int min_graph_nodes = cfg_.min_graph_nodes() == 0 ? kDefaultMinGraphNodes
                                                     : cfg_.min_graph_nodes();
   if (item.graph.node_size() < min_graph_nodes) {
@@ -842,7 +865,7 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, GrapplerItem&& item,
                                    }) != optimization_result.results.end();
 
   // Record graph optimization result.
-  optimization_results_.push_back(optimization_result);
+  optimization_results->push_back(optimization_result);
 
   if (is_optimized) {
     TF_RETURN_IF_ERROR(TopologicalSort(optimized_graph));
@@ -915,7 +938,8 @@ Status MetaOptimizer::RunOptimizer(
         optimized_graph_function_library.release());
   }
 
-  OptimizerResult optimizer_result{optimizer->name(), message, status};
+  OptimizerResult optimizer_result{optimizer->name(), message, status,
+                                   duration_ms};
   optimization_result->results.push_back(optimizer_result);
 
   if (!status.ok() && cfg_.fail_on_optimizer_errors()) return status;
@@ -1092,11 +1116,112 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
   // Propagate `_tf_data_function` attributes from functions to their callees.
   PropagateTFDataAttrs(flib, *optimized_graph->mutable_library());
 
+  // Optimizing functions of TPU graphs is limited to implementation selection
+  // (see below). Recomputed at the start of every pass over the library.
+  bool is_tpu_graph = false;
+
+  // Optimizes a single function body against the current state of `flib`.
+  // Function bodies only read `flib`, so independent functions can be
+  // optimized concurrently.
+  const auto optimize_function = [&](const FunctionDef& func,
+                                     FunctionOptimizationTask* task) -> Status {
+    GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
+    const string& func_name = func.signature().name();
+
+    // Make a GrapplerItem from a FunctionDef.
+    GrapplerFunctionItem& func_item = task->func_item;
+    TF_RETURN_IF_ERROR(
+        MakeGrapplerFunctionItem(func, flib, producer, &func_item));
+
+    // If we need to compute the gradient of optimized function at runtime, we
+    // can't perform non-differentiable rewrites.
+    func_item.optimization_options().allow_non_differentiable_rewrites =
+        !differentiable_functions.contains(func_name);
+
+    // Device set available to the function is defined only by the runtime,
+    // when we instantiate and execute the function. We can't use all devices
+    // available to the main graph, because after partitioning the function
+    // call node might execute on a remote worker.
+    if (!func_item.devices().empty()) {
+      return errors::Internal("GrapplerFunctionItem devices must be empty.");
+    }
+
+    // We are not allowed to prune certain types of ops from the graph
+    // instantiated by the function definition, because we must guarantee
+    // function execution semantics wrt side effects (see
+    // function_optimizer.cc).
+    func_item.optimization_options().allow_pruning_stateful_and_dataset_ops =
+        false;
+
+    // Optimize function body graph.
+    if (is_tpu_graph) {
+      // Skip optimizing functions if this is a TPU graph. Currently, Grappler
+      // passes do not handle TPU functions correctly in a variety of ways
+      // (Note that due to the pre-placement TPU graph rewriting passes, the
+      // TPU-related ops are encapsulated away into functions). For example,
+      // TPU graphs contain TPUReplicateMetadata node that carries relevant
+      // TPU metadata and Grappler passes could prune that away. Grappler
+      // passes could also cause issues around shape inference. Since the
+      // desired and existing behavior is to not optimize TPU functions with
+      // Grappler, this check preserves that. The only exception is
+      // implementation selector what is required to swap in some TPU specific
+      // lowering code and is verified the work correctly on TPUs.
+      ImplementationSelector implementation_selector;
+
+      // Implementation selector needs to have access to valid function
+      // signature and attributes, and it doesn't need actual function body.
+      std::unique_ptr<FunctionDefLibrary> func_item_function_library(
+          func_item.graph.release_library());
+      *func_item.graph.mutable_library() =
+          GetFunctionDefLibraryStub(*func_item_function_library);
+
+      TF_RETURN_IF_ERROR(implementation_selector.Optimize(
+          cluster, func_item, &task->optimized_func_graph));
+    } else {
+      GrapplerFunctionItem func_item_copy = func_item;
+      TF_RETURN_IF_ERROR(OptimizeGraph(cluster, std::move(func_item_copy),
+                                       &task->optimized_func_graph,
+                                       &task->optimization_results));
+    }
+    return Status::OK();
+  };
+
+  // Writes an optimized function body back into `flib`. Must be called in
+  // library order to keep the optimized library deterministic.
+  const auto apply_optimized_function =
+      [&](const string& func_name, FunctionOptimizationTask* task) -> Status {
+    optimization_results_.insert(
+        optimization_results_.end(),
+        std::make_move_iterator(task->optimization_results.begin()),
+        std::make_move_iterator(task->optimization_results.end()));
+
+    // Function body optimization might have created new specialized
+    // functions for each instantiation context. Add them to the library.
+    for (const FunctionDef& func_def :
+         task->optimized_func_graph.library().function()) {
+      if (flib.Find(func_def.signature().name()) == nullptr) {
+        TF_RETURN_IF_ERROR(flib.AddFunctionDef(func_def));
+      }
+    }
+
+    // Convert optimized graph back to FunctionDef.
+    FunctionDef optimized_func;
+    task->func_item.SwapFunctionBody(std::move(task->optimized_func_graph));
+    TF_RETURN_IF_ERROR(MakeFunctionDef(task->func_item, flib, &optimized_func));
+
+    // Replace optimized function with a new FunctionDef.
+    return flib.ReplaceFunction(func_name, optimized_func);
+  };
+
+  const int64_t num_function_threads = NumFunctionOptimizationThreads();
+
   // Optimize each function only once.
   absl::flat_hash_set<string> optimized_funcs;
   while (optimize_function_library) {
     optimize_function_library = false;
+    is_tpu_graph = IsTPUGraphDef(*optimized_graph);
 
+    std::vector<const FunctionDef*> funcs_to_optimize;
     int function_idx = 0;
     for (const FunctionDef& func : optimized_graph->library().function()) {
       GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
@@ -1128,79 +1253,40 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
       // have to reset the flag and do at least one more pass over the library.
       optimize_function_library = true;
       optimized_funcs.insert(func_name);
+      funcs_to_optimize.push_back(&func);
+    }
 
-      // Make a GrapplerItem from a FunctionDef.
-      GrapplerFunctionItem func_item;
-      TF_RETURN_IF_ERROR(
-          MakeGrapplerFunctionItem(func, flib, producer, &func_item));
-
-      // If we need to compute the gradient of optimized function at runtime, we
-      // can't perform non-differentiable rewrites.
-      func_item.optimization_options().allow_non_differentiable_rewrites =
-          !differentiable_functions.contains(func_name);
-
-      // Device set available to the function is defined only by the runtime,
-      // when we instantiate and execute the function. We can't use all devices
-      // available to the main graph, because after partitioning the function
-      // call node might execute on a remote worker.
-      if (!func_item.devices().empty()) {
-        return errors::Internal("GrapplerFunctionItem devices must be empty.");
+    if (num_function_threads > 1 && funcs_to_optimize.size() > 1) {
+      // Optimize all function bodies of this pass concurrently against the
+      // library as it was at the start of the pass, then apply the results in
+      // library order. Functions that were specialized by a sibling in the same
+      // pass are picked up by the next pass.
+      VLOG(2) << "Optimizing " << funcs_to_optimize.size()
+              << " functions using " << num_function_threads << " threads.";
+      std::vector<FunctionOptimizationTask> tasks(funcs_to_optimize.size());
+      {
+        thread::ThreadPool pool(
+            Env::Default(), "grappler_function_optimizer",
+            std::min<int64_t>(num_function_threads, tasks.size()));
+        for (size_t i = 0; i < tasks.size(); ++i) {
+          pool.Schedule([&optimize_function, &funcs_to_optimize, &tasks, i]() {
+            tasks[i].status =
+                optimize_function(*funcs_to_optimize[i], &tasks[i]);
+          });
+        }
       }
-
-      // We are not allowed to prune certain types of ops from the graph
-      // instantiated by the function definition, because we must guarantee
-      // function execution semantics wrt side effects (see
-      // function_optimizer.cc).
-      func_item.optimization_options().allow_pruning_stateful_and_dataset_ops =
-          false;
-
-      // Optimize function body graph.
-      GraphDef optimized_func_graph;
-      if (IsTPUGraphDef(*optimized_graph)) {
-        // Skip optimizing functions if this is a TPU graph. Currently, Grappler
-        // passes do not handle TPU functions correctly in a variety of ways
-        // (Note that due to the pre-placement TPU graph rewriting passes, the
-        // TPU-related ops are encapsulated away into functions). For example,
-        // TPU graphs contain TPUReplicateMetadata node that carries relevant
-        // TPU metadata and Grappler passes could prune that away. Grappler
-        // passes could also cause issues around shape inference. Since the
-        // desired and existing behavior is to not optimize TPU functions with
-        // Grappler, this check preserves that. The only exception is
-        // implementation selector what is required to swap in some TPU specific
-        // lowering code and is verified the work correctly on TPUs.
-        ImplementationSelector implementation_selector;
-
-        // Implementation selector needs to have access to valid function
-        // signature and attributes, and it doesn't need actual function body.
-        std::unique_ptr<FunctionDefLibrary> func_item_function_library(
-            func_item.graph.release_library());
-        *func_item.graph.mutable_library() =
-            GetFunctionDefLibraryStub(*func_item_function_library);
-
-        TF_RETURN_IF_ERROR(implementation_selector.Optimize(
-            cluster, func_item, &optimized_func_graph));
-      } else {
-        GrapplerFunctionItem func_item_copy = func_item;
-        TF_RETURN_IF_ERROR(OptimizeGraph(cluster, std::move(func_item_copy),
-                                         &optimized_func_graph));
+      for (size_t i = 0; i < tasks.size(); ++i) {
+        TF_RETURN_IF_ERROR(tasks[i].status);
+        TF_RETURN_IF_ERROR(apply_optimized_function(
+            funcs_to_optimize[i]->signature().name(), &tasks[i]));
       }
-
-      // Function body optimization might have created new specialized
-      // functions for each instantiation context. Add them to the library.
-      for (const FunctionDef& func_def :
-           optimized_func_graph.library().function()) {
-        if (flib.Find(func_def.signature().name()) == nullptr) {
-          TF_RETURN_IF_ERROR(flib.AddFunctionDef(func_def));
-        }
+    } else {
+      for (const FunctionDef* func : funcs_to_optimize) {
+        FunctionOptimizationTask task;
+        TF_RETURN_IF_ERROR(optimize_function(*func, &task));
+        TF_RETURN_IF_ERROR(
+            apply_optimized_function(func->signature().name(), &task));
       }
-
-      // Convert optimized graph back to FunctionDef.
-      FunctionDef optimized_func;
-      func_item.SwapFunctionBody(std::move(optimized_func_graph));
-      TF_RETURN_IF_ERROR(MakeFunctionDef(func_item, flib, &optimized_func));
-
-      // Replace optimized function with a new FunctionDef.
-      TF_RETURN_IF_ERROR(flib.ReplaceFunction(func_name, optimized_func));
     }
 
     // If optimized at least one function, update the graph library.
@@ -1236,7 +1322,35 @@ string MetaOptimizer::GetResultString() const {
   return result_string;
 }
 
-void MetaOptimizer::PrintResult() { VLOG(1) << GetResultString(); }
+string MetaOptimizer::GetTimingReportString() const {
+  std::string result_string;
+  std::map<string, double> optimizer_total_ms;
+  for (const GraphOptimizationResult& graph_result : optimization_results_) {
+    double item_total_ms = 0;
+    for (const OptimizerResult& result : graph_result.results) {
+      item_total_ms += result.duration_ms;
+      optimizer_total_ms[result.optimizer_name] += result.duration_ms;
+    }
+    absl::StrAppend(&result_string,
+                    "Optimization time for grappler item: ", graph_result.id,
+                    " = ", item_total_ms, "ms.\n");
+    for (const OptimizerResult& result : graph_result.results) {
+      absl::StrAppend(&result_string, "  ", result.optimizer_name, ": ",
+                      result.duration_ms, "ms.\n");
+    }
+  }
+  absl::StrAppend(&result_string, "Total optimization time per optimizer:\n");
+  for (const auto& optimizer_time : optimizer_total_ms) {
+    absl::StrAppend(&result_string, "  ", optimizer_time.first, ": ",
+                    optimizer_time.second, "ms.\n");
+  }
+  return result_string;
+}
+
+void MetaOptimizer::PrintResult() {
+  VLOG(1) << GetResultString();
+  VLOG(2) << GetTimingReportString();
+}
 
 bool MetaOptimizerEnabled(const ConfigProto& cfg) {
   const auto& rewrite_cfg = cfg.graph_options().rewrite_options();
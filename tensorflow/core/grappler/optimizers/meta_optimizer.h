@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/grappler/utils/functions.h"
 #include "tensorflow/core/grappler/verifiers/graph_verifier.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/protobuf/config.pb.h"
@@ -52,6 +53,11 @@ class MetaOptimizer : public GraphOptimizer {
 
   string GetResultString() const;
 
+  // Returns the time spent by every optimizer on every optimized grappler item
+  // (the main graph and each function body), followed by the total time spent
+  // in each optimizer.
+  string GetTimingReportString() const;
+
   void PrintResult();
 
  private:
@@ -103,6 +109,7 @@ class MetaOptimizer : public GraphOptimizer {
     string optimizer_name;
     string message;
     Status status;
+    double duration_ms = 0;
   };
 
   struct GraphOptimizationResult {
@@ -115,6 +122,21 @@ class MetaOptimizer : public GraphOptimizer {
                       GrapplerItem* optimized_item, GraphDef* optimized_graph,
                       GraphOptimizationResult* optimization_result);
 
+  // Same as above, but appends the optimization result to
+  // `optimization_results` instead of `optimization_results_`, so that
+  // function bodies can be optimized concurrently.
+  Status OptimizeGraph(
+      Cluster* cluster, GrapplerItem&& item, GraphDef* optimized_graph,
+      std::vector<GraphOptimizationResult>* optimization_results);
+
+  // State for optimizing a single function body of the function library.
+  struct FunctionOptimizationTask {
+    GrapplerFunctionItem func_item;
+    GraphDef optimized_func_graph;
+    std::vector<GraphOptimizationResult> optimization_results;
+    Status status;
+  };
+
   std::vector<GraphOptimizationResult> optimization_results_;
 };
 
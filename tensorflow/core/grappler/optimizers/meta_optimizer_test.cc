@@ -18,6 +18,7 @@ limitations under the License.
 #include <atomic>
 
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/framework/dataset.h"
@@ -420,6 +421,82 @@ TEST_F(MetaOptimizerTest, OptimizeFunctionLibrary) {
   test::ExpectTensorEqual<int>(tensors_expected[1], tensors[1]);
 }
 
+TEST_F(MetaOptimizerTest, OptimizeFunctionLibraryInParallel) {
+  using test::function::NDef;
+
+  ConfigProto config_proto;
+  auto& rewriter_config =
+      *config_proto.mutable_graph_options()->mutable_rewrite_options();
+
+  rewriter_config.set_meta_optimizer_iterations(RewriterConfig::TWO);
+  rewriter_config.set_function_optimization(RewriterConfig::ON);
+  rewriter_config.add_optimizers("function");
+  rewriter_config.add_optimizers("constfold");
+  rewriter_config.set_min_graph_nodes(-1);
+
+  // Define a library of independent non-inlinable functions:
+  //
+  //   *MyMulAdd_i(x, y) = Identity(x * y) + x
+  //
+  //  * - marked as noinline
+  constexpr int kNumFunctions = 16;
+  std::vector<FunctionDef> funcs;
+  std::vector<NodeDef> nodes = {
+      NDef("a", "Placeholder", {}, {{"dtype", DT_FLOAT}}, kDevice),
+      NDef("b", "Placeholder", {}, {{"dtype", DT_FLOAT}}, kDevice)};
+  for (int i = 0; i < kNumFunctions; ++i) {
+    const string name = absl::StrCat("MyMulAdd_", i);
+    FunctionDef func = FunctionDefHelper::Create(
+        name, {"x:float", "y:float"}, {"z:float"}, {},
+        {{{"mul"}, "Mul", {"x", "y"}, {{"T", DT_FLOAT}}},
+         {{"id"}, "Identity", {"mul:z:0"}, {{"T", DT_FLOAT}}},
+         {{"add"}, "Add", {"id:output:0", "x"}, {{"T", DT_FLOAT}}}},
+        /*ret_def=*/
+        {{"z", "add:z:0"}});
+    (*func.mutable_attr())["_noinline"].set_b(true);
+    funcs.push_back(func);
+    nodes.push_back(NDef(absl::StrCat("call_", i), name, {"a", "b"}, {},
+                         kDevice));
+  }
+
+  GrapplerItem item;
+  item.id = "tf_graph";
+  item.graph = test::function::GDef(nodes, funcs);
+
+  const auto optimize = [&](const char* num_threads) -> GraphDef {
+    setenv("TF_GRAPPLER_FUNCTION_OPTIMIZATION_THREADS", num_threads,
+           1 /* replace */);
+    MetaOptimizer optimizer(nullptr, config_proto);
+    GraphDef output;
+    TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+    EXPECT_TRUE(absl::StrContains(optimizer.GetTimingReportString(),
+                                  "Total optimization time per optimizer"));
+    unsetenv("TF_GRAPPLER_FUNCTION_OPTIMIZATION_THREADS");
+    return output;
+  };
+
+  const GraphDef sequential = optimize("1");
+  const GraphDef parallel = optimize("4");
+  const GraphDef parallel_again = optimize("4");
+
+  // Optimizing independent functions concurrently must produce the same
+  // function library, in the same order, as optimizing them one by one.
+  CompareGraphs(sequential, parallel);
+  CompareGraphs(parallel, parallel_again);
+  ASSERT_EQ(sequential.library().function_size(),
+            parallel.library().function_size());
+  for (int i = 0; i < sequential.library().function_size(); ++i) {
+    EXPECT_EQ(sequential.library().function(i).signature().name(),
+              parallel.library().function(i).signature().name());
+    EXPECT_EQ(parallel.library().function(i).signature().name(),
+              parallel_again.library().function(i).signature().name());
+    EXPECT_TRUE(FunctionDefsEqual(sequential.library().function(i),
+                                  parallel.library().function(i)));
+    EXPECT_TRUE(FunctionDefsEqual(parallel.library().function(i),
+                                  parallel_again.library().function(i)));
+  }
+}
+
 TEST_F(MetaOptimizerTest, OptimizeFunctionLibraryPruneUnusedOutputs) {
   using test::function::NDef;
 
@@ -59,6 +59,12 @@ namespace grappler {
 //
 // Sigmoid + Mul -> _MklSwish  // This fusion only works on Intel CPU.
 //
+// GatherV2 + SparseSegment{Sum,Mean,SqrtN} -> _FusedEmbeddingLookupSparse
+//   This fusion only works on CPU.
+//
+// StaticRegexFullMatch x N (same input) -> _StaticRegexFullMatchSet
+//   This fusion only works on CPU.
+//
 //
 // In all cases, the supported activation functions are Relu, Relu6, and Elu.
 //
@@ -73,6 +79,8 @@ constexpr char kFusedDepthwiseConv2dNative[] = "_FusedDepthwiseConv2dNative";
 constexpr char kFusedBatchNormEx[] = "_FusedBatchNormEx";
 constexpr char kFusedBatchNormGradEx[] = "_FusedBatchNormGradEx";
 constexpr char kTensorToHashBucket[] = "_TensorToHashBucketFast";
+constexpr char kFusedEmbeddingLookupSparse[] = "_FusedEmbeddingLookupSparse";
+constexpr char kStaticRegexFullMatchSet[] = "_StaticRegexFullMatchSet";
 
 constexpr char kDataFormat[] = "data_format";
 constexpr char kIsTraining[] = "is_training";
@@ -143,6 +151,25 @@ struct TensorToHashBucket {
   int string_to_hash_bucket = kMissingIndex;
 };
 
+// GatherV2 of embedding rows combined by a SparseSegment{Sum,Mean,SqrtN} that
+// can be replaced with _FusedEmbeddingLookupSparse, which does not materialize
+// the gathered rows.
+struct EmbeddingLookupSparse {
+  EmbeddingLookupSparse() = default;
+  EmbeddingLookupSparse(int gather, int segment_reduction)
+      : gather(gather), segment_reduction(segment_reduction) {}
+
+  int gather = kMissingIndex;
+  int segment_reduction = kMissingIndex;
+};
+
+// StaticRegexFullMatch nodes that match the same tensor against different
+// patterns, and can be replaced with one _StaticRegexFullMatchSet that scans
+// every element once.
+struct RegexFullMatchSet {
+  std::vector<int> regex_full_matches;
+};
+
 // Contraction node followed by a BiasAdd.
 struct ContractionWithBiasAdd {
   ContractionWithBiasAdd() = default;
@@ -1667,6 +1694,108 @@ bool FindTensorToHashBucket(const RemapperContext& ctx, int node_index,
   return true;
 }
 
+// Returns the _FusedEmbeddingLookupSparse combiner of a sparse segment
+// reduction, or nullptr if `node` is not one.
+const char* GetEmbeddingCombiner(const NodeDef& node) {
+  if (node.op() == "SparseSegmentSum") return "sum";
+  if (node.op() == "SparseSegmentMean") return "mean";
+  if (node.op() == "SparseSegmentSqrtN") return "sqrtn";
+  return nullptr;
+}
+
+bool FindEmbeddingLookupSparse(const RemapperContext& ctx, int node_index,
+                               EmbeddingLookupSparse* matched) {
+  // Root of the pattern must be a SparseSegment{Sum,Mean,SqrtN} on CPU.
+  const auto* node_view = ctx.graph_view.GetNode(node_index);
+  const auto* node_def = node_view->node();
+  if (GetEmbeddingCombiner(*node_def) == nullptr || !NodeIsOnCpu(node_def) ||
+      HasControlFaninOrFanout(*node_view) ||
+      node_view->NumRegularFanins() != 3)
+    return false;
+  if (!HasDataType(node_def, DT_FLOAT) && !HasDataType(node_def, DT_DOUBLE))
+    return false;
+
+  // Input to the reduction must be a GatherV2 of whole rows (axis 0, no batch
+  // dimensions) that is not used anywhere else. It must run on the device of
+  // the reduction: a gather placed next to its table, e.g. on a parameter
+  // server, must not be fused into an op reading the whole table remotely.
+  const auto* gather_node_view = node_view->GetRegularFanin(0).node_view();
+  const auto* gather_node_def = gather_node_view->node();
+  if (gather_node_def->op() != "GatherV2" || !NodeIsOnCpu(gather_node_def) ||
+      gather_node_def->device() != node_def->device() ||
+      HasControlFaninOrFanout(*gather_node_view) ||
+      !HasAtMostOneFanoutAtPort0(*gather_node_view) ||
+      IsInPreserveSet(ctx, gather_node_def) ||
+      gather_node_view->NumRegularFanins() != 3)
+    return false;
+
+  int batch_dims = 0;
+  if (TryGetNodeAttr(*gather_node_def, "batch_dims", &batch_dims) &&
+      batch_dims != 0)
+    return false;
+
+  const auto* axis_node_def =
+      gather_node_view->GetRegularFanin(2).node_view()->node();
+  Tensor axis;
+  if (!IsConstant(*axis_node_def) || !HasNodeAttr(*axis_node_def, "value") ||
+      !axis.FromProto(axis_node_def->attr().at("value").tensor()) ||
+      axis.NumElements() != 1)
+    return false;
+  const int64_t axis_value = axis.dtype() == DT_INT32
+                                 ? axis.flat<int32>()(0)
+                                 : axis.flat<int64_t>()(0);
+  if (axis_value != 0) return false;
+
+  // The fused op reads ids and indices with the same index type, and only
+  // supports one-dimensional ids.
+  if (GetDataTypeFromAttr(*gather_node_def, "Tindices") !=
+      GetDataTypeFromAttr(*node_def, "Tidx"))
+    return false;
+  const auto& props =
+      ctx.graph_properties.GetInputProperties(gather_node_def->name());
+  if (props.size() < 2 || props[1].shape().unknown_rank() ||
+      props[1].shape().dim_size() != 1)
+    return false;
+
+  const EmbeddingLookupSparse pattern{gather_node_view->node_index(),
+                                      node_index};
+  *matched = pattern;
+
+  return true;
+}
+
+bool IsFusableRegexFullMatch(const utils::MutableNodeView& node_view) {
+  const auto* node_def = node_view.node();
+  return node_def->op() == "StaticRegexFullMatch" && NodeIsOnCpu(node_def) &&
+         !HasControlFaninOrFanout(node_view) &&
+         node_view.NumRegularFanins() == 1;
+}
+
+bool FindRegexFullMatchSet(const RemapperContext& ctx, int node_index,
+                           RegexFullMatchSet* matched) {
+  // Root of the pattern must be a StaticRegexFullMatch on CPU.
+  const auto* node_view = ctx.graph_view.GetNode(node_index);
+  if (!IsFusableRegexFullMatch(*node_view)) return false;
+
+  // Collect every StaticRegexFullMatch on the same device that reads the same
+  // tensor, including the root.
+  const auto& input = node_view->GetRegularFanin(0);
+  std::vector<int> regex_full_matches;
+  for (const auto& fanout :
+       input.node_view()->GetRegularFanout(input.index())) {
+    const auto* fanout_node_view = fanout.node_view();
+    if (IsFusableRegexFullMatch(*fanout_node_view) &&
+        fanout_node_view->node()->device() == node_view->node()->device()) {
+      regex_full_matches.push_back(fanout_node_view->node_index());
+    }
+  }
+  if (regex_full_matches.size() < 2) return false;
+
+  matched->regex_full_matches = std::move(regex_full_matches);
+
+  return true;
+}
+
 bool FindFusedBatchMatMul(RemapperContext* ctx, int node_index,
                           std::map<string, int>* matched_nodes_map,
                           std::set<int>* remove_node_indices) {
@@ -2723,6 +2852,103 @@ Status AddTensorToHashBucketNode(RemapperContext* ctx,
   return Status::OK();
 }
 
+Status AddEmbeddingLookupSparseNode(RemapperContext* ctx,
+                                   const EmbeddingLookupSparse& matched,
+                                   std::vector<bool>* invalidated_nodes,
+                                   std::vector<bool>* nodes_to_delete) {
+  const GraphDef* graph = ctx->graph_view.graph();
+  const NodeDef& gather = graph->node(matched.gather);
+  const NodeDef& segment_reduction = graph->node(matched.segment_reduction);
+  VLOG(2) << "Fuse GatherV2 with " << segment_reduction.op() << ":"
+          << " gather=" << gather.name()
+          << " segment_reduction=" << segment_reduction.name()
+          << " on device=" << segment_reduction.device();
+
+  NodeDef fused_op;
+  fused_op.set_name(segment_reduction.name());
+  fused_op.set_device(segment_reduction.device());
+  fused_op.add_input(gather.input(0));             // 0: params
+  fused_op.add_input(gather.input(1));             // 1: ids
+  fused_op.add_input(segment_reduction.input(1));  // 2: indices
+  fused_op.add_input(segment_reduction.input(2));  // 3: segment_ids
+  fused_op.set_op(kFusedEmbeddingLookupSparse);
+
+  auto* attr = fused_op.mutable_attr();
+  auto& src_attr = segment_reduction.attr();
+  (*attr)["T"] = src_attr.at("T");
+  (*attr)["Tidx"] = src_attr.at("Tidx");
+  (*attr)["Tsegmentids"] = src_attr.at("Tsegmentids");
+  SetAttrValue(0, &(*attr)["num_weights"]);
+  SetAttrValue(GetEmbeddingCombiner(segment_reduction),
+               &(*attr)["combiner"]);
+
+  utils::Mutation* mutation = ctx->graph_view.GetMutationBuilder();
+  Status status;
+  mutation->AddNode(std::move(fused_op), &status);
+  TF_RETURN_IF_ERROR(status);
+  TF_RETURN_IF_ERROR(mutation->Apply());
+
+  (*invalidated_nodes)[matched.segment_reduction] = true;
+  (*nodes_to_delete)[matched.gather] = true;
+
+  return Status::OK();
+}
+
+Status AddRegexFullMatchSetNode(RemapperContext* ctx,
+                                const RegexFullMatchSet& matched,
+                                std::vector<bool>* invalidated_nodes) {
+  const GraphDef* graph = ctx->graph_view.graph();
+  const NodeDef& root = graph->node(matched.regex_full_matches[0]);
+  VLOG(2) << "Fuse " << matched.regex_full_matches.size()
+          << " StaticRegexFullMatch nodes of input=" << root.input(0)
+          << " on device=" << root.device();
+
+  NodeDef fused_op;
+  fused_op.set_name(AddPrefixToNodeName("RegexFullMatchSet", root.name()));
+  fused_op.set_device(root.device());
+  fused_op.add_input(root.input(0));  // 0: input
+  fused_op.set_op(kStaticRegexFullMatchSet);
+
+  // Every StaticRegexFullMatch is replaced with an Identity of its output of
+  // the fused op, so that its consumers and fetches are preserved.
+  std::vector<string> patterns;
+  std::vector<NodeDef> identity_ops;
+  for (int index : matched.regex_full_matches) {
+    const NodeDef& regex_full_match = graph->node(index);
+    NodeDef identity_op;
+    identity_op.set_op("Identity");
+    identity_op.set_name(regex_full_match.name());
+    identity_op.set_device(regex_full_match.device());
+    identity_op.add_input(
+        patterns.empty()
+            ? fused_op.name()
+            : absl::StrCat(fused_op.name(), ":", patterns.size()));
+    SetAttrValue(DT_BOOL, &(*identity_op.mutable_attr())["T"]);
+    identity_ops.push_back(std::move(identity_op));
+    patterns.push_back(regex_full_match.attr().at("pattern").s());
+  }
+
+  auto* attr = fused_op.mutable_attr();
+  SetAttrValue(patterns, &(*attr)["patterns"]);
+  SetAttrValue(static_cast<int>(patterns.size()), &(*attr)["num_patterns"]);
+
+  utils::Mutation* mutation = ctx->graph_view.GetMutationBuilder();
+  Status status;
+  mutation->AddNode(std::move(fused_op), &status);
+  TF_RETURN_IF_ERROR(status);
+  for (NodeDef& identity_op : identity_ops) {
+    mutation->AddNode(std::move(identity_op), &status);
+    TF_RETURN_IF_ERROR(status);
+  }
+  TF_RETURN_IF_ERROR(mutation->Apply());
+
+  for (int index : matched.regex_full_matches) {
+    (*invalidated_nodes)[index] = true;
+  }
+
+  return Status::OK();
+}
+
 Status AddFusedBatchMatMul(RemapperContext* ctx,
                            const std::map<string, int>& matched_nodes_map,
                            const std::set<int>& remove_node_indices,
@@ -2910,13 +3136,24 @@ bool RequiresInferredShapes(const RemapperContext& ctx, int node_index) {
     return false;
   };
 
+  // Candidate for an embedding lookup fusion, which needs the rank of the ids.
+  const auto is_embedding_lookup_candidate = [&]() -> bool {
+    if (GetEmbeddingCombiner(*node_def) == nullptr) return false;
+    if (node_view->NumRegularFanins() < 1) return false;
+    const auto* fanin_0_node_def =
+        node_view->GetRegularFanin(0).node_view()->node();
+    return fanin_0_node_def->op() == "GatherV2";
+  };
+
   if (IsMKLEnabled())
     return is_batch_norm_candidate() || is_batch_norm_fusion_candidate() ||
-           IsContractionWithAdd(ctx, node_index);
+           IsContractionWithAdd(ctx, node_index) ||
+           is_embedding_lookup_candidate();
 
   return is_relu_biasadd_conv_candidate() || is_batch_norm_candidate() ||
          is_batch_norm_fusion_candidate() ||
-         is_batch_norm_grad_fusion_candidate();
+         is_batch_norm_grad_fusion_candidate() ||
+         is_embedding_lookup_candidate();
 }
 }  // namespace
 
@@ -3125,6 +3362,27 @@ Status Remapper::Optimize(Cluster* cluster, const GrapplerItem& item,
       continue;
     }
 
+    // Remap GatherV2+SparseSegment{Sum,Mean,SqrtN} into the
+    // _FusedEmbeddingLookupSparse.
+    EmbeddingLookupSparse embedding_lookup_sparse;
+    if (allow_non_differentiable_rewrites &&
+        FindEmbeddingLookupSparse(ctx, i, &embedding_lookup_sparse)) {
+      TF_RETURN_IF_ERROR(
+          AddEmbeddingLookupSparseNode(&ctx, embedding_lookup_sparse,
+                                       &invalidated_nodes, &nodes_to_delete));
+      continue;
+    }
+
+    // Remap StaticRegexFullMatch nodes that read the same tensor into the
+    // _StaticRegexFullMatchSet.
+    RegexFullMatchSet regex_full_match_set;
+    if (allow_non_differentiable_rewrites &&
+        FindRegexFullMatchSet(ctx, i, &regex_full_match_set)) {
+      TF_RETURN_IF_ERROR(AddRegexFullMatchSetNode(&ctx, regex_full_match_set,
+                                                  &invalidated_nodes));
+      continue;
+    }
+
     // During inference, most of the inputs to FusedBatchNorm are constant, and
     // we can therefore replace the op with a much cheaper set of primitives.
     FusedBatchNorm fused_batch_norm;
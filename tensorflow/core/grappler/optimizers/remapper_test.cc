@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/core/grappler/optimizers/remapper.h"
 
+#include <set>
+
 #include "tensorflow/cc/ops/nn_ops_internal.h"
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
@@ -1078,6 +1080,227 @@ TEST_F(RemapperTensorToHashBucketTest, I32) { RunTest<DT_INT32>(); }
 
 TEST_F(RemapperTensorToHashBucketTest, I64) { RunTest<DT_INT64>(); }
 
+TEST_F(RemapperTest, FuseRegexFullMatchSet) {
+  using ::tensorflow::ops::Placeholder;
+
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto input = Placeholder(s.WithOpName("input"), DT_STRING,
+                           ops::Placeholder::Shape({4}));
+  auto digits =
+      ops::StaticRegexFullMatch(s.WithOpName("digits"), input, "[0-9]+");
+  auto words = ops::StaticRegexFullMatch(s.WithOpName("words"), input, "\\w+");
+  auto email = ops::StaticRegexFullMatch(s.WithOpName("email"), input,
+                                         ".+@.+\\..+");
+  auto fetch_digits = ops::Identity(s.WithOpName("fetch_digits"), digits);
+  auto fetch_words = ops::Identity(s.WithOpName("fetch_words"), words);
+  auto fetch_email = ops::Identity(s.WithOpName("fetch_email"), email);
+
+  auto input_t = test::AsTensor<tstring>({"123", "abc", "a@b.c", "a b"});
+
+  GrapplerItem item;
+  item.fetch = {"fetch_digits", "fetch_words", "fetch_email"};
+  item.feed = {{"input", input_t}};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  // Place all nodes on CPU.
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  int found_set = 0;
+  int found_identities = 0;
+  for (const NodeDef& node : output.node()) {
+    if (node.op() == "_StaticRegexFullMatchSet") {
+      ASSERT_EQ(node.input_size(), 1);
+      EXPECT_EQ(node.input(0), "input");
+      EXPECT_EQ(node.attr().at("num_patterns").i(), 3);
+      EXPECT_EQ(node.attr().at("patterns").list().s_size(), 3);
+      found_set++;
+    } else if (node.name() == "digits" || node.name() == "words" ||
+               node.name() == "email") {
+      EXPECT_EQ(node.op(), "Identity");
+      found_identities++;
+    }
+  }
+  EXPECT_EQ(found_set, 1);
+  EXPECT_EQ(found_identities, 3);
+
+  auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+  ASSERT_EQ(tensors_expected.size(), 3);
+  auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+  ASSERT_EQ(tensors.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    test::ExpectTensorEqual<bool>(tensors[i], tensors_expected[i]);
+  }
+}
+
+TEST_F(RemapperTest, DoNotFuseSingleRegexFullMatch) {
+  using ::tensorflow::ops::Placeholder;
+
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+  auto input = Placeholder(s.WithOpName("input"), DT_STRING,
+                           ops::Placeholder::Shape({4}));
+  auto digits =
+      ops::StaticRegexFullMatch(s.WithOpName("digits"), input, "[0-9]+");
+  auto fetch = ops::Identity(s.WithOpName("fetch"), digits);
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    item.graph.mutable_node(i)->set_device("/device:CPU:0");
+  }
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE(node.op(), "_StaticRegexFullMatchSet");
+  }
+}
+
+class RemapperFuseEmbeddingLookupSparseTest : public RemapperTest {
+ public:
+  template <typename SegmentReduction>
+  void RunTest(const string& combiner) {
+    using ::tensorflow::ops::Placeholder;
+
+    tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+
+    auto params_shape = ops::Placeholder::Shape({64, 16});
+    auto ids_shape = ops::Placeholder::Shape({10});
+    auto indices_shape = ops::Placeholder::Shape({20});
+
+    auto params = Placeholder(s.WithOpName("params"), DT_FLOAT, params_shape);
+    auto ids = Placeholder(s.WithOpName("ids"), DT_INT32, ids_shape);
+    auto indices =
+        Placeholder(s.WithOpName("indices"), DT_INT32, indices_shape);
+    auto segment_ids =
+        Placeholder(s.WithOpName("segment_ids"), DT_INT32, indices_shape);
+
+    auto axis = ops::Const(s.WithOpName("axis"), 0);
+    auto gather = ops::GatherV2(s.WithOpName("gather"), params, ids, axis);
+    auto combined = SegmentReduction(s.WithOpName("combined"), gather,
+                                     indices, segment_ids);
+    auto fetch = ops::Identity(s.WithOpName("fetch"), combined);
+
+    std::vector<int32> ids_v;
+    for (int i = 0; i < 10; ++i) ids_v.push_back((i * 7) % 64);
+    // Every third segment is empty.
+    std::vector<int32> indices_v;
+    std::vector<int32> segment_ids_v;
+    for (int i = 0; i < 20; ++i) {
+      indices_v.push_back((i * 3) % 10);
+      segment_ids_v.push_back((i / 2) * 3 / 2);
+    }
+
+    auto params_t = GenerateRandomTensor<DT_FLOAT>({64, 16});
+    auto ids_t = test::AsTensor<int32>(ids_v);
+    auto indices_t = test::AsTensor<int32>(indices_v);
+    auto segment_ids_t = test::AsTensor<int32>(segment_ids_v);
+
+    GrapplerItem item;
+    item.fetch = {"fetch"};
+    item.feed = {{"params", params_t},
+                 {"ids", ids_t},
+                 {"indices", indices_t},
+                 {"segment_ids", segment_ids_t}};
+    TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+    // Place all nodes on CPU.
+    for (int i = 0; i < item.graph.node_size(); ++i) {
+      item.graph.mutable_node(i)->set_device("/device:CPU:0");
+    }
+
+    Remapper optimizer(RewriterConfig::ON);
+    GraphDef output;
+    TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+    int found = 0;
+    for (const NodeDef& node : output.node()) {
+      EXPECT_NE(node.name(), "gather");
+      if (node.name() == "combined") {
+        EXPECT_EQ(node.op(), "_FusedEmbeddingLookupSparse");
+        ASSERT_EQ(node.input_size(), 4);
+        EXPECT_EQ(node.input(0), "params");
+        EXPECT_EQ(node.input(1), "ids");
+        EXPECT_EQ(node.input(2), "indices");
+        EXPECT_EQ(node.input(3), "segment_ids");
+        EXPECT_EQ(node.attr().at("combiner").s(), combiner);
+        EXPECT_EQ(node.attr().at("num_weights").i(), 0);
+        found++;
+      }
+    }
+    EXPECT_EQ(found, 1);
+
+    auto tensors_expected = EvaluateNodes(item.graph, item.fetch, item.feed);
+    ASSERT_EQ(tensors_expected.size(), 1);
+    auto tensors = EvaluateNodes(output, item.fetch, item.feed);
+    ASSERT_EQ(tensors.size(), 1);
+    test::ExpectTensorNear<float>(tensors[0], tensors_expected[0], 1e-5);
+  }
+};
+
+TEST_F(RemapperFuseEmbeddingLookupSparseTest, Sum) {
+  RunTest<ops::SparseSegmentSum>("sum");
+}
+
+TEST_F(RemapperFuseEmbeddingLookupSparseTest, Mean) {
+  RunTest<ops::SparseSegmentMean>("mean");
+}
+
+TEST_F(RemapperFuseEmbeddingLookupSparseTest, SqrtN) {
+  RunTest<ops::SparseSegmentSqrtN>("sqrtn");
+}
+
+TEST_F(RemapperFuseEmbeddingLookupSparseTest, GatherOnOtherDevice) {
+  using ::tensorflow::ops::Placeholder;
+
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope();
+  auto params = Placeholder(s.WithOpName("params"), DT_FLOAT,
+                            ops::Placeholder::Shape({64, 16}));
+  auto ids = Placeholder(s.WithOpName("ids"), DT_INT32,
+                         ops::Placeholder::Shape({10}));
+  auto indices = Placeholder(s.WithOpName("indices"), DT_INT32,
+                             ops::Placeholder::Shape({20}));
+  auto segment_ids = Placeholder(s.WithOpName("segment_ids"), DT_INT32,
+                                 ops::Placeholder::Shape({20}));
+  auto axis = ops::Const(s.WithOpName("axis"), 0);
+  auto gather = ops::GatherV2(s.WithOpName("gather"), params, ids, axis);
+  auto combined = ops::SparseSegmentSum(s.WithOpName("combined"), gather,
+                                        indices, segment_ids);
+  auto fetch = ops::Identity(s.WithOpName("fetch"), combined);
+
+  GrapplerItem item;
+  item.fetch = {"fetch"};
+  TF_ASSERT_OK(s.ToGraphDef(&item.graph));
+
+  // The table and its gather are on a parameter server, the reduction on a
+  // worker.
+  const std::set<string> ps_nodes = {"params", "ids", "axis", "gather"};
+  for (int i = 0; i < item.graph.node_size(); ++i) {
+    NodeDef* node = item.graph.mutable_node(i);
+    node->set_device(ps_nodes.count(node->name()) > 0
+                         ? "/job:ps/replica:0/task:0/device:CPU:0"
+                         : "/job:worker/replica:0/task:0/device:CPU:0");
+  }
+
+  Remapper optimizer(RewriterConfig::ON);
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  for (const NodeDef& node : output.node()) {
+    EXPECT_NE(node.op(), "_FusedEmbeddingLookupSparse");
+  }
+}
+
 class RemapperFuseMatMulWithBiasTest : public RemapperTest {
  public:
   template <DataType DTYPE>
@@ -15,6 +15,7 @@ limitations under the License.
 
 // See docs in ../ops/string_ops.cc.
 
+#include <cstdio>
 #include <string>
 
 #include "tensorflow/core/framework/kernel_def_builder.h"
@@ -26,8 +27,42 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
+namespace {
+
+// Formats `args` with `format` into `out`. Unlike strings::Printf, this does
+// not build a temporary std::string, so results that fit in a tstring's
+// inline buffer do not allocate at all.
+template <typename... Args>
+void FormatInto(tstring* out, const char* format, Args... args) {
+  char buffer[64];
+  const int size = snprintf(buffer, sizeof(buffer), format, args...);
+  if (size < 0) {
+    // Matches strings::Printf, which returns an empty string on errors.
+    out->clear();
+  } else if (static_cast<size_t>(size) < sizeof(buffer)) {
+    out->assign(buffer, size);
+  } else {
+    *out = strings::Printf(format, args...);
+  }
+}
+
+// Calls `format_one(i)` for every i in [0, n), splitting the work across the
+// CPU worker threads.
+template <typename FormatFn>
+void FormatAll(OpKernelContext* context, int64_t n, FormatFn format_one) {
+  // Estimated cost, in cycles, of formatting one number.
+  constexpr int64_t kFormatCost = 300;
+  auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+  Shard(worker_threads->num_threads, worker_threads->workers, n, kFormatCost,
+        [&format_one](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) format_one(i);
+        });
+}
+
+}  // namespace
 
 class AsStringOp : public OpKernel {
  public:
@@ -152,12 +187,12 @@ class AsStringOp : public OpKernel {
                                             &output_tensor));
     auto output_flat = output_tensor->flat<tstring>();
 
-#define ENCODE_TYPE(type, T, enc_str)                                     \
-  case (type): {                                                          \
-    const auto& input_flat = input_tensor->flat<T>();                     \
-    for (int i = 0; i < input_flat.size(); ++i) {                         \
-      output_flat(i) = strings::Printf((enc_str.c_str()), input_flat(i)); \
-    }                                                                     \
+#define ENCODE_TYPE(type, T, enc_str)                                   \
+  case (type): {                                                        \
+    const auto& input_flat = input_tensor->flat<T>();                   \
+    FormatAll(context, input_flat.size(), [&](int64_t i) {              \
+      FormatInto(&output_flat(i), enc_str.c_str(), input_flat(i));      \
+    });                                                                 \
   } break
 
     switch (dtype) {
@@ -185,31 +220,31 @@ class AsStringOp : public OpKernel {
       } break;
       case (DT_HALF): {
         const auto& input_flat = input_tensor->flat<Eigen::half>();
-        for (int i = 0; i < input_flat.size(); ++i) {
-          output_flat(i) = strings::Printf(format_.c_str(),
-                                           static_cast<float>(input_flat(i)));
-        }
+        FormatAll(context, input_flat.size(), [&](int64_t i) {
+          FormatInto(&output_flat(i), format_.c_str(),
+                     static_cast<float>(input_flat(i)));
+        });
       } break;
       case (DT_BFLOAT16): {
         const auto& input_flat = input_tensor->flat<bfloat16>();
-        for (int i = 0; i < input_flat.size(); ++i) {
-          output_flat(i) = strings::Printf(format_.c_str(),
-                                           static_cast<float>(input_flat(i)));
-        }
+        FormatAll(context, input_flat.size(), [&](int64_t i) {
+          FormatInto(&output_flat(i), format_.c_str(),
+                     static_cast<float>(input_flat(i)));
+        });
       } break;
       case (DT_COMPLEX64): {
         const auto& input_flat = input_tensor->flat<complex64>();
-        for (int i = 0; i < input_flat.size(); ++i) {
-          output_flat(i) = strings::Printf(
-              format_.c_str(), input_flat(i).real(), input_flat(i).imag());
-        }
+        FormatAll(context, input_flat.size(), [&](int64_t i) {
+          FormatInto(&output_flat(i), format_.c_str(), input_flat(i).real(),
+                     input_flat(i).imag());
+        });
       } break;
       case (DT_COMPLEX128): {
         const auto& input_flat = input_tensor->flat<complex128>();
-        for (int i = 0; i < input_flat.size(); ++i) {
-          output_flat(i) = strings::Printf(
-              format_.c_str(), input_flat(i).real(), input_flat(i).imag());
-        }
+        FormatAll(context, input_flat.size(), [&](int64_t i) {
+          FormatInto(&output_flat(i), format_.c_str(), input_flat(i).real(),
+                     input_flat(i).imag());
+        });
       } break;
       default:
         bool can_encode_type = false;
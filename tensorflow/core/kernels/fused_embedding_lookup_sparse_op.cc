@@ -0,0 +1,236 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/math_ops.cc.
+
+#define EIGEN_USE_THREADS
+
+#include <cmath>
+#include <vector>
+
+#include "third_party/eigen3/Eigen/Core"
+#include "tensorflow/core/framework/bounds_check.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/platform/prefetch.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+
+// Computes SparseSegment{Sum,Mean,SqrtN}(Gather(params, ids), indices,
+// segment_ids), optionally scaling every gathered row by a weight, without
+// materializing the gathered rows. Output rows are partitioned across the CPU
+// worker threads, and every thread reads the rows it combines straight from
+// `params`.
+template <typename T, typename Tidx, typename Tsegmentids>
+class FusedEmbeddingLookupSparseOp : public OpKernel {
+ public:
+  explicit FusedEmbeddingLookupSparseOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    int num_weights;
+    OP_REQUIRES_OK(context, context->GetAttr("num_weights", &num_weights));
+    OP_REQUIRES(context, num_weights <= 1,
+                errors::InvalidArgument(
+                    "Expected at most one weights input, got ", num_weights));
+    has_weights_ = num_weights == 1;
+
+    string combiner;
+    OP_REQUIRES_OK(context, context->GetAttr("combiner", &combiner));
+    if (combiner == "sum") {
+      combiner_ = Combiner::kSum;
+    } else if (combiner == "mean") {
+      combiner_ = Combiner::kMean;
+    } else if (combiner == "sqrtn") {
+      combiner_ = Combiner::kSqrtN;
+    } else {
+      context->CtxFailure(
+          errors::InvalidArgument("Unsupported combiner: ", combiner));
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& params = context->input(0);
+    const Tensor& ids = context->input(1);
+    const Tensor& indices = context->input(2);
+    const Tensor& segment_ids = context->input(3);
+
+    OP_REQUIRES(context, TensorShapeUtils::IsVectorOrHigher(params.shape()),
+                errors::InvalidArgument("params must be at least 1-D, got ",
+                                        params.shape().DebugString()));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(ids.shape()),
+                errors::InvalidArgument("ids must be a vector, got ",
+                                        ids.shape().DebugString()));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(indices.shape()),
+                errors::InvalidArgument("indices must be a vector, got ",
+                                        indices.shape().DebugString()));
+    OP_REQUIRES(context, TensorShapeUtils::IsVector(segment_ids.shape()),
+                errors::InvalidArgument("segment_ids must be a vector, got ",
+                                        segment_ids.shape().DebugString()));
+    const int64_t num_indices = indices.NumElements();
+    OP_REQUIRES(context, segment_ids.NumElements() == num_indices,
+                errors::InvalidArgument(
+                    "segment_ids and indices should have same size, got ",
+                    segment_ids.NumElements(), " and ", num_indices));
+    const T* weights = nullptr;
+    if (has_weights_) {
+      const Tensor& weights_tensor = context->input(4);
+      OP_REQUIRES(context,
+                  TensorShapeUtils::IsVector(weights_tensor.shape()) &&
+                      weights_tensor.NumElements() == num_indices,
+                  errors::InvalidArgument(
+                      "weights must be a vector of the same size as indices, "
+                      "got ",
+                      weights_tensor.shape().DebugString()));
+      weights = weights_tensor.flat<T>().data();
+    }
+
+    const auto params_flat = params.flat_outer_dims<T>();
+    const int64_t num_params = params_flat.dimension(0);
+    const int64_t row_size = params_flat.dimension(1);
+    const auto ids_vec = ids.vec<Tidx>();
+    const auto indices_vec = indices.vec<Tidx>();
+    const auto segment_vec = segment_ids.vec<Tsegmentids>();
+
+    const int64_t num_segments =
+        num_indices > 0
+            ? internal::SubtleMustCopy(segment_vec(num_indices - 1)) + 1
+            : 0;
+    OP_REQUIRES(context, num_segments >= 0,
+                errors::InvalidArgument("segment ids must be >= 0"));
+
+    // Resolve the params row of every index and the range of indices of every
+    // segment up front, so that the workers below cannot fail.
+    std::vector<int64_t> rows(num_indices);
+    std::vector<int64_t> segment_starts(num_segments + 1);
+    int64_t next_segment = 0;
+    for (int64_t i = 0; i < num_indices; ++i) {
+      const Tidx index = internal::SubtleMustCopy(indices_vec(i));
+      OP_REQUIRES(context, FastBoundsCheck(index, ids_vec.size()),
+                  errors::InvalidArgument("indices[", i, "] = ", index,
+                                          " is not in [0, ", ids_vec.size(),
+                                          ")"));
+      const Tidx id = internal::SubtleMustCopy(ids_vec(index));
+      OP_REQUIRES(context, FastBoundsCheck(id, num_params),
+                  errors::InvalidArgument("ids[", index, "] = ", id,
+                                          " is not in [0, ", num_params, ")"));
+      rows[i] = id;
+
+      const Tsegmentids segment = internal::SubtleMustCopy(segment_vec(i));
+      OP_REQUIRES(context, segment >= next_segment - 1,
+                  errors::InvalidArgument("segment ids are not increasing"));
+      OP_REQUIRES(
+          context, FastBoundsCheck(segment, num_segments),
+          errors::InvalidArgument(
+              "Segment id ", segment, " out of range [0, ", num_segments,
+              "), possibly because 'segment_ids' input is not sorted."));
+      while (next_segment <= segment) segment_starts[next_segment++] = i;
+    }
+    while (next_segment <= num_segments) {
+      segment_starts[next_segment++] = num_indices;
+    }
+
+    TensorShape output_shape = params.shape();
+    OP_REQUIRES_OK(context, output_shape.SetDimWithStatus(0, num_segments));
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context, context->allocate_output(0, output_shape, &output));
+    if (num_segments == 0 || row_size == 0) return;
+
+    typedef Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>> Row;
+    typedef Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>> ConstRow;
+    const T* params_data = params_flat.data();
+    T* output_data = output->flat<T>().data();
+    const int64_t row_bytes = row_size * sizeof(T);
+
+    auto combine_segments = [&](int64_t begin, int64_t end) {
+      for (int64_t segment = begin; segment < end; ++segment) {
+        Row out(output_data + segment * row_size, row_size);
+        out.setZero();
+        const int64_t start = segment_starts[segment];
+        const int64_t limit = segment_starts[segment + 1];
+        T scale(0);
+        for (int64_t i = start; i < limit; ++i) {
+          if (i + kPrefetchDistance < limit) {
+            const char* ahead = reinterpret_cast<const char*>(
+                params_data + rows[i + kPrefetchDistance] * row_size);
+            for (int64_t offset = 0; offset < row_bytes;
+                 offset += kCacheLineBytes) {
+              port::prefetch<port::PREFETCH_HINT_T0>(ahead + offset);
+            }
+          }
+          ConstRow row(params_data + rows[i] * row_size, row_size);
+          if (has_weights_) {
+            const T weight = weights[i];
+            out += weight * row;
+            scale += combiner_ == Combiner::kSqrtN ? weight * weight : weight;
+          } else {
+            out += row;
+          }
+        }
+        if (combiner_ == Combiner::kSum) continue;
+        if (!has_weights_) scale = static_cast<T>(limit - start);
+        if (combiner_ == Combiner::kSqrtN) scale = std::sqrt(scale);
+        // Like embedding_lookup_sparse, segments whose weights sum to zero
+        // produce zeros.
+        if (scale == T(0)) {
+          out.setZero();
+        } else {
+          out /= scale;
+        }
+      }
+    };
+
+    const int64_t rows_per_segment =
+        (num_indices + num_segments - 1) / num_segments;
+    const int64_t cost_per_segment = (rows_per_segment + 1) * row_size * 2;
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, num_segments,
+          cost_per_segment, combine_segments);
+  }
+
+ private:
+  enum class Combiner { kSum, kMean, kSqrtN };
+
+  // Number of rows to look ahead when prefetching params rows.
+  static constexpr int64_t kPrefetchDistance = 4;
+  static constexpr int64_t kCacheLineBytes = 64;
+
+  bool has_weights_;
+  Combiner combiner_;
+};
+
+#define REGISTER_KERNEL(T, Tidx, Tsegmentids)                         \
+  REGISTER_KERNEL_BUILDER(Name("_FusedEmbeddingLookupSparse")         \
+                              .Device(DEVICE_CPU)                     \
+                              .TypeConstraint<T>("T")                 \
+                              .TypeConstraint<Tidx>("Tidx")           \
+                              .TypeConstraint<Tsegmentids>(           \
+                                  "Tsegmentids"),                     \
+                          FusedEmbeddingLookupSparseOp<T, Tidx, Tsegmentids>);
+
+#define REGISTER_KERNELS_ALL_INDICES(T) \
+  REGISTER_KERNEL(T, int32, int32);     \
+  REGISTER_KERNEL(T, int32, int64_t);   \
+  REGISTER_KERNEL(T, int64_t, int32);   \
+  REGISTER_KERNEL(T, int64_t, int64_t);
+
+TF_CALL_float(REGISTER_KERNELS_ALL_INDICES);
+TF_CALL_double(REGISTER_KERNELS_ALL_INDICES);
+
+#undef REGISTER_KERNELS_ALL_INDICES
+#undef REGISTER_KERNEL
+
+}  // namespace tensorflow
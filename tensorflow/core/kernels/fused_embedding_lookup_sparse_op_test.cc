@@ -0,0 +1,137 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cmath>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class FusedEmbeddingLookupSparseOpTest : public OpsTestBase {
+ protected:
+  void MakeOp(const string& combiner, int num_weights) {
+    TF_ASSERT_OK(NodeDefBuilder("fused", "_FusedEmbeddingLookupSparse")
+                     .Input(FakeInput(DT_FLOAT))
+                     .Input(FakeInput(DT_INT32))
+                     .Input(FakeInput(DT_INT32))
+                     .Input(FakeInput(DT_INT32))
+                     .Input(FakeInput(num_weights, DT_FLOAT))
+                     .Attr("combiner", combiner)
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+  }
+
+  // params is [4, 2]; row r is {r, 10 * r}. ids selects rows {3, 1, 2, 0}.
+  // Segment 1 is empty.
+  void AddLookupInputs() {
+    AddInputFromArray<float>(TensorShape({4, 2}),
+                             {0, 0, 1, 10, 2, 20, 3, 30});
+    AddInputFromArray<int32>(TensorShape({4}), {3, 1, 2, 0});
+    AddInputFromArray<int32>(TensorShape({4}), {0, 1, 2, 3});
+    AddInputFromArray<int32>(TensorShape({4}), {0, 0, 2, 2});
+  }
+};
+
+TEST_F(FusedEmbeddingLookupSparseOpTest, Sum) {
+  MakeOp("sum", 0);
+  AddLookupInputs();
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({3, 2}));
+  test::FillValues<float>(&expected, {4, 40, 0, 0, 2, 20});
+  test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+}
+
+TEST_F(FusedEmbeddingLookupSparseOpTest, Mean) {
+  MakeOp("mean", 0);
+  AddLookupInputs();
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({3, 2}));
+  test::FillValues<float>(&expected, {2, 20, 0, 0, 1, 10});
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-6);
+}
+
+TEST_F(FusedEmbeddingLookupSparseOpTest, SqrtN) {
+  MakeOp("sqrtn", 0);
+  AddLookupInputs();
+  TF_ASSERT_OK(RunOpKernel());
+
+  const float s = std::sqrt(2.0f);
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({3, 2}));
+  test::FillValues<float>(&expected,
+                          {4 / s, 40 / s, 0, 0, 2 / s, 20 / s});
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-5);
+}
+
+TEST_F(FusedEmbeddingLookupSparseOpTest, WeightedMean) {
+  MakeOp("mean", 1);
+  AddLookupInputs();
+  AddInputFromArray<float>(TensorShape({4}), {1, 3, 2, -2});
+  TF_ASSERT_OK(RunOpKernel());
+
+  // Segment 0 is (3 * 1 + 1 * 3) / 4. The weights of segment 2 sum to zero.
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({3, 2}));
+  test::FillValues<float>(&expected, {1.5, 15, 0, 0, 0, 0});
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-6);
+}
+
+TEST_F(FusedEmbeddingLookupSparseOpTest, WeightedSqrtN) {
+  MakeOp("sqrtn", 1);
+  AddLookupInputs();
+  AddInputFromArray<float>(TensorShape({4}), {3, 4, 1, 1});
+  TF_ASSERT_OK(RunOpKernel());
+
+  // Segment 0 is (3 * 3 + 4 * 1) / sqrt(3^2 + 4^2).
+  const float s = std::sqrt(2.0f);
+  Tensor expected(allocator(), DT_FLOAT, TensorShape({3, 2}));
+  test::FillValues<float>(&expected, {2.6, 26, 0, 0, 2 / s, 20 / s});
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-5);
+}
+
+TEST_F(FusedEmbeddingLookupSparseOpTest, IdOutOfRange) {
+  MakeOp("sum", 0);
+  AddInputFromArray<float>(TensorShape({4, 2}),
+                           {0, 0, 1, 10, 2, 20, 3, 30});
+  AddInputFromArray<int32>(TensorShape({2}), {3, 4});
+  AddInputFromArray<int32>(TensorShape({2}), {0, 1});
+  AddInputFromArray<int32>(TensorShape({2}), {0, 1});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(absl::StrContains(s.ToString(), "ids[1] = 4 is not in [0, 4)"))
+      << s;
+}
+
+TEST_F(FusedEmbeddingLookupSparseOpTest, UnsortedSegments) {
+  MakeOp("sum", 0);
+  AddInputFromArray<float>(TensorShape({4, 2}),
+                           {0, 0, 1, 10, 2, 20, 3, 30});
+  AddInputFromArray<int32>(TensorShape({2}), {3, 1});
+  AddInputFromArray<int32>(TensorShape({3}), {0, 1, 0});
+  AddInputFromArray<int32>(TensorShape({3}), {1, 0, 1});
+  Status s = RunOpKernel();
+  EXPECT_TRUE(absl::StrContains(s.ToString(), "not increasing")) << s;
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -20,6 +20,7 @@ limitations under the License.
 
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
 #include <atomic>
 
 #include "tensorflow/core/framework/bounds_check.h"
@@ -29,6 +30,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/gather_nd_op.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/prefetch.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/util/util.h"
 
@@ -38,54 +40,85 @@ typedef Eigen::ThreadPoolDevice CPUDevice;
 
 namespace generator {
 
+// How many slices ahead the gathered slices are prefetched, and how many of
+// their leading bytes.
+constexpr int kGatherNdPrefetchDistance = 8;
+constexpr int kGatherNdPrefetchBytes = 256;
+
+// Gathers the slices of "Tparams" addressed by the rows of "Tindices" into the
+// rows of "Tout".  The flat offsets of the slices are computed with strides
+// precomputed once, the slices of the following indices are prefetched, and
+// the slices are copied with std::copy_n, i.e. memmove for the POD types.
 template <typename T, typename Index, int IXDIM>
 class GatherNdSliceGenerator {
  public:
-  EIGEN_DEVICE_FUNC EIGEN_ALWAYS_INLINE GatherNdSliceGenerator(
-      const Index slice_size, typename TTypes<Index>::ConstMatrix Tindices,
-      typename TTypes<T, IXDIM + 1>::ConstTensor Tparams,
-      typename TTypes<T>::Matrix Tout, std::atomic<Index>* error_loc)
+  GatherNdSliceGenerator(const Index slice_size,
+                         typename TTypes<Index>::ConstMatrix Tindices,
+                         typename TTypes<T, IXDIM + 1>::ConstTensor Tparams,
+                         typename TTypes<T>::Matrix Tout,
+                         std::atomic<Index>* error_loc)
       : slice_size_(slice_size),
         Tindices_(Tindices),
-        Tparams_(Tparams),
-        Tout_(Tout),
-        error_loc_(error_loc) {}
+        params_(Tparams.data()),
+        out_(Tout.data()),
+        error_loc_(error_loc) {
+    Eigen::DenseIndex stride = slice_size;
+    for (int i = IXDIM - 1; i >= 0; --i) {
+      dims_[i] = Tparams.dimension(i);
+      strides_[i] = stride;
+      stride *= dims_[i];
+    }
+  }
 
-  EIGEN_DEVICE_FUNC EIGEN_ALWAYS_INLINE bool GenerateIndices(
-      const Index loc, Eigen::array<Eigen::DenseIndex, IXDIM + 1>* ix) const {
-    (*ix)[IXDIM] = 0;
+  // Returns the offset in "Tparams" of the slice of index "loc", or -1 if
+  // the index is out of bounds.
+  EIGEN_ALWAYS_INLINE Eigen::DenseIndex SliceOffset(const Index loc) const {
+    Eigen::DenseIndex offset = 0;
     bool out_of_bounds = false;
     for (int i = 0; i < IXDIM; ++i) {
       const Index ix_i = internal::SubtleMustCopy(Tindices_(loc, i));
-      (*ix)[i] = ix_i;
-      out_of_bounds |= !FastBoundsCheck(ix_i, Tparams_.dimension(i));
+      out_of_bounds |= !FastBoundsCheck(ix_i, dims_[i]);
+      offset += ix_i * strides_[i];
     }
-    return out_of_bounds;
+    return TF_PREDICT_FALSE(out_of_bounds) ? -1 : offset;
   }
 
-  EIGEN_DEVICE_FUNC EIGEN_ALWAYS_INLINE int32
-  operator()(const Eigen::array<Eigen::DenseIndex, 1>& loc_array) const {
-    const Index loc = loc_array[0];
-    Eigen::array<Eigen::DenseIndex, IXDIM + 1> ix;
-    Eigen::array<Eigen::DenseIndex, 2> ix_out;
-    ix_out[0] = loc;
-    ix_out[1] = 0;
-    const bool out_of_bounds = GenerateIndices(loc, &ix);
-    if (TF_PREDICT_FALSE(out_of_bounds)) {
-      error_loc_->store(loc);
-      std::fill_n(&Tout_(ix_out), slice_size_, T());
-    } else {
-      std::copy_n(&Tparams_(ix), slice_size_, &Tout_(ix_out));
+  // Gathers the slices of indices [begin, end).
+  void operator()(const Index begin, const Index end) const {
+    const int64_t prefetch_bytes = std::min<int64_t>(
+        kGatherNdPrefetchBytes, static_cast<int64_t>(slice_size_) * sizeof(T));
+    for (Index loc = begin; loc < end; ++loc) {
+      if (loc + kGatherNdPrefetchDistance < end) {
+        const Eigen::DenseIndex next =
+            SliceOffset(loc + kGatherNdPrefetchDistance);
+        if (next >= 0) {
+          const char* slice = reinterpret_cast<const char*>(params_ + next);
+          for (int64_t b = 0; b < prefetch_bytes; b += 64) {
+            port::prefetch<port::PREFETCH_HINT_T0>(slice + b);
+          }
+        }
+      }
+      const Eigen::DenseIndex offset = SliceOffset(loc);
+      T* out_slice = out_ + static_cast<Eigen::DenseIndex>(loc) * slice_size_;
+      if (TF_PREDICT_FALSE(offset < 0)) {
+        error_loc_->store(loc);
+        std::fill_n(out_slice, slice_size_, T());
+      } else if (slice_size_ == 1) {
+        *out_slice = params_[offset];
+      } else {
+        std::copy_n(params_ + offset, slice_size_, out_slice);
+      }
     }
-
-    return static_cast<int32>(0);  // Return something...
   }
 
  private:
   const Index slice_size_;
   const typename TTypes<Index>::ConstMatrix Tindices_;
-  const typename TTypes<T, IXDIM + 1>::ConstTensor Tparams_;
-  mutable typename TTypes<T>::Matrix Tout_;
+  const T* const params_;
+  T* const out_;
+  // The sizes and the strides, in elements, of the indexed dimensions.
+  Eigen::array<Eigen::DenseIndex, IXDIM> dims_;
+  Eigen::array<Eigen::DenseIndex, IXDIM> strides_;
   std::atomic<Index>* error_loc_;
 };
 
@@ -106,10 +139,7 @@ struct GatherNdSlice<CPUDevice, T, Index, IXDIM> {
         slice_size, Tindices, Tparams, Tout, &error_loc);
 
     auto compute_shard = [&](Eigen::Index begin, Eigen::Index end) {
-      for (Eigen::Index i = begin; i < end; ++i) {
-        const Eigen::array<Eigen::Index, 1> loc{i};
-        gather_nd_generator(loc);
-      }
+      gather_nd_generator(static_cast<Index>(begin), static_cast<Index>(end));
     };
     Eigen::Index bytes_moved = sizeof(T) * (slice_size + IXDIM);
     auto cost = Eigen::TensorOpCost(bytes_moved /* bytes loaded */,
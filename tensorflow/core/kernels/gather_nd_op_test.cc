@@ -17,6 +17,7 @@ limitations under the License.
 #include <memory>
 #include <vector>
 
+#include "absl/strings/match.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/fake_input.h"
@@ -106,6 +107,51 @@ TEST_F(GatherNdOpTest, Quantized_INT8) {
   test::ExpectTensorEqual<qint8>(expected, *GetOutput(0));
 }
 
+TEST_F(GatherNdOpTest, ManySlices) {
+  MakeOp(DT_FLOAT, DT_INT64);
+
+  const int64_t kRows = 200;
+  const int64_t kCols = 30;
+  const int64_t kSliceSize = 5;
+  const int64_t kNumSlices = 10000;
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<float> params(kRows * kCols * kSliceSize);
+  for (int64_t i = 0; i < params.size(); ++i) params[i] = i;
+  std::vector<int64_t> indices;
+  std::vector<float> expected;
+  for (int64_t i = 0; i < kNumSlices; ++i) {
+    const int64_t row = rnd.Uniform(kRows);
+    const int64_t col = rnd.Uniform(kCols);
+    indices.push_back(row);
+    indices.push_back(col);
+    for (int64_t j = 0; j < kSliceSize; ++j) {
+      expected.push_back(params[(row * kCols + col) * kSliceSize + j]);
+    }
+  }
+  AddInputFromArray<float>(TensorShape({kRows, kCols, kSliceSize}), params);
+  AddInputFromArray<int64_t>(TensorShape({kNumSlices, 2}), indices);
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected_tensor(allocator(), DT_FLOAT,
+                         TensorShape({kNumSlices, kSliceSize}));
+  test::FillValues<float>(&expected_tensor, expected);
+  test::ExpectTensorEqual<float>(expected_tensor, *GetOutput(0));
+}
+
+TEST_F(GatherNdOpTest, Error_OutOfRangeAmongManyIndices) {
+  MakeOp(DT_FLOAT, DT_INT32);
+
+  std::vector<int32> indices(10000, 3);
+  indices[7777] = 5;
+  AddInputFromArray<float>(TensorShape({5}), {0, 1, 2, 8, 4});
+  AddInputFromArray<int32>(TensorShape({10000, 1}), indices);
+  Status s = RunOpKernel();
+  EXPECT_TRUE(absl::StrContains(
+      s.ToString(), "indices[7777] = [5] does not index into param shape [5]"))
+      << s;
+}
+
 constexpr int kLookups = 2000;
 
 template <typename Index>
@@ -0,0 +1,97 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_HASH_BUCKET_UTIL_H_
+#define TENSORFLOW_CORE_KERNELS_HASH_BUCKET_UTIL_H_
+
+#include <algorithm>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/platform/prefetch.h"
+#include "tensorflow/core/platform/tstring.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+namespace hash_bucket_util {
+
+// Strings are hashed in batches of this many elements. The payloads of the
+// next batch are prefetched while the current one is hashed, so that the
+// cache misses on out-of-line string data overlap with hashing.
+constexpr int64_t kHashBatchSize = 16;
+
+// Estimated cost, in cycles, of hashing a string of `length` bytes.
+inline int64_t StringHashCost(int64_t length) { return 20 + length / 2; }
+
+// Returns the estimated cost of hashing one of `strings[0, n)`, based on the
+// lengths of a few evenly spaced elements.
+inline int64_t EstimateStringHashCost(const tstring* strings, int64_t n) {
+  constexpr int64_t kNumSamples = 16;
+  if (n == 0) return StringHashCost(0);
+  const int64_t step = std::max<int64_t>(1, n / kNumSamples);
+  int64_t total_length = 0;
+  int64_t num_sampled = 0;
+  for (int64_t i = 0; i < n; i += step) {
+    total_length += strings[i].size();
+    ++num_sampled;
+  }
+  return StringHashCost(total_length / num_sampled);
+}
+
+// Computes `hash(strings[i])` into `hashes[i]` for every i in [begin, end).
+// `hash` is a callable taking a `const tstring&` and returning a uint64.
+template <typename HashFn>
+void HashStrings(const tstring* strings, int64_t begin, int64_t end,
+                 HashFn hash, uint64* hashes) {
+  for (int64_t batch = begin; batch < end; batch += kHashBatchSize) {
+    const int64_t batch_end = std::min(batch + kHashBatchSize, end);
+    const int64_t next_end = std::min(batch_end + kHashBatchSize, end);
+    for (int64_t i = batch_end; i < next_end; ++i) {
+      port::prefetch<port::PREFETCH_HINT_T0>(strings[i].data());
+    }
+    for (int64_t i = batch; i < batch_end; ++i) {
+      hashes[i] = hash(strings[i]);
+    }
+  }
+}
+
+// Stores `hash(strings[i]) % num_buckets` in `output[i]` for every element of
+// `strings[0, n)`, splitting the work across the CPU worker threads of
+// `context`. The result is the same as hashing the elements one at a time.
+template <typename HashFn>
+void StringsToHashBuckets(OpKernelContext* context, const tstring* strings,
+                          int64_t n, int64_t num_buckets, HashFn hash,
+                          int64_t* output) {
+  auto to_buckets = [strings, num_buckets, &hash, output](int64_t begin,
+                                                          int64_t end) {
+    // Hashes are staged in `output` itself, which has the same width.
+    uint64* hashes = reinterpret_cast<uint64*>(output);
+    HashStrings(strings, begin, end, hash, hashes);
+    for (int64_t i = begin; i < end; ++i) {
+      // The number of buckets is always in the positive range of int64 so is
+      // the resulting bucket_id. Casting the bucket_id from uint64 to int64 is
+      // safe.
+      output[i] = static_cast<int64_t>(hashes[i] % num_buckets);
+    }
+  };
+  auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+  Shard(worker_threads->num_threads, worker_threads->workers, n,
+        EstimateStringHashCost(strings, n), to_buckets);
+}
+
+}  // namespace hash_bucket_util
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_HASH_BUCKET_UTIL_H_
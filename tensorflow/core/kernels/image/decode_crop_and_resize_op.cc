@@ -0,0 +1,402 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// See docs in ../ops/image_ops.cc
+//
+// Fuses decoding, cropping and bilinear resizing of JPEG and PNG images, so
+// that input pipelines neither decode the pixels they crop away nor
+// materialize the full resolution image.  JPEG images are decoded in the DCT
+// domain at the smallest scale still at least as large as the output.
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "third_party/eigen3/Eigen/Core"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
+#include "tensorflow/core/lib/jpeg/jpeg_mem.h"
+#include "tensorflow/core/lib/png/png_io.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+namespace {
+
+static const char kPngMagicBytes[] = "\x89\x50\x4E\x47\x0D\x0A\x1A\x0A";
+static const char kJpegMagicBytes[] = "\xff\xd8\xff";
+
+// The cost of decoding an image, for sharding: large enough for every image
+// of a batch to be decoded by its own thread.
+constexpr int64_t kCostPerImage = 1 << 20;
+
+// A crop window, in pixels.
+struct Crop {
+  int64_t y;
+  int64_t x;
+  int64_t height;
+  int64_t width;
+};
+
+// Validates "crop_window", [y, x, height, width] in an image of "height" by
+// "width" pixels, or nullptr for the whole image.
+Status GetCrop(const int32* crop_window, int64_t height, int64_t width,
+               Crop* crop) {
+  if (crop_window == nullptr) {
+    *crop = {0, 0, height, width};
+    return Status::OK();
+  }
+  *crop = {crop_window[0], crop_window[1], crop_window[2], crop_window[3]};
+  if (crop->y < 0 || crop->x < 0 || crop->height <= 0 || crop->width <= 0 ||
+      crop->y + crop->height > height || crop->x + crop->width > width) {
+    return errors::InvalidArgument(
+        "Invalid crop window [", crop->y, ", ", crop->x, ", ", crop->height,
+        ", ", crop->width, "] for an image of ", height, "x", width,
+        " pixels");
+  }
+  return Status::OK();
+}
+
+// The two input pixels an output pixel is interpolated from, along one
+// dimension.
+struct Taps {
+  int64_t lower;
+  int64_t upper;
+  float lerp;
+};
+
+// Computes the taps of "out_size" pixels sampling, with half-pixel centers,
+// the "extent" pixels starting at "offset" of a dimension of "in_size"
+// pixels.  The input pixels are multiplied by "stride".
+std::vector<Taps> ComputeTaps(float offset, float extent, int64_t in_size,
+                              int64_t out_size, int64_t stride) {
+  std::vector<Taps> taps(out_size);
+  const float scale = extent / out_size;
+  const float max_in = in_size - 1;
+  for (int64_t i = 0; i < out_size; ++i) {
+    const float in =
+        std::min(std::max(offset + (i + 0.5f) * scale - 0.5f, 0.0f), max_in);
+    const int64_t lower = static_cast<int64_t>(in);
+    taps[i].lower = lower * stride;
+    taps[i].upper = std::min(lower + 1, in_size - 1) * stride;
+    taps[i].lerp = in - lower;
+  }
+  return taps;
+}
+
+// Interpolates the uint8 input row "row" horizontally into "out".  Fixing the
+// number of channels lets the compiler unroll the inner loop.
+template <int kChannels>
+void ResizeRow(const uint8* row, const std::vector<Taps>& xs, float* out) {
+  for (const Taps& x : xs) {
+    const uint8* lower = row + x.lower;
+    const uint8* upper = row + x.upper;
+    for (int c = 0; c < kChannels; ++c) {
+      *out++ = lower[c] + (upper[c] - lower[c]) * x.lerp;
+    }
+  }
+}
+
+// Resizes the window of "window_height" by "window_width" pixels at
+// ("y_offset", "x_offset") of "image", of shape [in_height, in_width,
+// channels], to "output", of shape [out_height, out_width, channels].  The
+// window may start and end between pixels.
+//
+// The resize is separable: every input row used is interpolated horizontally
+// once, and the pairs of interpolated rows are then blended with Eigen's
+// vectorized array ops.
+void ResizeWindow(const uint8* image, int64_t in_height, int64_t in_width,
+                  int channels, float y_offset, float x_offset,
+                  float window_height, float window_width, int64_t out_height,
+                  int64_t out_width, float* output) {
+  const std::vector<Taps> ys =
+      ComputeTaps(y_offset, window_height, in_height, out_height, 1);
+  const std::vector<Taps> xs =
+      ComputeTaps(x_offset, window_width, in_width, out_width, channels);
+  const int64_t in_row_size = in_width * channels;
+  const int64_t out_row_size = out_width * channels;
+  auto resize_row = [&](int64_t y, float* out) {
+    const uint8* row = image + y * in_row_size;
+    if (channels == 3) {
+      ResizeRow<3>(row, xs, out);
+    } else {
+      ResizeRow<1>(row, xs, out);
+    }
+  };
+
+  // The last two interpolated rows, which neighboring output rows share.
+  std::vector<float> top(out_row_size);
+  std::vector<float> bottom(out_row_size);
+  int64_t top_row = -1;
+  int64_t bottom_row = -1;
+  for (int64_t y = 0; y < out_height; ++y) {
+    const Taps& taps = ys[y];
+    if (taps.lower != top_row) {
+      if (taps.lower == bottom_row) {
+        std::swap(top, bottom);
+        std::swap(top_row, bottom_row);
+      } else {
+        resize_row(taps.lower, top.data());
+        top_row = taps.lower;
+      }
+    }
+    const float* bottom_data = top.data();
+    if (taps.upper != taps.lower) {
+      if (taps.upper != bottom_row) {
+        resize_row(taps.upper, bottom.data());
+        bottom_row = taps.upper;
+      }
+      bottom_data = bottom.data();
+    }
+    Eigen::Map<const Eigen::ArrayXf> top_v(top.data(), out_row_size);
+    Eigen::Map<const Eigen::ArrayXf> bottom_v(bottom_data, out_row_size);
+    Eigen::Map<Eigen::ArrayXf> out_v(output + y * out_row_size, out_row_size);
+    out_v = top_v + (bottom_v - top_v) * taps.lerp;
+  }
+}
+
+// Decodes "crop_window" of the JPEG image "contents" at the smallest scale
+// at which it still has at least "out_height" by "out_width" pixels, and
+// resizes it.
+Status DecodeCropAndResizeJpeg(StringPiece contents, const int32* crop_window,
+                               const jpeg::UncompressFlags& base_flags,
+                               int64_t out_height, int64_t out_width,
+                               float* output) {
+  int image_height;
+  int image_width;
+  if (!jpeg::GetImageInfo(contents.data(), contents.size(), &image_width,
+                          &image_height, nullptr)) {
+    return errors::InvalidArgument("Invalid JPEG data, size ",
+                                   contents.size());
+  }
+  Crop crop;
+  TF_RETURN_IF_ERROR(GetCrop(crop_window, image_height, image_width, &crop));
+
+  jpeg::UncompressFlags flags = base_flags;
+  flags.ratio = 8;
+  while (flags.ratio > 1 && (crop.height < out_height * flags.ratio ||
+                             crop.width < out_width * flags.ratio)) {
+    flags.ratio /= 2;
+  }
+  // libjpeg rounds the scaled size up.  The crop window is widened to whole
+  // pixels of the scaled image, and the exact window resampled from it.
+  const int ratio = flags.ratio;
+  const int64_t scaled_height = (image_height + ratio - 1) / ratio;
+  const int64_t scaled_width = (image_width + ratio - 1) / ratio;
+  const int64_t y0 = crop.y / ratio;
+  const int64_t x0 = crop.x / ratio;
+  const int64_t y1 =
+      std::min((crop.y + crop.height + ratio - 1) / ratio, scaled_height);
+  const int64_t x1 =
+      std::min((crop.x + crop.width + ratio - 1) / ratio, scaled_width);
+  flags.crop = y1 - y0 != scaled_height || x1 - x0 != scaled_width;
+  flags.crop_y = y0;
+  flags.crop_x = x0;
+  flags.crop_height = y1 - y0;
+  flags.crop_width = x1 - x0;
+
+  std::unique_ptr<uint8[]> buffer;
+  int decoded_height = 0;
+  int decoded_width = 0;
+  const uint8* decoded = jpeg::Uncompress(
+      contents.data(), contents.size(), flags, nullptr /* nwarn */,
+      [&](int width, int height, int channels) -> uint8* {
+        decoded_width = width;
+        decoded_height = height;
+        buffer.reset(new uint8[static_cast<int64_t>(height) * width *
+                               channels]);
+        return buffer.get();
+      });
+  if (decoded == nullptr) {
+    return errors::InvalidArgument(
+        "jpeg::Uncompress failed. Invalid JPEG data, size ", contents.size());
+  }
+  ResizeWindow(decoded, decoded_height, decoded_width, flags.components,
+               static_cast<float>(crop.y) / ratio - y0,
+               static_cast<float>(crop.x) / ratio - x0,
+               static_cast<float>(crop.height) / ratio,
+               static_cast<float>(crop.width) / ratio, out_height, out_width,
+               output);
+  return Status::OK();
+}
+
+// Decodes the PNG image "contents" and resizes "crop_window" of it.  PNG has
+// no equivalent of DCT scaling, and libpng decodes whole rows, so only the
+// resize is fused.
+Status DecodeCropAndResizePng(StringPiece contents, const int32* crop_window,
+                              int channels, int64_t out_height,
+                              int64_t out_width, float* output) {
+  png::DecodeContext decode;
+  if (!png::CommonInitDecode(contents, channels, 8, &decode)) {
+    return errors::InvalidArgument(
+        "Invalid PNG. Failed to initialize decoder.");
+  }
+  auto cleanup =
+      gtl::MakeCleanup([&decode]() { png::CommonFreeDecode(&decode); });
+  const int64_t height = decode.height;
+  const int64_t width = decode.width;
+  if (width <= 0 || width >= (1LL << 27) || height <= 0 ||
+      height >= (1LL << 27) || width * height >= (1LL << 29)) {
+    return errors::InvalidArgument("PNG size too large for int: ", width,
+                                   " by ", height);
+  }
+  Crop crop;
+  TF_RETURN_IF_ERROR(GetCrop(crop_window, height, width, &crop));
+
+  std::unique_ptr<uint8[]> buffer(new uint8[height * width * channels]);
+  if (!png::CommonFinishDecode(buffer.get(), width * channels, &decode)) {
+    return errors::InvalidArgument("Invalid PNG data, size ",
+                                   contents.size());
+  }
+  ResizeWindow(buffer.get(), height, width, channels, crop.y, crop.x,
+               crop.height, crop.width, out_height, out_width, output);
+  return Status::OK();
+}
+
+class DecodeCropAndResizeImageOp : public OpKernel {
+ public:
+  explicit DecodeCropAndResizeImageOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    batched_ = type_string() == "_BatchDecodeCropAndResizeImage";
+    OP_REQUIRES_OK(context, context->GetAttr("channels", &flags_.components));
+    OP_REQUIRES(context, flags_.components == 1 || flags_.components == 3,
+                errors::InvalidArgument("channels must be 1 or 3, got ",
+                                        flags_.components));
+    string dct_method;
+    OP_REQUIRES_OK(context, context->GetAttr("dct_method", &dct_method));
+    OP_REQUIRES(
+        context,
+        (dct_method.empty() || dct_method == "INTEGER_FAST" ||
+         dct_method == "INTEGER_ACCURATE"),
+        errors::InvalidArgument("dct_method must be one of "
+                                "{'', 'INTEGER_FAST', 'INTEGER_ACCURATE'}"));
+    flags_.dct_method =
+        dct_method == "INTEGER_ACCURATE" ? JDCT_ISLOW : JDCT_IFAST;
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& contents = context->input(0);
+    const Tensor& crop_windows = context->input(1);
+    const Tensor& size = context->input(2);
+    if (batched_) {
+      OP_REQUIRES(context, TensorShapeUtils::IsVector(contents.shape()),
+                  errors::InvalidArgument("contents must be a vector, got ",
+                                          contents.shape().DebugString()));
+    } else {
+      OP_REQUIRES(context, TensorShapeUtils::IsScalar(contents.shape()),
+                  errors::InvalidArgument("contents must be a scalar, got ",
+                                          contents.shape().DebugString()));
+    }
+    const int64_t batch_size = contents.NumElements();
+    const bool crop = crop_windows.NumElements() > 0;
+    if (crop) {
+      const TensorShape expected_shape = batched_
+                                             ? TensorShape({batch_size, 4})
+                                             : TensorShape({4});
+      OP_REQUIRES(context, crop_windows.shape() == expected_shape,
+                  errors::InvalidArgument(
+                      "crop windows must have shape ",
+                      expected_shape.DebugString(), " or be empty, got ",
+                      crop_windows.shape().DebugString()));
+    }
+    OP_REQUIRES(context,
+                TensorShapeUtils::IsVector(size.shape()) &&
+                    size.NumElements() == 2,
+                errors::InvalidArgument("size must be a 2-element vector, got ",
+                                        size.shape().DebugString()));
+    const int64_t out_height = size.vec<int32>()(0);
+    const int64_t out_width = size.vec<int32>()(1);
+    OP_REQUIRES(context, out_height > 0 && out_width > 0,
+                errors::InvalidArgument("size must be positive, got ",
+                                        size.DebugString()));
+
+    TensorShape output_shape({out_height, out_width, flags_.components});
+    if (batched_) output_shape.InsertDim(0, batch_size);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(0, output_shape, &output));
+    const int64_t image_size = out_height * out_width * flags_.components;
+
+    const auto contents_flat = contents.flat<tstring>();
+    const int32* crop_data = crop ? crop_windows.flat<int32>().data() : nullptr;
+    float* output_data = output->flat<float>().data();
+    std::vector<Status> statuses(batch_size);
+    auto decode = [&](int64_t start, int64_t limit) {
+      for (int64_t i = start; i < limit; ++i) {
+        statuses[i] = DecodeCropAndResize(
+            contents_flat(i), crop ? crop_data + 4 * i : nullptr, out_height,
+            out_width, output_data + i * image_size);
+      }
+    };
+    if (batched_) {
+      auto* worker_threads = context->device()->tensorflow_cpu_worker_threads();
+      Shard(worker_threads->num_threads, worker_threads->workers, batch_size,
+            kCostPerImage, decode);
+    } else {
+      decode(0, batch_size);
+    }
+    for (int64_t i = 0; i < batch_size; ++i) {
+      if (!statuses[i].ok() && batched_) {
+        errors::AppendToMessage(&statuses[i], "\nWhile decoding image ", i);
+      }
+      OP_REQUIRES_OK(context, statuses[i]);
+    }
+  }
+
+ private:
+  Status DecodeCropAndResize(StringPiece contents, const int32* crop_window,
+                             int64_t out_height, int64_t out_width,
+                             float* output) const {
+    if (contents.size() > std::numeric_limits<int>::max()) {
+      return errors::InvalidArgument("Input contents are too large for int: ",
+                                     contents.size());
+    }
+    if (absl::StartsWith(contents, kJpegMagicBytes)) {
+      return DecodeCropAndResizeJpeg(contents, crop_window, flags_,
+                                     out_height, out_width, output);
+    }
+    if (absl::StartsWith(contents, kPngMagicBytes)) {
+      return DecodeCropAndResizePng(contents, crop_window, flags_.components,
+                                    out_height, out_width, output);
+    }
+    return errors::InvalidArgument(
+        "Unknown image file format. One of JPEG, PNG required.");
+  }
+
+  bool batched_;
+  // The channels and DCT method of the images.
+  jpeg::UncompressFlags flags_;
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("_DecodeCropAndResizeImage").Device(DEVICE_CPU).HostMemory("size"),
+    DecodeCropAndResizeImageOp);
+REGISTER_KERNEL_BUILDER(Name("_BatchDecodeCropAndResizeImage")
+                            .Device(DEVICE_CPU)
+                            .HostMemory("size"),
+                        DecodeCropAndResizeImageOp);
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,190 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/jpeg/jpeg_mem.h"
+#include "tensorflow/core/lib/png/png_io.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// The value of channel "c" of the pixel at ("y", "x") of the test images, a
+// linear gradient, which bilinear resizing and DCT scaling both preserve.
+float Gradient(float y, float x, int c) { return 2 * x + y + 10 * c; }
+
+// Returns a "height" by "width" RGB gradient image.
+std::vector<uint8> MakeImage(int height, int width) {
+  std::vector<uint8> image(height * width * 3);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      for (int c = 0; c < 3; ++c) {
+        image[(y * width + x) * 3 + c] = Gradient(y, x, c);
+      }
+    }
+  }
+  return image;
+}
+
+tstring EncodePng(int height, int width) {
+  const std::vector<uint8> image = MakeImage(height, width);
+  tstring png;
+  CHECK(png::WriteImageToBuffer(image.data(), width, height, width * 3, 3, 8,
+                                -1, &png, nullptr));
+  return png;
+}
+
+tstring EncodeJpeg(int height, int width) {
+  const std::vector<uint8> image = MakeImage(height, width);
+  jpeg::CompressFlags flags;
+  flags.format = jpeg::FORMAT_RGB;
+  flags.quality = 100;
+  flags.chroma_downsampling = false;
+  return jpeg::Compress(image.data(), width, height, flags);
+}
+
+// Returns the expected resize of the crop [y, x, height, width] of the
+// gradient to "out_height" by "out_width" pixels.
+Tensor ExpectedImage(float y, float x, float height, float width,
+                     int out_height, int out_width) {
+  Tensor expected(DT_FLOAT, TensorShape({out_height, out_width, 3}));
+  test::FillFn<float>(&expected, [=](int i) -> float {
+    const int c = i % 3;
+    const int out_x = i / 3 % out_width;
+    const int out_y = i / 3 / out_width;
+    return Gradient(y + (out_y + 0.5f) * height / out_height - 0.5f,
+                    x + (out_x + 0.5f) * width / out_width - 0.5f, c);
+  });
+  return expected;
+}
+
+class DecodeCropAndResizeImageOpTest : public OpsTestBase {
+ protected:
+  Status Decode(const tstring& contents, const std::vector<int32>& crop_window,
+                int height, int width) {
+    TF_RETURN_IF_ERROR(NodeDefBuilder("decode", "_DecodeCropAndResizeImage")
+                           .Input(FakeInput(DT_STRING))
+                           .Input(FakeInput(DT_INT32))
+                           .Input(FakeInput(DT_INT32))
+                           .Finalize(node_def()));
+    TF_RETURN_IF_ERROR(InitOp());
+    inputs_.clear();
+    AddInputFromArray<tstring>(TensorShape({}), {contents});
+    AddInputFromArray<int32>(
+        TensorShape({static_cast<int64_t>(crop_window.size())}), crop_window);
+    AddInputFromArray<int32>(TensorShape({2}), {height, width});
+    return RunOpKernel();
+  }
+
+  Status DecodeBatch(const std::vector<tstring>& contents,
+                     const std::vector<int32>& crop_windows, int height,
+                     int width) {
+    TF_RETURN_IF_ERROR(
+        NodeDefBuilder("decode", "_BatchDecodeCropAndResizeImage")
+            .Input(FakeInput(DT_STRING))
+            .Input(FakeInput(DT_INT32))
+            .Input(FakeInput(DT_INT32))
+            .Finalize(node_def()));
+    TF_RETURN_IF_ERROR(InitOp());
+    inputs_.clear();
+    AddInputFromArray<tstring>(
+        TensorShape({static_cast<int64_t>(contents.size())}), contents);
+    AddInputFromArray<int32>(
+        TensorShape({static_cast<int64_t>(crop_windows.size() / 4), 4}),
+        crop_windows);
+    AddInputFromArray<int32>(TensorShape({2}), {height, width});
+    return RunOpKernel();
+  }
+};
+
+TEST_F(DecodeCropAndResizeImageOpTest, CropsPng) {
+  TF_ASSERT_OK(Decode(EncodePng(20, 30), {3, 5, 8, 10}, 8, 10));
+  test::ExpectTensorEqual<float>(ExpectedImage(3, 5, 8, 10, 8, 10),
+                                 *GetOutput(0));
+}
+
+TEST_F(DecodeCropAndResizeImageOpTest, ResizesPng) {
+  TF_ASSERT_OK(Decode(EncodePng(32, 32), {}, 16, 8));
+  test::ExpectTensorNear<float>(ExpectedImage(0, 0, 32, 32, 16, 8),
+                                *GetOutput(0), 1e-4);
+  TF_ASSERT_OK(Decode(EncodePng(32, 32), {4, 2, 12, 20}, 5, 7));
+  test::ExpectTensorNear<float>(ExpectedImage(4, 2, 12, 20, 5, 7),
+                                *GetOutput(0), 1e-4);
+}
+
+TEST_F(DecodeCropAndResizeImageOpTest, ResizesJpegWhileDecoding) {
+  const tstring jpeg = EncodeJpeg(64, 64);
+  // Decoded at 1/8 scale.
+  TF_ASSERT_OK(Decode(jpeg, {16, 8, 32, 48}, 4, 6));
+  test::ExpectTensorNear<float>(ExpectedImage(16, 8, 32, 48, 4, 6),
+                                *GetOutput(0), 4);
+  // Decoded at 1/4 scale, with a window not aligned to the scaled pixels.
+  TF_ASSERT_OK(Decode(jpeg, {3, 5, 40, 30}, 10, 7));
+  test::ExpectTensorNear<float>(ExpectedImage(3, 5, 40, 30, 10, 7),
+                                *GetOutput(0), 4);
+  // Decoded at full scale.
+  TF_ASSERT_OK(Decode(jpeg, {}, 48, 40));
+  test::ExpectTensorNear<float>(ExpectedImage(0, 0, 64, 64, 48, 40),
+                                *GetOutput(0), 4);
+}
+
+TEST_F(DecodeCropAndResizeImageOpTest, DecodesBatch) {
+  const std::vector<tstring> contents = {EncodePng(20, 30),
+                                         EncodeJpeg(64, 64)};
+  const std::vector<int32> crop_windows = {2, 4, 16, 24, 8, 16, 48, 40};
+  TF_ASSERT_OK(DecodeBatch(contents, crop_windows, 6, 5));
+  const Tensor batch = *GetOutput(0);
+  ASSERT_EQ(batch.shape(), TensorShape({2, 6, 5, 3}));
+  for (int i = 0; i < 2; ++i) {
+    TF_ASSERT_OK(Decode(contents[i],
+                        std::vector<int32>(crop_windows.begin() + 4 * i,
+                                           crop_windows.begin() + 4 * i + 4),
+                        6, 5));
+    test::ExpectTensorEqual<float>(*GetOutput(0), batch.SubSlice(i));
+  }
+
+  // Without crop windows.
+  TF_ASSERT_OK(Decode(contents[1], {}, 6, 5));
+  const Tensor expected = *GetOutput(0);
+  TF_ASSERT_OK(DecodeBatch(contents, {}, 6, 5));
+  test::ExpectTensorEqual<float>(expected, GetOutput(0)->SubSlice(1));
+}
+
+TEST_F(DecodeCropAndResizeImageOpTest, Errors) {
+  const tstring png = EncodePng(20, 30);
+  EXPECT_TRUE(errors::IsInvalidArgument(Decode(png, {15, 0, 6, 30}, 4, 4)));
+  EXPECT_TRUE(errors::IsInvalidArgument(Decode(png, {0, -1, 5, 5}, 4, 4)));
+  EXPECT_TRUE(errors::IsInvalidArgument(Decode(png, {0, 0, 5}, 4, 4)));
+  EXPECT_TRUE(errors::IsInvalidArgument(Decode(png, {}, 0, 4)));
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      Decode(EncodeJpeg(16, 16), {8, 8, 9, 8}, 4, 4)));
+  EXPECT_TRUE(errors::IsInvalidArgument(Decode("GIF89a", {}, 4, 4)));
+
+  const Status status = DecodeBatch({png, "not an image"}, {}, 4, 4);
+  EXPECT_TRUE(errors::IsInvalidArgument(status));
+  EXPECT_TRUE(absl::StrContains(status.error_message(), "image 1"));
+}
+
+}  // namespace
+}  // namespace tensorflow
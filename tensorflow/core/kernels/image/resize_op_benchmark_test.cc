@@ -22,10 +22,14 @@ limitations under the License.
 namespace tensorflow {
 
 static Graph* Resize(const char* algorithm, int batches, int width,
-                     int height) {
+                     int height, DataType dtype = DT_FLOAT) {
   Graph* g = new Graph(OpRegistry::Global());
-  Tensor in(DT_FLOAT, TensorShape({batches, width, height, 3}));
-  in.flat<float>().setRandom();
+  Tensor in(dtype, TensorShape({batches, width, height, 3}));
+  if (dtype == DT_FLOAT) {
+    in.flat<float>().setRandom();
+  } else {
+    in.flat<uint8>().setRandom();
+  }
 
   Tensor out_size(DT_INT32, TensorShape({2}));
   auto out_size_flat = out_size.flat<int32>();
@@ -51,8 +55,76 @@ static Graph* Resize(const char* algorithm, int batches, int width,
   }                                                               \
   BENCHMARK(BM_Resize_##ALGORITHM##_##DEVICE##_##B##_##W##_##H)
 
+#define BM_ResizeUint8Dev(DEVICE, ALGORITHM, B, W, H)                    \
+  static void BM_ResizeUint8_##ALGORITHM##_##DEVICE##_##B##_##W##_##H(   \
+      ::testing::benchmark::State& state) {                              \
+    test::Benchmark(#DEVICE, Resize(#ALGORITHM, B, W, H, DT_UINT8),      \
+                    /*old_benchmark_api*/ false)                         \
+        .Run(state);                                                     \
+    state.SetItemsProcessed(state.iterations() * B * W * H * 3);         \
+  }                                                                      \
+  BENCHMARK(BM_ResizeUint8_##ALGORITHM##_##DEVICE##_##B##_##W##_##H)
+
 BM_ResizeDev(cpu, ResizeNearestNeighbor, 10, 499, 499);
 BM_ResizeDev(cpu, ResizeBilinear, 10, 499, 499);
+BM_ResizeDev(cpu, ResizeBicubic, 10, 499, 499);
+BM_ResizeDev(cpu, ResizeArea, 10, 499, 499);
+BM_ResizeUint8Dev(cpu, ResizeBilinear, 10, 499, 499);
+BM_ResizeUint8Dev(cpu, ResizeArea, 10, 499, 499);
+
+// Resizes "batches" uint8 or float images of "height" by "width" pixels to
+// "out_height" by "out_width" pixels with ScaleAndTranslate.
+static Graph* ScaleAndTranslate(const char* kernel_type, int batches,
+                                int width, int height, int out_width,
+                                int out_height, DataType dtype) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor in(dtype, TensorShape({batches, height, width, 3}));
+  if (dtype == DT_FLOAT) {
+    in.flat<float>().setRandom();
+  } else {
+    in.flat<uint8>().setRandom();
+  }
+
+  Tensor size(DT_INT32, TensorShape({2}));
+  size.flat<int32>()(0) = out_height;
+  size.flat<int32>()(1) = out_width;
+  Tensor scale(DT_FLOAT, TensorShape({2}));
+  scale.flat<float>()(0) = static_cast<float>(out_height) / height;
+  scale.flat<float>()(1) = static_cast<float>(out_width) / width;
+  Tensor translation(DT_FLOAT, TensorShape({2}));
+  translation.flat<float>().setZero();
+
+  Node* ret;
+  Status s = NodeBuilder(g->NewName("n"), "ScaleAndTranslate")
+                 .Input(test::graph::Constant(g, in))
+                 .Input(test::graph::Constant(g, size))
+                 .Input(test::graph::Constant(g, scale))
+                 .Input(test::graph::Constant(g, translation))
+                 .Attr("kernel_type", kernel_type)
+                 .Attr("antialias", true)
+                 .Finalize(g, &ret);
+  assert(s.ok());
+  return g;
+}
+
+#define BM_ScaleAndTranslateDev(DEVICE, KERNEL, DTYPE, B, W, H, OW, OH)  \
+  static void BM_ScaleAndTranslate_##KERNEL##_##DTYPE##_##DEVICE##_##OW( \
+      ::testing::benchmark::State& state) {                             \
+    test::Benchmark(#DEVICE,                                            \
+                    ScaleAndTranslate(#KERNEL, B, W, H, OW, OH, DTYPE), \
+                    /*old_benchmark_api*/ false)                        \
+        .Run(state);                                                    \
+    state.SetItemsProcessed(state.iterations() * B * OW * OH * 3);      \
+  }                                                                     \
+  BENCHMARK(BM_ScaleAndTranslate_##KERNEL##_##DTYPE##_##DEVICE##_##OW)
+
+// Downsampling, where the antialiased kernels are widest, and upsampling.
+BM_ScaleAndTranslateDev(cpu, lanczos3, DT_FLOAT, 10, 640, 480, 224, 224);
+BM_ScaleAndTranslateDev(cpu, lanczos3, DT_UINT8, 10, 640, 480, 224, 224);
+BM_ScaleAndTranslateDev(cpu, triangle, DT_FLOAT, 10, 640, 480, 224, 224);
+BM_ScaleAndTranslateDev(cpu, triangle, DT_UINT8, 10, 640, 480, 224, 224);
+BM_ScaleAndTranslateDev(cpu, keyscubic, DT_FLOAT, 10, 224, 224, 640, 480);
+BM_ScaleAndTranslateDev(cpu, keyscubic, DT_UINT8, 10, 224, 224, 640, 480);
 
 #if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
 BM_ResizeDev(gpu, ResizeNearestNeighbor, 10, 499, 499);
@@ -19,6 +19,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/image/scale_and_translate_op.h"
 
 #include <memory>
+#include <type_traits>
 
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/bounds_check.h"
@@ -29,9 +30,11 @@ limitations under the License.
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/kernels/image/sampling_kernels.h"
+#include "tensorflow/core/kernels/image/separable_resize.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 using strings::Printf;
@@ -277,6 +280,9 @@ class ScaleAndTranslateOp : public OpKernel {
     OP_REQUIRES(context, kernel_type_ != functor::SamplingKernelTypeEnd,
                 errors::InvalidArgument("Unrecognized kernel type: " +
                                         kernel_type_str));
+    OP_REQUIRES_OK(context, ReadBoolFromEnvVar(
+                                "TF_SCALE_AND_TRANSLATE_UINT8_FIXED_POINT",
+                                false, &use_fixed_point_));
   }
 
   void Compute(OpKernelContext* context) override {
@@ -333,46 +339,48 @@ class ScaleAndTranslateOp : public OpKernel {
     // Return if the output is empty.
     if (output->NumElements() == 0) return;
 
-    typename TTypes<T, 4>::ConstTensor image_data(input.tensor<T, 4>());
-    TTypes<float, 4>::Tensor output_data = output->tensor<float, 4>();
-
-    functor::Spans col_spans;
-    OP_REQUIRES_OK(
-        context,
-        ComputeSpans(context, kernel_type_, output_width, input_width,
-                     col_scale, col_translation, antialias_, &col_spans));
-    functor::Spans row_spans;
-    OP_REQUIRES_OK(
-        context,
-        ComputeSpans(context, kernel_type_, output_height, input_height,
-                     row_scale, row_translation, antialias_, &row_spans));
+    // The filter tables are cached across calls, as the sizes, scales and
+    // translations of a model rarely change.
+    std::shared_ptr<const functor::ResizeFilter> row_filter;
+    OP_REQUIRES_OK(context, functor::GetResizeFilter(
+                                kernel_type_, input_height, output_height,
+                                row_scale, row_translation, antialias_,
+                                &row_filter));
+    std::shared_ptr<const functor::ResizeFilter> col_filter;
+    OP_REQUIRES_OK(context, functor::GetResizeFilter(
+                                kernel_type_, input_width, output_width,
+                                col_scale, col_translation, antialias_,
+                                &col_filter));
+
+    // The intermediate buffer holds the images resampled along their rows.
+    const TensorShape intermediate_shape(
+        {batch_size, output_height, input_width, channels});
     Tensor intermediate_t;
-    OP_REQUIRES_OK(
-        context, context->allocate_temp(DT_FLOAT,
-                                        TensorShape({batch_size, output_height,
-                                                     input_width, channels}),
-                                        &intermediate_t));
-    TTypes<float, 4>::Tensor intermediate_data =
-        intermediate_t.tensor<float, 4>();
-
-    const functor::Spans& const_row_spans = row_spans;
-    typename TTypes<int32, 1>::ConstTensor row_starts(
-        const_row_spans.starts.tensor<int32, 1>());
-    typename TTypes<float, 1>::ConstTensor row_weights(
-        const_row_spans.weights.tensor<float, 1>());
-    const functor::Spans& const_col_spans = col_spans;
-    typename TTypes<int32, 1>::ConstTensor col_starts(
-        const_col_spans.starts.tensor<int32, 1>());
-    typename TTypes<float, 1>::ConstTensor col_weights(
-        const_col_spans.weights.tensor<float, 1>());
-
-    functor::GatherSpans<Device, T>()(
-        context->eigen_device<Device>(), row_spans.span_size, row_starts,
-        row_weights, col_spans.span_size, col_starts, col_weights, image_data,
-        intermediate_data, output_data);
+    if (std::is_same<T, uint8>::value && use_fixed_point_) {
+      OP_REQUIRES_OK(context, context->allocate_temp(DT_INT16,
+                                                     intermediate_shape,
+                                                     &intermediate_t));
+      functor::ParallelSeparableResizeFixedPoint(
+          context, *row_filter, *col_filter, batch_size, channels,
+          reinterpret_cast<const uint8*>(input.flat<T>().data()),
+          intermediate_t.flat<int16>().data(), output->flat<float>().data());
+      return;
+    }
+    OP_REQUIRES_OK(context, context->allocate_temp(DT_FLOAT,
+                                                   intermediate_shape,
+                                                   &intermediate_t));
+    functor::ParallelSeparableResize(context, *row_filter, *col_filter,
+                                     batch_size, channels,
+                                     input.flat<T>().data(),
+                                     intermediate_t.flat<float>().data(),
+                                     output->flat<float>().data());
   }
+
   functor::SamplingKernelType kernel_type_;
   bool antialias_;
+  // Whether uint8 images are resized in fixed point, which rounds and clamps
+  // the output pixels to [0, 255].
+  bool use_fixed_point_;
 };
 
 template <typename Device, typename T>
@@ -0,0 +1,555 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/image/separable_resize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+
+#include "absl/container/flat_hash_map.h"
+#include "third_party/eigen3/Eigen/Core"
+#include "tensorflow/core/framework/numeric_types.h"
+#include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/util/work_sharder.h"
+
+namespace tensorflow {
+namespace functor {
+namespace {
+
+// The number of cached filter tables.  The cache is cleared when full: the
+// tables of a model are few and quickly computed again.
+constexpr size_t kMaxCachedResizeFilters = 256;
+
+// Rounds the "size" weights of a span, which sum to one, to fixed point.
+void SetFixedPointWeights(const float* weights, int size,
+                          int16* fixed_point_weights) {
+  int fixed_point_sum = 0;
+  int largest = 0;
+  for (int i = 0; i < size; ++i) {
+    fixed_point_weights[i] = static_cast<int16>(
+        std::round(weights[i] * (1 << kResizeFilterFixedPointBits)));
+    fixed_point_sum += fixed_point_weights[i];
+    if (weights[i] > weights[largest]) largest = i;
+  }
+  // Rounding errors go to the largest weight, so that flat areas stay flat.
+  if (size > 0) {
+    fixed_point_weights[largest] +=
+        (1 << kResizeFilterFixedPointBits) - fixed_point_sum;
+  }
+}
+
+template <typename Kernel>
+Status ComputeResizeFilterCore(const Kernel& kernel, float scale,
+                               float translate, bool antialias,
+                               ResizeFilter* filter) {
+  const int64_t input_size = filter->input_size;
+  const int64_t output_size = filter->output_size;
+  // When sampling, we need the inverse scale and translation, to map from an
+  // output to an input pixel.
+  const float inv_scale = 1.0 / scale;
+  const float inv_translate = -inv_scale * translate;
+  // When downsampling the kernel should be scaled since we want to low pass
+  // filter and interpolate, but when upsampling it should not be since we only
+  // want to interpolate.
+  const float kernel_scale = antialias ? std::max(inv_scale, 1.0f) : 1.0f;
+  filter->span_size = std::min(
+      2 * static_cast<int>(std::ceil(kernel.Radius() * kernel_scale)) + 1,
+      static_cast<int>(input_size));
+  const int span_size = filter->span_size;
+  filter->starts.assign(output_size, 0);
+  filter->weights.assign(output_size * span_size, 0.0f);
+  filter->fixed_point_weights.assign(output_size * span_size, 0);
+
+  const float one_over_kernel_scale = 1.0f / kernel_scale;
+  std::vector<float> temp_weights;
+  for (int64_t x = 0; x < output_size; ++x) {
+    const float col_f = x + 0.5f;
+    const float sample_f = col_f * inv_scale + inv_translate;
+
+    // Don't sample when the sampling location is outside the source image.
+    if (sample_f < 0 || sample_f > input_size) continue;
+    int64_t span_start =
+        std::ceil(sample_f - kernel.Radius() * kernel_scale - 0.5f);
+    int64_t span_end =
+        std::floor(sample_f + kernel.Radius() * kernel_scale - 0.5f);
+    span_start = std::min(std::max(span_start, int64_t{0}), input_size - 1);
+    span_end = std::min(std::max(span_end, int64_t{0}), input_size - 1) + 1;
+    const int this_span_size = span_end - span_start;
+    if (this_span_size > span_size) {
+      return errors::Internal("Span is too large: ", this_span_size, " vs ",
+                              span_size, ".");
+    }
+    float total_weight_sum = 0.0f;
+    temp_weights.clear();
+    for (int64_t source = span_start; source < span_end; ++source) {
+      float kernel_pos = static_cast<float>(source) + 0.5f - sample_f;
+      float weight = kernel(std::abs(kernel_pos * one_over_kernel_scale));
+      total_weight_sum += weight;
+      temp_weights.push_back(weight);
+    }
+    filter->starts[x] = span_start;
+    if (std::abs(total_weight_sum) <
+        1000.0f * std::numeric_limits<float>::min()) {
+      continue;
+    }
+    const float one_over_total_weight_sum = 1.0f / total_weight_sum;
+    float* weights = &filter->weights[x * span_size];
+    for (int i = 0; i < this_span_size; ++i) {
+      weights[i] = temp_weights[i] * one_over_total_weight_sum;
+    }
+    SetFixedPointWeights(weights, this_span_size,
+                         &filter->fixed_point_weights[x * span_size]);
+  }
+  return Status::OK();
+}
+
+// The filters of ResizeArea are cached with this kernel type.
+constexpr int kAreaFilterKernelType = -1;
+
+// (kernel type, input size, output size, scale, translate, antialias).
+using ResizeFilterKey = std::tuple<int, int64_t, int64_t, float, float, bool>;
+
+struct ResizeFilterCache {
+  mutex mu;
+  absl::flat_hash_map<ResizeFilterKey, std::shared_ptr<const ResizeFilter>>
+      filters TF_GUARDED_BY(mu);
+};
+
+ResizeFilterCache* GetResizeFilterCache() {
+  static ResizeFilterCache* cache = new ResizeFilterCache;
+  return cache;
+}
+
+// Returns the cached table of "key", computing it with "compute" when it is
+// missing.  The cache is not locked while computing.
+template <typename Compute>
+Status GetCachedResizeFilter(const ResizeFilterKey& key, Compute compute,
+                             std::shared_ptr<const ResizeFilter>* filter) {
+  ResizeFilterCache* cache = GetResizeFilterCache();
+  {
+    mutex_lock l(cache->mu);
+    auto it = cache->filters.find(key);
+    if (it != cache->filters.end()) {
+      *filter = it->second;
+      return Status::OK();
+    }
+  }
+  auto new_filter = std::make_shared<ResizeFilter>();
+  TF_RETURN_IF_ERROR(compute(new_filter.get()));
+  *filter = new_filter;
+  mutex_lock l(cache->mu);
+  if (cache->filters.size() >= kMaxCachedResizeFilters) {
+    cache->filters.clear();
+  }
+  cache->filters.emplace(key, std::move(new_filter));
+  return Status::OK();
+}
+
+// Returns the number of input pixels of output pixel "x", which may be less
+// than "span_size" at the end of the input.
+inline int64_t RealSpanSize(int span_size, const int32* starts,
+                            int64_t input_size, int64_t x) {
+  return std::min<int64_t>(starts[x] + span_size, input_size) - starts[x];
+}
+
+// Resamples the columns with "kChannels" channels, or "channels" when
+// "kChannels" is 0.  Fixing the number of channels lets the compiler unroll
+// and vectorize the channel loops.
+template <int kChannels, typename Weight, typename Accumulator,
+          typename Store>
+void ResampleColumnsImpl(int span_size, const int32* starts,
+                         const Weight* weights, int64_t input_size,
+                         int64_t output_size, int64_t num_rows,
+                         int dynamic_channels, Store store,
+                         const typename Store::Input* input,
+                         typename Store::Output* output) {
+  const int channels = kChannels > 0 ? kChannels : dynamic_channels;
+  const int64_t in_row_size = input_size * channels;
+  const int64_t out_row_size = output_size * channels;
+  Accumulator local_sums[4];
+  std::vector<Accumulator> heap_sums;
+  Accumulator* sums = local_sums;
+  if (channels > 4) {
+    heap_sums.resize(channels);
+    sums = heap_sums.data();
+  }
+  for (int64_t y = 0; y < num_rows; ++y) {
+    const typename Store::Input* in_row = input + y * in_row_size;
+    typename Store::Output* out_pix = output + y * out_row_size;
+    for (int64_t x = 0; x < output_size; ++x, out_pix += channels) {
+      const typename Store::Input* in_pix = in_row + starts[x] * channels;
+      const Weight* span_weights = weights + x * span_size;
+      const int64_t real_span_size =
+          RealSpanSize(span_size, starts, input_size, x);
+      std::fill(sums, sums + channels, Accumulator(0));
+      for (int64_t i = 0; i < real_span_size; ++i, in_pix += channels) {
+        const Accumulator w = span_weights[i];
+        for (int c = 0; c < channels; ++c) {
+          sums[c] += w * static_cast<Accumulator>(in_pix[c]);
+        }
+      }
+      for (int c = 0; c < channels; ++c) out_pix[c] = store(sums[c]);
+    }
+  }
+}
+
+template <typename Weight, typename Accumulator, typename Store>
+void ResampleColumnsDispatch(int span_size, const int32* starts,
+                             const Weight* weights, int64_t input_size,
+                             int64_t output_size, int64_t num_rows,
+                             int channels, Store store,
+                             const typename Store::Input* input,
+                             typename Store::Output* output) {
+  switch (channels) {
+    case 1:
+      ResampleColumnsImpl<1, Weight, Accumulator>(
+          span_size, starts, weights, input_size, output_size, num_rows,
+          channels, store, input, output);
+      break;
+    case 3:
+      ResampleColumnsImpl<3, Weight, Accumulator>(
+          span_size, starts, weights, input_size, output_size, num_rows,
+          channels, store, input, output);
+      break;
+    case 4:
+      ResampleColumnsImpl<4, Weight, Accumulator>(
+          span_size, starts, weights, input_size, output_size, num_rows,
+          channels, store, input, output);
+      break;
+    default:
+      ResampleColumnsImpl<0, Weight, Accumulator>(
+          span_size, starts, weights, input_size, output_size, num_rows,
+          channels, store, input, output);
+  }
+}
+
+struct StoreFloat {
+  using Input = float;
+  using Output = float;
+  float operator()(float sum) const { return sum; }
+};
+
+// Rounds the fixed-point sums of the row pass to the resampled rows.  They are
+// not clamped, so that the overshoots of the kernel cancel out in the column
+// pass.
+struct StoreFixedPointRow {
+  int16 operator()(int32 sum) const {
+    constexpr int kShift =
+        kResizeFilterFixedPointBits - kResizeBufferFixedPointBits;
+    const int32 rounded = (sum + (1 << (kShift - 1))) >> kShift;
+    return static_cast<int16>(std::min<int32>(
+        std::max<int32>(rounded, std::numeric_limits<int16>::min()),
+        std::numeric_limits<int16>::max()));
+  }
+};
+
+// Rounds the fixed-point sums of the column pass to uint8, stored as "Out".
+template <typename Out>
+struct StoreFixedPoint {
+  using Input = int16;
+  using Output = Out;
+  Out operator()(int32 sum) const {
+    constexpr int kShift =
+        kResizeFilterFixedPointBits + kResizeBufferFixedPointBits;
+    const int32 rounded = (sum + (1 << (kShift - 1))) >> kShift;
+    return static_cast<Out>(std::min(std::max(rounded, 0), 255));
+  }
+};
+
+// Calls "resize(b, begin_row, end_row)" for the output rows of all images,
+// in parallel on the intra-op threads of "context".
+template <typename Resize>
+void ParallelForOutputRows(OpKernelContext* context, const ResizeFilter& rows,
+                           const ResizeFilter& cols, int64_t batch_size,
+                           int channels, Resize resize) {
+  // The cost of an output row is a row pass over the input row, and a column
+  // pass over the output row.
+  const int64_t cost_per_row =
+      (rows.span_size * cols.input_size + cols.span_size * cols.output_size) *
+      channels;
+  auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+  Shard(worker_threads->num_threads, worker_threads->workers,
+        batch_size * rows.output_size, cost_per_row,
+        [&](int64_t begin, int64_t end) {
+          // Splits [begin, end) by image.
+          while (begin < end) {
+            const int64_t b = begin / rows.output_size;
+            const int64_t begin_row = begin % rows.output_size;
+            const int64_t end_row =
+                std::min(rows.output_size, begin_row + end - begin);
+            resize(b, begin_row, end_row);
+            begin += end_row - begin_row;
+          }
+        });
+}
+
+}  // namespace
+
+Status ComputeResizeFilter(SamplingKernelType kernel_type, int64_t input_size,
+                           int64_t output_size, float scale, float translate,
+                           bool antialias, ResizeFilter* filter) {
+  filter->input_size = input_size;
+  filter->output_size = output_size;
+  switch (kernel_type) {
+    case Lanczos1Kernel:
+      return ComputeResizeFilterCore(CreateLanczos1Kernel(), scale, translate,
+                                     antialias, filter);
+    case Lanczos3Kernel:
+      return ComputeResizeFilterCore(CreateLanczos3Kernel(), scale, translate,
+                                     antialias, filter);
+    case Lanczos5Kernel:
+      return ComputeResizeFilterCore(CreateLanczos5Kernel(), scale, translate,
+                                     antialias, filter);
+    case GaussianKernel:
+      return ComputeResizeFilterCore(CreateGaussianKernel(), scale, translate,
+                                     antialias, filter);
+    case BoxKernel:
+      return ComputeResizeFilterCore(CreateBoxKernel(), scale, translate,
+                                     antialias, filter);
+    case TriangleKernel:
+      return ComputeResizeFilterCore(CreateTriangleKernel(), scale, translate,
+                                     antialias, filter);
+    case KeysCubicKernel:
+      return ComputeResizeFilterCore(CreateKeysCubicKernel(), scale,
+                                     translate, antialias, filter);
+    case MitchellCubicKernel:
+      return ComputeResizeFilterCore(CreateMitchellCubicKernel(), scale,
+                                     translate, antialias, filter);
+    default:
+      return errors::InvalidArgument("Unrecognized kernel type: ",
+                                     static_cast<int>(kernel_type));
+  }
+}
+
+Status GetResizeFilter(SamplingKernelType kernel_type, int64_t input_size,
+                       int64_t output_size, float scale, float translate,
+                       bool antialias,
+                       std::shared_ptr<const ResizeFilter>* filter) {
+  return GetCachedResizeFilter(
+      ResizeFilterKey(kernel_type, input_size, output_size, scale, translate,
+                      antialias),
+      [&](ResizeFilter* new_filter) {
+        return ComputeResizeFilter(kernel_type, input_size, output_size,
+                                   scale, translate, antialias, new_filter);
+      },
+      filter);
+}
+
+void ComputeAreaResizeFilter(int64_t input_size, int64_t output_size,
+                             float scale, ResizeFilter* filter) {
+  filter->input_size = input_size;
+  filter->output_size = output_size;
+  auto bound = [input_size](int64_t x) {
+    return std::min(input_size - 1, std::max(int64_t{0}, x));
+  };
+  // The input pixels of output pixel "x" are [floor(in_x), ceil(in_x1)), once
+  // bounded.
+  filter->span_size = 0;
+  for (int64_t x = 0; x < output_size; ++x) {
+    const int64_t start = bound(static_cast<int64_t>(std::floor(x * scale)));
+    const int64_t end =
+        bound(static_cast<int64_t>(std::ceil((x + 1) * scale)) - 1) + 1;
+    filter->span_size =
+        std::max(filter->span_size, static_cast<int>(end - start));
+  }
+  const int span_size = filter->span_size;
+  filter->starts.assign(output_size, 0);
+  filter->weights.assign(output_size * span_size, 0.0f);
+  filter->fixed_point_weights.assign(output_size * span_size, 0);
+  const float one_over_scale = 1.0f / scale;
+  for (int64_t x = 0; x < output_size; ++x) {
+    const float in_x = x * scale;
+    const float in_x1 = (x + 1) * scale;
+    const int64_t start = std::floor(in_x);
+    const int64_t end = std::ceil(in_x1);
+    filter->starts[x] = bound(start);
+    float* weights = &filter->weights[x * span_size];
+    // The weight of each input pixel is the length of its overlap with
+    // [in_x, in_x1), as in ResizeAreaOp.
+    for (int64_t i = start; i < end; ++i) {
+      const float overlap =
+          i < in_x ? (i + 1 > in_x1 ? scale : i + 1 - in_x)
+                   : (i + 1 > in_x1 ? in_x1 - i : 1.0f);
+      weights[bound(i) - filter->starts[x]] += overlap * one_over_scale;
+    }
+    SetFixedPointWeights(weights, bound(end - 1) + 1 - filter->starts[x],
+                         &filter->fixed_point_weights[x * span_size]);
+  }
+}
+
+void GetAreaResizeFilter(int64_t input_size, int64_t output_size, float scale,
+                         std::shared_ptr<const ResizeFilter>* filter) {
+  TF_CHECK_OK(GetCachedResizeFilter(
+      ResizeFilterKey(kAreaFilterKernelType, input_size, output_size, scale,
+                      0.0f, false),
+      [&](ResizeFilter* new_filter) {
+        ComputeAreaResizeFilter(input_size, output_size, scale, new_filter);
+        return Status::OK();
+      },
+      filter));
+}
+
+template <typename T>
+void ResampleRows(int span_size, const int32* starts, const float* weights,
+                  int64_t input_size, int64_t output_size, int64_t row_size,
+                  const T* input, float* output) {
+  using InputRow = Eigen::Array<T, Eigen::Dynamic, 1>;
+  for (int64_t y = 0; y < output_size; ++y) {
+    Eigen::Map<Eigen::ArrayXf> out_row(output + y * row_size, row_size);
+    out_row.setZero();
+    const float* span_weights = weights + y * span_size;
+    const int64_t real_span_size =
+        RealSpanSize(span_size, starts, input_size, y);
+    for (int64_t i = 0; i < real_span_size; ++i) {
+      Eigen::Map<const InputRow> in_row(input + (starts[y] + i) * row_size,
+                                        row_size);
+      out_row += in_row.template cast<float>() * span_weights[i];
+    }
+  }
+}
+
+void ResampleColumns(int span_size, const int32* starts, const float* weights,
+                     int64_t input_size, int64_t output_size, int64_t num_rows,
+                     int channels, const float* input, float* output) {
+  ResampleColumnsDispatch<float, float>(span_size, starts, weights,
+                                        input_size, output_size, num_rows,
+                                        channels, StoreFloat(), input, output);
+}
+
+template <typename T>
+void SeparableResize(const ResizeFilter& rows, const ResizeFilter& cols,
+                     int channels, const T* image, int64_t begin_row,
+                     int64_t end_row, float* buffer, float* output) {
+  const int64_t row_size = cols.input_size * channels;
+  ResampleRows(rows.span_size, rows.starts.data() + begin_row,
+               rows.weights.data() + begin_row * rows.span_size,
+               rows.input_size, end_row - begin_row, row_size, image, buffer);
+  ResampleColumns(cols.span_size, cols.starts.data(), cols.weights.data(),
+                  cols.input_size, cols.output_size, end_row - begin_row,
+                  channels, buffer,
+                  output + begin_row * cols.output_size * channels);
+}
+
+template <typename Out>
+void SeparableResizeFixedPoint(const ResizeFilter& rows,
+                               const ResizeFilter& cols, int channels,
+                               const uint8* image, int64_t begin_row,
+                               int64_t end_row, int16* buffer, Out* output) {
+  // The rows are accumulated in int32, a whole row at a time.
+  const int64_t row_size = cols.input_size * channels;
+  std::vector<int32> sums(row_size);
+  for (int64_t y = begin_row; y < end_row; ++y) {
+    std::fill(sums.begin(), sums.end(), 0);
+    const int16* span_weights =
+        rows.fixed_point_weights.data() + y * rows.span_size;
+    const int64_t real_span_size =
+        RealSpanSize(rows.span_size, rows.starts.data(), rows.input_size, y);
+    for (int64_t i = 0; i < real_span_size; ++i) {
+      const uint8* in_row = image + (rows.starts[y] + i) * row_size;
+      const int32 w = span_weights[i];
+      for (int64_t j = 0; j < row_size; ++j) sums[j] += w * in_row[j];
+    }
+    int16* out_row = buffer + (y - begin_row) * row_size;
+    const StoreFixedPointRow store;
+    for (int64_t j = 0; j < row_size; ++j) out_row[j] = store(sums[j]);
+  }
+  ResampleColumnsDispatch<int16, int32>(
+      cols.span_size, cols.starts.data(), cols.fixed_point_weights.data(),
+      cols.input_size, cols.output_size, end_row - begin_row, channels,
+      StoreFixedPoint<Out>(), buffer,
+      output + begin_row * cols.output_size * channels);
+}
+
+template <typename T>
+void ParallelSeparableResize(OpKernelContext* context,
+                             const ResizeFilter& rows,
+                             const ResizeFilter& cols, int64_t batch_size,
+                             int channels, const T* images, float* buffer,
+                             float* output) {
+  const int64_t image_size = rows.input_size * cols.input_size * channels;
+  const int64_t buffer_row_size = cols.input_size * channels;
+  const int64_t buffer_size = rows.output_size * buffer_row_size;
+  const int64_t output_size = rows.output_size * cols.output_size * channels;
+  ParallelForOutputRows(
+      context, rows, cols, batch_size, channels,
+      [&](int64_t b, int64_t begin_row, int64_t end_row) {
+        SeparableResize(
+            rows, cols, channels, images + b * image_size, begin_row, end_row,
+            buffer + b * buffer_size + begin_row * buffer_row_size,
+            output + b * output_size);
+      });
+}
+
+template <typename Out>
+void ParallelSeparableResizeFixedPoint(OpKernelContext* context,
+                                       const ResizeFilter& rows,
+                                       const ResizeFilter& cols,
+                                       int64_t batch_size, int channels,
+                                       const uint8* images, int16* buffer,
+                                       Out* output) {
+  const int64_t image_size = rows.input_size * cols.input_size * channels;
+  const int64_t buffer_row_size = cols.input_size * channels;
+  const int64_t buffer_size = rows.output_size * buffer_row_size;
+  const int64_t output_size = rows.output_size * cols.output_size * channels;
+  ParallelForOutputRows(
+      context, rows, cols, batch_size, channels,
+      [&](int64_t b, int64_t begin_row, int64_t end_row) {
+        SeparableResizeFixedPoint(
+            rows, cols, channels, images + b * image_size, begin_row, end_row,
+            buffer + b * buffer_size + begin_row * buffer_row_size,
+            output + b * output_size);
+      });
+}
+
+#define DEFINE_SEPARABLE_RESIZE(T)                                         \
+  template void ResampleRows<T>(int span_size, const int32* starts,        \
+                                const float* weights, int64_t input_size,  \
+                                int64_t output_size, int64_t row_size,     \
+                                const T* input, float* output);            \
+  template void SeparableResize<T>(                                       \
+      const ResizeFilter& rows, const ResizeFilter& cols, int channels,    \
+      const T* image, int64_t begin_row, int64_t end_row, float* buffer,   \
+      float* output);                                                      \
+  template void ParallelSeparableResize<T>(                               \
+      OpKernelContext * context, const ResizeFilter& rows,                 \
+      const ResizeFilter& cols, int64_t batch_size, int channels,          \
+      const T* images, float* buffer, float* output);
+
+TF_CALL_REAL_NUMBER_TYPES(DEFINE_SEPARABLE_RESIZE);
+
+#undef DEFINE_SEPARABLE_RESIZE
+
+#define DEFINE_SEPARABLE_RESIZE_FIXED_POINT(Out)                           \
+  template void SeparableResizeFixedPoint<Out>(                           \
+      const ResizeFilter& rows, const ResizeFilter& cols, int channels,    \
+      const uint8* image, int64_t begin_row, int64_t end_row,              \
+      int16* buffer, Out* output);                                         \
+  template void ParallelSeparableResizeFixedPoint<Out>(                   \
+      OpKernelContext * context, const ResizeFilter& rows,                 \
+      const ResizeFilter& cols, int64_t batch_size, int channels,          \
+      const uint8* images, int16* buffer, Out* output);
+
+DEFINE_SEPARABLE_RESIZE_FIXED_POINT(uint8);
+DEFINE_SEPARABLE_RESIZE_FIXED_POINT(float);
+
+#undef DEFINE_SEPARABLE_RESIZE_FIXED_POINT
+
+}  // namespace functor
+}  // namespace tensorflow
@@ -0,0 +1,146 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_IMAGE_SEPARABLE_RESIZE_H_
+#define TENSORFLOW_CORE_KERNELS_IMAGE_SEPARABLE_RESIZE_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/kernels/image/sampling_kernels.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace functor {
+
+// A separable resize resamples the rows of an image, then its columns.  Along
+// each dimension, every output pixel is the weighted sum of a span of
+// consecutive input pixels, and the spans and weights form a filter table.
+// The table of a dimension only depends on its sizes, the sampling kernel
+// and the transform, so it is computed once for all rows or columns, and
+// GetResizeFilter() caches it across calls.
+//
+// The rows are resampled a whole row at a time, with Eigen's vectorized array
+// ops, so that the packet size of the target (SSE, AVX2, NEON...) is used.
+
+// The number of fractional bits of the fixed-point weights.
+constexpr int kResizeFilterFixedPointBits = 14;
+
+// The number of fractional bits of the fixed-point resampled rows, which are
+// int16: kernels with negative lobes overshoot [0, 255] a little.
+constexpr int kResizeBufferFixedPointBits = 6;
+
+// The filter table of one dimension.
+struct ResizeFilter {
+  int64_t input_size = 0;
+  int64_t output_size = 0;
+  // The maximum number of input pixels of an output pixel.
+  int span_size = 0;
+  // [output_size], the first input pixel of each output pixel.
+  std::vector<int32> starts;
+  // [output_size, span_size], the weights of the input pixels of each output
+  // pixel.  The weights past the end of the span are zero.
+  std::vector<float> weights;
+  // "weights" with kResizeFilterFixedPointBits fractional bits, rounded so
+  // that the weights of each non-empty span sum to one.
+  std::vector<int16> fixed_point_weights;
+};
+
+// Computes the filter table resampling "input_size" pixels to "output_size"
+// pixels with "kernel_type", the input being scaled by "scale" and then
+// translated by "translate", as in ScaleAndTranslate.  When "antialias" the
+// kernel is widened when downsampling.  Output pixels sampling outside of
+// the input have empty spans.
+Status ComputeResizeFilter(SamplingKernelType kernel_type, int64_t input_size,
+                           int64_t output_size, float scale, float translate,
+                           bool antialias, ResizeFilter* filter);
+
+// Like ComputeResizeFilter(), but returns a cached table when the same
+// arguments were seen recently.  Thread-safe.
+Status GetResizeFilter(SamplingKernelType kernel_type, int64_t input_size,
+                       int64_t output_size, float scale, float translate,
+                       bool antialias,
+                       std::shared_ptr<const ResizeFilter>* filter);
+
+// Computes the filter table of ResizeArea, where output pixel "x" averages
+// the input pixels covering [x * scale, (x + 1) * scale).  Input pixels past
+// the end of the input are replaced by the last one.
+void ComputeAreaResizeFilter(int64_t input_size, int64_t output_size,
+                             float scale, ResizeFilter* filter);
+
+// Like ComputeAreaResizeFilter(), with the cache of GetResizeFilter().
+void GetAreaResizeFilter(int64_t input_size, int64_t output_size, float scale,
+                         std::shared_ptr<const ResizeFilter>* filter);
+
+// Resamples "input", of shape [input_size, row_size], into "output", of shape
+// [output_size, row_size], with the filter table of the first dimension given
+// by "span_size", "starts" and "weights".
+template <typename T>
+void ResampleRows(int span_size, const int32* starts, const float* weights,
+                  int64_t input_size, int64_t output_size, int64_t row_size,
+                  const T* input, float* output);
+
+// Resamples "input", of shape [num_rows, input_size, channels], into
+// "output", of shape [num_rows, output_size, channels], with the filter table
+// of the second dimension given by "span_size", "starts" and "weights".
+void ResampleColumns(int span_size, const int32* starts, const float* weights,
+                     int64_t input_size, int64_t output_size, int64_t num_rows,
+                     int channels, const float* input, float* output);
+
+// Resizes "image", of shape [rows.input_size, cols.input_size, channels], to
+// "output", of shape [rows.output_size, cols.output_size, channels].  Only the
+// output rows in [begin_row, end_row) are computed, so that disjoint ranges
+// can be computed in parallel.  "buffer" holds the
+// [end_row - begin_row, cols.input_size, channels] resampled rows.
+template <typename T>
+void SeparableResize(const ResizeFilter& rows, const ResizeFilter& cols,
+                     int channels, const T* image, int64_t begin_row,
+                     int64_t end_row, float* buffer, float* output);
+
+// Like SeparableResize(), for uint8 images, in fixed point.  The resampled
+// rows have kResizeBufferFixedPointBits fractional bits.  The output pixels
+// are rounded and clamped to uint8, and stored as "Out" (uint8 or float).
+template <typename Out>
+void SeparableResizeFixedPoint(const ResizeFilter& rows,
+                               const ResizeFilter& cols, int channels,
+                               const uint8* image, int64_t begin_row,
+                               int64_t end_row, int16* buffer, Out* output);
+
+// Resizes the "batch_size" images of "images" with SeparableResize(), sharding
+// their output rows across the intra-op threads of "context".  "buffer" holds
+// the [batch_size, rows.output_size, cols.input_size, channels] resampled
+// rows.
+template <typename T>
+void ParallelSeparableResize(OpKernelContext* context,
+                             const ResizeFilter& rows,
+                             const ResizeFilter& cols, int64_t batch_size,
+                             int channels, const T* images, float* buffer,
+                             float* output);
+
+// Like ParallelSeparableResize(), with SeparableResizeFixedPoint().
+template <typename Out>
+void ParallelSeparableResizeFixedPoint(OpKernelContext* context,
+                                       const ResizeFilter& rows,
+                                       const ResizeFilter& cols,
+                                       int64_t batch_size, int channels,
+                                       const uint8* images, int16* buffer,
+                                       Out* output);
+
+}  // namespace functor
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_IMAGE_SEPARABLE_RESIZE_H_
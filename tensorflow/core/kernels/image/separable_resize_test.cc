@@ -0,0 +1,180 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/image/separable_resize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace functor {
+namespace {
+
+// Returns the sum of the weights of output pixel "x" of "filter".
+float SumOfWeights(const ResizeFilter& filter, int64_t x) {
+  float sum = 0.0f;
+  for (int i = 0; i < filter.span_size; ++i) {
+    sum += filter.weights[x * filter.span_size + i];
+  }
+  return sum;
+}
+
+// Returns the sum of the fixed-point weights of output pixel "x" of "filter".
+int SumOfFixedPointWeights(const ResizeFilter& filter, int64_t x) {
+  int sum = 0;
+  for (int i = 0; i < filter.span_size; ++i) {
+    sum += filter.fixed_point_weights[x * filter.span_size + i];
+  }
+  return sum;
+}
+
+TEST(SeparableResizeTest, FilterWeightsSumToOne) {
+  for (SamplingKernelType kernel_type :
+       {Lanczos3Kernel, GaussianKernel, BoxKernel, TriangleKernel,
+        KeysCubicKernel}) {
+    for (int64_t output_size : {3, 17, 64}) {
+      ResizeFilter filter;
+      TF_ASSERT_OK(ComputeResizeFilter(kernel_type, 31, output_size,
+                                       output_size / 31.0f, 0.0f,
+                                       /*antialias=*/true, &filter));
+      ASSERT_EQ(filter.starts.size(), output_size);
+      for (int64_t x = 0; x < output_size; ++x) {
+        EXPECT_NEAR(SumOfWeights(filter, x), 1.0f, 1e-5);
+        EXPECT_EQ(SumOfFixedPointWeights(filter, x),
+                  1 << kResizeFilterFixedPointBits);
+        EXPECT_LE(filter.starts[x] + 1, filter.input_size);
+      }
+    }
+  }
+}
+
+TEST(SeparableResizeTest, AreaFilter) {
+  // Resizing 4 pixels to 3, output pixel 1 covers 2/3 of pixels 1 and 2.
+  ResizeFilter filter;
+  ComputeAreaResizeFilter(4, 3, 4.0f / 3, &filter);
+  EXPECT_EQ(filter.span_size, 2);
+  EXPECT_EQ(filter.starts[1], 1);
+  EXPECT_NEAR(filter.weights[2], 0.5f, 1e-6);
+  EXPECT_NEAR(filter.weights[3], 0.5f, 1e-6);
+
+  // With aligned corners, the input past the last pixel is the last pixel.
+  ComputeAreaResizeFilter(3, 2, 2.0f, &filter);
+  EXPECT_EQ(filter.starts[1], 2);
+  EXPECT_NEAR(filter.weights[filter.span_size], 1.0f, 1e-6);
+}
+
+TEST(SeparableResizeTest, FiltersAreCached) {
+  std::shared_ptr<const ResizeFilter> filter1;
+  TF_ASSERT_OK(GetResizeFilter(Lanczos3Kernel, 100, 33, 0.33f, 0.0f,
+                               /*antialias=*/true, &filter1));
+  std::shared_ptr<const ResizeFilter> filter2;
+  TF_ASSERT_OK(GetResizeFilter(Lanczos3Kernel, 100, 33, 0.33f, 0.0f,
+                               /*antialias=*/true, &filter2));
+  EXPECT_EQ(filter1.get(), filter2.get());
+  std::shared_ptr<const ResizeFilter> filter3;
+  TF_ASSERT_OK(GetResizeFilter(Lanczos3Kernel, 100, 33, 0.33f, 0.5f,
+                               /*antialias=*/true, &filter3));
+  EXPECT_NE(filter1.get(), filter3.get());
+}
+
+// Resizes "image" without the separable engine, for comparison.
+std::vector<float> ResizeBaseline(const ResizeFilter& rows,
+                                  const ResizeFilter& cols, int channels,
+                                  const std::vector<uint8>& image) {
+  std::vector<float> output(rows.output_size * cols.output_size * channels);
+  for (int64_t y = 0; y < rows.output_size; ++y) {
+    for (int64_t x = 0; x < cols.output_size; ++x) {
+      for (int c = 0; c < channels; ++c) {
+        float sum = 0.0f;
+        for (int i = 0; i < rows.span_size; ++i) {
+          const int64_t in_y = rows.starts[y] + i;
+          if (in_y >= rows.input_size) break;
+          for (int j = 0; j < cols.span_size; ++j) {
+            const int64_t in_x = cols.starts[x] + j;
+            if (in_x >= cols.input_size) break;
+            sum += rows.weights[y * rows.span_size + i] *
+                   cols.weights[x * cols.span_size + j] *
+                   image[(in_y * cols.input_size + in_x) * channels + c];
+          }
+        }
+        output[(y * cols.output_size + x) * channels + c] = sum;
+      }
+    }
+  }
+  return output;
+}
+
+TEST(SeparableResizeTest, MatchesBaseline) {
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  for (int channels : {1, 3, 4, 5}) {
+    ResizeFilter rows, cols;
+    TF_ASSERT_OK(ComputeResizeFilter(Lanczos3Kernel, 40, 17, 17 / 40.0f, 0.0f,
+                                     /*antialias=*/true, &rows));
+    TF_ASSERT_OK(ComputeResizeFilter(Lanczos3Kernel, 30, 61, 61 / 30.0f, 0.0f,
+                                     /*antialias=*/true, &cols));
+    std::vector<uint8> image(rows.input_size * cols.input_size * channels);
+    for (uint8& pixel : image) pixel = rnd.Uniform(256);
+    const std::vector<float> expected =
+        ResizeBaseline(rows, cols, channels, image);
+
+    // Computes the output rows in two ranges, as when sharded.
+    std::vector<float> buffer(rows.output_size * cols.input_size * channels);
+    std::vector<float> output(expected.size());
+    SeparableResize(rows, cols, channels, image.data(), 0, 5, buffer.data(),
+                    output.data());
+    SeparableResize(rows, cols, channels, image.data(), 5, rows.output_size,
+                    buffer.data() + 5 * cols.input_size * channels,
+                    output.data());
+    for (int i = 0; i < expected.size(); ++i) {
+      EXPECT_NEAR(output[i], expected[i], 1e-3) << i;
+    }
+
+    // Fixed point rounds the output to integers, and clamps it to [0, 255].
+    std::vector<int16> fixed_point_buffer(buffer.size());
+    std::vector<uint8> fixed_point_output(expected.size());
+    SeparableResizeFixedPoint(rows, cols, channels, image.data(), 0,
+                              rows.output_size, fixed_point_buffer.data(),
+                              fixed_point_output.data());
+    for (int i = 0; i < expected.size(); ++i) {
+      EXPECT_NEAR(fixed_point_output[i],
+                  std::min(std::max(expected[i], 0.0f), 255.0f), 1.0f)
+          << i;
+    }
+  }
+}
+
+TEST(SeparableResizeTest, FixedPointKeepsFlatImagesFlat) {
+  ResizeFilter rows, cols;
+  TF_ASSERT_OK(ComputeResizeFilter(KeysCubicKernel, 23, 50, 50 / 23.0f, 0.0f,
+                                   /*antialias=*/true, &rows));
+  ComputeAreaResizeFilter(37, 5, 37 / 5.0f, &cols);
+  const std::vector<uint8> image(23 * 37 * 3, 77);
+  std::vector<int16> buffer(50 * 37 * 3);
+  std::vector<uint8> output(50 * 5 * 3);
+  SeparableResizeFixedPoint(rows, cols, 3, image.data(), 0, 50, buffer.data(),
+                            output.data());
+  for (uint8 pixel : output) EXPECT_EQ(pixel, 77);
+}
+
+}  // namespace
+}  // namespace functor
+}  // namespace tensorflow
@@ -0,0 +1,346 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Ops backing read-only tensors, such as the embedding tables of a served
+// model, by their checkpoint: rows are read from the checkpoint when first
+// gathered instead of restoring the whole tensor up front.
+
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/framework/bounds_check.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+namespace {
+
+auto* lazy_restore_rows = monitoring::Counter<1>::New(
+    "/tensorflow/core/checkpoint/lazy_restore/rows",
+    "The number of rows gathered from lazily restored tensors, by whether "
+    "they were resident in memory or read from the checkpoint.",
+    "source");
+
+auto* lazy_restore_evicted_rows = monitoring::Counter<0>::New(
+    "/tensorflow/core/checkpoint/lazy_restore/evicted_rows",
+    "The number of rows of lazily restored tensors evicted from memory.");
+
+// A tensor restored lazily from a checkpoint.  Gathered rows are read from
+// the checkpoint unless they are resident, and the most recently gathered rows
+// are kept resident, up to a maximum number of rows.
+//
+// The checkpoint is read without holding "mu_", so that gathers of resident
+// rows do not wait for the reads of other gathers.
+class LazyRestoredTensor : public ResourceBase {
+ public:
+  LazyRestoredTensor() {}
+
+  string DebugString() const override {
+    tf_shared_lock l(mu_);
+    return strings::StrCat("LazyRestoredTensor(", tensor_name_, ", ",
+                           DataTypeString(dtype_), ", ", shape_.DebugString(),
+                           ", ", slots_.size(), " resident rows)");
+  }
+
+  int64_t MemoryUsed() const override {
+    tf_shared_lock l(mu_);
+    return resident_rows_.TotalBytes();
+  }
+
+  // Backs the tensor by the tensor "tensor_name" of "reader", dropping the
+  // resident rows.
+  Status Initialize(std::unique_ptr<BundleReader> reader,
+                    const string& tensor_name, DataType dtype,
+                    int64_t max_resident_rows) {
+    DataType stored_dtype;
+    TensorShape shape;
+    TF_RETURN_IF_ERROR(
+        reader->LookupDtypeAndShape(tensor_name, &stored_dtype, &shape));
+    if (stored_dtype != dtype) {
+      return errors::InvalidArgument(
+          "Expected ", DataTypeString(dtype), " for ", tensor_name,
+          ", but the checkpoint holds ", DataTypeString(stored_dtype));
+    }
+    if (!DataTypeCanUseMemcpy(dtype) || shape.dims() < 1) {
+      return errors::InvalidArgument(
+          "Cannot restore ", tensor_name, ", of dtype ", DataTypeString(dtype),
+          " and shape ", shape.DebugString(),
+          " lazily: it must have a fixed-size dtype and at least one "
+          "dimension");
+    }
+    TensorShape resident_shape(shape);
+    resident_shape.set_dim(0, std::min(max_resident_rows, shape.dim_size(0)));
+
+    mutex_lock l(mu_);
+    reader_ = std::move(reader);
+    ++generation_;
+    tensor_name_ = tensor_name;
+    dtype_ = dtype;
+    shape_ = shape;
+    const int64_t num_rows = shape.dim_size(0);
+    row_bytes_ = num_rows == 0
+                     ? 0
+                     : shape.num_elements() / num_rows * DataTypeSize(dtype);
+    resident_rows_ = Tensor(dtype, resident_shape);
+    slots_.clear();
+    lru_.clear();
+    return Status::OK();
+  }
+
+  // Gathers the rows "indices" into output 0 of "ctx", of dtype "dtype".
+  template <typename Index>
+  Status Gather(OpKernelContext* ctx, DataType dtype, const Tensor& indices) {
+    // The state of the tensor the rows are read from, in case Initialize()
+    // runs while they are.
+    std::shared_ptr<BundleReader> reader;
+    string tensor_name;
+    TensorShape shape;
+    int64_t row_bytes;
+    int64_t generation;
+    Tensor* output;
+    char* output_data;
+    std::vector<std::pair<int64_t, int64_t>> missing;
+    {
+      mutex_lock l(mu_);
+      if (reader_ == nullptr) {
+        return errors::FailedPrecondition(
+            "The lazily restored tensor is not initialized.");
+      }
+      if (dtype != dtype_) {
+        return errors::InvalidArgument("Expected ", DataTypeString(dtype),
+                                       " rows, but ", tensor_name_, " is ",
+                                       DataTypeString(dtype_));
+      }
+      TensorShape row_shape(shape_);
+      row_shape.RemoveDim(0);
+      TensorShape output_shape(indices.shape());
+      output_shape.AppendShape(row_shape);
+      TF_RETURN_IF_ERROR(ctx->allocate_output(0, output_shape, &output));
+
+      // Copies the resident rows and collects the others, with their
+      // positions in the output.
+      const auto indices_flat = indices.flat<Index>();
+      const int64_t num_rows = shape_.dim_size(0);
+      output_data = const_cast<char*>(output->tensor_data().data());
+      const char* resident_data = resident_rows_.tensor_data().data();
+      for (int64_t i = 0; i < indices_flat.size(); ++i) {
+        const int64_t row = internal::SubtleMustCopy(indices_flat(i));
+        if (!FastBoundsCheck(row, num_rows)) {
+          return errors::InvalidArgument("indices[", i, "] = ", row,
+                                         " is not in [0, ", num_rows, ")");
+        }
+        auto it = slots_.find(row);
+        if (it == slots_.end()) {
+          missing.emplace_back(row, i);
+          continue;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+        memcpy(output_data + i * row_bytes_,
+               resident_data + it->second.slot * row_bytes_, row_bytes_);
+      }
+      lazy_restore_rows->GetCell("resident")->IncrementBy(
+          indices_flat.size() - missing.size());
+      if (missing.empty()) return Status::OK();
+      reader = reader_;
+      tensor_name = tensor_name_;
+      shape = shape_;
+      row_bytes = row_bytes_;
+      generation = generation_;
+    }
+
+    // Reads every missing row once, in order, so that neighboring rows are
+    // read at once.
+    std::sort(missing.begin(), missing.end());
+    std::vector<int64_t> rows;
+    for (const auto& row_and_position : missing) {
+      if (rows.empty() || rows.back() != row_and_position.first) {
+        rows.push_back(row_and_position.first);
+      }
+    }
+    TensorShape read_shape(shape);
+    read_shape.set_dim(0, rows.size());
+    Tensor read(dtype, read_shape);
+    {
+      // BundleReader is not thread-safe.
+      mutex_lock l(read_mu_);
+      TF_RETURN_IF_ERROR(reader->LookupRows(tensor_name, rows, &read));
+    }
+    lazy_restore_rows->GetCell("checkpoint")->IncrementBy(rows.size());
+    const char* read_data = read.tensor_data().data();
+    for (size_t i = 0, j = 0; i < missing.size(); ++i) {
+      if (missing[i].first != rows[j]) ++j;
+      memcpy(output_data + missing[i].second * row_bytes,
+             read_data + j * row_bytes, row_bytes);
+    }
+
+    // Makes the rows read resident, evicting the least recently gathered
+    // rows.  Only the last rows fit when more rows were read than can be
+    // resident.  Rows made resident meanwhile by other gathers are kept.
+    mutex_lock l(mu_);
+    if (generation != generation_) return Status::OK();
+    char* resident_data =
+        const_cast<char*>(resident_rows_.tensor_data().data());
+    const int64_t max_resident_rows = resident_rows_.dim_size(0);
+    int64_t num_evicted = 0;
+    const size_t first_resident =
+        rows.size() - std::min<size_t>(rows.size(), max_resident_rows);
+    for (size_t j = first_resident; j < rows.size(); ++j) {
+      auto it = slots_.find(rows[j]);
+      if (it != slots_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+        continue;
+      }
+      int64_t slot;
+      if (static_cast<int64_t>(slots_.size()) < max_resident_rows) {
+        slot = slots_.size();
+      } else {
+        auto evicted = slots_.find(lru_.back());
+        slot = evicted->second.slot;
+        slots_.erase(evicted);
+        lru_.pop_back();
+        ++num_evicted;
+      }
+      memcpy(resident_data + slot * row_bytes, read_data + j * row_bytes,
+             row_bytes);
+      lru_.push_front(rows[j]);
+      slots_.emplace(rows[j], Slot{slot, lru_.begin()});
+    }
+    lazy_restore_evicted_rows->GetCell()->IncrementBy(num_evicted);
+    return Status::OK();
+  }
+
+ private:
+  // A resident row.
+  struct Slot {
+    // The index of the row in "resident_rows_".
+    int64_t slot;
+    std::list<int64_t>::iterator lru_position;
+  };
+
+  mutable mutex mu_;
+  // Serializes the reads of the checkpoint.  Never held with "mu_".
+  mutex read_mu_;
+  std::shared_ptr<BundleReader> reader_ TF_GUARDED_BY(mu_);
+  // Incremented by every Initialize().
+  int64_t generation_ TF_GUARDED_BY(mu_) = 0;
+  string tensor_name_ TF_GUARDED_BY(mu_);
+  DataType dtype_ TF_GUARDED_BY(mu_) = DT_INVALID;
+  TensorShape shape_ TF_GUARDED_BY(mu_);
+  int64_t row_bytes_ TF_GUARDED_BY(mu_) = 0;
+  // Holds the resident rows, at most "max_resident_rows" of them.
+  Tensor resident_rows_ TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<int64_t, Slot> slots_ TF_GUARDED_BY(mu_);
+  // The resident rows, most recently gathered first.
+  std::list<int64_t> lru_ TF_GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(LazyRestoredTensor);
+};
+
+class InitializeLazyRestoredTensorOp : public OpKernel {
+ public:
+  explicit InitializeLazyRestoredTensorOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("tensor_name", &tensor_name_));
+    OP_REQUIRES_OK(context, context->GetAttr("dtype", &dtype_));
+    OP_REQUIRES_OK(context,
+                   context->GetAttr("max_resident_rows", &max_resident_rows_));
+    OP_REQUIRES_OK(context, context->GetAttr("use_mmap", &use_mmap_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& prefix = context->input(1);
+    OP_REQUIRES(context, TensorShapeUtils::IsScalar(prefix.shape()),
+                errors::InvalidArgument("prefix must be a scalar, got shape ",
+                                        prefix.shape().DebugString()));
+    const string& prefix_string = prefix.scalar<tstring>()();
+    BundleReader::Options options;
+    options.use_mmap = use_mmap_;
+    std::unique_ptr<BundleReader> reader(
+        new BundleReader(context->env(), prefix_string, options));
+    OP_REQUIRES_OK(context, reader->status());
+
+    core::RefCountPtr<LazyRestoredTensor> tensor;
+    OP_REQUIRES_OK(context, LookupOrCreateResource<LazyRestoredTensor>(
+                                context, HandleFromInput(context, 0), &tensor,
+                                [](LazyRestoredTensor** ptr) {
+                                  *ptr = new LazyRestoredTensor;
+                                  return Status::OK();
+                                }));
+    OP_REQUIRES_OK(context, tensor->Initialize(std::move(reader), tensor_name_,
+                                               dtype_, max_resident_rows_));
+  }
+
+ private:
+  string tensor_name_;
+  DataType dtype_;
+  int64_t max_resident_rows_;
+  bool use_mmap_;
+};
+
+template <typename Index>
+class LazyRestoredTensorGatherOp : public OpKernel {
+ public:
+  explicit LazyRestoredTensorGatherOp(OpKernelConstruction* context)
+      : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("dtype", &dtype_));
+  }
+
+  void Compute(OpKernelContext* context) override {
+    core::RefCountPtr<LazyRestoredTensor> tensor;
+    OP_REQUIRES_OK(context,
+                   LookupResource(context, HandleFromInput(context, 0),
+                                  &tensor));
+    OP_REQUIRES_OK(context,
+                   tensor->Gather<Index>(context, dtype_, context->input(1)));
+  }
+
+ private:
+  DataType dtype_;
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("_LazyRestoredTensorHandle").Device(DEVICE_CPU),
+    ResourceHandleOp<LazyRestoredTensor>);
+REGISTER_KERNEL_BUILDER(
+    Name("_InitializeLazyRestoredTensor").Device(DEVICE_CPU),
+    InitializeLazyRestoredTensorOp);
+
+#define REGISTER_GATHER(Index)                                    \
+  REGISTER_KERNEL_BUILDER(Name("_LazyRestoredTensorGather")       \
+                              .Device(DEVICE_CPU)                 \
+                              .TypeConstraint<Index>("Tindices"), \
+                          LazyRestoredTensorGatherOp<Index>)
+
+REGISTER_GATHER(int32);
+REGISTER_GATHER(int64_t);
+
+#undef REGISTER_GATHER
+
+}  // namespace
+}  // namespace tensorflow
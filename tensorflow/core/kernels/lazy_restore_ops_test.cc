@@ -0,0 +1,175 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/resource_handle.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/tensor_bundle/naming.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns a 4x2 float tensor whose row r holds {r + offset, r + offset}.
+Tensor Embedding(float offset) {
+  Tensor embedding(DT_FLOAT, TensorShape({4, 2}));
+  test::FillFn<float>(&embedding,
+                      [offset](int i) -> float { return i / 2 + offset; });
+  return embedding;
+}
+
+string WriteCheckpoint(const string& name, const Tensor& embedding) {
+  const string prefix = io::JoinPath(testing::TmpDir(), name);
+  BundleWriter writer(Env::Default(), prefix);
+  TF_CHECK_OK(writer.Add("embedding", embedding));
+  TF_CHECK_OK(writer.Add("string", test::AsTensor<tstring>({"a", "b"})));
+  TF_CHECK_OK(writer.Finish());
+  return prefix;
+}
+
+class LazyRestoreOpsTest : public OpsTestBase {
+ protected:
+  // Creates the handle of the lazily restored tensor.
+  void MakeHandle() {
+    TF_ASSERT_OK(NodeDefBuilder("handle", "_LazyRestoredTensorHandle")
+                     .Attr("shared_name", "embedding")
+                     .Finalize(node_def()));
+    TF_ASSERT_OK(InitOp());
+    TF_ASSERT_OK(RunOpKernel());
+    handle_ = GetOutput(0)->scalar<ResourceHandle>()();
+  }
+
+  Status Initialize(const string& prefix, const string& tensor_name,
+                    int max_resident_rows) {
+    TF_RETURN_IF_ERROR(
+        NodeDefBuilder("initialize", "_InitializeLazyRestoredTensor")
+            .Input(FakeInput(DT_RESOURCE))
+            .Input(FakeInput(DT_STRING))
+            .Attr("tensor_name", tensor_name)
+            .Attr("dtype", DT_FLOAT)
+            .Attr("max_resident_rows", max_resident_rows)
+            .Finalize(node_def()));
+    TF_RETURN_IF_ERROR(InitOp());
+    inputs_.clear();
+    AddInputFromArray<ResourceHandle>(TensorShape({}), {handle_});
+    AddInputFromArray<tstring>(TensorShape({}), {prefix});
+    return RunOpKernel();
+  }
+
+  Status Gather(const std::vector<int64_t>& indices) {
+    TF_RETURN_IF_ERROR(NodeDefBuilder("gather", "_LazyRestoredTensorGather")
+                           .Input(FakeInput(DT_RESOURCE))
+                           .Input(FakeInput(DT_INT64))
+                           .Attr("dtype", DT_FLOAT)
+                           .Finalize(node_def()));
+    TF_RETURN_IF_ERROR(InitOp());
+    inputs_.clear();
+    AddInputFromArray<ResourceHandle>(TensorShape({}), {handle_});
+    AddInputFromArray<int64_t>(
+        TensorShape({static_cast<int64_t>(indices.size())}), indices);
+    return RunOpKernel();
+  }
+
+  void ExpectGathered(const std::vector<float>& expected_rows) {
+    const int64_t num_rows = expected_rows.size();
+    Tensor expected(DT_FLOAT, TensorShape({num_rows, 2}));
+    test::FillFn<float>(&expected, [&expected_rows](int i) -> float {
+      return expected_rows[i / 2];
+    });
+    test::ExpectTensorEqual<float>(expected, *GetOutput(0));
+  }
+
+  ResourceHandle handle_;
+};
+
+TEST_F(LazyRestoreOpsTest, GathersRows) {
+  const string prefix = WriteCheckpoint("lazy_restore", Embedding(0));
+  MakeHandle();
+  TF_ASSERT_OK(Initialize(prefix, "embedding", 10));
+  TF_ASSERT_OK(Gather({3, 1, 1, 0}));
+  ExpectGathered({3, 1, 1, 0});
+  TF_ASSERT_OK(Gather({}));
+  EXPECT_EQ(GetOutput(0)->shape(), TensorShape({0, 2}));
+}
+
+TEST_F(LazyRestoreOpsTest, EvictsLeastRecentlyGatheredRows) {
+  const string prefix = WriteCheckpoint("lazy_restore_lru", Embedding(0));
+  MakeHandle();
+  TF_ASSERT_OK(Initialize(prefix, "embedding", 2));
+  TF_ASSERT_OK(Gather({0, 1}));
+  ExpectGathered({0, 1});
+
+  // Changes the data file in place, so that the rows read from now on differ
+  // from the resident ones.
+  const string new_prefix =
+      WriteCheckpoint("lazy_restore_lru_new", Embedding(10));
+  string data;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(),
+                                DataFilename(new_prefix, 0, 1), &data));
+  TF_ASSERT_OK(
+      WriteStringToFile(Env::Default(), DataFilename(prefix, 0, 1), data));
+
+  // Rows 0 and 1 are resident. Reading row 2 evicts row 1, the least recently
+  // gathered.
+  TF_ASSERT_OK(Gather({1, 0, 2}));
+  ExpectGathered({1, 0, 12});
+  TF_ASSERT_OK(Gather({2, 1, 0}));
+  ExpectGathered({12, 11, 0});
+
+  // Initializing again drops the resident rows.
+  TF_ASSERT_OK(Initialize(prefix, "embedding", 2));
+  TF_ASSERT_OK(Gather({1}));
+  ExpectGathered({11});
+}
+
+TEST_F(LazyRestoreOpsTest, MoreRowsThanResident) {
+  const string prefix = WriteCheckpoint("lazy_restore_small", Embedding(0));
+  MakeHandle();
+  TF_ASSERT_OK(Initialize(prefix, "embedding", 1));
+  TF_ASSERT_OK(Gather({3, 2, 1, 0, 2}));
+  ExpectGathered({3, 2, 1, 0, 2});
+  TF_ASSERT_OK(Gather({0, 3}));
+  ExpectGathered({0, 3});
+}
+
+TEST_F(LazyRestoreOpsTest, Errors) {
+  const string prefix = WriteCheckpoint("lazy_restore_errors", Embedding(0));
+  MakeHandle();
+  EXPECT_TRUE(errors::IsNotFound(Gather({0})));
+
+  EXPECT_TRUE(errors::IsNotFound(Initialize(prefix, "missing", 2)));
+  // Not a float tensor.
+  EXPECT_TRUE(errors::IsInvalidArgument(Initialize(prefix, "string", 2)));
+  EXPECT_FALSE(Initialize(io::JoinPath(testing::TmpDir(), "nonexistent"),
+                          "embedding", 2)
+                   .ok());
+
+  TF_ASSERT_OK(Initialize(prefix, "embedding", 2));
+  EXPECT_TRUE(errors::IsInvalidArgument(Gather({4})));
+  EXPECT_TRUE(errors::IsInvalidArgument(Gather({-1})));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -15,16 +15,24 @@ limitations under the License.
 
 // Tests kernels of lookup ops.
 
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/lookup_interface.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/shape_inference_testutil.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace {
@@ -100,5 +108,146 @@ TEST_F(LookupOpsTest, AnonymousHashTable_RefCounting) {
   EXPECT_FALSE(alive);
 }
 
+TEST_F(LookupOpsTest, MutableHashTable_ConcurrentInsertAndFind) {
+  TF_ASSERT_OK(NodeDefBuilder("table", "AnonymousMutableHashTable")
+                   .Attr("key_dtype", DT_INT64)
+                   .Attr("value_dtype", DT_INT64)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  TF_ASSERT_OK(RunOpKernel());
+  // Keep a reference to the handle, which owns the table.
+  Tensor handle = *GetOutput(0);
+  auto table_or =
+      handle.scalar<ResourceHandle>()().GetResource<lookup::LookupInterface>();
+  TF_ASSERT_OK(table_or.status());
+  lookup::LookupInterface* table = table_or.ValueOrDie();
+
+  // Insert keys from several threads, each owning a disjoint range of keys.
+  constexpr int kNumThreads = 8;
+  constexpr int64_t kKeysPerThread = 5000;
+  {
+    thread::ThreadPool pool(Env::Default(), "insert", kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      pool.Schedule([this, table, t]() {
+        Tensor keys(DT_INT64, TensorShape({kKeysPerThread}));
+        Tensor values(DT_INT64, TensorShape({kKeysPerThread}));
+        for (int64_t i = 0; i < kKeysPerThread; ++i) {
+          keys.flat<int64_t>()(i) = t * kKeysPerThread + i;
+          values.flat<int64_t>()(i) = 10 * (t * kKeysPerThread + i);
+        }
+        TF_EXPECT_OK(table->Insert(context_.get(), keys, values));
+      });
+    }
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumThreads * kKeysPerThread), table->size());
+  EXPECT_GT(table->MemoryUsed(), 0);
+
+  // Later duplicates of a key in the same batch take precedence.
+  Tensor update_keys = test::AsTensor<int64_t>({3, 7, 3});
+  Tensor update_values = test::AsTensor<int64_t>({-1, -2, -3});
+  TF_ASSERT_OK(table->Insert(context_.get(), update_keys, update_values));
+
+  // Look up all keys, plus one missing key, in a single batch.
+  const int64_t num_keys = kNumThreads * kKeysPerThread + 1;
+  Tensor keys(DT_INT64, TensorShape({num_keys}));
+  for (int64_t i = 0; i < num_keys; ++i) {
+    keys.flat<int64_t>()(i) = i;
+  }
+  Tensor values(DT_INT64, TensorShape({num_keys}));
+  Tensor default_value = test::AsScalar<int64_t>(-100);
+  TF_ASSERT_OK(table->Find(context_.get(), keys, &values, default_value));
+  for (int64_t i = 0; i < num_keys - 1; ++i) {
+    if (i == 3) {
+      EXPECT_EQ(-3, values.flat<int64_t>()(i));
+    } else if (i == 7) {
+      EXPECT_EQ(-2, values.flat<int64_t>()(i));
+    } else {
+      EXPECT_EQ(10 * i, values.flat<int64_t>()(i));
+    }
+  }
+  EXPECT_EQ(-100, values.flat<int64_t>()(num_keys - 1));
+
+  // Removing keys only affects the removed keys.
+  TF_ASSERT_OK(table->Remove(context_.get(), update_keys));
+  EXPECT_EQ(static_cast<size_t>(kNumThreads * kKeysPerThread - 2),
+            table->size());
+
+  // Importing replaces the whole table.
+  TF_ASSERT_OK(table->ImportValues(context_.get(),
+                                   test::AsTensor<int64_t>({1, 2}),
+                                   test::AsTensor<int64_t>({11, 22})));
+  EXPECT_EQ(2u, table->size());
+  Tensor lookup_keys = test::AsTensor<int64_t>({1, 2, 100});
+  Tensor lookup_values(DT_INT64, TensorShape({3}));
+  TF_ASSERT_OK(table->Find(context_.get(), lookup_keys, &lookup_values,
+                           default_value));
+  test::ExpectTensorEqual<int64_t>(test::AsTensor<int64_t>({11, 22, -100}),
+                                   lookup_values);
+}
+
+// Builds a graph where `num_finders` LookupTableFindV2 nodes, each looking up
+// `batch_size` keys, run concurrently with a LookupTableInsertV2 node that
+// updates the same MutableHashTableV2.
+static Graph* MutableHashTableContention(int num_finders, int batch_size) {
+  Graph* g = new Graph(OpRegistry::Global());
+  constexpr int64_t kNumKeys = 1 << 20;
+
+  Node* table;
+  TF_CHECK_OK(NodeBuilder(g->NewName("table"), "MutableHashTableV2")
+                  .Attr("key_dtype", DT_INT64)
+                  .Attr("value_dtype", DT_INT64)
+                  .Finalize(g, &table));
+
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  const auto random_keys = [&rnd](int64_t n) {
+    Tensor keys(DT_INT64, TensorShape({n}));
+    for (int64_t i = 0; i < n; ++i) {
+      keys.flat<int64_t>()(i) = rnd.Uniform64(kNumKeys);
+    }
+    return keys;
+  };
+
+  Tensor insert_keys = random_keys(kNumKeys / 16);
+  Node* insert;
+  TF_CHECK_OK(NodeBuilder(g->NewName("insert"), "LookupTableInsertV2")
+                  .Input(table)
+                  .Input(test::graph::Constant(g, insert_keys))
+                  .Input(test::graph::Constant(g, insert_keys))
+                  .Finalize(g, &insert));
+
+  Node* default_value =
+      test::graph::Constant(g, test::AsScalar<int64_t>(-1));
+  for (int i = 0; i < num_finders; ++i) {
+    Node* find;
+    TF_CHECK_OK(NodeBuilder(g->NewName("find"), "LookupTableFindV2")
+                    .Input(table)
+                    .Input(test::graph::Constant(g, random_keys(batch_size)))
+                    .Input(default_value)
+                    .Finalize(g, &find));
+  }
+  return g;
+}
+
+static void BM_MutableHashTableContention(
+    ::testing::benchmark::State& state) {
+  const int num_finders = state.range(0);
+  const int batch_size = state.range(1);
+
+  test::Benchmark("cpu", MutableHashTableContention(num_finders, batch_size),
+                  /*old_benchmark_api=*/false)
+      .Run(state);
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_finders * batch_size);
+}
+
+BENCHMARK(BM_MutableHashTableContention)
+    ->UseRealTime()
+    ->ArgPair(1, 1024)
+    ->ArgPair(8, 1024)
+    ->ArgPair(32, 1024)
+    ->ArgPair(8, 65536)
+    ->ArgPair(32, 65536);
+
 }  // namespace
 }  // namespace tensorflow
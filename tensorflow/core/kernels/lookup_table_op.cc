@@ -16,17 +16,23 @@ limitations under the License.
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
+#include <array>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/kernels/initializable_lookup_table.h"
+#include "tensorflow/core/kernels/perfect_hash_table_file.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 namespace lookup {
@@ -36,11 +42,184 @@ std::string UniqueNodeName(const std::string& base) {
   return strings::StrCat(base, "/", counter.fetch_add(1), "/", random::New64());
 }
 
-// Lookup table that wraps an unordered_map, where the key and value data type
-// is specified. Each individual value must be a scalar. If vector values are
-// required, use MutableHashTableOfTensors.
+// Hash map from K to V split into a fixed number of shards, each guarded by
+// its own mutex. Keys are assigned to shards by hash, so concurrent lookups
+// and inserts only contend when they touch the same shard. Batched operations
+// take every shard lock at most once, and process the shards in parallel on
+// the CPU worker threads when the batch is large enough.
+template <class K, class V>
+class ShardedHashMap {
+ public:
+  using Map = std::unordered_map<K, V>;
+  using ConstKeys = typename TTypes<K>::ConstFlat;
+
+  static constexpr int kLogNumShards = 4;
+  static constexpr int kNumShards = 1 << kLogNumShards;
+
+  using ShardMaps = std::array<const Map*, kNumShards>;
+
+  size_t size() const {
+    size_t size = 0;
+    for (const MapShard& shard : shards_) {
+      tf_shared_lock l(shard.mu);
+      size += shard.map.size();
+    }
+    return size;
+  }
+
+  // Returns an estimate of the memory used by the buckets of all shards.
+  int64_t MemoryUsed() const {
+    int64_t ret = 0;
+    for (const MapShard& shard : shards_) {
+      tf_shared_lock l(shard.mu);
+      for (unsigned i = 0; i < shard.map.bucket_count(); ++i) {
+        size_t bucket_size = shard.map.bucket_size(i);
+        if (bucket_size == 0) {
+          ret++;
+        } else {
+          ret += bucket_size;
+        }
+      }
+    }
+    return ret;
+  }
+
+  // Calls `fn(map, i)` for every index `i` of `keys`, where `map` is the map of
+  // the shard owning `keys(i)`, locked in shared mode. Indices owned by the
+  // same shard are visited in increasing order. `cost_per_key` is the
+  // estimated number of cycles spent in one call of `fn`.
+  template <typename Fn>
+  void ForEachKeyShared(OpKernelContext* ctx, ConstKeys keys,
+                        int64_t cost_per_key, Fn fn) const {
+    ForEachShardGroup(ctx, keys, cost_per_key,
+                      [this, &fn](int shard, const int64_t* begin,
+                                  const int64_t* end) {
+                        const MapShard& s = shards_[shard];
+                        tf_shared_lock l(s.mu);
+                        for (const int64_t* it = begin; it != end; ++it) {
+                          fn(s.map, *it);
+                        }
+                      });
+  }
+
+  // Same as ForEachKeyShared, but `fn(map, i)` receives a mutable `map` of the
+  // shard owning `keys(i)`, locked in exclusive mode.
+  template <typename Fn>
+  void ForEachKey(OpKernelContext* ctx, ConstKeys keys, int64_t cost_per_key,
+                  Fn fn) {
+    ForEachShardGroup(ctx, keys, cost_per_key,
+                      [this, &fn](int shard, const int64_t* begin,
+                                  const int64_t* end) {
+                        MapShard& s = shards_[shard];
+                        mutex_lock l(s.mu);
+                        for (const int64_t* it = begin; it != end; ++it) {
+                          fn(&s.map, *it);
+                        }
+                      });
+  }
+
+  // Clears all shards and calls `fn(map, i)` for every index `i` of `keys` in
+  // order. No other operation observes the table in between.
+  template <typename Fn>
+  void ClearAndForEachKey(ConstKeys keys, Fn fn) TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (MapShard& shard : shards_) shard.mu.lock();
+    for (MapShard& shard : shards_) shard.map.clear();
+    for (int64_t i = 0; i < keys.size(); ++i) {
+      fn(&shards_[ShardOf(SubtleMustCopyIfIntegral(keys(i)))].map, i);
+    }
+    for (MapShard& shard : shards_) shard.mu.unlock();
+  }
+
+  // Locks all shards in shared mode and returns `fn(maps)`, where `maps` holds
+  // the map of every shard, so that `fn` observes a consistent snapshot.
+  template <typename Fn>
+  Status WithAllShardsShared(Fn fn) const TF_NO_THREAD_SAFETY_ANALYSIS {
+    ShardMaps maps;
+    for (int i = 0; i < kNumShards; ++i) {
+      shards_[i].mu.lock_shared();
+      maps[i] = &shards_[i].map;
+    }
+    Status status = fn(maps);
+    for (const MapShard& shard : shards_) shard.mu.unlock_shared();
+    return status;
+  }
+
+  static int64_t TotalSize(const ShardMaps& maps) {
+    int64_t size = 0;
+    for (const Map* map : maps) size += map->size();
+    return size;
+  }
+
+ private:
+  struct MapShard {
+    mutable mutex mu;
+    Map map TF_GUARDED_BY(mu);
+  };
+
+  static int ShardOf(const K& key) {
+    // std::hash is the identity for integers, so mix the hash to spread dense
+    // integer ids over all shards.
+    const uint64 hash = static_cast<uint64>(std::hash<K>()(key));
+    return static_cast<int>((hash * 0x9E3779B97F4A7C15ull) >>
+                            (64 - kLogNumShards));
+  }
+
+  // Groups the indices of `keys` by shard, keeping them in increasing order
+  // within each group, and calls `fn(shard, begin, end)` for every non-empty
+  // group.
+  template <typename Fn>
+  static void ForEachShardGroup(OpKernelContext* ctx, ConstKeys keys,
+                                int64_t cost_per_key, Fn fn) {
+    const int64_t num_keys = keys.size();
+    if (num_keys == 0) return;
+    if (num_keys == 1) {
+      const int64_t index = 0;
+      fn(ShardOf(SubtleMustCopyIfIntegral(keys(0))), &index, &index + 1);
+      return;
+    }
+
+    std::vector<uint8> shard_ids(num_keys);
+    std::array<int64_t, kNumShards + 1> offsets{};
+    for (int64_t i = 0; i < num_keys; ++i) {
+      shard_ids[i] = ShardOf(SubtleMustCopyIfIntegral(keys(i)));
+      ++offsets[shard_ids[i] + 1];
+    }
+    for (int s = 0; s < kNumShards; ++s) {
+      offsets[s + 1] += offsets[s];
+    }
+    std::vector<int64_t> order(num_keys);
+    std::array<int64_t, kNumShards> next;
+    std::copy(offsets.begin(), offsets.end() - 1, next.begin());
+    for (int64_t i = 0; i < num_keys; ++i) {
+      order[next[shard_ids[i]]++] = i;
+    }
+
+    auto process_shards = [&fn, &offsets, &order](int64_t begin, int64_t end) {
+      for (int64_t s = begin; s < end; ++s) {
+        if (offsets[s] == offsets[s + 1]) continue;
+        fn(static_cast<int>(s), order.data() + offsets[s],
+           order.data() + offsets[s + 1]);
+      }
+    };
+    if (ctx == nullptr) {
+      process_shards(0, kNumShards);
+      return;
+    }
+    auto* worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, kNumShards,
+          cost_per_key * num_keys / kNumShards, process_shards);
+  }
+
+  std::array<MapShard, kNumShards> shards_;
+};
+
+// Lookup table that wraps a sharded unordered_map, where the key and value
+// data type is specified. Each individual value must be a scalar. If vector
+// values are required, use MutableHashTableOfTensors.
 //
 // This table is mutable and thread safe - Insert can be called at any time.
+// Keys are spread over independently locked shards, so concurrent Find and
+// Insert calls only contend when they touch the same shard.
 //
 // Sample use case:
 //
@@ -55,10 +234,7 @@ class MutableHashTableOfScalars final : public LookupInterface {
  public:
   MutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel) {}
 
-  size_t size() const override {
-    tf_shared_lock l(mu_);
-    return table_.size();
-  }
+  size_t size() const override { return table_.size(); }
 
   Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
               const Tensor& default_value) override {
@@ -70,69 +246,74 @@ class MutableHashTableOfScalars final : public LookupInterface {
     int64_t default_total = default_flat.size();
     bool is_full_size_default = (total == default_total);
 
-    tf_shared_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      // is_full_size_default is true:
-      //   Each key has an independent default value, key_values(i)
-      //   corresponding uses default_flat(i) as its default value.
-      //
-      // is_full_size_default is false:
-      //   All keys will share the default_flat(0) as default value.
-      value_values(i) = gtl::FindWithDefault(
-          table_, SubtleMustCopyIfIntegral(key_values(i)),
-          is_full_size_default ? default_flat(i) : default_flat(0));
-    }
+    table_.ForEachKeyShared(
+        ctx, key_values, kCostPerKey,
+        [&](const typename Table::Map& table, int64_t i) {
+          // is_full_size_default is true:
+          //   Each key has an independent default value, key_values(i)
+          //   corresponding uses default_flat(i) as its default value.
+          //
+          // is_full_size_default is false:
+          //   All keys will share the default_flat(0) as default value.
+          value_values(i) = gtl::FindWithDefault(
+              table, SubtleMustCopyIfIntegral(key_values(i)),
+              is_full_size_default ? default_flat(i) : default_flat(0));
+        });
 
     return Status::OK();
   }
 
-  Status DoInsert(bool clear, const Tensor& keys, const Tensor& values) {
+  Status DoInsert(OpKernelContext* ctx, bool clear, const Tensor& keys,
+                  const Tensor& values) {
     const auto key_values = keys.flat<K>();
     const auto value_values = values.flat<V>();
 
-    mutex_lock l(mu_);
-    if (clear) {
-      table_.clear();
-    }
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      gtl::InsertOrUpdate(&table_, SubtleMustCopyIfIntegral(key_values(i)),
+    const auto insert = [&](typename Table::Map* table, int64_t i) {
+      gtl::InsertOrUpdate(table, SubtleMustCopyIfIntegral(key_values(i)),
                           SubtleMustCopyIfIntegral(value_values(i)));
+    };
+    if (clear) {
+      table_.ClearAndForEachKey(key_values, insert);
+    } else {
+      table_.ForEachKey(ctx, key_values, kCostPerKey, insert);
     }
     return Status::OK();
   }
 
   Status Insert(OpKernelContext* ctx, const Tensor& keys,
                 const Tensor& values) override {
-    return DoInsert(false, keys, values);
+    return DoInsert(ctx, false, keys, values);
   }
 
   Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
     const auto key_values = keys.flat<K>();
 
-    mutex_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      table_.erase(SubtleMustCopyIfIntegral(key_values(i)));
-    }
+    table_.ForEachKey(ctx, key_values, kCostPerKey,
+                      [&](typename Table::Map* table, int64_t i) {
+                        table->erase(SubtleMustCopyIfIntegral(key_values(i)));
+                      });
     return Status::OK();
   }
 
   Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
                       const Tensor& values) override {
-    return DoInsert(true, keys, values);
+    return DoInsert(ctx, true, keys, values);
   }
 
   Status ExportValues(OpKernelContext* ctx) override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-
-    Tensor* keys;
-    Tensor* values;
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("keys", TensorShape({size}), &keys));
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("values", TensorShape({size}), &values));
-    ExportKeysAndValues(keys, values);
-    return Status::OK();
+    return table_.WithAllShardsShared(
+        [&](const typename Table::ShardMaps& maps) -> Status {
+          int64_t size = Table::TotalSize(maps);
+
+          Tensor* keys;
+          Tensor* values;
+          TF_RETURN_IF_ERROR(
+              ctx->allocate_output("keys", TensorShape({size}), &keys));
+          TF_RETURN_IF_ERROR(
+              ctx->allocate_output("values", TensorShape({size}), &values));
+          ExportKeysAndValues(maps, keys, values);
+          return Status::OK();
+        });
   }
 
   DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
@@ -144,25 +325,20 @@ class MutableHashTableOfScalars final : public LookupInterface {
   TensorShape value_shape() const override { return TensorShape(); }
 
   int64_t MemoryUsed() const override {
-    int64_t ret = 0;
-    tf_shared_lock l(mu_);
-    for (unsigned i = 0; i < table_.bucket_count(); ++i) {
-      size_t bucket_size = table_.bucket_size(i);
-      if (bucket_size == 0) {
-        ret++;
-      } else {
-        ret += bucket_size;
-      }
-    }
-    return sizeof(MutableHashTableOfScalars) + ret;
+    return sizeof(MutableHashTableOfScalars) + table_.MemoryUsed();
   }
 
   Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-    Tensor keys(key_dtype(), TensorShape({size}));
-    Tensor values(value_dtype(), TensorShape({size}));
-    ExportKeysAndValues(&keys, &values);
+    Tensor keys;
+    Tensor values;
+    TF_RETURN_IF_ERROR(table_.WithAllShardsShared(
+        [&](const typename Table::ShardMaps& maps) -> Status {
+          int64_t size = Table::TotalSize(maps);
+          keys = Tensor(key_dtype(), TensorShape({size}));
+          values = Tensor(value_dtype(), TensorShape({size}));
+          ExportKeysAndValues(maps, &keys, &values);
+          return Status::OK();
+        }));
 
     // We set use_node_name_sharing with a unique node name so that the resource
     // can outlive the MutableHashTableV2 kernel. This means that the lifetime
@@ -195,24 +371,30 @@ class MutableHashTableOfScalars final : public LookupInterface {
   }
 
  private:
-  // Writes all keys and values into `keys` and `values`. `keys` and `values`
-  // must point to tensors of size `table_.size()`.
-  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) {
+  typedef ShardedHashMap<K, V> Table;
+
+  // Estimated number of cycles to look up or insert a single key.
+  static constexpr int64_t kCostPerKey = 100;
+
+  // Writes all keys and values of `maps` into `keys` and `values`. `keys` and
+  // `values` must point to tensors of size `Table::TotalSize(maps)`.
+  void ExportKeysAndValues(const typename Table::ShardMaps& maps, Tensor* keys,
+                           Tensor* values) const {
     auto keys_data = keys->flat<K>();
     auto values_data = values->flat<V>();
     int64_t i = 0;
-    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
-      keys_data(i) = it->first;
-      values_data(i) = it->second;
+    for (const auto* map : maps) {
+      for (auto it = map->begin(); it != map->end(); ++it, ++i) {
+        keys_data(i) = it->first;
+        values_data(i) = it->second;
+      }
     }
   }
 
-  mutable mutex mu_;
-  std::unordered_map<K, V> table_ TF_GUARDED_BY(mu_);
+  Table table_;
 };
 
-// Lookup table that wraps an unordered_map. Behaves identical to
+// Lookup table that wraps a sharded unordered_map. Behaves identical to
 // MutableHashTableOfScalars except that each value must be a vector.
 template <class K, class V>
 class MutableHashTableOfTensors final : public LookupInterface {
@@ -226,10 +408,7 @@ class MutableHashTableOfTensors final : public LookupInterface {
                                 value_shape_.DebugString()));
   }
 
-  size_t size() const override {
-    tf_shared_lock l(mu_);
-    return table_.size();
-  }
+  size_t size() const override { return table_.size(); }
 
   Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
               const Tensor& default_value) override {
@@ -242,85 +421,90 @@ class MutableHashTableOfTensors final : public LookupInterface {
     int64_t default_total = default_flat.size();
     bool is_full_size_default = (total == default_total);
 
-    tf_shared_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      ValueArray* value_vec =
-          gtl::FindOrNull(table_, SubtleMustCopyIfIntegral(key_values(i)));
-      if (value_vec != nullptr) {
-        for (int64_t j = 0; j < value_dim; j++) {
-          value_values(i, j) = value_vec->at(j);
-        }
-      } else {
-        // is_full_size_default is true:
-        //   Each key has an independent default value, key_values(i)
-        //   corresponding uses default_flat(i) as its default value.
-        //
-        // is_full_size_default is false:
-        //   All keys will share the default_flat(0) as default value.
-        for (int64_t j = 0; j < value_dim; j++) {
-          value_values(i, j) =
-              is_full_size_default ? default_flat(i, j) : default_flat(0, j);
-        }
-      }
-    }
+    table_.ForEachKeyShared(
+        ctx, key_values, kCostPerKey + value_dim,
+        [&](const typename Table::Map& table, int64_t i) {
+          const ValueArray* value_vec =
+              gtl::FindOrNull(table, SubtleMustCopyIfIntegral(key_values(i)));
+          if (value_vec != nullptr) {
+            for (int64_t j = 0; j < value_dim; j++) {
+              value_values(i, j) = value_vec->at(j);
+            }
+          } else {
+            // is_full_size_default is true:
+            //   Each key has an independent default value, key_values(i)
+            //   corresponding uses default_flat(i) as its default value.
+            //
+            // is_full_size_default is false:
+            //   All keys will share the default_flat(0) as default value.
+            for (int64_t j = 0; j < value_dim; j++) {
+              value_values(i, j) = is_full_size_default ? default_flat(i, j)
+                                                        : default_flat(0, j);
+            }
+          }
+        });
 
     return Status::OK();
   }
 
-  Status DoInsert(bool clear, const Tensor& keys, const Tensor& values) {
+  Status DoInsert(OpKernelContext* ctx, bool clear, const Tensor& keys,
+                  const Tensor& values) {
     const auto key_values = keys.flat<K>();
     const auto value_values = values.flat_inner_dims<V, 2>();
     int64_t value_dim = value_shape_.dim_size(0);
 
-    mutex_lock l(mu_);
-    if (clear) {
-      table_.clear();
-    }
-    for (int64_t i = 0; i < key_values.size(); ++i) {
+    const auto insert = [&](typename Table::Map* table, int64_t i) {
       ValueArray value_vec;
       for (int64_t j = 0; j < value_dim; j++) {
         V value = value_values(i, j);
         value_vec.push_back(value);
       }
-      gtl::InsertOrUpdate(&table_, SubtleMustCopyIfIntegral(key_values(i)),
+      gtl::InsertOrUpdate(table, SubtleMustCopyIfIntegral(key_values(i)),
                           value_vec);
+    };
+    if (clear) {
+      table_.ClearAndForEachKey(key_values, insert);
+    } else {
+      table_.ForEachKey(ctx, key_values, kCostPerKey + value_dim, insert);
     }
     return Status::OK();
   }
 
   Status Insert(OpKernelContext* ctx, const Tensor& keys,
                 const Tensor& values) override {
-    return DoInsert(false, keys, values);
+    return DoInsert(ctx, false, keys, values);
   }
 
   Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
     const auto key_values = keys.flat<K>();
 
-    mutex_lock l(mu_);
-    for (int64_t i = 0; i < key_values.size(); ++i) {
-      table_.erase(SubtleMustCopyIfIntegral(key_values(i)));
-    }
+    table_.ForEachKey(ctx, key_values, kCostPerKey,
+                      [&](typename Table::Map* table, int64_t i) {
+                        table->erase(SubtleMustCopyIfIntegral(key_values(i)));
+                      });
     return Status::OK();
   }
 
   Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
                       const Tensor& values) override {
-    return DoInsert(true, keys, values);
+    return DoInsert(ctx, true, keys, values);
   }
 
   Status ExportValues(OpKernelContext* ctx) override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-    int64_t value_dim = value_shape_.dim_size(0);
-
-    Tensor* keys;
-    Tensor* values;
-    TF_RETURN_IF_ERROR(
-        ctx->allocate_output("keys", TensorShape({size}), &keys));
-    TF_RETURN_IF_ERROR(ctx->allocate_output(
-        "values", TensorShape({size, value_dim}), &values));
-    ExportKeysAndValues(keys, values);
-    return Status::OK();
+    return table_.WithAllShardsShared(
+        [&](const typename Table::ShardMaps& maps) -> Status {
+          int64_t size = Table::TotalSize(maps);
+          int64_t value_dim = value_shape_.dim_size(0);
+
+          Tensor* keys;
+          Tensor* values;
+          TF_RETURN_IF_ERROR(
+              ctx->allocate_output("keys", TensorShape({size}), &keys));
+          TF_RETURN_IF_ERROR(ctx->allocate_output(
+              "values", TensorShape({size, value_dim}), &values));
+          ExportKeysAndValues(maps, keys, values);
+          return Status::OK();
+        });
   }
 
   DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
@@ -332,25 +516,21 @@ class MutableHashTableOfTensors final : public LookupInterface {
   TensorShape value_shape() const override { return value_shape_; }
 
   int64_t MemoryUsed() const override {
-    int64_t ret = 0;
-    tf_shared_lock l(mu_);
-    for (unsigned i = 0; i < table_.bucket_count(); ++i) {
-      size_t bucket_size = table_.bucket_size(i);
-      if (bucket_size == 0) {
-        ret++;
-      } else {
-        ret += bucket_size;
-      }
-    }
-    return sizeof(MutableHashTableOfTensors) + ret;
+    return sizeof(MutableHashTableOfTensors) + table_.MemoryUsed();
   }
 
   Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
-    tf_shared_lock l(mu_);
-    int64_t size = table_.size();
-    Tensor keys(key_dtype(), TensorShape({size}));
-    Tensor values(value_dtype(), TensorShape({size, value_shape_.dim_size(0)}));
-    ExportKeysAndValues(&keys, &values);
+    Tensor keys;
+    Tensor values;
+    TF_RETURN_IF_ERROR(table_.WithAllShardsShared(
+        [&](const typename Table::ShardMaps& maps) -> Status {
+          int64_t size = Table::TotalSize(maps);
+          keys = Tensor(key_dtype(), TensorShape({size}));
+          values = Tensor(value_dtype(),
+                          TensorShape({size, value_shape_.dim_size(0)}));
+          ExportKeysAndValues(maps, &keys, &values);
+          return Status::OK();
+        }));
 
     // We set use_node_name_sharing with a unique node name so that the resource
     // can outlive the MutableHashTableOfTensorsV2 kernel. This means that the
@@ -384,28 +564,35 @@ class MutableHashTableOfTensors final : public LookupInterface {
   }
 
  private:
-  // Writes all keys and values into `keys` and `values`. `keys` and `values`
-  // must point to tensors of size `table_.size()`.
-  void ExportKeysAndValues(Tensor* keys, Tensor* values) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) {
+  typedef gtl::InlinedVector<V, 4> ValueArray;
+  typedef ShardedHashMap<K, ValueArray> Table;
+
+  // Estimated number of cycles to look up or insert a single key, excluding
+  // the cost of copying its value.
+  static constexpr int64_t kCostPerKey = 100;
+
+  // Writes all keys and values of `maps` into `keys` and `values`. `keys` and
+  // `values` must point to tensors of size `Table::TotalSize(maps)`.
+  void ExportKeysAndValues(const typename Table::ShardMaps& maps, Tensor* keys,
+                           Tensor* values) const {
     int64_t value_dim = value_shape_.dim_size(0);
     auto keys_data = keys->flat<K>();
     auto values_data = values->matrix<V>();
     int64_t i = 0;
-    for (auto it = table_.begin(); it != table_.end(); ++it, ++i) {
-      K key = it->first;
-      ValueArray value = it->second;
-      keys_data(i) = key;
-      for (int64_t j = 0; j < value_dim; j++) {
-        values_data(i, j) = value[j];
+    for (const auto* map : maps) {
+      for (auto it = map->begin(); it != map->end(); ++it, ++i) {
+        K key = it->first;
+        const ValueArray& value = it->second;
+        keys_data(i) = key;
+        for (int64_t j = 0; j < value_dim; j++) {
+          values_data(i, j) = value[j];
+        }
       }
     }
   }
 
   TensorShape value_shape_;
-  mutable mutex mu_;
-  typedef gtl::InlinedVector<V, 4> ValueArray;
-  std::unordered_map<K, ValueArray> table_ TF_GUARDED_BY(mu_);
+  Table table_;
 };
 
 namespace {
@@ -878,6 +1065,135 @@ class MutableDenseHashTable final : public LookupInterface {
   uint64 deleted_key_hash_;
 };
 
+// Immutable table backed by a memory-mapped file written by
+// WritePerfectHashTableFile. Opening the table does not read its entries, and
+// processes on the same host that open the same file share its pages, so very
+// large vocabularies cost neither load time nor per-process memory. Lookups
+// take no locks.
+template <class K, class V>
+class MemoryMappedHashTable final : public LookupInterface {
+ public:
+  MemoryMappedHashTable(OpKernelContext* ctx, OpKernel* kernel) {
+    OP_REQUIRES_OK(ctx, GetNodeAttr(kernel->def(), "filename", &filename_));
+    OP_REQUIRES_OK(ctx,
+                   PerfectHashTableFile::Open(ctx->env(), filename_, &file_));
+    OP_REQUIRES(ctx, file_->key_dtype() == key_dtype(),
+                errors::InvalidArgument(
+                    "Table file ", filename_, " has keys of type ",
+                    DataTypeString(file_->key_dtype()), ", expected ",
+                    DataTypeString(key_dtype())));
+  }
+
+  size_t size() const override { return file_->size(); }
+
+  Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
+              const Tensor& default_value) override {
+    const auto key_values = key.flat<K>();
+    auto value_values = value->flat<V>();
+    const auto default_flat = default_value.flat<V>();
+    const bool is_full_size_default =
+        (value_values.size() == default_flat.size());
+
+    auto find = [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        if (!FindKey(*file_, key_values(i), &value_values(i))) {
+          value_values(i) =
+              is_full_size_default ? default_flat(i) : default_flat(0);
+        }
+      }
+    };
+    auto* worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers,
+          key_values.size(), kCostPerKey, find);
+    return Status::OK();
+  }
+
+  Status Insert(OpKernelContext* ctx, const Tensor& keys,
+                const Tensor& values) override {
+    return errors::Unimplemented("MemoryMappedHashTable is read-only.");
+  }
+
+  Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
+    return errors::Unimplemented("MemoryMappedHashTable is read-only.");
+  }
+
+  Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
+                      const Tensor& values) override {
+    return errors::Unimplemented("MemoryMappedHashTable is read-only.");
+  }
+
+  Status ExportValues(OpKernelContext* ctx) override {
+    const int64_t size = file_->size();
+    Tensor* keys;
+    Tensor* values;
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("keys", TensorShape({size}), &keys));
+    TF_RETURN_IF_ERROR(
+        ctx->allocate_output("values", TensorShape({size}), &values));
+    ExportEntries(*file_, keys->flat<K>(), values->flat<V>());
+    return Status::OK();
+  }
+
+  DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
+
+  DataType value_dtype() const override { return DataTypeToEnum<V>::v(); }
+
+  TensorShape key_shape() const final { return TensorShape(); }
+
+  TensorShape value_shape() const override { return TensorShape(); }
+
+  // The mapped file is owned by the page cache and shared between tables, so
+  // it is not accounted to this table.
+  int64_t MemoryUsed() const override { return sizeof(MemoryMappedHashTable); }
+
+  Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
+    *out = ops::SourceOp(
+        "MemoryMappedHashTable",
+        builder->opts()
+            .WithName(UniqueNodeName("MemoryMappedHashTableFromGraphDef"))
+            .WithAttr("filename", filename_)
+            .WithAttr("use_node_name_sharing", true)
+            .WithAttr("key_dtype", key_dtype())
+            .WithAttr("value_dtype", value_dtype()));
+    return Status::OK();
+  }
+
+ private:
+  // Estimated number of cycles to look up a single key.
+  static constexpr int64_t kCostPerKey = 50;
+
+  static bool FindKey(const PerfectHashTableFile& file, int64_t key,
+                      int64_t* value) {
+    return file.Find(key, value);
+  }
+  static bool FindKey(const PerfectHashTableFile& file, const tstring& key,
+                      int64_t* value) {
+    return file.Find(StringPiece(key), value);
+  }
+
+  static void ExportEntries(const PerfectHashTableFile& file,
+                            TTypes<int64_t>::Flat keys,
+                            TTypes<int64_t>::Flat values) {
+    int64_t i = 0;
+    file.ForEachInt64Entry([&](int64_t key, int64_t value) {
+      keys(i) = key;
+      values(i++) = value;
+    });
+  }
+  static void ExportEntries(const PerfectHashTableFile& file,
+                            TTypes<tstring>::Flat keys,
+                            TTypes<int64_t>::Flat values) {
+    int64_t i = 0;
+    file.ForEachStringEntry([&](StringPiece key, int64_t value) {
+      keys(i) = tstring(key.data(), key.size());
+      values(i++) = value;
+    });
+  }
+
+  string filename_;
+  std::unique_ptr<PerfectHashTableFile> file_;
+};
+
 }  // namespace lookup
 
 // Base class for kernels that take a LookupTable handle as the 0th input.
@@ -1244,4 +1560,70 @@ REGISTER_KERNEL(tstring, ResourceHandle);
 
 #undef REGISTER_KERNEL
 
+// Register the MemoryMappedHashTable op.
+#define REGISTER_KERNEL(key_dtype, value_dtype)                             \
+  REGISTER_KERNEL_BUILDER(                                                  \
+      Name("MemoryMappedHashTable")                                         \
+          .Device(DEVICE_CPU)                                               \
+          .TypeConstraint<key_dtype>("key_dtype")                           \
+          .TypeConstraint<value_dtype>("value_dtype"),                      \
+      LookupTableOp<lookup::MemoryMappedHashTable<key_dtype, value_dtype>,  \
+                    key_dtype, value_dtype>)                                \
+  REGISTER_KERNEL_BUILDER(                                                  \
+      Name("AnonymousMemoryMappedHashTable")                                \
+          .Device(DEVICE_CPU)                                               \
+          .TypeConstraint<key_dtype>("key_dtype")                           \
+          .TypeConstraint<value_dtype>("value_dtype"),                      \
+      AnonymousLookupTableOp<                                               \
+          lookup::MemoryMappedHashTable<key_dtype, value_dtype>, key_dtype, \
+          value_dtype>)
+
+REGISTER_KERNEL(int64_t, int64_t);
+REGISTER_KERNEL(tstring, int64_t);
+
+#undef REGISTER_KERNEL
+
+// Writes a file for MemoryMappedHashTable from a vector of keys and a vector of
+// values.
+template <class K>
+class WriteMemoryMappedHashTableFileOp : public OpKernel {
+ public:
+  explicit WriteMemoryMappedHashTableFileOp(OpKernelConstruction* ctx)
+      : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext* ctx) override {
+    const Tensor& filename = ctx->input(0);
+    const Tensor& keys = ctx->input(1);
+    const Tensor& values = ctx->input(2);
+    OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(filename.shape()),
+                errors::InvalidArgument("filename must be a scalar, got shape ",
+                                        filename.shape().DebugString()));
+    OP_REQUIRES(ctx, TensorShapeUtils::IsVector(keys.shape()),
+                errors::InvalidArgument("keys must be a vector, got shape ",
+                                        keys.shape().DebugString()));
+    OP_REQUIRES(ctx, TensorShapeUtils::IsVector(values.shape()),
+                errors::InvalidArgument("values must be a vector, got shape ",
+                                        values.shape().DebugString()));
+    const auto keys_flat = keys.flat<K>();
+    const auto values_flat = values.flat<int64_t>();
+    OP_REQUIRES_OK(ctx, lookup::WritePerfectHashTableFile(
+                            ctx->env(), string(filename.scalar<tstring>()()),
+                            absl::Span<const K>(keys_flat.data(),
+                                                keys_flat.size()),
+                            absl::Span<const int64_t>(values_flat.data(),
+                                                      values_flat.size())));
+  }
+};
+
+#define REGISTER_KERNEL(key_dtype)                                \
+  REGISTER_KERNEL_BUILDER(Name("WriteMemoryMappedHashTableFile")  \
+                              .Device(DEVICE_CPU)                 \
+                              .TypeConstraint<key_dtype>("Tkey"), \
+                          WriteMemoryMappedHashTableFileOp<key_dtype>)
+
+REGISTER_KERNEL(int64_t);
+REGISTER_KERNEL(tstring);
+
+#undef REGISTER_KERNEL
+
 }  // namespace tensorflow
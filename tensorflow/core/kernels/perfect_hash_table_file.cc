@@ -0,0 +1,396 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/perfect_hash_table_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/byte_order.h"
+#include "tensorflow/core/platform/hash.h"
+
+namespace tensorflow {
+namespace lookup {
+namespace {
+
+constexpr char kMagic[8] = {'T', 'F', 'P', 'H', 'T', 'A', 'B', '\0'};
+constexpr uint32 kVersion = 1;
+constexpr uint64 kHashSeed = 0x5bd1e9955bd1e995ULL;
+// Average number of keys per bucket. Larger buckets give a smaller
+// displacement array but make the first buckets harder to place.
+constexpr uint64 kKeysPerBucket = 4;
+// Upper bound on the displacements tried for a single bucket. A bucket that
+// cannot be placed within them is unlucky with the current hash seed, which
+// is cheaper to change than to keep searching.
+constexpr uint32 kMaxDisplacement = 1u << 16;
+// Number of hash seeds tried before giving up on building a table.
+constexpr int kMaxSeeds = 16;
+
+// 64-bit finalizer from MurmurHash3. Unlike Hash64Combine it mixes every input
+// bit into every output bit, so consecutive displacements yield independent
+// slots.
+inline uint64 Mix(uint64 x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+inline uint64 SlotFor(uint64 hash, uint32 displacement, uint64 num_slots) {
+  return Mix(hash + displacement * 0x9E3779B97F4A7C15ULL) % num_slots;
+}
+
+inline uint64 HashKey(int64_t key, uint64 seed) {
+  return Hash64(reinterpret_cast<const char*>(&key), sizeof(key), seed);
+}
+
+inline uint64 HashKey(StringPiece key, uint64 seed) {
+  return Hash64(key.data(), key.size(), seed);
+}
+
+inline uint64 RoundUp8(uint64 n) { return (n + 7) & ~uint64{7}; }
+
+inline uint64 NumBitmapWords(uint64 num_slots) { return (num_slots + 63) / 64; }
+
+bool KeysEqual(int64_t a, int64_t b) { return a == b; }
+bool KeysEqual(const tstring& a, const tstring& b) { return a == b; }
+
+// Assigns every key a distinct slot. On success `slots[i]` is the slot of
+// `hashes[i]`.
+Status BuildPerfectHash(const std::vector<uint64>& hashes, uint64 num_slots,
+                        uint64 num_buckets, std::vector<uint32>* displacements,
+                        std::vector<uint64>* slots) {
+  std::vector<std::vector<uint32>> buckets(num_buckets);
+  for (uint32 i = 0; i < hashes.size(); ++i) {
+    buckets[hashes[i] % num_buckets].push_back(i);
+  }
+  // Place the largest buckets first, while most slots are still free.
+  std::vector<uint64> order(num_buckets);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&buckets](uint64 a, uint64 b) {
+    return buckets[a].size() > buckets[b].size();
+  });
+
+  displacements->assign(num_buckets, 0);
+  slots->assign(hashes.size(), 0);
+  std::vector<bool> taken(num_slots, false);
+  std::vector<uint64> candidate;
+  for (uint64 b : order) {
+    const std::vector<uint32>& bucket = buckets[b];
+    if (bucket.empty()) break;
+    bool placed = false;
+    for (uint32 d = 0; d < kMaxDisplacement && !placed; ++d) {
+      candidate.clear();
+      placed = true;
+      for (uint32 i : bucket) {
+        const uint64 slot = SlotFor(hashes[i], d, num_slots);
+        if (taken[slot] || std::find(candidate.begin(), candidate.end(),
+                                     slot) != candidate.end()) {
+          placed = false;
+          break;
+        }
+        candidate.push_back(slot);
+      }
+      if (placed) {
+        (*displacements)[b] = d;
+        for (size_t j = 0; j < bucket.size(); ++j) {
+          taken[candidate[j]] = true;
+          (*slots)[bucket[j]] = candidate[j];
+        }
+      }
+    }
+    if (!placed) {
+      return errors::Internal("Could not find a perfect hash for a bucket of ",
+                              bucket.size(), " keys in a table of ",
+                              hashes.size(), " keys.");
+    }
+  }
+  return Status::OK();
+}
+
+template <typename K>
+Status CheckDistinctHashes(absl::Span<const K> keys,
+                           const std::vector<uint64>& hashes) {
+  std::vector<uint32> by_hash(hashes.size());
+  std::iota(by_hash.begin(), by_hash.end(), 0);
+  std::sort(by_hash.begin(), by_hash.end(),
+            [&hashes](uint32 a, uint32 b) { return hashes[a] < hashes[b]; });
+  for (size_t i = 1; i < by_hash.size(); ++i) {
+    const uint32 a = by_hash[i - 1];
+    const uint32 b = by_hash[i];
+    if (hashes[a] != hashes[b]) continue;
+    if (KeysEqual(keys[a], keys[b])) {
+      return errors::InvalidArgument("Duplicate key at positions ", a, " and ",
+                                     b, ".");
+    }
+    return errors::Internal("Keys at positions ", a, " and ", b,
+                            " have the same 64-bit hash.");
+  }
+  return Status::OK();
+}
+
+template <typename T>
+Status AppendArray(WritableFile* file, const std::vector<T>& array) {
+  const uint64 bytes = array.size() * sizeof(T);
+  TF_RETURN_IF_ERROR(file->Append(
+      StringPiece(reinterpret_cast<const char*>(array.data()), bytes)));
+  static const char kPadding[8] = {0};
+  return file->Append(StringPiece(kPadding, RoundUp8(bytes) - bytes));
+}
+
+// Writes the key section for a table whose slot `s` holds
+// `keys[entry_of_slot[s]]`, or nothing if `entry_of_slot[s]` is negative.
+Status AppendKeys(WritableFile* file, absl::Span<const int64_t> keys,
+                  const std::vector<int64_t>& entry_of_slot) {
+  std::vector<int64_t> slot_keys(entry_of_slot.size(), 0);
+  for (size_t slot = 0; slot < entry_of_slot.size(); ++slot) {
+    if (entry_of_slot[slot] >= 0) slot_keys[slot] = keys[entry_of_slot[slot]];
+  }
+  return AppendArray(file, slot_keys);
+}
+
+Status AppendKeys(WritableFile* file, absl::Span<const tstring> keys,
+                  const std::vector<int64_t>& entry_of_slot) {
+  std::vector<uint64> key_offsets;
+  std::vector<char> key_data;
+  key_offsets.reserve(entry_of_slot.size() + 1);
+  key_offsets.push_back(0);
+  for (size_t slot = 0; slot < entry_of_slot.size(); ++slot) {
+    if (entry_of_slot[slot] >= 0) {
+      const tstring& key = keys[entry_of_slot[slot]];
+      key_data.insert(key_data.end(), key.data(), key.data() + key.size());
+    }
+    key_offsets.push_back(key_data.size());
+  }
+  TF_RETURN_IF_ERROR(AppendArray(file, key_offsets));
+  return AppendArray(file, key_data);
+}
+
+uint64 KeyDataSize(absl::Span<const int64_t> keys) { return 0; }
+
+uint64 KeyDataSize(absl::Span<const tstring> keys) {
+  uint64 size = 0;
+  for (const tstring& key : keys) size += key.size();
+  return size;
+}
+
+template <typename K>
+Status WriteTable(Env* env, const string& filename, absl::Span<const K> keys,
+                  absl::Span<const int64_t> values, DataType key_dtype) {
+  if (!port::kLittleEndian) {
+    return errors::Unimplemented(
+        "Perfect hash table files are only supported on little-endian hosts.");
+  }
+  if (keys.size() != values.size()) {
+    return errors::InvalidArgument("Got ", keys.size(), " keys and ",
+                                   values.size(), " values.");
+  }
+  if (keys.size() >= std::numeric_limits<uint32>::max()) {
+    return errors::InvalidArgument("Too many keys: ", keys.size());
+  }
+
+  const uint64 num_entries = keys.size();
+  const uint64 num_slots = num_entries + num_entries / 100 + 1;
+  const uint64 num_buckets =
+      std::max<uint64>(1, (num_entries + kKeysPerBucket - 1) / kKeysPerBucket);
+
+  // Hash collisions and buckets that cannot be placed are retried with other
+  // seeds; duplicate keys are an error whatever the seed.
+  uint64 seed = kHashSeed;
+  std::vector<uint64> hashes(num_entries);
+  std::vector<uint32> displacements;
+  std::vector<uint64> slot_of;
+  Status status;
+  for (int attempt = 0; attempt < kMaxSeeds; ++attempt) {
+    seed = Mix(kHashSeed + attempt);
+    for (uint64 i = 0; i < num_entries; ++i) hashes[i] = HashKey(keys[i], seed);
+    status = CheckDistinctHashes(keys, hashes);
+    if (errors::IsInvalidArgument(status)) return status;
+    if (status.ok()) {
+      status = BuildPerfectHash(hashes, num_slots, num_buckets, &displacements,
+                                &slot_of);
+    }
+    if (status.ok()) break;
+  }
+  TF_RETURN_IF_ERROR(status);
+
+  std::vector<uint64> occupied(NumBitmapWords(num_slots), 0);
+  std::vector<int64_t> slot_values(num_slots, 0);
+  std::vector<int64_t> entry_of_slot(num_slots, -1);
+  for (uint64 i = 0; i < num_entries; ++i) {
+    const uint64 slot = slot_of[i];
+    occupied[slot / 64] |= uint64{1} << (slot % 64);
+    slot_values[slot] = values[i];
+    entry_of_slot[slot] = i;
+  }
+
+  std::unique_ptr<WritableFile> file;
+  TF_RETURN_IF_ERROR(env->NewWritableFile(filename, &file));
+
+  PerfectHashTableHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.key_dtype = key_dtype;
+  header.num_entries = num_entries;
+  header.num_slots = num_slots;
+  header.num_buckets = num_buckets;
+  header.key_data_size = KeyDataSize(keys);
+  header.hash_seed = seed;
+
+  TF_RETURN_IF_ERROR(file->Append(
+      StringPiece(reinterpret_cast<const char*>(&header), sizeof(header))));
+  TF_RETURN_IF_ERROR(AppendArray(file.get(), displacements));
+  TF_RETURN_IF_ERROR(AppendArray(file.get(), occupied));
+  TF_RETURN_IF_ERROR(AppendArray(file.get(), slot_values));
+  TF_RETURN_IF_ERROR(AppendKeys(file.get(), keys, entry_of_slot));
+  return file->Close();
+}
+
+}  // namespace
+
+Status WritePerfectHashTableFile(Env* env, const string& filename,
+                                 absl::Span<const int64_t> keys,
+                                 absl::Span<const int64_t> values) {
+  return WriteTable(env, filename, keys, values, DT_INT64);
+}
+
+Status WritePerfectHashTableFile(Env* env, const string& filename,
+                                 absl::Span<const tstring> keys,
+                                 absl::Span<const int64_t> values) {
+  return WriteTable(env, filename, keys, values, DT_STRING);
+}
+
+Status PerfectHashTableFile::Open(
+    Env* env, const string& filename,
+    std::unique_ptr<PerfectHashTableFile>* table) {
+  if (!port::kLittleEndian) {
+    return errors::Unimplemented(
+        "Perfect hash table files are only supported on little-endian hosts.");
+  }
+  std::unique_ptr<PerfectHashTableFile> result(new PerfectHashTableFile);
+  TF_RETURN_IF_ERROR(
+      env->NewReadOnlyMemoryRegionFromFile(filename, &result->region_));
+  const char* data = static_cast<const char*>(result->region_->data());
+  const uint64 length = result->region_->length();
+  if (reinterpret_cast<uintptr_t>(data) % 8 != 0) {
+    return errors::FailedPrecondition("Memory region of ", filename,
+                                      " is not 8-byte aligned.");
+  }
+
+  PerfectHashTableHeader header;
+  if (length < sizeof(header)) {
+    return errors::DataLoss(filename, " is too short to be a hash table file.");
+  }
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    return errors::DataLoss(filename, " is not a hash table file.");
+  }
+  if (header.version != kVersion) {
+    return errors::DataLoss(filename, " has unsupported version ",
+                            header.version, ", expected ", kVersion, ".");
+  }
+  if (header.key_dtype != DT_INT64 && header.key_dtype != DT_STRING) {
+    return errors::DataLoss(filename, " has unsupported key type ",
+                            header.key_dtype, ".");
+  }
+  // Bound every count by the file length before computing section sizes so
+  // that the arithmetic below cannot overflow.
+  if (header.num_slots == 0 || header.num_slots > length / 8 ||
+      header.num_buckets == 0 || header.num_buckets > length / 4 ||
+      header.num_entries > header.num_slots ||
+      header.key_data_size > length) {
+    return errors::DataLoss(filename, " has an invalid header.");
+  }
+
+  const uint64 num_slots = header.num_slots;
+  uint64 offset = sizeof(header);
+  const uint64 displacements_offset = offset;
+  offset += RoundUp8(header.num_buckets * sizeof(uint32));
+  const uint64 occupied_offset = offset;
+  offset += NumBitmapWords(num_slots) * sizeof(uint64);
+  const uint64 values_offset = offset;
+  offset += num_slots * sizeof(int64_t);
+  const uint64 keys_offset = offset;
+  if (header.key_dtype == DT_INT64) {
+    offset += num_slots * sizeof(int64_t);
+  } else {
+    offset += (num_slots + 1) * sizeof(uint64);
+    offset += RoundUp8(header.key_data_size);
+  }
+  if (offset != length) {
+    return errors::DataLoss(filename, " has size ", length, ", expected ",
+                            offset, ".");
+  }
+
+  result->key_dtype_ = static_cast<DataType>(header.key_dtype);
+  result->num_entries_ = header.num_entries;
+  result->num_slots_ = num_slots;
+  result->num_buckets_ = header.num_buckets;
+  result->key_data_size_ = header.key_data_size;
+  result->hash_seed_ = header.hash_seed;
+  result->displacements_ =
+      reinterpret_cast<const uint32*>(data + displacements_offset);
+  result->occupied_ = reinterpret_cast<const uint64*>(data + occupied_offset);
+  result->values_ = reinterpret_cast<const int64_t*>(data + values_offset);
+  if (result->key_dtype_ == DT_INT64) {
+    result->int64_keys_ = reinterpret_cast<const int64_t*>(data + keys_offset);
+  } else {
+    result->key_offsets_ = reinterpret_cast<const uint64*>(data + keys_offset);
+    result->key_data_ = data + keys_offset + (num_slots + 1) * sizeof(uint64);
+  }
+  *table = std::move(result);
+  return Status::OK();
+}
+
+uint64 PerfectHashTableFile::Slot(uint64 hash) const {
+  return SlotFor(hash, displacements_[hash % num_buckets_], num_slots_);
+}
+
+bool PerfectHashTableFile::StringKeyAt(uint64 slot, StringPiece* key) const {
+  const uint64 begin = key_offsets_[slot];
+  const uint64 end = key_offsets_[slot + 1];
+  if (begin > end || end > key_data_size_) return false;
+  *key = StringPiece(key_data_ + begin, end - begin);
+  return true;
+}
+
+bool PerfectHashTableFile::Find(int64_t key, int64_t* value) const {
+  if (key_dtype_ != DT_INT64) return false;
+  const uint64 slot = Slot(HashKey(key, hash_seed_));
+  if (!IsOccupied(slot) || int64_keys_[slot] != key) return false;
+  *value = values_[slot];
+  return true;
+}
+
+bool PerfectHashTableFile::Find(StringPiece key, int64_t* value) const {
+  if (key_dtype_ != DT_STRING) return false;
+  const uint64 slot = Slot(HashKey(key, hash_seed_));
+  StringPiece stored;
+  if (!IsOccupied(slot) || !StringKeyAt(slot, &stored) || stored != key) {
+    return false;
+  }
+  *value = values_[slot];
+  return true;
+}
+
+}  // namespace lookup
+}  // namespace tensorflow
@@ -0,0 +1,150 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_PERFECT_HASH_TABLE_FILE_H_
+#define TENSORFLOW_CORE_KERNELS_PERFECT_HASH_TABLE_FILE_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/types/span.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/stringpiece.h"
+#include "tensorflow/core/platform/tstring.h"
+
+namespace tensorflow {
+namespace lookup {
+
+// An immutable table from int64 or string keys to int64 values, stored in a
+// single file that can be memory-mapped and queried without parsing.
+//
+// Keys are placed with a "hash and displace" perfect hash: every key hashes,
+// with `hash_seed`, to one of `num_buckets` buckets, and each bucket stores a
+// displacement that maps all of its keys to distinct slots. A lookup therefore
+// reads one displacement, one slot and compares one key. Tables use slightly
+// more slots than keys (about 1%), which keeps building linear in the number
+// of keys.
+//
+// File layout. All integers are stored little-endian and every section starts
+// at a multiple of 8 bytes:
+//
+//   PerfectHashTableHeader header
+//   uint32 displacements[num_buckets]           (padded to 8 bytes)
+//   uint64 occupied[ceil(num_slots / 64)]       (bitmap of used slots)
+//   int64  values[num_slots]
+//   For DT_INT64 keys:
+//     int64  keys[num_slots]
+//   For DT_STRING keys:
+//     uint64 key_offsets[num_slots + 1]         (into key_data)
+//     char   key_data[key_data_size]            (padded to 8 bytes)
+struct PerfectHashTableHeader {
+  char magic[8];
+  uint32 version;
+  uint32 key_dtype;
+  uint64 num_entries;
+  uint64 num_slots;
+  uint64 num_buckets;
+  uint64 key_data_size;
+  uint64 hash_seed;
+};
+
+// Writes a table mapping `keys[i]` to `values[i]` to `filename`. Keys must be
+// unique.
+Status WritePerfectHashTableFile(Env* env, const string& filename,
+                                 absl::Span<const int64_t> keys,
+                                 absl::Span<const int64_t> values);
+Status WritePerfectHashTableFile(Env* env, const string& filename,
+                                 absl::Span<const tstring> keys,
+                                 absl::Span<const int64_t> values);
+
+// Read-only view of a file written by WritePerfectHashTableFile. The file is
+// memory-mapped when the filesystem supports it, so opening a table is
+// independent of its size and its pages are shared by all processes on the
+// host that open the same file.
+class PerfectHashTableFile {
+ public:
+  // Maps `filename` and validates its header.
+  static Status Open(Env* env, const string& filename,
+                     std::unique_ptr<PerfectHashTableFile>* table);
+
+  DataType key_dtype() const { return key_dtype_; }
+
+  // Returns the number of keys in the table.
+  int64_t size() const { return num_entries_; }
+
+  // Returns the size of the mapped file in bytes.
+  uint64 mapped_bytes() const { return region_->length(); }
+
+  // Looks up `key` and stores its value in `value`. Returns false if `key` is
+  // not in the table or has the wrong type.
+  bool Find(int64_t key, int64_t* value) const;
+  bool Find(StringPiece key, int64_t* value) const;
+
+  // Calls `fn(key, value)` for every entry of an int64 or string keyed table,
+  // in slot order.
+  template <typename Fn>
+  void ForEachInt64Entry(Fn fn) const;
+  template <typename Fn>
+  void ForEachStringEntry(Fn fn) const;
+
+ private:
+  PerfectHashTableFile() = default;
+
+  // Returns the slot that may hold a key with hash `hash`.
+  uint64 Slot(uint64 hash) const;
+  bool IsOccupied(uint64 slot) const {
+    return (occupied_[slot / 64] >> (slot % 64)) & 1;
+  }
+  // Returns false if `slot` refers to key bytes outside of the file.
+  bool StringKeyAt(uint64 slot, StringPiece* key) const;
+
+  std::unique_ptr<ReadOnlyMemoryRegion> region_;
+  DataType key_dtype_ = DT_INVALID;
+  int64_t num_entries_ = 0;
+  uint64 num_slots_ = 0;
+  uint64 num_buckets_ = 0;
+  uint64 key_data_size_ = 0;
+  uint64 hash_seed_ = 0;
+  const uint32* displacements_ = nullptr;
+  const uint64* occupied_ = nullptr;
+  const int64_t* values_ = nullptr;
+  const int64_t* int64_keys_ = nullptr;
+  const uint64* key_offsets_ = nullptr;
+  const char* key_data_ = nullptr;
+};
+
+template <typename Fn>
+void PerfectHashTableFile::ForEachInt64Entry(Fn fn) const {
+  if (key_dtype_ != DT_INT64) return;
+  for (uint64 slot = 0; slot < num_slots_; ++slot) {
+    if (IsOccupied(slot)) fn(int64_keys_[slot], values_[slot]);
+  }
+}
+
+template <typename Fn>
+void PerfectHashTableFile::ForEachStringEntry(Fn fn) const {
+  if (key_dtype_ != DT_STRING) return;
+  StringPiece key;
+  for (uint64 slot = 0; slot < num_slots_; ++slot) {
+    if (IsOccupied(slot) && StringKeyAt(slot, &key)) fn(key, values_[slot]);
+  }
+}
+
+}  // namespace lookup
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_PERFECT_HASH_TABLE_FILE_H_
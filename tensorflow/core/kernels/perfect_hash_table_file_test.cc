@@ -0,0 +1,156 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/perfect_hash_table_file.h"
+
+#include <map>
+#include <vector>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace lookup {
+namespace {
+
+string TablePath(const string& name) {
+  return io::JoinPath(testing::TmpDir(), name);
+}
+
+TEST(PerfectHashTableFileTest, Int64Keys) {
+  const string filename = TablePath("int64_keys");
+  std::vector<int64_t> keys;
+  std::vector<int64_t> values;
+  for (int64_t i = 0; i < 10000; ++i) {
+    keys.push_back(i * 7919 - 5000);
+    values.push_back(i);
+  }
+  TF_ASSERT_OK(
+      WritePerfectHashTableFile(Env::Default(), filename, keys, values));
+
+  std::unique_ptr<PerfectHashTableFile> table;
+  TF_ASSERT_OK(PerfectHashTableFile::Open(Env::Default(), filename, &table));
+  EXPECT_EQ(DT_INT64, table->key_dtype());
+  EXPECT_EQ(static_cast<int64_t>(keys.size()), table->size());
+
+  int64_t value;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_TRUE(table->Find(keys[i], &value)) << keys[i];
+    EXPECT_EQ(values[i], value);
+  }
+  EXPECT_FALSE(table->Find(int64_t{1}, &value));
+  EXPECT_FALSE(table->Find(StringPiece("0"), &value));
+
+  std::map<int64_t, int64_t> exported;
+  table->ForEachInt64Entry(
+      [&exported](int64_t key, int64_t v) { exported[key] = v; });
+  EXPECT_EQ(keys.size(), exported.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    EXPECT_EQ(values[i], exported[keys[i]]);
+  }
+}
+
+TEST(PerfectHashTableFileTest, StringKeys) {
+  const string filename = TablePath("string_keys");
+  std::vector<tstring> keys;
+  std::vector<int64_t> values;
+  for (int64_t i = 0; i < 10000; ++i) {
+    keys.push_back(strings::StrCat("token_", i));
+    values.push_back(-i);
+  }
+  keys.push_back("");
+  values.push_back(42);
+  TF_ASSERT_OK(
+      WritePerfectHashTableFile(Env::Default(), filename, keys, values));
+
+  std::unique_ptr<PerfectHashTableFile> table;
+  TF_ASSERT_OK(PerfectHashTableFile::Open(Env::Default(), filename, &table));
+  EXPECT_EQ(DT_STRING, table->key_dtype());
+  EXPECT_EQ(static_cast<int64_t>(keys.size()), table->size());
+
+  int64_t value;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_TRUE(table->Find(StringPiece(keys[i]), &value)) << keys[i];
+    EXPECT_EQ(values[i], value);
+  }
+  EXPECT_FALSE(table->Find(StringPiece("token_10000"), &value));
+  EXPECT_FALSE(table->Find(int64_t{0}, &value));
+
+  int64_t count = 0;
+  table->ForEachStringEntry([&count](StringPiece key, int64_t v) {
+    ++count;
+  });
+  EXPECT_EQ(static_cast<int64_t>(keys.size()), count);
+}
+
+TEST(PerfectHashTableFileTest, EmptyTable) {
+  const string filename = TablePath("empty");
+  TF_ASSERT_OK(WritePerfectHashTableFile(Env::Default(), filename,
+                                         absl::Span<const int64_t>(), {}));
+  std::unique_ptr<PerfectHashTableFile> table;
+  TF_ASSERT_OK(PerfectHashTableFile::Open(Env::Default(), filename, &table));
+  EXPECT_EQ(0, table->size());
+  int64_t value;
+  EXPECT_FALSE(table->Find(int64_t{0}, &value));
+}
+
+TEST(PerfectHashTableFileTest, DuplicateKeys) {
+  const std::vector<int64_t> keys = {1, 2, 1};
+  const std::vector<int64_t> values = {0, 1, 2};
+  Status s = WritePerfectHashTableFile(Env::Default(), TablePath("duplicates"),
+                                       keys, values);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
+
+TEST(PerfectHashTableFileTest, MismatchedSizes) {
+  const std::vector<int64_t> keys = {1, 2};
+  const std::vector<int64_t> values = {0};
+  Status s = WritePerfectHashTableFile(Env::Default(), TablePath("mismatched"),
+                                       keys, values);
+  EXPECT_TRUE(errors::IsInvalidArgument(s)) << s;
+}
+
+TEST(PerfectHashTableFileTest, CorruptFiles) {
+  const string filename = TablePath("corrupt");
+  const std::vector<int64_t> keys = {1, 2, 3};
+  TF_ASSERT_OK(
+      WritePerfectHashTableFile(Env::Default(), filename, keys, keys));
+  string contents;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), filename, &contents));
+
+  std::unique_ptr<PerfectHashTableFile> table;
+  // Truncated.
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), filename,
+                                 contents.substr(0, contents.size() - 8)));
+  EXPECT_TRUE(errors::IsDataLoss(
+      PerfectHashTableFile::Open(Env::Default(), filename, &table)));
+  // Shorter than the header.
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), filename, "TFPH"));
+  EXPECT_TRUE(errors::IsDataLoss(
+      PerfectHashTableFile::Open(Env::Default(), filename, &table)));
+  // Bad magic.
+  string bad_magic = contents;
+  bad_magic[0] = 'X';
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), filename, bad_magic));
+  EXPECT_TRUE(errors::IsDataLoss(
+      PerfectHashTableFile::Open(Env::Default(), filename, &table)));
+}
+
+}  // namespace
+}  // namespace lookup
+}  // namespace tensorflow
@@ -420,6 +420,7 @@ class RandomBinomialOp : public OpKernel {
 
     OP_REQUIRES_OK(ctx, PrepareToUpdateVariable<Device, StateElementType>(
                             ctx, var_tensor, var->copy_on_read_mode.load()));
+    var->MarkAllRowsDirty();
     auto var_data = var_tensor_flat.data();
     auto philox = GetPhiloxRandomFromMem(var_data);
     UpdateMemWithPhiloxRandom(
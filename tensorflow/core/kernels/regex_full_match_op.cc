@@ -14,17 +14,38 @@ limitations under the License.
 ==============================================================================*/
 
 #include <string>
+#include <vector>
 
 #include "re2/re2.h"
+#include "re2/set.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/regex_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
-#include "tensorflow/core/platform/mutex.h"
-#include "tensorflow/core/platform/thread_annotations.h"
-#include "tensorflow/core/util/ptr_util.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
+namespace {
+
+// Full-matches every element of `input` against `regex` into `output`, which
+// has the same shape, splitting the elements across the CPU worker threads.
+void FullMatchAll(OpKernelContext* ctx, const RE2& regex, const Tensor& input,
+                  Tensor* output) {
+  const tstring* input_data = input.flat<tstring>().data();
+  bool* output_data = output->flat<bool>().data();
+  const int64_t n = input.NumElements();
+  auto match = [&regex, input_data, output_data](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      output_data[i] = RE2::FullMatch(input_data[i], regex);
+    }
+  };
+  auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+  Shard(worker_threads->num_threads, worker_threads->workers, n,
+        EstimateRegexMatchCost(input_data, n), match);
+}
+
+}  // namespace
 
 class RegexFullMatchOp : public OpKernel {
  public:
@@ -35,7 +56,6 @@ class RegexFullMatchOp : public OpKernel {
   void Compute(OpKernelContext* ctx) override {
     const Tensor* input_tensor;
     OP_REQUIRES_OK(ctx, ctx->input("input", &input_tensor));
-    const auto& input_flat = input_tensor->flat<tstring>();
 
     const Tensor* pattern_tensor;
     OP_REQUIRES_OK(ctx, ctx->input("pattern", &pattern_tensor));
@@ -43,7 +63,7 @@ class RegexFullMatchOp : public OpKernel {
                 errors::InvalidArgument("Pattern must be scalar, but received ",
                                         pattern_tensor->shape().DebugString()));
     const string pattern = pattern_tensor->flat<tstring>()(0);
-    std::shared_ptr<RE2> regex = CachedRE2(pattern);
+    std::shared_ptr<const RE2> regex = GetCompiledRegex(pattern);
     OP_REQUIRES(ctx, regex->ok(),
                 errors::InvalidArgument("Invalid pattern: ", pattern,
                                         ", error: ", regex->error()));
@@ -51,34 +71,10 @@ class RegexFullMatchOp : public OpKernel {
     Tensor* output_tensor = nullptr;
     OP_REQUIRES_OK(ctx, ctx->allocate_output("output", input_tensor->shape(),
                                              &output_tensor));
-    auto output_flat = output_tensor->flat<bool>();
-    for (size_t i = 0; i < input_flat.size(); ++i) {
-      output_flat(i) = RE2::FullMatch(input_flat(i), *regex);
-    }
+    FullMatchAll(ctx, *regex, *input_tensor, output_tensor);
   }
 
  private:
-  std::shared_ptr<RE2> CachedRE2(const string& pattern) {
-    {
-      tf_shared_lock l(mu_);
-      if (regex_ != nullptr && regex_->pattern() == pattern) {
-        return regex_;
-      }
-    }
-    // Construct the new RE2 object before acquiring the lock.
-    auto regex = std::make_shared<RE2>(pattern);
-    {
-      mutex_lock l(mu_);
-      // Swap instead of assigning so that we destruct the old
-      // RE2 object (when necessary) after releasing the lock.
-      regex_.swap(regex);
-      return regex_;
-    }
-  }
-
-  mutex mu_;
-  std::shared_ptr<RE2> regex_ TF_GUARDED_BY(mu_);
-
   TF_DISALLOW_COPY_AND_ASSIGN(RegexFullMatchOp);
 };
 
@@ -90,7 +86,7 @@ class StaticRegexFullMatchOp : public OpKernel {
   explicit StaticRegexFullMatchOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
     string pattern;
     OP_REQUIRES_OK(ctx, ctx->GetAttr("pattern", &pattern));
-    re_ = MakeUnique<RE2>(pattern);
+    re_ = GetCompiledRegex(pattern);
     OP_REQUIRES(ctx, re_->ok(),
                 errors::InvalidArgument("Invalid pattern: ", pattern,
                                         ", error: ", re_->error()));
@@ -99,22 +95,104 @@ class StaticRegexFullMatchOp : public OpKernel {
   void Compute(OpKernelContext* ctx) override {
     const Tensor* input_tensor;
     OP_REQUIRES_OK(ctx, ctx->input("input", &input_tensor));
-    const auto& input_flat = input_tensor->flat<tstring>();
 
     Tensor* output_tensor = nullptr;
     OP_REQUIRES_OK(ctx, ctx->allocate_output("output", input_tensor->shape(),
                                              &output_tensor));
-    auto output_flat = output_tensor->flat<bool>();
-    for (size_t i = 0; i < input_flat.size(); ++i) {
-      output_flat(i) = RE2::FullMatch(input_flat(i), *re_);
-    }
+    FullMatchAll(ctx, *re_, *input_tensor, output_tensor);
   }
 
  private:
-  std::unique_ptr<RE2> re_;
+  std::shared_ptr<const RE2> re_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("StaticRegexFullMatch").Device(DEVICE_CPU),
                         StaticRegexFullMatchOp);
 
+// Full-matches every element of its input against several patterns in a
+// single pass with an RE2::Set, instead of scanning the element once per
+// pattern. Elements for which the set runs out of memory are matched against
+// the patterns one at a time.
+class StaticRegexFullMatchSetOp : public OpKernel {
+ public:
+  explicit StaticRegexFullMatchSetOp(OpKernelConstruction* ctx)
+      : OpKernel(ctx), set_(SetOptions(), RE2::ANCHOR_BOTH) {
+    std::vector<string> patterns;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("patterns", &patterns));
+    OP_REQUIRES(ctx, patterns.size() == static_cast<size_t>(num_outputs()),
+                errors::InvalidArgument("Expected ", num_outputs(),
+                                        " patterns, got ", patterns.size()));
+    for (const string& pattern : patterns) {
+      regexes_.push_back(GetCompiledRegex(pattern));
+      const RE2& regex = *regexes_.back();
+      OP_REQUIRES(ctx, regex.ok(),
+                  errors::InvalidArgument("Invalid pattern: ", pattern,
+                                          ", error: ", regex.error()));
+      string error;
+      OP_REQUIRES(ctx, set_.Add(pattern, &error) >= 0,
+                  errors::InvalidArgument("Invalid pattern: ", pattern,
+                                          ", error: ", error));
+    }
+    set_compiled_ = set_.Compile();
+    if (!set_compiled_) {
+      LOG(WARNING) << "Could not compile the " << patterns.size()
+                   << " patterns of " << name()
+                   << " into one automaton; matching them one at a time.";
+    }
+  }
+
+  void Compute(OpKernelContext* ctx) override {
+    const Tensor* input_tensor;
+    OP_REQUIRES_OK(ctx, ctx->input("input", &input_tensor));
+    const int num_patterns = regexes_.size();
+    std::vector<bool*> outputs(num_patterns);
+    for (int k = 0; k < num_patterns; ++k) {
+      Tensor* output_tensor = nullptr;
+      OP_REQUIRES_OK(ctx, ctx->allocate_output(k, input_tensor->shape(),
+                                               &output_tensor));
+      outputs[k] = output_tensor->flat<bool>().data();
+    }
+
+    const tstring* input_data = input_tensor->flat<tstring>().data();
+    const int64_t n = input_tensor->NumElements();
+    auto match = [this, input_data, &outputs](int64_t begin, int64_t end) {
+      std::vector<int> matches;
+      for (int64_t i = begin; i < end; ++i) {
+        for (bool* output : outputs) output[i] = false;
+        RE2::Set::ErrorInfo error_info;
+        if (set_compiled_ &&
+            (set_.Match(input_data[i], &matches, &error_info) ||
+             error_info.kind == RE2::Set::kNoError)) {
+          for (int k : matches) outputs[k][i] = true;
+          continue;
+        }
+        for (size_t k = 0; k < outputs.size(); ++k) {
+          outputs[k][i] = RE2::FullMatch(input_data[i], *regexes_[k]);
+        }
+      }
+    };
+    auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, n,
+          EstimateRegexMatchCost(input_data, n) + num_patterns, match);
+  }
+
+ private:
+  static RE2::Options SetOptions() {
+    RE2::Options options;
+    // Invalid patterns are reported by the constructor, and running out of
+    // memory while matching is handled by falling back to the patterns.
+    options.set_log_errors(false);
+    return options;
+  }
+
+  RE2::Set set_;
+  bool set_compiled_ = false;
+  std::vector<std::shared_ptr<const RE2>> regexes_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StaticRegexFullMatchSetOp);
+};
+
+REGISTER_KERNEL_BUILDER(Name("_StaticRegexFullMatchSet").Device(DEVICE_CPU),
+                        StaticRegexFullMatchSetOp);
+
 }  // namespace tensorflow
@@ -0,0 +1,147 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+class RegexFullMatchSetOpTest : public OpsTestBase {
+ protected:
+  Status MakeOp(const std::vector<string>& patterns) {
+    const int num_patterns = patterns.size();
+    TF_RETURN_IF_ERROR(NodeDefBuilder("regex", "_StaticRegexFullMatchSet")
+                           .Input(FakeInput(DT_STRING))
+                           .Attr("patterns", patterns)
+                           .Attr("num_patterns", num_patterns)
+                           .Finalize(node_def()));
+    return InitOp();
+  }
+};
+
+TEST_F(RegexFullMatchSetOpTest, MatchesEveryPattern) {
+  TF_ASSERT_OK(MakeOp({"a.*", "[0-9]+", "abc|x", "(?i)hello"}));
+  AddInputFromArray<tstring>(TensorShape({2, 3}),
+                             {"", "abc", "123", "a1", "HeLLo", "x"});
+  TF_ASSERT_OK(RunOpKernel());
+
+  const std::vector<std::vector<bool>> expected = {
+      {false, true, false, true, false, false},
+      {false, false, true, false, false, false},
+      {false, true, false, false, false, true},
+      {false, false, false, false, true, false}};
+  for (int k = 0; k < 4; ++k) {
+    Tensor expected_output(allocator(), DT_BOOL, TensorShape({2, 3}));
+    test::FillValues<bool>(&expected_output, expected[k]);
+    test::ExpectTensorEqual<bool>(expected_output, *GetOutput(k));
+  }
+}
+
+TEST_F(RegexFullMatchSetOpTest, MatchesLikeStaticRegexFullMatch) {
+  // The set is anchored at both ends, so a pattern that only matches a prefix
+  // or a suffix of the input does not match.
+  TF_ASSERT_OK(MakeOp({"ab", "b", "ab|abc"}));
+  AddInputFromArray<tstring>(TensorShape({3}), {"abc", "ab", "b"});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_BOOL, TensorShape({3}));
+  test::FillValues<bool>(&expected, {false, true, false});
+  test::ExpectTensorEqual<bool>(expected, *GetOutput(0));
+  test::FillValues<bool>(&expected, {false, false, true});
+  test::ExpectTensorEqual<bool>(expected, *GetOutput(1));
+  test::FillValues<bool>(&expected, {true, true, false});
+  test::ExpectTensorEqual<bool>(expected, *GetOutput(2));
+}
+
+TEST_F(RegexFullMatchSetOpTest, InvalidPattern) {
+  Status s = MakeOp({"a.*", "(a"});
+  EXPECT_TRUE(absl::StrContains(s.ToString(), "Invalid pattern: (a")) << s;
+}
+
+const char* kLines[] = {
+    "TensorFlow is an open source software library for numerical computation.",
+    "user-12345@example.com",
+    "https://www.tensorflow.org/guide/",
+    "2021-06-01T12:34:56Z",
+    "The graph nodes represent mathematical operations."};
+
+const char* kPatterns[] = {"[a-z0-9.-]+@[a-z0-9.-]+",
+                           "https?://[^ ]+",
+                           "[0-9]{4}-[0-9]{2}-[0-9]{2}T.*",
+                           ".*[Gg]raph.*",
+                           "[A-Z][a-z]+ .*",
+                           "[0-9]+",
+                           ".*\\.org.*",
+                           ".*tensor.*"};
+
+// Builds a graph that matches `batch_size` lines against the first
+// `num_patterns` patterns, with one StaticRegexFullMatch per pattern or with a
+// single _StaticRegexFullMatchSet.
+Graph* SetupRegexFullMatchGraph(int batch_size, int num_patterns,
+                                bool use_set) {
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor input(DT_STRING, TensorShape({batch_size}));
+  auto input_flat = input.flat<tstring>();
+  for (int i = 0; i < batch_size; ++i) {
+    input_flat(i) = kLines[i % TF_ARRAYSIZE(kLines)];
+  }
+  Node* input_node = test::graph::Constant(g, input);
+  std::vector<string> patterns(kPatterns, kPatterns + num_patterns);
+  if (use_set) {
+    TF_CHECK_OK(NodeBuilder(g->NewName("regex"), "_StaticRegexFullMatchSet")
+                    .Input(input_node)
+                    .Attr("patterns", patterns)
+                    .Attr("num_patterns", num_patterns)
+                    .Finalize(g, nullptr /* node */));
+    return g;
+  }
+  for (const string& pattern : patterns) {
+    TF_CHECK_OK(NodeBuilder(g->NewName("regex"), "StaticRegexFullMatch")
+                    .Input(input_node)
+                    .Attr("pattern", pattern)
+                    .Finalize(g, nullptr /* node */));
+  }
+  return g;
+}
+
+#define BM_RegexFullMatch(USE_SET, B, P)                                   \
+  static void BM_RegexFullMatch_##USE_SET##_##B##_##P(                     \
+      ::testing::benchmark::State& state) {                                \
+    test::Benchmark("cpu", SetupRegexFullMatchGraph(B, P, USE_SET),        \
+                    /*old_benchmark_api=*/false)                           \
+        .Run(state);                                                       \
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * B); \
+  }                                                                        \
+  BENCHMARK(BM_RegexFullMatch_##USE_SET##_##B##_##P)->UseRealTime();
+
+BM_RegexFullMatch(false, 256, 1);
+BM_RegexFullMatch(false, 4096, 1);
+BM_RegexFullMatch(false, 4096, 8);
+BM_RegexFullMatch(true, 4096, 8);
+
+}  // namespace
+}  // namespace tensorflow
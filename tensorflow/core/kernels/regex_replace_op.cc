@@ -18,11 +18,10 @@ limitations under the License.
 #include "re2/re2.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/regex_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
-#include "tensorflow/core/platform/mutex.h"
-#include "tensorflow/core/platform/thread_annotations.h"
-#include "tensorflow/core/util/ptr_util.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
 namespace {
@@ -46,20 +45,34 @@ Status InternalCompute(const RE2& regex, const string& rewrite,
   } else {
     TF_RETURN_IF_ERROR(
         ctx->allocate_output("output", input_tensor->shape(), &output_tensor));
-    output_tensor->flat<tstring>() = input_tensor->flat<tstring>();
   }
-  auto output_flat = output_tensor->flat<tstring>();
-  for (size_t i = 0; i < output_flat.size(); ++i) {
-    // TODO(dero): Mitigate copy; Global and GlobalReplace below currently only
-    // accept std::string.
-    string buf = output_flat(i);
-    if (replace_global) {
-      RE2::GlobalReplace(&buf, regex, rewrite);
-    } else {
-      RE2::Replace(&buf, regex, rewrite);
+  const bool forwarded = maybe_forwarded != nullptr;
+  const tstring* input_data =
+      (forwarded ? output_tensor : input_tensor)->flat<tstring>().data();
+  tstring* output_data = output_tensor->flat<tstring>().data();
+  auto replace = [&](int64_t begin, int64_t end) {
+    // Replace and GlobalReplace below only accept std::string, so every
+    // element is copied into `buf`. The buffer is reused across elements, so
+    // that it only allocates when an element is larger than all the previous
+    // ones, and only the elements that the pattern changes are written back.
+    string buf;
+    for (int64_t i = begin; i < end; ++i) {
+      const tstring& in = input_data[i];
+      buf.assign(in.data(), in.size());
+      const bool replaced = replace_global
+                                ? RE2::GlobalReplace(&buf, regex, rewrite) > 0
+                                : RE2::Replace(&buf, regex, rewrite);
+      if (replaced) {
+        output_data[i].assign(buf.data(), buf.size());
+      } else if (!forwarded) {
+        output_data[i] = in;
+      }
     }
-    output_flat(i) = std::move(buf);
-  }
+  };
+  const int64_t n = output_tensor->NumElements();
+  auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+  Shard(worker_threads->num_threads, worker_threads->workers, n,
+        EstimateRegexMatchCost(input_data, n), replace);
   return Status::OK();
 }
 }  // namespace
@@ -79,7 +92,7 @@ class RegexReplaceOp : public OpKernel {
                 errors::InvalidArgument("Pattern must be scalar, but received ",
                                         pattern_tensor->shape().DebugString()));
     const string& pattern = pattern_tensor->scalar<tstring>()();
-    std::shared_ptr<RE2> regex = CachedRE2(pattern);
+    std::shared_ptr<const RE2> regex = GetCompiledRegex(pattern);
     OP_REQUIRES(ctx, regex->ok(),
                 errors::InvalidArgument("Invalid pattern: ", pattern,
                                         ", error: ", regex->error()));
@@ -94,27 +107,7 @@ class RegexReplaceOp : public OpKernel {
   }
 
  private:
-  std::shared_ptr<RE2> CachedRE2(const string& pattern) {
-    {
-      tf_shared_lock l(mu_);
-      if (regex_ != nullptr && regex_->pattern() == pattern) {
-        return regex_;
-      }
-    }
-    // Construct the new RE2 object before acquiring the lock.
-    auto regex = std::make_shared<RE2>(pattern);
-    {
-      mutex_lock l(mu_);
-      // Swap instead of assigning so that we destruct the old
-      // RE2 object (when necessary) after releasing the lock.
-      regex_.swap(regex);
-      return regex_;
-    }
-  }
-
   bool replace_global_;
-  mutex mu_;
-  std::shared_ptr<RE2> regex_ TF_GUARDED_BY(mu_);
 
   TF_DISALLOW_COPY_AND_ASSIGN(RegexReplaceOp);
 };
@@ -127,7 +120,7 @@ class StaticRegexReplaceOp : public OpKernel {
   explicit StaticRegexReplaceOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
     string pattern;
     OP_REQUIRES_OK(ctx, ctx->GetAttr("pattern", &pattern));
-    re_ = MakeUnique<RE2>(pattern);
+    re_ = GetCompiledRegex(pattern);
     OP_REQUIRES(ctx, re_->ok(),
                 errors::InvalidArgument("Invalid pattern: ", pattern,
                                         ", error: ", re_->error()));
@@ -141,7 +134,7 @@ class StaticRegexReplaceOp : public OpKernel {
   }
 
  private:
-  std::unique_ptr<RE2> re_;
+  std::shared_ptr<const RE2> re_;
   string rewrite_str_;
   bool replace_global_;
 };
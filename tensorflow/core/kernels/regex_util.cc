@@ -0,0 +1,120 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/regex_util.h"
+
+#include <algorithm>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace {
+
+// Least recently used patterns are evicted once the cache holds this many.
+constexpr size_t kMaxCachedRegexes = 1024;
+
+// Estimated cost, in cycles, of a match call and of every byte it scans.
+constexpr int64_t kRegexCallCost = 200;
+constexpr int64_t kRegexByteCost = 10;
+
+class CompiledRegexCache {
+ public:
+  std::shared_ptr<const RE2> Get(const string& pattern,
+                                 const RE2::Options& options) {
+    // ParseFlags() covers the options that change how the pattern is parsed;
+    // max_mem() and longest_match() change how it is compiled.
+    const string key =
+        strings::StrCat(options.ParseFlags(), ":", options.max_mem(), ":",
+                        options.longest_match(), ":", pattern);
+    {
+      mutex_lock l(mu_);
+      auto it = entries_.find(key);
+      if (it != entries_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+        return it->second.regex;
+      }
+    }
+    // Compile outside of the lock, so that a slow compilation does not block
+    // the lookups of other kernels. Racing compilations of the same pattern
+    // are harmless; the first one to finish is kept.
+    std::shared_ptr<const RE2> regex = std::make_shared<RE2>(pattern, options);
+    // Evicted entries are released after the lock.
+    std::shared_ptr<const RE2> evicted;
+    mutex_lock l(mu_);
+    auto inserted = entries_.emplace(key, Entry());
+    Entry& entry = inserted.first->second;
+    if (!inserted.second) {
+      lru_.splice(lru_.begin(), lru_, entry.lru_position);
+      return entry.regex;
+    }
+    lru_.push_front(key);
+    entry.regex = std::move(regex);
+    entry.lru_position = lru_.begin();
+    if (entries_.size() > kMaxCachedRegexes) {
+      auto oldest = entries_.find(lru_.back());
+      evicted = std::move(oldest->second.regex);
+      entries_.erase(oldest);
+      lru_.pop_back();
+    }
+    return entry.regex;
+  }
+
+ private:
+  struct Entry {
+    std::shared_ptr<const RE2> regex;
+    std::list<string>::iterator lru_position;
+  };
+
+  mutex mu_;
+  // Keys, most recently used first.
+  std::list<string> lru_ TF_GUARDED_BY(mu_);
+  std::unordered_map<string, Entry> entries_ TF_GUARDED_BY(mu_);
+};
+
+CompiledRegexCache* GlobalCompiledRegexCache() {
+  static CompiledRegexCache* cache = new CompiledRegexCache;
+  return cache;
+}
+
+}  // namespace
+
+std::shared_ptr<const RE2> GetCompiledRegex(const string& pattern,
+                                            const RE2::Options& options) {
+  return GlobalCompiledRegexCache()->Get(pattern, options);
+}
+
+std::shared_ptr<const RE2> GetCompiledRegex(const string& pattern) {
+  return GetCompiledRegex(pattern, RE2::Options());
+}
+
+int64_t EstimateRegexMatchCost(const tstring* strings, int64_t n) {
+  constexpr int64_t kNumSamples = 16;
+  if (n == 0) return kRegexCallCost;
+  const int64_t step = std::max<int64_t>(1, n / kNumSamples);
+  int64_t total_length = 0;
+  int64_t num_sampled = 0;
+  for (int64_t i = 0; i < n; i += step) {
+    total_length += strings[i].size();
+    ++num_sampled;
+  }
+  return kRegexCallCost + kRegexByteCost * (total_length / num_sampled);
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,44 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_REGEX_UTIL_H_
+#define TENSORFLOW_CORE_KERNELS_REGEX_UTIL_H_
+
+#include <memory>
+
+#include "re2/re2.h"
+#include "tensorflow/core/platform/tstring.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Returns the RE2 compiled from `pattern` with `options`. Compiled patterns
+// are shared by all the kernels of the process, so that kernels that are
+// instantiated many times, or that receive the pattern as an input, only
+// compile it once. The result may be a pattern that failed to compile; callers
+// must check RE2::ok(). Thread-safe.
+std::shared_ptr<const RE2> GetCompiledRegex(const string& pattern,
+                                            const RE2::Options& options);
+
+// As above, with the default RE2 options.
+std::shared_ptr<const RE2> GetCompiledRegex(const string& pattern);
+
+// Returns the estimated cost, in cycles, of matching one of `strings[0, n)`
+// against a regex, based on the lengths of a few evenly spaced elements.
+int64_t EstimateRegexMatchCost(const tstring* strings, int64_t n);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_REGEX_UTIL_H_
@@ -53,6 +53,7 @@ limitations under the License.
 #include "tensorflow/core/platform/stream_executor.h"
 #endif
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -439,6 +440,7 @@ class AssignVariableOp : public OpKernel {
       *variable->tensor() = value;
     }
     variable->is_initialized = true;
+    variable->MarkAllRowsDirty();
   }
 
  private:
@@ -575,6 +577,7 @@ class AssignUpdateVariableOp : public OpKernel {
     functor::DenseUpdate<Device, T, Op> update_functor;
     update_functor(context->eigen_device<Device>(), var_tensor->flat<T>(),
                    value.flat<T>());
+    variable->MarkAllRowsDirty();
   }
 };
 
@@ -640,6 +643,80 @@ REGISTER_KERNEL_BUILDER(Name("VarIsInitializedOp")
                             .HostMemory("is_initialized"),
                         VarIsInitializedOp);
 
+class TakeVariableDirtyRowsOp : public OpKernel {
+ public:
+  explicit TakeVariableDirtyRowsOp(OpKernelConstruction* c) : OpKernel(c) {}
+
+  void Compute(OpKernelContext* context) override {
+    core::RefCountPtr<Var> variable;
+    OP_REQUIRES_OK(context, LookupResource(context, HandleFromInput(context, 0),
+                                           &variable));
+    std::vector<int64_t> rows;
+    bool all_rows;
+    variable->TakeDirtyRows(&rows, &all_rows);
+    Tensor* rows_t = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(
+                       0, TensorShape({static_cast<int64_t>(rows.size())}),
+                       &rows_t));
+    std::copy(rows.begin(), rows.end(), rows_t->vec<int64_t>().data());
+    Tensor* all_rows_t = nullptr;
+    OP_REQUIRES_OK(context,
+                   context->allocate_output(1, TensorShape({}), &all_rows_t));
+    all_rows_t->scalar<bool>()() = all_rows;
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("_TakeVariableDirtyRows").Device(DEVICE_CPU),
+                        TakeVariableDirtyRowsOp);
+
+REGISTER_KERNEL_BUILDER(Name("_TakeVariableDirtyRows")
+                            .Device(DEVICE_DEFAULT)
+                            .HostMemory("resource")
+                            .HostMemory("rows")
+                            .HostMemory("all_rows"),
+                        TakeVariableDirtyRowsOp);
+
+class SetVariableSparseUpdateModeOp : public OpKernel {
+ public:
+  explicit SetVariableSparseUpdateModeOp(OpKernelConstruction* c)
+      : OpKernel(c) {
+    OP_REQUIRES_OK(c, c->GetAttr("mode", &mode_name_));
+    // Only the sparse training ops on CPU lock rows, or skip use_locking.
+    OP_REQUIRES(c,
+                mode_name_ == "default" ||
+                    c->device_type() == DeviceType(DEVICE_CPU),
+                errors::InvalidArgument("Sparse update mode ", mode_name_,
+                                        " is only supported on CPU"));
+    if (mode_name_ == "row_locks") {
+      mode_ = Var::SparseUpdateMode::kRowLocks;
+    } else if (mode_name_ == "lock_free") {
+      mode_ = Var::SparseUpdateMode::kLockFree;
+    } else {
+      mode_ = Var::SparseUpdateMode::kDefault;
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    core::RefCountPtr<Var> variable;
+    OP_REQUIRES_OK(context, LookupResource(context, HandleFromInput(context, 0),
+                                           &variable));
+    variable->SetSparseUpdateMode(mode_);
+  }
+
+ private:
+  string mode_name_;
+  Var::SparseUpdateMode mode_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("_SetVariableSparseUpdateMode").Device(DEVICE_CPU),
+                        SetVariableSparseUpdateModeOp);
+
+REGISTER_KERNEL_BUILDER(Name("_SetVariableSparseUpdateMode")
+                            .Device(DEVICE_DEFAULT)
+                            .HostMemory("resource"),
+                        SetVariableSparseUpdateModeOp);
+
 template <typename Device, typename T, typename Index>
 class ResourceGatherOp : public OpKernel {
  public:
@@ -1095,6 +1172,12 @@ class ResourceScatterUpdateOp : public OpKernel {
         OP_REQUIRES_OK(
             c, DoScatter<Device, T, Index, op>(c, params, indices, updates, N));
       }
+      if (isCPUDevice<Device>()) {
+        v->MarkRowsDirty(indices_flat.data(), N);
+      } else {
+        // The indices are in device memory.
+        v->MarkAllRowsDirty();
+      }
     }
   }
 };
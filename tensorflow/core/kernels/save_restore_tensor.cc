@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/save_restore_tensor.h"
 
+#include <algorithm>
 #include <memory>
 #include <numeric>
 #include <unordered_map>
@@ -33,6 +34,8 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
+#include "tensorflow/core/util/tensor_bundle/delta_bundle.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
@@ -359,6 +362,70 @@ struct RestoreOp {
   ::tensorflow::Status status;
 };
 
+// Restores the full (unsliced) tensors of "restore_ops" with a single
+// BundleReader::LookupTensors() call, which reads them concurrently.
+Status RestoreFullTensors(OpKernelContext* context,
+                          const std::vector<RestoreOp*>& restore_ops,
+                          bool alias_mapped_data, int num_threads,
+                          BundleReader* reader) {
+  std::vector<string> keys;
+  std::vector<Tensor> aliased(restore_ops.size());
+  std::vector<Tensor*> vals;
+  keys.reserve(restore_ops.size());
+  vals.reserve(restore_ops.size());
+  for (size_t i = 0; i < restore_ops.size(); ++i) {
+    const RestoreOp& op = *restore_ops[i];
+    keys.push_back(op.tensor_name);
+    if (alias_mapped_data) {
+      // Empty tensors let the reader hand out tensors aliasing the mapped
+      // data files, which become the outputs as is.
+      vals.push_back(&aliased[i]);
+      continue;
+    }
+    TensorShape restored_full_shape;
+    TF_RETURN_IF_ERROR(
+        reader->LookupTensorShape(op.tensor_name, &restored_full_shape));
+    Tensor* restored_tensor;
+    TF_RETURN_IF_ERROR(context->allocate_output(op.idx, restored_full_shape,
+                                                &restored_tensor));
+    vals.push_back(restored_tensor);
+  }
+  TF_RETURN_IF_ERROR(reader->LookupTensors(keys, vals, num_threads));
+  if (alias_mapped_data) {
+    for (size_t i = 0; i < restore_ops.size(); ++i) {
+      context->set_output(restore_ops[i]->idx, aliased[i]);
+    }
+  }
+  return Status::OK();
+}
+
+// Restores the tensors of "restore_ops" from the delta bundle at "prefix",
+// merging its chain of deltas.
+Status RestoreTensorsFromDeltas(OpKernelContext* context, const string& prefix,
+                                const std::vector<RestoreOp>& restore_ops) {
+  DeltaBundleReader reader(Env::Default(), prefix);
+  TF_RETURN_IF_ERROR(reader.status());
+  VLOG(1) << "Restoring from a chain of " << reader.chain_length()
+          << " delta checkpoints ending at " << prefix;
+  for (const RestoreOp& op : restore_ops) {
+    if (!op.shape_and_slice.empty()) {
+      return errors::Unimplemented(
+          "tensor_name = ", op.tensor_name,
+          "; restoring slices from delta checkpoints is not supported");
+    }
+    Tensor restored_tensor;
+    TF_RETURN_IF_ERROR(reader.Lookup(op.tensor_name, &restored_tensor));
+    if (op.dtype != restored_tensor.dtype()) {
+      return errors::InvalidArgument(
+          "tensor_name = ", op.tensor_name, "; expected dtype ",
+          DataTypeString(op.dtype), " does not equal restored dtype ",
+          DataTypeString(restored_tensor.dtype()));
+    }
+    context->set_output(op.idx, restored_tensor);
+  }
+  return Status::OK();
+}
+
 }  // namespace
 
 Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
@@ -377,8 +444,26 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
                            shape_and_slices_flat(i), prefix_string, dtypes[i]});
   }
 
-  BundleReader default_reader(Env::Default(), prefix_string);
+  // Reading through mmap, and returning tensors that alias the mapped files,
+  // are opt-in: the latter requires the checkpoint files to stay unmodified
+  // while the restored tensors are in use.
+  BundleReader::Options reader_options;
+  TF_RETURN_IF_ERROR(ReadBoolFromEnvVar("TF_CHECKPOINT_RESTORE_USE_MMAP",
+                                        false, &reader_options.use_mmap));
+  TF_RETURN_IF_ERROR(ReadBoolFromEnvVar("TF_CHECKPOINT_RESTORE_ALIAS_MMAP",
+                                        false,
+                                        &reader_options.alias_mapped_data));
+  reader_options.alias_mapped_data &= reader_options.use_mmap;
+  int64_t num_restore_threads;
+  TF_RETURN_IF_ERROR(ReadInt64FromEnvVar("TF_CHECKPOINT_RESTORE_THREADS", 8,
+                                         &num_restore_threads));
+  num_restore_threads = std::max<int64_t>(1, num_restore_threads);
+
+  BundleReader default_reader(Env::Default(), prefix_string, reader_options);
   TF_RETURN_IF_ERROR(default_reader.status());
+  if (default_reader.Contains(kDeltaBaseKey)) {
+    return RestoreTensorsFromDeltas(context, prefix_string, restore_ops);
+  }
 
   TF_RETURN_IF_ERROR(default_reader.SortForSequentialAccess<RestoreOp>(
       restore_ops, [](const RestoreOp& op) { return op.tensor_name; }));
@@ -402,10 +487,15 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     return errors::InvalidArgument(error_msg);
   }
 
+  // Full tensors are read together, concurrently. Slices are assembled from
+  // the stored slices one tensor at a time, the expensive ones in a pool.
+  std::vector<RestoreOp*> full_restore_ops;
   std::vector<RestoreOp*> pool_restore_ops;
   std::vector<RestoreOp*> direct_restore_ops;
   for (RestoreOp& restore_op : restore_ops) {
-    if (restore_op.should_run_in_pool(&default_reader)) {
+    if (restore_op.shape_and_slice.empty()) {
+      full_restore_ops.push_back(&restore_op);
+    } else if (restore_op.should_run_in_pool(&default_reader)) {
       pool_restore_ops.push_back(&restore_op);
     } else {
       direct_restore_ops.push_back(&restore_op);
@@ -424,6 +514,12 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
       }
     }
 
+    if (!full_restore_ops.empty()) {
+      TF_RETURN_IF_ERROR(RestoreFullTensors(
+          context, full_restore_ops, reader_options.alias_mapped_data,
+          static_cast<int>(num_restore_threads), &default_reader));
+    }
+
     // Read small tensors from the op thread
     for (auto* op : direct_restore_ops) {
       TF_RETURN_IF_ERROR(op->run(&default_reader));
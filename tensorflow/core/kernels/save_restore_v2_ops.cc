@@ -15,6 +15,7 @@ limitations under the License.
 
 // See docs in ../ops/io_ops.cc.
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -31,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
@@ -90,17 +92,25 @@ void ValidateInputs(bool is_save_op, OpKernelContext* context,
 }  // namespace
 
 // Saves a list of named tensors using the tensor bundle library.
-class SaveV2 : public OpKernel {
+//
+// With TF_CHECKPOINT_SAVE_THREADS > 0, the tensors are checksummed and written
+// on background threads, and the op completes once the files are finished
+// without holding an inter-op thread meanwhile. The tensors are snapshotted
+// when queued, since variables may be updated while they are written.
+class SaveV2 : public AsyncOpKernel {
  public:
-  explicit SaveV2(OpKernelConstruction* context) : OpKernel(context) {}
+  explicit SaveV2(OpKernelConstruction* context) : AsyncOpKernel(context) {}
 
-  void Compute(OpKernelContext* context) override {
+  void ComputeAsync(OpKernelContext* context, DoneCallback done) override {
     const Tensor& prefix = context->input(0);
     const Tensor& tensor_names = context->input(1);
     const Tensor& shape_and_slices = context->input(2);
     ValidateInputs(true /* is save op */, context, prefix, tensor_names,
                    shape_and_slices);
-    if (!context->status().ok()) return;
+    if (!context->status().ok()) {
+      done();
+      return;
+    }
 
     const int kFixedInputs = 3;  // Prefix, tensor names, shape_and_slices.
     const int num_tensors = static_cast<int>(tensor_names.NumElements());
@@ -108,8 +118,17 @@ class SaveV2 : public OpKernel {
     const auto& tensor_names_flat = tensor_names.flat<tstring>();
     const auto& shape_and_slices_flat = shape_and_slices.flat<tstring>();
 
-    BundleWriter writer(Env::Default(), prefix_string);
-    OP_REQUIRES_OK(context, writer.status());
+    int64_t num_save_threads;
+    OP_REQUIRES_OK_ASYNC(context,
+                         ReadInt64FromEnvVar("TF_CHECKPOINT_SAVE_THREADS", 0,
+                                             &num_save_threads),
+                         done);
+    BundleWriter::Options writer_options;
+    writer_options.num_threads = static_cast<int>(num_save_threads);
+
+    auto writer = std::make_shared<BundleWriter>(Env::Default(), prefix_string,
+                                                 writer_options);
+    OP_REQUIRES_OK_ASYNC(context, writer->status(), done);
     VLOG(1) << "BundleWriter, prefix_string: " << prefix_string;
 
     for (int i = 0; i < num_tensors; ++i) {
@@ -123,19 +142,23 @@ class SaveV2 : public OpKernel {
         TensorSlice slice(tensor.dims());
         TensorShape slice_shape;
 
-        OP_REQUIRES_OK(context, checkpoint::ParseShapeAndSlice(
-                                    shape_spec, &shape, &slice, &slice_shape));
-        OP_REQUIRES(context, slice_shape.IsSameSize(tensor.shape()),
-                    errors::InvalidArgument("Slice in shape_and_slice "
-                                            "specification does not match the "
-                                            "shape of the tensor to  save: ",
-                                            shape_spec, ", tensor: ",
-                                            tensor.shape().DebugString()));
-
-        OP_REQUIRES_OK(context,
-                       writer.AddSlice(tensor_name, shape, slice, tensor));
+        OP_REQUIRES_OK_ASYNC(context,
+                             checkpoint::ParseShapeAndSlice(
+                                 shape_spec, &shape, &slice, &slice_shape),
+                             done);
+        OP_REQUIRES_ASYNC(context, slice_shape.IsSameSize(tensor.shape()),
+                          errors::InvalidArgument(
+                              "Slice in shape_and_slice "
+                              "specification does not match the "
+                              "shape of the tensor to  save: ",
+                              shape_spec, ", tensor: ",
+                              tensor.shape().DebugString()),
+                          done);
+
+        OP_REQUIRES_OK_ASYNC(
+            context, writer->AddSlice(tensor_name, shape, slice, tensor), done);
       } else {
-        OP_REQUIRES_OK(context, writer.Add(tensor_name, tensor));
+        OP_REQUIRES_OK_ASYNC(context, writer->Add(tensor_name, tensor), done);
       }
 
       if (VLOG_IS_ON(5)) {
@@ -157,28 +180,41 @@ class SaveV2 : public OpKernel {
 
       VLOG(2) << "Done save of " << tensor_name;
     }
-    OP_REQUIRES_OK(context, writer.Finish());
-    VLOG(1) << "Done BundleWriter, prefix_string: " << prefix_string;
 
-    ResourceMgr* resource_manager = context->resource_manager();
-    if (resource_manager != nullptr) {
-      checkpoint::CheckpointCallbackManager* checkpoint_callback_manager;
-      OP_REQUIRES_OK(
-          context,
-          resource_manager
-              ->LookupOrCreate<checkpoint::CheckpointCallbackManager>(
-                  resource_manager->default_container(),
-                  std::string(
-                      checkpoint::kCheckpointCallbackManagerResourceName),
-                  &checkpoint_callback_manager,
-                  [](checkpoint::CheckpointCallbackManager** out) {
-                    *out = new checkpoint::CheckpointCallbackManager();
-                    return Status::OK();
-                  }));
-      checkpoint_callback_manager->Save(prefix_string);
-      checkpoint_callback_manager->Unref();
+    auto finish = [context, writer, prefix_string, done]() {
+      OP_REQUIRES_OK_ASYNC(context, writer->Finish(), done);
+      VLOG(1) << "Done BundleWriter, prefix_string: " << prefix_string;
+      OP_REQUIRES_OK_ASYNC(
+          context, NotifyCheckpointSaved(context, prefix_string), done);
+      done();
+    };
+    if (num_save_threads > 0) {
+      Env::Default()->SchedClosure(std::move(finish));
+    } else {
+      finish();
     }
   }
+
+ private:
+  // Runs the checkpoint callbacks registered for `prefix`.
+  static Status NotifyCheckpointSaved(OpKernelContext* context,
+                                      const string& prefix) {
+    ResourceMgr* resource_manager = context->resource_manager();
+    if (resource_manager == nullptr) return Status::OK();
+    checkpoint::CheckpointCallbackManager* checkpoint_callback_manager;
+    TF_RETURN_IF_ERROR(
+        resource_manager->LookupOrCreate<checkpoint::CheckpointCallbackManager>(
+            resource_manager->default_container(),
+            std::string(checkpoint::kCheckpointCallbackManagerResourceName),
+            &checkpoint_callback_manager,
+            [](checkpoint::CheckpointCallbackManager** out) {
+              *out = new checkpoint::CheckpointCallbackManager();
+              return Status::OK();
+            }));
+    checkpoint_callback_manager->Save(prefix);
+    checkpoint_callback_manager->Unref();
+    return Status::OK();
+  }
 };
 REGISTER_KERNEL_BUILDER(Name("SaveV2").Device(DEVICE_CPU), SaveV2);
 
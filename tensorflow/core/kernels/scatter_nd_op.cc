@@ -21,6 +21,9 @@ limitations under the License.
 #include "tensorflow/core/platform/stream_executor.h"
 #endif  // GOOGLE_CUDA || TENSORFLOW_USE_ROCM
 
+#include <type_traits>
+#include <vector>
+
 #include "tensorflow/core/framework/bounds_check.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -277,9 +280,9 @@ class ScatterNdUpdateOp : public OpKernel {
     const Tensor& updates = c->input(2);
     Tensor params;
     TensorShape params_shape;
+    core::RefCountPtr<Var> v;
 
     if (dtype_ == DT_RESOURCE) {
-      core::RefCountPtr<Var> v;
       OP_REQUIRES_OK(c, LookupResource(c, HandleFromInput(c, 0), &v));
       Tensor* t = v->tensor();
       params = *t;
@@ -310,6 +313,26 @@ class ScatterNdUpdateOp : public OpKernel {
     OP_REQUIRES_OK(
         c, functor::DoScatterNd<Device, T, Index, op>(
                c, indices, updates, params_shape, &params, false /*allocate*/));
+    if (v) MarkRowsDirty(indices, params_shape, v.get());
+  }
+
+  // Records the rows of "var", i.e. its indices in the first dimension, that
+  // were updated, for delta checkpoints.
+  static void MarkRowsDirty(const Tensor& indices,
+                            const TensorShape& params_shape, Var* var) {
+    if (!var->tracks_dirty_rows()) return;
+    const int64_t index_depth =
+        indices.dims() > 0 ? indices.dim_size(indices.dims() - 1) : 0;
+    if (!std::is_same<Device, CPUDevice>::value || index_depth == 0 ||
+        params_shape.dims() == 0) {
+      // The indices are in device memory, or every update spans all rows.
+      var->MarkAllRowsDirty();
+      return;
+    }
+    const auto indices_mat = indices.flat_inner_dims<Index>();
+    std::vector<Index> rows(indices_mat.dimension(0));
+    for (int64_t i = 0; i < rows.size(); ++i) rows[i] = indices_mat(i, 0);
+    var->MarkRowsDirty(rows.data(), rows.size());
   }
 };
 
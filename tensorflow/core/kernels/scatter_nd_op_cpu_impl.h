@@ -20,7 +20,9 @@ limitations under the License.
 
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
 #include <atomic>
+#include <vector>
 
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 
@@ -32,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/fill_functor.h"
 #include "tensorflow/core/kernels/scatter_nd_op.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/prefetch.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/util/util.h"
 
@@ -100,6 +103,121 @@ class UpdateExecutor<T, Input, Update, Output, scatter_nd_op::UpdateOp::MAX> {
 
 }  // namespace update_executor
 
+namespace scatter_nd_cpu {
+
+// The number of updated elements below which updates are applied by the
+// calling thread.
+constexpr int64_t kParallelUpdateThreshold = 32 * 1024;
+
+// Slices of at least this many bytes are split into column ranges across
+// threads, rather than distributing the updates.
+constexpr int64_t kColumnPartitionSliceBytes = 16 * 1024;
+
+// The number of row partitions per thread, to even out skewed indices.
+constexpr int kRowPartitionsPerThread = 4;
+
+// How many updates ahead the output slices are prefetched.
+constexpr int kPrefetchDistance = 8;
+
+// Applies "update" to the "slice_size" elements of "output" with the
+// vectorized Eigen expressions of OP.
+template <typename T, typename Index, scatter_nd_op::UpdateOp OP>
+EIGEN_STRONG_INLINE void UpdateSlice(const T* update, Index slice_size,
+                                     T* output) {
+  typename TTypes<T>::UnalignedConstFlat update_slice(update, slice_size);
+  typename TTypes<T>::UnalignedFlat output_slice(output, slice_size);
+  update_executor::UpdateExecutor<
+      Eigen::DefaultDevice, decltype(output_slice), decltype(update_slice),
+      decltype(output_slice),
+      OP>::Execute(Eigen::DefaultDevice(), output_slice, update_slice,
+                   output_slice);
+}
+
+// Applies the updates order[begin, end) of "updates" to the slices "rows" of
+// "output", prefetching the slices of the following updates.
+template <typename T, typename Index, scatter_nd_op::UpdateOp OP>
+void UpdateSlices(Index slice_size, const Index* rows, const Index* order,
+                  int64_t begin, int64_t end, const T* updates, T* output) {
+  for (int64_t k = begin; k < end; ++k) {
+    if (k + kPrefetchDistance < end) {
+      const Index next = order ? order[k + kPrefetchDistance]
+                               : k + kPrefetchDistance;
+      port::prefetch<port::PREFETCH_HINT_T0>(
+          output + static_cast<int64_t>(rows[next]) * slice_size);
+    }
+    const Index loc = order ? order[k] : k;
+    UpdateSlice<T, Index, OP>(
+        updates + static_cast<int64_t>(loc) * slice_size, slice_size,
+        output + static_cast<int64_t>(rows[loc]) * slice_size);
+  }
+}
+
+// Applies updates [0, num_updates) of "updates" to the slices "rows" of
+// "output", which has "num_rows" slices, in parallel.
+//
+// The threads never update the same elements, so that no atomics are needed
+// and the updates of every element are applied in their order, as by a
+// sequential loop: either every thread updates a range of the columns of all
+// the slices, or the updates are partitioned by ranges of rows, with a stable
+// counting sort.
+template <typename T, typename Index, scatter_nd_op::UpdateOp OP>
+void ApplyUpdates(const CPUDevice& d, Index slice_size, Index num_rows,
+                  const Index* rows, Index num_updates, const T* updates,
+                  T* output) {
+  const int64_t num_elements = static_cast<int64_t>(num_updates) * slice_size;
+  if (num_elements < kParallelUpdateThreshold || d.numThreads() <= 1) {
+    UpdateSlices<T, Index, OP>(slice_size, rows, /*order=*/nullptr, 0,
+                               num_updates, updates, output);
+    return;
+  }
+
+  if (static_cast<int64_t>(slice_size * sizeof(T)) >=
+      kColumnPartitionSliceBytes) {
+    const Eigen::TensorOpCost cost(/*bytes_loaded=*/2 * num_updates * sizeof(T),
+                                   /*bytes_stored=*/num_updates * sizeof(T),
+                                   /*compute_cycles=*/num_updates);
+    d.parallelFor(slice_size, cost, [&](int64_t begin, int64_t end) {
+      for (Index loc = 0; loc < num_updates; ++loc) {
+        UpdateSlice<T, Index, OP>(
+            updates + static_cast<int64_t>(loc) * slice_size + begin,
+            static_cast<Index>(end - begin),
+            output + static_cast<int64_t>(rows[loc]) * slice_size + begin);
+      }
+    });
+    return;
+  }
+
+  const Index num_parts = std::min<int64_t>(
+      num_rows, static_cast<int64_t>(d.numThreads()) * kRowPartitionsPerThread);
+  const Index rows_per_part = (num_rows + num_parts - 1) / num_parts;
+  std::vector<Index> part_starts(num_parts + 1, 0);
+  for (Index loc = 0; loc < num_updates; ++loc) {
+    ++part_starts[rows[loc] / rows_per_part + 1];
+  }
+  for (Index part = 0; part < num_parts; ++part) {
+    part_starts[part + 1] += part_starts[part];
+  }
+  std::vector<Index> order(num_updates);
+  std::vector<Index> next(part_starts.begin(), part_starts.end() - 1);
+  for (Index loc = 0; loc < num_updates; ++loc) {
+    order[next[rows[loc] / rows_per_part]++] = loc;
+  }
+
+  const int64_t updates_per_part = num_updates / num_parts + 1;
+  const Eigen::TensorOpCost cost(
+      /*bytes_loaded=*/updates_per_part * (2 * slice_size * sizeof(T) +
+                                           2 * sizeof(Index)),
+      /*bytes_stored=*/updates_per_part * slice_size * sizeof(T),
+      /*compute_cycles=*/updates_per_part * slice_size);
+  d.parallelFor(num_parts, cost, [&](int64_t begin, int64_t end) {
+    UpdateSlices<T, Index, OP>(slice_size, rows, order.data(),
+                               part_starts[begin], part_starts[end], updates,
+                               output);
+  });
+}
+
+}  // namespace scatter_nd_cpu
+
 namespace functor {
 
 // Implementation of update functor for CPU.
@@ -112,10 +230,6 @@ struct ScatterNdFunctor<CPUDevice, T, Index, OP, IXDIM> {
       typename TTypes<Index, 2>::ConstTensor Tindices,
       typename TTypes<T, 2>::ConstTensor Tupdates,
       typename TTypes<T, 2>::Tensor Toutput) {
-    // error_loc is -1 if there's no out-of-bounds index,
-    // otherwise it is the location of an OOB index in Tindices.
-    Index error_loc = -1;
-
     const Eigen::DenseIndex batch_size = Tindices.dimension(0);
 
     Index batch_strides[IXDIM];
@@ -128,29 +242,43 @@ struct ScatterNdFunctor<CPUDevice, T, Index, OP, IXDIM> {
       }
     }
 
-    for (Eigen::DenseIndex loc = 0; loc < batch_size; ++loc) {
-      Index i = 0;
-      bool out_of_bounds = false;
-      for (int dim = 0; dim < IXDIM; ++dim) {
-        const Index ix_d = internal::SubtleMustCopy(Tindices(loc, dim));
-        out_of_bounds |= !FastBoundsCheck(ix_d, output_shape_prefix[dim]);
-        i += ix_d * batch_strides[dim];
+    // Flattens the indices into output rows in parallel, and finds the first
+    // out-of-bounds index.
+    std::vector<Index> rows(batch_size);
+    std::atomic<Eigen::DenseIndex> first_error_loc(batch_size);
+    auto flatten_indices = [&](int64_t begin, int64_t end) {
+      for (Eigen::DenseIndex loc = begin; loc < end; ++loc) {
+        Index i = 0;
+        bool out_of_bounds = false;
+        for (int dim = 0; dim < IXDIM; ++dim) {
+          const Index ix_d = internal::SubtleMustCopy(Tindices(loc, dim));
+          out_of_bounds |= !FastBoundsCheck(ix_d, output_shape_prefix[dim]);
+          i += ix_d * batch_strides[dim];
+        }
+        if (TF_PREDICT_FALSE(out_of_bounds)) {
+          Eigen::DenseIndex error_loc = first_error_loc.load();
+          while (loc < error_loc &&
+                 !first_error_loc.compare_exchange_weak(error_loc, loc)) {
+          }
+          return;
+        }
+        rows[loc] = i;
       }
-      if (TF_PREDICT_FALSE(out_of_bounds)) {
-        error_loc = loc;
-        break;
-      } else {
-        auto input_chip = Toutput.template chip<0>(i);
-        auto output_chip = input_chip;
-        auto update_chip = Tupdates.template chip<0>(loc);
-        update_executor::UpdateExecutor<
-            CPUDevice, decltype(input_chip), decltype(update_chip),
-            decltype(output_chip), OP>::Execute(d, input_chip, update_chip,
-                                                output_chip);
-      }
-    }
-
-    return error_loc;
+    };
+    const Eigen::TensorOpCost flatten_cost(
+        /*bytes_loaded=*/IXDIM * sizeof(Index),
+        /*bytes_stored=*/sizeof(Index), /*compute_cycles=*/2 * IXDIM);
+    d.parallelFor(batch_size, flatten_cost, flatten_indices);
+
+    // Like a sequential loop, applies the updates before the first
+    // out-of-bounds index.
+    const Eigen::DenseIndex num_updates = first_error_loc.load();
+    scatter_nd_cpu::ApplyUpdates<T, Index, OP>(
+        d, slice_size, static_cast<Index>(Toutput.dimension(0)), rows.data(),
+        static_cast<Index>(num_updates), Tupdates.data(), Toutput.data());
+
+    // The location of the first out-of-bounds index in Tindices, or -1.
+    return num_updates < batch_size ? static_cast<Index>(num_updates) : -1;
   }
 };
 
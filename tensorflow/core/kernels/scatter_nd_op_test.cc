@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/resource_var.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
@@ -38,14 +39,55 @@ namespace {
 
 class ScatterNdUpdateOpTest : public OpsTestBase {
  protected:
-  void MakeOp(DataType variable_ref_type, DataType index_type) {
-    TF_ASSERT_OK(NodeDefBuilder("myop", "ScatterNdUpdate")
+  void MakeOp(DataType variable_ref_type, DataType index_type,
+              const char* op = "ScatterNdUpdate") {
+    TF_ASSERT_OK(NodeDefBuilder("myop", op)
                      .Input(FakeInput(variable_ref_type))
                      .Input(FakeInput(index_type))
                      .Input(FakeInput(RemoveRefType(variable_ref_type)))
                      .Finalize(node_def()));
     TF_ASSERT_OK(InitOp());
   }
+
+  // Scatters many slices with duplicate indices, which the CPU kernels apply
+  // in parallel, and compares with applying them in order.
+  void ScatterManySlices(const char* op, int64_t slice_size) {
+    const int64_t kRows = 300;
+    const int64_t kCols = 4;
+    const int64_t kNumUpdates = 20000;
+    const bool add = string(op) == "ScatterNdAdd";
+    random::PhiloxRandom philox(301, 17);
+    random::SimplePhilox rnd(&philox);
+    std::vector<float> values(kRows * kCols * slice_size);
+    for (float& value : values) value = rnd.Uniform(100);
+    std::vector<int32> indices;
+    std::vector<float> updates;
+    std::vector<float> expected = values;
+    for (int64_t i = 0; i < kNumUpdates; ++i) {
+      const int32 row = rnd.Uniform(kRows);
+      const int32 col = rnd.Uniform(kCols);
+      indices.push_back(row);
+      indices.push_back(col);
+      for (int64_t j = 0; j < slice_size; ++j) {
+        // Small integers are added exactly, in any order.
+        const float update = rnd.Uniform(1000);
+        updates.push_back(update);
+        float& value = expected[(row * kCols + col) * slice_size + j];
+        value = add ? value + update : update;
+      }
+    }
+
+    MakeOp(DT_FLOAT_REF, DT_INT32, op);
+    AddInputFromArray<float>(TensorShape({kRows, kCols, slice_size}), values);
+    AddInputFromArray<int32>(TensorShape({kNumUpdates, 2}), indices);
+    AddInputFromArray<float>(TensorShape({kNumUpdates, slice_size}), updates);
+    TF_ASSERT_OK(RunOpKernel());
+
+    Tensor expected_tensor(allocator(), DT_FLOAT,
+                           TensorShape({kRows, kCols, slice_size}));
+    test::FillValues<float>(&expected_tensor, expected);
+    test::ExpectTensorEqual<float>(expected_tensor, *mutable_input(0).tensor);
+  }
 };
 
 // TODO(simister): Re-enable this once binary size is under control.
@@ -189,6 +231,63 @@ TEST_F(ScatterNdUpdateOpTest, Error_IndexOutOfRange) {
       << s;
 }
 
+TEST_F(ScatterNdUpdateOpTest, ResourceUpdateMarksRowsDirty) {
+  TF_ASSERT_OK(NodeDefBuilder("myop", "ResourceScatterNdAdd")
+                   .Input(FakeInput(DT_RESOURCE))
+                   .Input(FakeInput(DT_INT32))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  Var* var = new Var(DT_FLOAT);
+  *var->tensor() = Tensor(DT_FLOAT, TensorShape({5, 3}));
+  var->tensor()->flat<float>().setZero();
+  var->is_initialized = true;
+  // Starts tracking the dirty rows, for the next delta.
+  std::vector<int64_t> rows;
+  bool all_rows;
+  var->TakeDirtyRows(&rows, &all_rows);
+  AddResourceInput("", "var", var);
+  AddInputFromArray<int32>(TensorShape({3, 2}), {4, 0, 1, 2, 4, 1});
+  AddInputFromArray<float>(TensorShape({3}), {1, 2, 3});
+  TF_ASSERT_OK(RunOpKernel());
+
+  var->TakeDirtyRows(&rows, &all_rows);
+  EXPECT_FALSE(all_rows);
+  EXPECT_EQ(rows, std::vector<int64_t>({1, 4}));
+  EXPECT_EQ(var->tensor()->matrix<float>()(4, 1), 3);
+}
+
+TEST_F(ScatterNdUpdateOpTest, ManySlices_Update) {
+  ScatterManySlices("ScatterNdUpdate", 16);
+}
+
+TEST_F(ScatterNdUpdateOpTest, ManySlices_Add) {
+  ScatterManySlices("ScatterNdAdd", 16);
+}
+
+TEST_F(ScatterNdUpdateOpTest, ManyScalars_Add) {
+  ScatterManySlices("ScatterNdAdd", 1);
+}
+
+TEST_F(ScatterNdUpdateOpTest, Error_IndexOutOfRangeAmongManyIndices) {
+  MakeOp(DT_FLOAT_REF, DT_INT32);
+
+  const int kNumUpdates = 50000;
+  std::vector<int32> indices(kNumUpdates);
+  for (int i = 0; i < kNumUpdates; ++i) indices[i] = i % 5;
+  indices[30000] = 99;
+  indices[40000] = -1;
+  AddInputFromArray<float>(TensorShape({5, 3}),
+                           {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0});
+  AddInputFromArray<int32>(TensorShape({kNumUpdates, 1}), indices);
+  AddInputFromArray<float>(TensorShape({kNumUpdates, 3}),
+                           std::vector<float>(kNumUpdates * 3, 1.0f));
+  Status s = RunOpKernel();
+  EXPECT_TRUE(absl::StrContains(
+      s.ToString(), "indices[30000] = [99] does not index into shape [5,3]"))
+      << s;
+}
+
 TEST_F(ScatterNdUpdateOpTest, Error_WrongDimsIndices) {
   MakeOp(DT_FLOAT_REF, DT_INT32);
 
@@ -255,14 +354,14 @@ class ScatterNdUpdateBM : public ScatterNdUpdateOpTest {
 
 template <typename Index>
 void BM_ScatterNdHelper(::testing::benchmark::State& state, int embedding_size,
-                        const char* op) {
+                        const char* op, int num_updates = 1000) {
   const int kRows = 10000000 / embedding_size;
   std::vector<float> values;
   values.reserve(kRows);
   for (int i = 0; i < kRows * embedding_size; i++) {
     values.push_back(i);
   }
-  const int kNumUpdates = 1000;
+  const int kNumUpdates = num_updates;
   random::PhiloxRandom philox(301, 17);
   random::SimplePhilox rnd(&philox);
   std::vector<Index> indices;
@@ -325,5 +424,21 @@ BENCHMARK(BM_ScatterNdUpdateInt64)
 BENCHMARK(BM_ScatterNdAddInt32)->Arg(1)->Arg(10)->Arg(64)->Arg(256)->Arg(1024);
 BENCHMARK(BM_ScatterNdAddInt64)->Arg(1)->Arg(10)->Arg(64)->Arg(256)->Arg(1024);
 
+// Aggregates the messages of the edges of a graph into its nodes, as in
+// graph neural networks: many more updates than in the benchmarks above.
+void BM_ScatterNdAddManyUpdatesInt32(::testing::benchmark::State& state) {
+  const int embedding_size = state.range(0);
+
+  BM_ScatterNdHelper<int32>(state, embedding_size, "ScatterNdAdd",
+                            /*num_updates=*/100000);
+}
+
+BENCHMARK(BM_ScatterNdAddManyUpdatesInt32)
+    ->UseRealTime()
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(64)
+    ->Arg(256);
+
 }  // namespace
 }  // namespace tensorflow
@@ -18,7 +18,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_SEGMENT_REDUCTION_OPS_IMPL_H_
 #define TENSORFLOW_CORE_KERNELS_SEGMENT_REDUCTION_OPS_IMPL_H_
 
+#include <algorithm>
 #include <cstdint>
+#include <vector>
 
 #include "tensorflow/core/framework/op_requires.h"
 #include "tensorflow/core/platform/types.h"
@@ -40,6 +42,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/segment_reduction_ops.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/util/determinism.h"
 #include "tensorflow/core/util/util.h"
 
@@ -76,6 +79,21 @@ Status ValidateSparseSegmentReduction(OpKernelContext* context,
                                       const Tensor& indices,
                                       const Tensor& segment_ids,
                                       bool has_num_segments);
+
+// Reducer used to combine partial results of a segment that was split across
+// several shards, and whether the combined result still has to be divided by
+// the number of rows in the segment.
+template <typename Reducer>
+struct PartialSegmentReducer {
+  typedef Reducer type;
+  static constexpr bool kIsMean = false;
+};
+
+template <typename T>
+struct PartialSegmentReducer<Eigen::internal::MeanReducer<T>> {
+  typedef Eigen::internal::SumReducer<T> type;
+  static constexpr bool kIsMean = true;
+};
 }  // namespace internal
 
 // This operator handles reducing segments along the first dimension.
@@ -125,14 +143,19 @@ class SegmentReductionOp : public OpKernel {
                 errors::InvalidArgument("segment ids must be >= 0"));
     auto output_flat = output->flat_outer_dims<T>();
 
+    const int num_shards = NumShards(context, num_indices, num_col);
+    if (num_shards > 1) {
+      ComputeSharded(context, num_shards, segment_vec, input_flat, output_rows,
+                     output_flat);
+      return;
+    }
+
     Eigen::IndexList<Eigen::type2index<0> > dims_to_reduce;
     Index start = 0, end = 1;
 
     Index uninitialized_index = 0;  // Index from which the output is not set.
     Index out_index = internal::SubtleMustCopy(segment_vec(start));
 
-    // TODO(agarwal): if this loop becomes a bottleneck, consider sharding it
-    // across threads.
     Eigen::DSizes<Eigen::DenseIndex, 1> out_slice_shape(num_col);
     while (end <= num_indices) {
       // We initialize next_index to 0 to avoid "warning: 'next_index' may be
@@ -201,6 +224,175 @@ class SegmentReductionOp : public OpKernel {
       out_index = next_index;
     }
   }
+
+ private:
+  typedef typename internal::PartialSegmentReducer<Reducer> PartialReducer;
+
+  // Inputs with fewer elements are reduced on the calling thread.
+  static constexpr int64_t kMinShardedElements = 1 << 16;
+  // Lower bound on the number of input elements reduced by each shard.
+  static constexpr int64_t kMinElementsPerShard = 1 << 14;
+
+  // Returns the number of shards to split the rows of the input into, or 1 to
+  // reduce them on the calling thread.
+  static int NumShards(OpKernelContext* context, int64_t num_rows,
+                       int64_t num_col) {
+    const int64_t num_elements = num_rows * num_col;
+    if (num_elements < kMinShardedElements) return 1;
+    const int num_threads =
+        context->device()->tensorflow_cpu_worker_threads()->num_threads;
+    return static_cast<int>(std::min<int64_t>(
+        {num_threads, num_rows, num_elements / kMinElementsPerShard}));
+  }
+
+  // Reduces the `num_rows` contiguous rows of length `num_col` starting at
+  // `in` into the single row at `out`.
+  template <typename R>
+  static void ReduceRows(const T* in, int64_t num_rows, int64_t num_col,
+                         T* out) {
+    Eigen::TensorMap<Eigen::Tensor<T, 1, Eigen::RowMajor>, Eigen::Unaligned>
+        out_row(out, num_col);
+    if (num_rows == 1) {
+      out_row = Eigen::TensorMap<Eigen::Tensor<const T, 1, Eigen::RowMajor>,
+                                 Eigen::Unaligned>(in, num_col);
+      return;
+    }
+    Eigen::IndexList<Eigen::type2index<0> > dims_to_reduce;
+    Eigen::TensorMap<Eigen::Tensor<const T, 2, Eigen::RowMajor>,
+                     Eigen::Unaligned>
+        in_rows(in, num_rows, num_col);
+    out_row = in_rows.reduce(dims_to_reduce, R());
+  }
+
+  // Splits the input rows evenly across `num_shards` shards instead of by
+  // segment, so that a few very large segments do not serialize the op.
+  // Segments that lie entirely inside a shard are written to the output
+  // directly. The pieces of a segment that crosses a shard boundary are
+  // reduced into a scratch row per piece, and combined once all shards are
+  // done.
+  void ComputeSharded(OpKernelContext* context, int num_shards,
+                      typename TTypes<Index>::ConstVec segment_vec,
+                      typename TTypes<T, 2>::ConstTensor input_flat,
+                      Index output_rows,
+                      typename TTypes<T, 2>::Tensor output_flat) {
+    const int64_t num_indices = segment_vec.size();
+    const int64_t num_col = input_flat.dimension(1);
+
+    // Validate the segment ids up front so that the shards cannot fail.
+    Index prev_id = internal::SubtleMustCopy(segment_vec(0));
+    for (int64_t i = 0; i < num_indices; ++i) {
+      const Index id = internal::SubtleMustCopy(segment_vec(i));
+      OP_REQUIRES(context, prev_id <= id,
+                  errors::InvalidArgument("segment ids are not increasing"));
+      OP_REQUIRES(
+          context, FastBoundsCheck(id, output_rows),
+          errors::InvalidArgument(
+              "Segment id ", id, " out of range [0, ", output_rows,
+              "), possibly because 'segment_ids' input is not sorted."));
+      prev_id = id;
+    }
+
+    const int64_t rows_per_shard = (num_indices + num_shards - 1) / num_shards;
+    num_shards = (num_indices + rows_per_shard - 1) / rows_per_shard;
+
+    // Shard `s` stores the piece of a segment that continues from the previous
+    // shard (or that spans the whole shard) in scratch row 2 * s, and the piece
+    // that continues into the next shard in scratch row 2 * s + 1.
+    Tensor scratch;
+    OP_REQUIRES_OK(context, context->allocate_temp(
+                                DataTypeToEnum<T>::value,
+                                TensorShape({2 * num_shards, num_col}),
+                                &scratch));
+    auto scratch_flat = scratch.matrix<T>();
+    std::vector<Index> scratch_segment(2 * num_shards, -1);
+    std::vector<int64_t> scratch_rows(2 * num_shards, 0);
+
+    auto segment_at = [&segment_vec](int64_t i) {
+      return internal::SubtleMustCopy(segment_vec(i));
+    };
+    auto reduce_shard = [&](int64_t shard_begin, int64_t shard_end) {
+      for (int64_t shard = shard_begin; shard < shard_end; ++shard) {
+        const int64_t begin = shard * rows_per_shard;
+        const int64_t end = std::min(begin + rows_per_shard, num_indices);
+        int64_t start = begin;
+        while (start < end) {
+          const Index id = segment_at(start);
+          int64_t limit = start + 1;
+          while (limit < end && segment_at(limit) == id) ++limit;
+          // The ids were validated above; only re-check them in case the input
+          // was modified concurrently.
+          if (!FastBoundsCheck(id, output_rows)) {
+            start = limit;
+            continue;
+          }
+
+          // Fill the gap between the previous segment and this one. Each gap
+          // is filled by the shard that owns the row following it.
+          const Index prev = start == 0 ? -1 : segment_at(start - 1);
+          if (prev + 1 < id && prev + 1 >= 0) {
+            Eigen::TensorMap<Eigen::Tensor<T, 1, Eigen::RowMajor>,
+                             Eigen::Unaligned>
+                gap(&output_flat(prev + 1, 0), (id - prev - 1) * num_col);
+            gap.setConstant(T(default_value));
+          }
+
+          const bool continues_before = start == begin && prev == id;
+          const bool continues_after =
+              limit == end && end < num_indices && segment_at(end) == id;
+          const T* in = &input_flat(start, 0);
+          if (continues_before || continues_after) {
+            const int64_t slot = start == begin ? 2 * shard : 2 * shard + 1;
+            ReduceRows<typename PartialReducer::type>(in, limit - start,
+                                                      num_col,
+                                                      &scratch_flat(slot, 0));
+            scratch_segment[slot] = id;
+            scratch_rows[slot] = limit - start;
+          } else {
+            ReduceRows<Reducer>(in, limit - start, num_col,
+                                &output_flat(id, 0));
+          }
+          start = limit;
+        }
+      }
+    };
+    const int64_t cost_per_shard = rows_per_shard * num_col * 5;
+    context->device()->tensorflow_cpu_worker_threads()->workers->ParallelFor(
+        num_shards, cost_per_shard, reduce_shard);
+
+    // Combine the pieces of each segment that crosses shard boundaries. The
+    // pieces of a segment occupy consecutive used scratch rows; move them
+    // next to each other and reduce them like a segment of their own.
+    int64_t slot = 0;
+    while (slot < 2 * num_shards) {
+      const Index id = scratch_segment[slot];
+      if (id < 0) {
+        ++slot;
+        continue;
+      }
+      int64_t num_pieces = 1;
+      int64_t num_rows = scratch_rows[slot];
+      int64_t next = slot + 1;
+      for (; next < 2 * num_shards; ++next) {
+        if (scratch_segment[next] < 0) continue;
+        if (scratch_segment[next] != id) break;
+        if (next != slot + num_pieces) {
+          std::copy_n(&scratch_flat(next, 0), num_col,
+                      &scratch_flat(slot + num_pieces, 0));
+        }
+        ++num_pieces;
+        num_rows += scratch_rows[next];
+      }
+      ReduceRows<typename PartialReducer::type>(
+          &scratch_flat(slot, 0), num_pieces, num_col, &output_flat(id, 0));
+      if (PartialReducer::kIsMean) {
+        Eigen::TensorMap<Eigen::Tensor<T, 1, Eigen::RowMajor>,
+                         Eigen::Unaligned>
+            out_row(&output_flat(id, 0), num_col);
+        out_row = out_row / static_cast<T>(num_rows);
+      }
+      slot = next;
+    }
+  }
 };
 
 #if GOOGLE_CUDA || TENSORFLOW_USE_ROCM
@@ -372,6 +564,9 @@ struct UnsortedSegmentFunctor<CPUDevice, T, Index, InitialValueF, ReductionF> {
     // `num_reductions` counts the rows actually reduced in output,
     // the rows only filled with InitialValueF() will be excluded.
     int64_t num_reductions = 0;
+    // `max_segment_rows` is the largest number of input rows reduced into a
+    // single output row.
+    int64_t max_segment_rows = 0;
     // `row_counter` records how many input rows will be reduced in each
     // output row, the row only fills with InitialValueF() will keep 0.
     // Length of non-zero elements is `num_reductions`.
@@ -389,11 +584,71 @@ struct UnsortedSegmentFunctor<CPUDevice, T, Index, InitialValueF, ReductionF> {
                       " = ", j, " is out of range [0, ", num_segments, ")"));
       if (row_counter[j] == 0) num_reductions++;
       row_counter[j]++;
+      max_segment_rows = std::max<int64_t>(max_segment_rows, row_counter[j]);
     }
 
     // Nothing to reduce. All output values equal to `InitialValueF()`.
     if (num_reductions == 0) return;
 
+    // Reduction functors includes Sum, Max, Min, etc. Simply consider it
+    // will cost 5 cycles per operation.
+    const int64_t cost_per_row = 5 * inner_dim;
+
+    // Parallelizing by segment (below) cannot use more threads than there are
+    // segments, and is bounded by the largest segment. When one segment holds
+    // more than a thread's share of the rows, parallelize by row instead: the
+    // rows are split into fixed contiguous blocks, each block is reduced into
+    // its own copy of the output, and the copies are combined in block order.
+    // So the result does not depend on the scheduling of the blocks. This is
+    // only done while the copies are smaller than the input.
+    thread::ThreadPool* workers =
+        ctx->device()->tensorflow_cpu_worker_threads()->workers;
+    const int64_t num_blocks = workers->NumThreads();
+    if (num_real_segment * inner_dim >= kMinRowShardedElements &&
+        max_segment_rows * num_blocks > num_real_segment &&
+        num_segments * num_blocks <= num_real_segment) {
+      const int64_t block_size = (N + num_blocks - 1) / num_blocks;
+      std::vector<Tensor> partials(num_blocks);
+      for (Tensor& partial : partials) {
+        OP_REQUIRES_OK(ctx, ctx->allocate_temp(
+                                DataTypeToEnum<T>::value,
+                                TensorShape({num_segments, inner_dim}),
+                                &partial));
+      }
+      auto reduce_blocks = [&](int64_t begin, int64_t end) {
+        for (int64_t b = begin; b < end; ++b) {
+          auto partial = partials[b].matrix<T>();
+          partial.setConstant(InitialValueF()());
+          const int64_t block_end = std::min(N, (b + 1) * block_size);
+          for (int64_t i = b * block_size; i < block_end; ++i) {
+            Index j = internal::SubtleMustCopy(segment_ids(i));
+            if (!FastBoundsCheck(j, num_segments)) continue;
+            reduction(data.template chip<0>(i), partial.template chip<0>(j));
+          }
+        }
+      };
+      workers->ParallelFor(num_blocks, cost_per_row * block_size,
+                           reduce_blocks);
+
+      auto combine = [&](int64_t begin, int64_t end) {
+        for (int64_t b = 0; b < num_blocks; ++b) {
+          const Tensor& partial_tensor = partials[b];
+          typename TTypes<T, 2>::ConstTensor partial =
+              partial_tensor.matrix<T>();
+          for (int64_t j = begin; j < end; ++j) {
+            if (row_counter[j] == 0) continue;
+            reduction(partial.template chip<0>(j),
+                      output.template chip<0>(j));
+          }
+        }
+      };
+      const Eigen::TensorOpCost combine_cost(
+          sizeof(T) * inner_dim * num_blocks, sizeof(T) * inner_dim,
+          cost_per_row * num_blocks);
+      cpu_device.parallelFor(num_segments, combine_cost, combine);
+      return;
+    }
+
     // Parallelize by `num_segments`. It's simple, efficient and safe
     // (no data dependency):
     //
@@ -403,9 +658,6 @@ struct UnsortedSegmentFunctor<CPUDevice, T, Index, InitialValueF, ReductionF> {
     // N | c0 |  | 2 |       -->  worker 3:  |2|           f(c0)
     //   | b1 |  | 1 |
     //   | a1 |  | 0 |
-    //
-    // TODO(intel-tf): Balance workload in `row_counter` to make parallelism
-    //                 more efficient.
     auto reductionWorker = [&](int64_t begin, int64_t end) -> void {
       for (int64_t i = 0; i < N; i++) {
         Index j = internal::SubtleMustCopy(segment_ids(i));
@@ -416,15 +668,17 @@ struct UnsortedSegmentFunctor<CPUDevice, T, Index, InitialValueF, ReductionF> {
       }
     };
 
-    // Reduction functors includes Sum, Max, Min, etc. Simply consider it
-    // will cost 5 cycles per operation.
     const int64_t kAverTaskSize = num_real_segment / num_segments;
-    const int64_t compute_cycles = 5 * inner_dim * kAverTaskSize;
+    const int64_t compute_cycles = cost_per_row * kAverTaskSize;
     const int64_t input_bytes = sizeof(T) * inner_dim * kAverTaskSize;
     const int64_t output_bytes = sizeof(T) * inner_dim * kAverTaskSize;
     const Eigen::TensorOpCost cost(input_bytes, output_bytes, compute_cycles);
     cpu_device.parallelFor(num_segments, cost, reductionWorker);
   }
+
+ private:
+  // Inputs with fewer elements are never parallelized by row.
+  static constexpr int64_t kMinRowShardedElements = 1 << 16;
 };
 
 template <typename T>
@@ -13,7 +13,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
 #include <functional>
+#include <random>
 #include <vector>
 
 #include "tensorflow/core/common_runtime/device.h"
@@ -181,6 +183,89 @@ BM_Reduce_Arg(64, 32, 2);
 BM_Reduce_Arg(4096, 32, 2);
 BM_Reduce_Arg(4096, 128, 2);
 
+// Reduces rows whose segment ids follow a power law, so that the first few
+// segments hold most of the rows. This is the typical distribution of
+// embedding combiner inputs.
+static void BM_SkewedSegmentReduction(::testing::benchmark::State& state,
+                                      const string& reduction, bool sorted) {
+  const int num_rows = state.range(0);
+  const int num_cols = state.range(1);
+  const int num_segments = state.range(2);
+  std::unique_ptr<Device> device(
+      DeviceFactory::NewDevice("CPU", {}, "/job:a/replica:0/task:0"));
+
+  gtl::InlinedVector<TensorValue, 4> reduction_inputs;
+  Tensor input(DT_FLOAT, TensorShape({num_rows, num_cols}));
+  input.flat<float>().setRandom();
+  reduction_inputs.push_back({nullptr, &input});
+
+  Tensor indices(DT_INT32, TensorShape({num_rows}));
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  auto indices_flat = indices.flat<int32>();
+  for (int i = 0; i < num_rows; ++i) {
+    const double u = uniform(rng);
+    indices_flat(i) = static_cast<int32>(num_segments * u * u * u * u);
+  }
+  if (sorted) {
+    std::sort(indices_flat.data(), indices_flat.data() + num_rows);
+  }
+  reduction_inputs.push_back({nullptr, &indices});
+
+  Tensor num_segments_tensor(DT_INT32, TensorShape({}));
+  num_segments_tensor.scalar<int32>()() = num_segments;
+  NodeDefBuilder builder(reduction, reduction);
+  builder.Input(FakeInput(DT_FLOAT)).Input(FakeInput(DT_INT32));
+  if (!sorted) {
+    reduction_inputs.push_back({nullptr, &num_segments_tensor});
+    builder.Input(FakeInput(DT_INT32));
+  }
+  NodeDef reduction_node_def;
+  TF_CHECK_OK(builder.Finalize(&reduction_node_def));
+  Status status;
+  std::unique_ptr<OpKernel> reduction_op(
+      CreateOpKernel(DEVICE_CPU, device.get(), cpu_allocator(),
+                     reduction_node_def, TF_GRAPH_DEF_VERSION, &status));
+  TF_CHECK_OK(status);
+
+  OpKernelContext::Params params;
+  params.device = device.get();
+  params.frame_iter = FrameAndIter(0, 0);
+  params.inputs = &reduction_inputs;
+  params.op_kernel = reduction_op.get();
+  std::vector<AllocatorAttributes> attrs;
+  test::SetOutputAttrs(&params, &attrs);
+
+  std::unique_ptr<OpKernelContext> reduction_context(
+      new OpKernelContext(&params));
+
+  reduction_op->Compute(reduction_context.get());
+  TF_CHECK_OK(reduction_context->status());
+  for (auto s : state) {
+    delete reduction_context->release_output(0).tensor;
+    reduction_op->Compute(reduction_context.get());
+  }
+  const int64_t bytes_per_iter =
+      static_cast<int64_t>(num_rows) * num_cols * sizeof(float);
+  state.SetBytesProcessed(bytes_per_iter * state.iterations());
+}
+
+#define BM_SkewedReduce(O, SORTED)                                        \
+  static void BM_Skewed_##O(::testing::benchmark::State& state) {         \
+    BM_SkewedSegmentReduction(state, #O, SORTED);                         \
+  }                                                                       \
+  BENCHMARK(BM_Skewed_##O)                                                \
+      ->UseRealTime()                                                     \
+      ->Args({1 << 16, 64, 16})                                           \
+      ->Args({1 << 16, 64, 1024})                                         \
+      ->Args({1 << 18, 16, 64})                                           \
+      ->Args({1 << 18, 256, 256});
+
+BM_SkewedReduce(SegmentSum, true);
+BM_SkewedReduce(SegmentMean, true);
+BM_SkewedReduce(UnsortedSegmentSum, false);
+BM_SkewedReduce(UnsortedSegmentMax, false);
+
 template <DataType T>
 static void SparseSegmentMeanGradHelper(::testing::benchmark::State& state,
                                         float uniqueness, int size) {
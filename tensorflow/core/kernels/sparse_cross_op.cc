@@ -16,6 +16,7 @@ limitations under the License.
 // Contains OP to generate sparse crosses.
 #include <assert.h>
 
+#include <cstring>
 #include <limits>
 #include <string>
 #include <vector>
@@ -109,7 +110,7 @@ class KeyedSparseTensorColumn : public ColumnInterface<InternalType> {
   std::vector<int64_t> feature_start_indices_;
 };
 
-// InternalType is int64 only when using HashCrosser.
+// InternalType is int64 only when using HashCrossWriter.
 template <>
 int64_t SparseTensorColumn<int64_t>::Feature(int64_t batch, int64_t n,
                                              bool strong_hash) const {
@@ -139,7 +140,7 @@ int64_t KeyedSparseTensorColumn<int64_t>::Feature(int64_t batch, int64_t n,
        sizeof(values_.dtype())});
 }
 
-// InternalType is string or StringPiece when using StringCrosser.
+// InternalType is string or StringPiece when using StringCrossWriter.
 template <>
 tstring SparseTensorColumn<tstring>::Feature(int64_t batch, int64_t n,
                                              bool strong_hash) const {
@@ -215,7 +216,7 @@ class KeyedDenseTensorColumn : public ColumnInterface<InternalType> {
   tensorflow::uint64 key_[2];
 };
 
-// InternalType is int64 only when using HashCrosser.
+// InternalType is int64 only when using HashCrossWriter.
 template <>
 int64_t DenseTensorColumn<int64_t>::Feature(int64_t batch, int64_t n,
                                             bool strong_hash) const {
@@ -241,7 +242,7 @@ int64_t KeyedDenseTensorColumn<int64_t>::Feature(int64_t batch, int64_t n,
   return tensor_.matrix<int64_t>()(batch, n);
 }
 
-// Internal type is string or StringPiece when using StringCrosser.
+// Internal type is string or StringPiece when using StringCrossWriter.
 template <>
 tstring DenseTensorColumn<tstring>::Feature(int64_t batch, int64_t n,
                                             bool strong_hash) const {
@@ -268,116 +269,192 @@ StringPiece KeyedDenseTensorColumn<StringPiece>::Feature(
   return tensor_.matrix<tstring>()(batch, n);
 }
 
-// Updates Output tensors with sparse crosses.
-template <typename OutType>
-class OutputUpdater {
- public:
-  OutputUpdater(const std::vector<int64_t>& output_start_indices,
-                Tensor* indices_out, Tensor* values_out)
-      : output_start_indices_(output_start_indices),
-        indices_out_(indices_out),
-        values_out_(values_out) {}
-
-  void Update(const int64_t batch_index, const int64_t cross_count,
-              const OutType& cross) const {
-    const int64_t output_index =
-        output_start_indices_[batch_index] + cross_count;
-
-    auto indices_matrix = indices_out_->matrix<int64_t>();
-    indices_matrix(output_index, 0) = batch_index;
-    indices_matrix(output_index, 1) = cross_count;
+// Estimated costs, in cycles, of fetching one feature of a column and of
+// writing one cross. Used to shard the batch rows across threads.
+constexpr int64_t kFeatureCost = 100;
+constexpr int64_t kHashCrossCost = 20;
+constexpr int64_t kStringCrossCost = 100;
+
+// Returns the estimated cost of crossing one of `batch_size` rows that have
+// `num_crosses` crosses in total.
+int64_t CrossCostPerRow(int64_t num_columns, int64_t batch_size,
+                        int64_t num_crosses, int64_t cost_per_cross) {
+  const int64_t crosses_per_row =
+      batch_size > 0 ? num_crosses / batch_size + 1 : 1;
+  return num_columns * kFeatureCost + crosses_per_row * cost_per_cross;
+}
 
-    auto value_vec = values_out_->vec<OutType>();
-    value_vec(output_index) = cross;
+// Stores the features of batch row `batch` of every column in `features`,
+// column after column, and the offset of the first feature of column i in
+// `(*offsets)[i]`. The vectors are reused across rows, so fetching the features
+// of a row does not allocate once they are large enough. Returns the number of
+// crosses of the row.
+template <typename InternalType, typename FeatureType>
+int64_t FetchRowFeatures(
+    const std::vector<std::unique_ptr<ColumnInterface<InternalType>>>& columns,
+    int64_t batch, bool strong_hash, std::vector<FeatureType>* features,
+    std::vector<int64_t>* offsets) {
+  int64_t num_crosses = 1;
+  int64_t num_features = 0;
+  for (size_t i = 0; i < columns.size(); ++i) {
+    const int64_t feature_count = columns[i]->FeatureCount(batch);
+    (*offsets)[i] = num_features;
+    num_features += feature_count;
+    num_crosses *= feature_count;
+  }
+  (*offsets)[columns.size()] = num_features;
+  // If one column is missing any feature, there won't be any cross.
+  if (num_crosses == 0) return 0;
+  if (features->size() < static_cast<size_t>(num_features)) {
+    features->resize(num_features);
+  }
+  for (size_t i = 0; i < columns.size(); ++i) {
+    const int64_t start = (*offsets)[i];
+    const int64_t feature_count = (*offsets)[i + 1] - start;
+    for (int64_t n = 0; n < feature_count; ++n) {
+      (*features)[start + n] = columns[i]->Feature(batch, n, strong_hash);
+    }
   }
+  return num_crosses;
+}
 
- private:
-  const std::vector<int64_t>& output_start_indices_;
-  Tensor* indices_out_;
-  Tensor* values_out_;
-};
+// Advances `position`, which holds the feature index of every column, to the
+// next cross of a row whose column features start at `offsets`. The last
+// column varies fastest. Returns the first column whose feature changed, or -1
+// after the last cross.
+int NextCross(const std::vector<int64_t>& offsets,
+              std::vector<int64_t>* position) {
+  for (int i = static_cast<int>(position->size()) - 1; i >= 0; --i) {
+    if (++(*position)[i] < offsets[i + 1] - offsets[i]) return i;
+    (*position)[i] = 0;
+  }
+  return -1;
+}
 
-// Generates the sparse crosses as concatenation of strings.
+// Writes the sparse crosses of batch rows as concatenations of strings,
+// directly into the preallocated output tensors.
 template <typename InternalType>
-class StringCrosser {
+class StringCrossWriter {
  public:
-  StringCrosser(const std::vector<
-                    std::unique_ptr<ColumnInterface<InternalType>>>& columns,
-                const int64_t num_buckets_unused, const uint64 hash_key_unused,
-                const tstring k_feature_separator)
-      : columns_(columns), k_feature_separator_(k_feature_separator) {}
-
-  string Generate(const int64_t batch_index,
-                  const std::vector<int>& permutation,
-                  bool unused_strong_hash) const {
-    gtl::InlinedVector<InternalType, 6> cross_vec(columns_.size());
-    for (int i = 0; i < permutation.size(); i++) {
-      cross_vec[i] = columns_[i]->Feature(batch_index, permutation[i], false);
+  StringCrossWriter(
+      const std::vector<std::unique_ptr<ColumnInterface<InternalType>>>&
+          columns,
+      const std::vector<int64_t>& output_start_indices, Tensor* indices_out,
+      Tensor* values_out, const tstring& separator)
+      : columns_(columns),
+        output_start_indices_(output_start_indices),
+        indices_out_(indices_out),
+        values_out_(values_out),
+        separator_(separator) {}
+
+  void WriteRows(int64_t begin, int64_t end) const {
+    const int num_columns = columns_.size();
+    auto indices = indices_out_->matrix<int64_t>();
+    auto values = values_out_->vec<tstring>();
+    std::vector<InternalType> features;
+    std::vector<int64_t> offsets(num_columns + 1);
+    std::vector<int64_t> position(num_columns);
+    for (int64_t b = begin; b < end; ++b) {
+      const int64_t num_crosses =
+          FetchRowFeatures(columns_, b, false, &features, &offsets);
+      std::fill(position.begin(), position.end(), 0);
+      int64_t output_index = output_start_indices_[b];
+      for (int64_t cross_count = 0; cross_count < num_crosses;
+           ++cross_count, ++output_index) {
+        indices(output_index, 0) = b;
+        indices(output_index, 1) = cross_count;
+
+        size_t size = separator_.size() * (num_columns - 1);
+        for (int i = 0; i < num_columns; ++i) {
+          size += StringPiece(features[offsets[i] + position[i]]).size();
+        }
+        tstring& cross = values(output_index);
+        cross.resize_uninitialized(size);
+        char* out = cross.mdata();
+        for (int i = 0; i < num_columns; ++i) {
+          if (i > 0) {
+            std::memcpy(out, separator_.data(), separator_.size());
+            out += separator_.size();
+          }
+          const StringPiece feature(features[offsets[i] + position[i]]);
+          std::memcpy(out, feature.data(), feature.size());
+          out += feature.size();
+        }
+        NextCross(offsets, &position);
+      }
     }
-    // TODO(zakaria): this will copy the string twice, might effect
-    // performance.
-    return absl::StrJoin(cross_vec, k_feature_separator_);
   }
 
  private:
   const std::vector<std::unique_ptr<ColumnInterface<InternalType>>>& columns_;
-  const tstring k_feature_separator_;
+  const std::vector<int64_t>& output_start_indices_;
+  Tensor* indices_out_;
+  Tensor* values_out_;
+  const tstring separator_;
 };
 
-// Generates the sparse crosses as nested hash to avoid string manipulations.
-class HashCrosser {
+// Writes the sparse crosses of batch rows as nested fingerprints, directly
+// into the preallocated output tensors. The fingerprint of the features of the
+// first i columns is kept for every i, so that moving to the next cross only
+// recomputes the fingerprints of the columns whose feature changed, which is
+// usually just the last one.
+class HashCrossWriter {
  public:
-  HashCrosser(
+  // If `use_hash_key` is true the fingerprint of a cross starts from
+  // `hash_key` (SparseCross), otherwise from the feature of the first column
+  // (SparseCrossHashed).
+  HashCrossWriter(
       const std::vector<std::unique_ptr<ColumnInterface<int64_t>>>& columns,
-      const int64_t num_buckets, const uint64 hash_key,
-      const tstring k_feature_separator_unused)
-      : columns_(columns), num_buckets_(num_buckets), hash_key_(hash_key) {}
-
-  int64_t Generate(const int64_t batch_index,
-                   const std::vector<int>& permutation,
-                   bool unused_strong_hash) const {
-    // Do the fingerprint concatenation on uint64.
-    uint64 hashed_output = hash_key_;
-    for (size_t i = 0; i < permutation.size(); ++i) {
-      uint64 hash_i = columns_[i]->Feature(batch_index, permutation[i], false);
-      hashed_output = FingerprintCat64(hashed_output, hash_i);
-    }
-    // The return value is int64 based on the number of buckets.
-    if (num_buckets_ > 0) {
-      return hashed_output % num_buckets_;
-    } else {
-      // To prevent negative output we take modulo to max int64.
-      return hashed_output % std::numeric_limits<int64_t>::max();
+      const std::vector<int64_t>& output_start_indices, Tensor* indices_out,
+      Tensor* values_out, int64_t num_buckets, bool use_hash_key,
+      uint64 hash_key, bool strong_hash)
+      : columns_(columns),
+        output_start_indices_(output_start_indices),
+        indices_out_(indices_out),
+        values_out_(values_out),
+        num_buckets_(num_buckets),
+        use_hash_key_(use_hash_key),
+        hash_key_(hash_key),
+        strong_hash_(strong_hash) {}
+
+  void WriteRows(int64_t begin, int64_t end) const {
+    const int num_columns = columns_.size();
+    auto indices = indices_out_->matrix<int64_t>();
+    auto values = values_out_->vec<int64_t>();
+    std::vector<int64_t> features;
+    std::vector<int64_t> offsets(num_columns + 1);
+    std::vector<int64_t> position(num_columns);
+    std::vector<uint64> prefixes(num_columns);
+    for (int64_t b = begin; b < end; ++b) {
+      const int64_t num_crosses =
+          FetchRowFeatures(columns_, b, strong_hash_, &features, &offsets);
+      std::fill(position.begin(), position.end(), 0);
+      int64_t output_index = output_start_indices_[b];
+      int first_changed = 0;
+      for (int64_t cross_count = 0; cross_count < num_crosses;
+           ++cross_count, ++output_index) {
+        // Do the fingerprint concatenation on uint64.
+        for (int i = first_changed; i < num_columns; ++i) {
+          const uint64 feature = features[offsets[i] + position[i]];
+          if (i > 0) {
+            prefixes[i] = FingerprintCat64(prefixes[i - 1], feature);
+          } else if (use_hash_key_) {
+            prefixes[i] = FingerprintCat64(hash_key_, feature);
+          } else {
+            prefixes[i] = feature;
+          }
+        }
+        indices(output_index, 0) = b;
+        indices(output_index, 1) = cross_count;
+        values(output_index) = Bucket(prefixes[num_columns - 1]);
+        first_changed = NextCross(offsets, &position);
+      }
     }
   }
 
  private:
-  const std::vector<std::unique_ptr<ColumnInterface<int64_t>>>& columns_;
-  const int64_t num_buckets_;
-  const uint64 hash_key_;
-};
-
-// Generates the sparse crosses as nested hash to avoid string manipulations.
-class HashCrosserV2 {
- public:
-  HashCrosserV2(
-      const std::vector<std::unique_ptr<ColumnInterface<int64_t>>>& columns,
-      const int64_t num_buckets, const uint64 hash_key_unused,
-      const tstring k_feature_separator_unused)
-      : columns_(columns), num_buckets_(num_buckets) {}
-
-  int64_t Generate(const int64_t batch_index,
-                   const std::vector<int>& permutation,
-                   bool strong_hash) const {
-    // Do the fingerprint concatenation on uint64.
-    uint64 hashed_output =
-        columns_[0]->Feature(batch_index, permutation[0], strong_hash);
-    for (size_t i = 1; i < permutation.size(); ++i) {
-      uint64 hash_i =
-          columns_[i]->Feature(batch_index, permutation[i], strong_hash);
-      hashed_output = FingerprintCat64(hashed_output, hash_i);
-    }
-    // The return value is int64 based on the number of buckets.
+  // The return value is int64 based on the number of buckets.
+  int64_t Bucket(uint64 hashed_output) const {
     if (num_buckets_ > 0) {
       return hashed_output % num_buckets_;
     } else {
@@ -386,58 +463,14 @@ class HashCrosserV2 {
     }
   }
 
- private:
   const std::vector<std::unique_ptr<ColumnInterface<int64_t>>>& columns_;
+  const std::vector<int64_t>& output_start_indices_;
+  Tensor* indices_out_;
+  Tensor* values_out_;
   const int64_t num_buckets_;
-};
-
-// ProductIterator generates cartesian products based on indices.
-template <typename InternalType>
-class ProductIterator {
- public:
-  explicit ProductIterator(
-      const std::vector<std::unique_ptr<ColumnInterface<InternalType>>>&
-          columns,
-      int64_t batch_index)
-      : columns_(columns), batch_index_(batch_index) {
-    next_permutation_.resize(columns_.size(), 0);
-    // Sets has_next_ to false if any feature column has 0 features.
-    has_next_ = true;
-    for (int i = 0; i < columns_.size(); i++) {
-      if (columns_[i]->FeatureCount(batch_index_) == 0) {
-        has_next_ = false;
-        break;
-      }
-    }
-  }
-
-  std::vector<int> Next() {
-    std::vector<int> permutation(next_permutation_);
-
-    // Generates next permutation, if available.
-    bool carry = true;
-    for (int i = next_permutation_.size() - 1; i >= 0; i--) {
-      if (carry) {
-        next_permutation_[i] = next_permutation_[i] + 1;
-      }
-      if (next_permutation_[i] == columns_[i]->FeatureCount(batch_index_)) {
-        next_permutation_[i] = 0;
-      } else {
-        carry = false;
-        break;
-      }
-    }
-    has_next_ = !carry;
-    return permutation;
-  }
-
-  bool HasNext() { return has_next_; }
-
- private:
-  bool has_next_;
-  const std::vector<std::unique_ptr<ColumnInterface<InternalType>>>& columns_;
-  const int64_t batch_index_;
-  std::vector<int> next_permutation_;
+  const bool use_hash_key_;
+  const uint64 hash_key_;
+  const bool strong_hash_;
 };
 
 template <bool HASHED_OUTPUT, typename InternalType>
@@ -445,16 +478,34 @@ struct CrossTraits;
 
 template <typename InternalType>
 struct CrossTraits<false, InternalType> {
-  typedef StringCrosser<InternalType> Crosser;
-  typedef StringCrosser<InternalType> CrosserV2;
-  typedef OutputUpdater<tstring> Updater;
+  typedef StringCrossWriter<InternalType> Writer;
+  static constexpr int64_t kCrossCost = kStringCrossCost;
+
+  static Writer CreateWriter(
+      const std::vector<std::unique_ptr<ColumnInterface<InternalType>>>&
+          columns,
+      const std::vector<int64_t>& output_start_indices, Tensor* indices_out,
+      Tensor* values_out, const int64_t num_buckets_unused,
+      const uint64 hash_key_unused, const tstring& separator) {
+    return Writer(columns, output_start_indices, indices_out, values_out,
+                  separator);
+  }
 };
 
 template <>
 struct CrossTraits<true, int64_t> {
-  typedef HashCrosser Crosser;
-  typedef HashCrosserV2 CrosserV2;
-  typedef OutputUpdater<int64_t> Updater;
+  typedef HashCrossWriter Writer;
+  static constexpr int64_t kCrossCost = kHashCrossCost;
+
+  static Writer CreateWriter(
+      const std::vector<std::unique_ptr<ColumnInterface<int64_t>>>& columns,
+      const std::vector<int64_t>& output_start_indices, Tensor* indices_out,
+      Tensor* values_out, const int64_t num_buckets, const uint64 hash_key,
+      const tstring& separator_unused) {
+    return Writer(columns, output_start_indices, indices_out, values_out,
+                  num_buckets, /*use_hash_key=*/true, hash_key,
+                  /*strong_hash=*/false);
+  }
 };
 }  // namespace
 
@@ -768,8 +819,6 @@ class SparseCrossOp : public OpKernel {
                                                shapes_list_in, dense_list_in);
 
     const tstring k_feature_separator = "_X_";
-    typename CrossTraits<HASHED_OUTPUT, InternalType>::Crosser crosser(
-        columns, num_buckets_, hash_key_, k_feature_separator);
     Tensor* indices_out;
     Tensor* values_out;
     Tensor* shape_out;
@@ -781,26 +830,20 @@ class SparseCrossOp : public OpKernel {
         CreateOutputTensors(columns, batch_size, context, &indices_out,
                             &values_out, &shape_out, &output_start_indices));
 
-    typename CrossTraits<HASHED_OUTPUT, InternalType>::Updater updater(
-        output_start_indices, indices_out, values_out);
-    auto do_work = [&columns, crosser, updater](int64_t begin, int64_t end) {
-      for (int b = begin; b < end; b++) {
-        ProductIterator<InternalType> product_iterator(columns, b);
-        int64_t cross_count = 0;
-        while (product_iterator.HasNext()) {
-          const auto permutation = product_iterator.Next();
-          updater.Update(b, cross_count,
-                         crosser.Generate(b, permutation, false));
-          cross_count++;
-        }
-      }
+    typedef CrossTraits<HASHED_OUTPUT, InternalType> Traits;
+    const typename Traits::Writer writer = Traits::CreateWriter(
+        columns, output_start_indices, indices_out, values_out, num_buckets_,
+        hash_key_, k_feature_separator);
+    auto do_work = [&writer](int64_t begin, int64_t end) {
+      writer.WriteRows(begin, end);
     };
 
     auto* worker_threads = context->device()->tensorflow_cpu_worker_threads();
-    // TODO(zakaria): optimize kCostPerUnit
-    const int kCostPerUnit = 5000 * indices_list_in.size();
+    const int64_t cost_per_row =
+        CrossCostPerRow(columns.size(), batch_size, indices_out->dim_size(0),
+                        Traits::kCrossCost);
     Shard(worker_threads->num_threads, worker_threads->workers, batch_size,
-          kCostPerUnit, do_work);
+          cost_per_row, do_work);
   }
 
  private:
@@ -847,27 +890,18 @@ class SparseCrossV2Op : public OpKernel {
         context,
         CreateOutputTensors(columns, batch_size, context, &indices_out,
                             &values_out, &shape_out, &output_start_indices));
-    StringCrosser<tstring> crosser(columns, 0, 0, separator);
-    OutputUpdater<tstring> updater(output_start_indices, indices_out,
-                                   values_out);
-    auto do_work = [&columns, crosser, updater](int64_t begin, int64_t end) {
-      for (int b = begin; b < end; b++) {
-        ProductIterator<tstring> product_iterator(columns, b);
-        int64_t cross_count = 0;
-        while (product_iterator.HasNext()) {
-          const auto permutation = product_iterator.Next();
-          updater.Update(b, cross_count,
-                         crosser.Generate(b, permutation, false));
-          cross_count++;
-        }
-      }
+    const StringCrossWriter<tstring> writer(
+        columns, output_start_indices, indices_out, values_out, separator);
+    auto do_work = [&writer](int64_t begin, int64_t end) {
+      writer.WriteRows(begin, end);
     };
 
     auto* worker_threads = context->device()->tensorflow_cpu_worker_threads();
-    // TODO(zakaria): optimize kCostPerUnit
-    const int kCostPerUnit = 5000 * indices_list_in.size();
+    const int64_t cost_per_row =
+        CrossCostPerRow(columns.size(), batch_size, indices_out->dim_size(0),
+                        kStringCrossCost);
     Shard(worker_threads->num_threads, worker_threads->workers, batch_size,
-          kCostPerUnit, do_work);
+          cost_per_row, do_work);
   }
 };
 
@@ -920,29 +954,20 @@ class SparseCrossHashedOp : public OpKernel {
         context,
         CreateOutputTensors(columns, batch_size, context, &indices_out,
                             &values_out, &shape_out, &output_start_indices));
-    const tstring unused_sep;
-    HashCrosserV2 crosser(columns, num_buckets, 0, unused_sep);
-    OutputUpdater<int64_t> updater(output_start_indices, indices_out,
-                                   values_out);
-    auto do_work = [&columns, crosser, updater, strong_hash](int64_t begin,
-                                                             int64_t end) {
-      for (int b = begin; b < end; b++) {
-        ProductIterator<int64_t> product_iterator(columns, b);
-        int64_t cross_count = 0;
-        while (product_iterator.HasNext()) {
-          const auto permutation = product_iterator.Next();
-          updater.Update(b, cross_count,
-                         crosser.Generate(b, permutation, strong_hash));
-          cross_count++;
-        }
-      }
+    const HashCrossWriter writer(columns, output_start_indices, indices_out,
+                                 values_out, num_buckets,
+                                 /*use_hash_key=*/false, /*hash_key=*/0,
+                                 strong_hash);
+    auto do_work = [&writer](int64_t begin, int64_t end) {
+      writer.WriteRows(begin, end);
     };
 
     auto* worker_threads = context->device()->tensorflow_cpu_worker_threads();
-    // TODO(zakaria): optimize kCostPerUnit
-    const int kCostPerUnit = 5000 * indices_list_in.size();
+    const int64_t cost_per_row =
+        CrossCostPerRow(columns.size(), batch_size, indices_out->dim_size(0),
+                        kHashCrossCost);
     Shard(worker_threads->num_threads, worker_threads->workers, batch_size,
-          kCostPerUnit, do_work);
+          cost_per_row, do_work);
   }
 };
 
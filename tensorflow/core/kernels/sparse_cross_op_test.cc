@@ -0,0 +1,175 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <vector>
+
+#include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/kernels/ops_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+class SparseCrossOpTest : public OpsTestBase {
+ protected:
+  // Adds two sparse string columns with a batch of 2. Row 0 has the features
+  // {"a", "b"} and {"x", "y", "z"}; row 1 has {"c"} and no features, so it has
+  // no crosses.
+  void AddSparseInputs() {
+    AddInputFromArray<int64_t>(TensorShape({3, 2}), {0, 0, 0, 1, 1, 0});
+    AddInputFromArray<int64_t>(TensorShape({3, 2}), {0, 0, 0, 1, 0, 2});
+    AddInputFromArray<tstring>(TensorShape({3}), {"a", "b", "c"});
+    AddInputFromArray<tstring>(TensorShape({3}), {"x", "y", "z"});
+    AddInputFromArray<int64_t>(TensorShape({2}), {2, 2});
+    AddInputFromArray<int64_t>(TensorShape({2}), {2, 3});
+  }
+};
+
+TEST_F(SparseCrossOpTest, Hashed) {
+  TF_ASSERT_OK(NodeDefBuilder("cross", "SparseCrossHashed")
+                   .Input(FakeInput(2, DT_INT64))
+                   .Input(FakeInput({DT_STRING, DT_STRING}))
+                   .Input(FakeInput(2, DT_INT64))
+                   .Input(FakeInput(DataTypeVector()))
+                   .Input(FakeInput(DT_INT64))
+                   .Input(FakeInput(DT_BOOL))
+                   .Input(FakeInput(DT_INT64))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddSparseInputs();
+  AddInputFromArray<int64_t>(TensorShape({}), {1000});
+  AddInputFromArray<bool>(TensorShape({}), {false});
+  AddInputFromArray<int64_t>(TensorShape({2}), {137, 173});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected_indices(allocator(), DT_INT64, TensorShape({6, 2}));
+  test::FillValues<int64_t>(&expected_indices,
+                            {0, 0, 0, 1, 0, 2, 0, 3, 0, 4, 0, 5});
+  test::ExpectTensorEqual<int64_t>(expected_indices, *GetOutput(0));
+
+  std::vector<int64_t> expected_values;
+  for (const char* first : {"a", "b"}) {
+    for (const char* second : {"x", "y", "z"}) {
+      expected_values.push_back(
+          FingerprintCat64(Fingerprint64(first), Fingerprint64(second)) %
+          1000);
+    }
+  }
+  Tensor expected(allocator(), DT_INT64, TensorShape({6}));
+  test::FillValues<int64_t>(&expected, expected_values);
+  test::ExpectTensorEqual<int64_t>(expected, *GetOutput(1));
+
+  Tensor expected_shape(allocator(), DT_INT64, TensorShape({2}));
+  test::FillValues<int64_t>(&expected_shape, {2, 6});
+  test::ExpectTensorEqual<int64_t>(expected_shape, *GetOutput(2));
+}
+
+TEST_F(SparseCrossOpTest, Strings) {
+  TF_ASSERT_OK(NodeDefBuilder("cross", "SparseCrossV2")
+                   .Input(FakeInput(2, DT_INT64))
+                   .Input(FakeInput({DT_STRING, DT_STRING}))
+                   .Input(FakeInput(2, DT_INT64))
+                   .Input(FakeInput(DataTypeVector()))
+                   .Input(FakeInput(DT_STRING))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  AddSparseInputs();
+  AddInputFromArray<tstring>(TensorShape({}), {"_X_"});
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(allocator(), DT_STRING, TensorShape({6}));
+  test::FillValues<tstring>(&expected,
+                            {"a_X_x", "a_X_y", "a_X_z", "b_X_x", "b_X_y",
+                             "b_X_z"});
+  test::ExpectTensorEqual<tstring>(expected, *GetOutput(1));
+}
+
+// Builds a SparseCrossHashed or SparseCrossV2 node crossing `num_columns`
+// sparse string columns that have `num_features` features in every row.
+static Graph* SparseCross(bool hashed, int batch_size, int num_columns,
+                          int num_features) {
+  Graph* g = new Graph(OpRegistry::Global());
+  std::vector<NodeBuilder::NodeOut> indices;
+  std::vector<NodeBuilder::NodeOut> values;
+  std::vector<NodeBuilder::NodeOut> shapes;
+  for (int c = 0; c < num_columns; ++c) {
+    const int64_t num_values = static_cast<int64_t>(batch_size) * num_features;
+    Tensor column_indices(DT_INT64, TensorShape({num_values, 2}));
+    Tensor column_values(DT_STRING, TensorShape({num_values}));
+    auto indices_matrix = column_indices.matrix<int64_t>();
+    auto values_vec = column_values.vec<tstring>();
+    for (int64_t i = 0; i < num_values; ++i) {
+      indices_matrix(i, 0) = i / num_features;
+      indices_matrix(i, 1) = i % num_features;
+      values_vec(i) = strings::StrCat("column_", c, "_feature_", i);
+    }
+    Tensor column_shape(DT_INT64, TensorShape({2}));
+    test::FillValues<int64_t>(&column_shape, {batch_size, num_features});
+    indices.emplace_back(test::graph::Constant(g, column_indices));
+    values.emplace_back(test::graph::Constant(g, column_values));
+    shapes.emplace_back(test::graph::Constant(g, column_shape));
+  }
+
+  NodeBuilder builder(g->NewName("cross"),
+                      hashed ? "SparseCrossHashed" : "SparseCrossV2");
+  builder.Input(indices)
+      .Input(values)
+      .Input(shapes)
+      .Input(std::vector<NodeBuilder::NodeOut>());
+  if (hashed) {
+    Tensor salt(DT_INT64, TensorShape({2}));
+    test::FillValues<int64_t>(&salt, {137, 173});
+    builder.Input(test::graph::Constant(g, test::AsScalar<int64_t>(1 << 20)))
+        .Input(test::graph::Constant(g, test::AsScalar<bool>(false)))
+        .Input(test::graph::Constant(g, salt));
+  } else {
+    builder.Input(test::graph::Constant(g, test::AsScalar<tstring>("_X_")));
+  }
+  TF_CHECK_OK(builder.Finalize(g, nullptr));
+  return g;
+}
+
+#define BM_SparseCross(HASHED, B, C, F)                                    \
+  static void BM_SparseCross_##HASHED##_##B##_##C##_##F(                   \
+      ::testing::benchmark::State& state) {                                \
+    test::Benchmark("cpu", SparseCross(HASHED, B, C, F),                   \
+                    /*old_benchmark_api=*/false)                           \
+        .Run(state);                                                       \
+    int64_t crosses = B;                                                   \
+    for (int c = 0; c < C; ++c) crosses *= F;                              \
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *     \
+                            crosses);                                      \
+  }                                                                        \
+  BENCHMARK(BM_SparseCross_##HASHED##_##B##_##C##_##F)->UseRealTime();
+
+BM_SparseCross(true, 256, 2, 16);
+BM_SparseCross(true, 256, 3, 16);
+BM_SparseCross(true, 256, 4, 8);
+BM_SparseCross(true, 32, 5, 8);
+BM_SparseCross(false, 256, 2, 16);
+BM_SparseCross(false, 256, 3, 16);
+BM_SparseCross(false, 256, 4, 8);
+
+}  // namespace
+}  // namespace tensorflow
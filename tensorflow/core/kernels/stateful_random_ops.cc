@@ -109,6 +109,7 @@ Status UpdateVariableAndFill(
     TF_RETURN_IF_ERROR(CheckPhiloxState(*var_tensor, alg_tag_skip));
     TF_RETURN_IF_ERROR(PrepareToUpdateVariable<Device, StateElementType>(
         ctx, var_tensor, var->copy_on_read_mode.load()));
+    var->MarkAllRowsDirty();
 
     UpdateVariableAndFill_Philox_Arg arg;
     arg.output_size = output_size;
@@ -282,6 +283,7 @@ class RngSkipOp : public OpKernel {
     using T = StateElementType;
     OP_REQUIRES_OK(ctx, PrepareToUpdateVariable<Device, T>(
                             ctx, var_tensor, var->copy_on_read_mode.load()));
+    var->MarkAllRowsDirty();
     if (read_old_value) {
       Tensor* output;
       OP_REQUIRES_OK(
@@ -38,6 +38,7 @@ limitations under the License.
 #include "tensorflow/core/kernels/variable_ops.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/platform/prefetch.h"
 #include "tensorflow/core/util/strided_slice_op.h"
 
@@ -303,6 +304,12 @@ class StridedSliceAssignOp : public OpKernel {
 
     Tensor* old_lhs = nullptr;
     Tensor tmp;
+    // Marks every row of a resource variable dirty, for delta checkpoints,
+    // once it was assigned.
+    core::RefCountPtr<Var> v;
+    auto mark_rows_dirty = gtl::MakeCleanup([&v] {
+      if (v) v->MarkAllRowsDirty();
+    });
     if (isTensor) {
       const Tensor& input = context->input(0);
 
@@ -317,7 +324,6 @@ class StridedSliceAssignOp : public OpKernel {
       }
     } else {
       if (context->input_dtype(0) == DT_RESOURCE) {
-        core::RefCountPtr<Var> v;
         OP_REQUIRES_OK(
             context, LookupResource(context, HandleFromInput(context, 0), &v));
         OP_REQUIRES_OK(context,
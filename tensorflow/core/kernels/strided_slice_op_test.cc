@@ -18,7 +18,10 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/fake_input.h"
+#include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/resource_var.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
@@ -122,5 +125,36 @@ void BM_ValidateStridedSliceOp(::testing::benchmark::State& state) {
 
 BENCHMARK(BM_ValidateStridedSliceOp);
 
+class StridedSliceAssignOpTest : public OpsTestBase {};
+
+TEST_F(StridedSliceAssignOpTest, ResourceAssignMarksRowsDirty) {
+  TF_ASSERT_OK(NodeDefBuilder("myop", "ResourceStridedSliceAssign")
+                   .Input(FakeInput(DT_RESOURCE))
+                   .Input(FakeInput(DT_INT32))
+                   .Input(FakeInput(DT_INT32))
+                   .Input(FakeInput(DT_INT32))
+                   .Input(FakeInput(DT_FLOAT))
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  Var* var = new Var(DT_FLOAT);
+  *var->tensor() = Tensor(DT_FLOAT, TensorShape({5, 3}));
+  var->tensor()->flat<float>().setZero();
+  var->is_initialized = true;
+  // Starts tracking the dirty rows, for the next delta.
+  std::vector<int64_t> rows;
+  bool all_rows;
+  var->TakeDirtyRows(&rows, &all_rows);
+  AddResourceInput("", "var", var);
+  AddInputFromArray<int32>(TensorShape({2}), {1, 0});
+  AddInputFromArray<int32>(TensorShape({2}), {3, 3});
+  AddInputFromArray<int32>(TensorShape({2}), {1, 1});
+  AddInputFromArray<float>(TensorShape({2, 3}), {1, 2, 3, 4, 5, 6});
+  TF_ASSERT_OK(RunOpKernel());
+
+  var->TakeDirtyRows(&rows, &all_rows);
+  EXPECT_TRUE(all_rows);
+  EXPECT_EQ(var->tensor()->matrix<float>()(2, 2), 6);
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -20,8 +20,11 @@ limitations under the License.
 #include "tensorflow/core/kernels/topk_op.h"
 
 #include <algorithm>
+#include <cstring>
 #include <numeric>
+#include <type_traits>
 #include <vector>
+
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -29,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/gtl/top_n.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/util/work_sharder.h"
 
 namespace tensorflow {
@@ -107,6 +111,301 @@ class TopK : public OpKernel {
   bool sorted_;
 };
 
+namespace {
+
+// Rows with at least this many columns are split across threads when there are
+// fewer rows than threads.
+constexpr int64_t kTopKWideRowMinCols = 128 * 1024;
+// Minimum number of columns per thread when splitting a row.
+constexpr int64_t kTopKMinColsPerSegment = 16 * 1024;
+// A row (or a part of it) is searched with a heap of k elements when it has at
+// least this many columns per element of k. Otherwise the top k elements are
+// selected without maintaining their order.
+constexpr int64_t kTopKHeapMinColsPerK = 16;
+// Number of consecutive columns that the heap search compares against the
+// smallest element of the heap at once.
+constexpr int64_t kTopKFilterBlockSize = 64;
+
+template <int kBytes>
+struct TopKUnsigned;
+template <>
+struct TopKUnsigned<1> {
+  typedef uint8 type;
+};
+template <>
+struct TopKUnsigned<2> {
+  typedef uint16 type;
+};
+template <>
+struct TopKUnsigned<4> {
+  typedef uint32 type;
+};
+template <>
+struct TopKUnsigned<8> {
+  typedef uint64 type;
+};
+
+// Maps values to unsigned keys with the same order, so that values can be
+// compared with integer instructions and selected by radix. -0.0 and 0.0 have
+// the same key, and every NaN has the largest key, above infinity.
+template <typename T>
+struct TopKKey {
+  typedef typename TopKUnsigned<sizeof(T)>::type Key;
+  static constexpr Key kSignBit =
+      static_cast<Key>(Key{1} << (8 * sizeof(T) - 1));
+
+  static EIGEN_ALWAYS_INLINE Key Of(const T& value) {
+    Key bits;
+    std::memcpy(&bits, &value, sizeof(T));
+    if (std::is_integral<T>::value) {
+      return std::is_signed<T>::value ? static_cast<Key>(bits ^ kSignBit)
+                                      : bits;
+    }
+    const T infinity = Eigen::NumTraits<T>::infinity();
+    Key infinity_bits;
+    std::memcpy(&infinity_bits, &infinity, sizeof(T));
+    const Key magnitude = static_cast<Key>(bits & ~kSignBit);
+    if (magnitude > infinity_bits) return static_cast<Key>(~Key{0});
+    if (magnitude == 0) return kSignBit;
+    return (bits & kSignBit) ? static_cast<Key>(~bits)
+                             : static_cast<Key>(bits | kSignBit);
+  }
+};
+
+// Orders columns of a row by decreasing value, and equal values by increasing
+// column.
+template <typename T>
+struct TopKGreater {
+  explicit TopKGreater(const T* row) : row(row) {}
+
+  bool operator()(const int32 a, const int32 b) const {
+    const auto key_a = TopKKey<T>::Of(row[a]);
+    const auto key_b = TopKKey<T>::Of(row[b]);
+    return key_a > key_b || (key_a == key_b && a < b);
+  }
+
+  const T* row;
+};
+
+// Moves the top `k` of the columns in `[begin, end)` of `row` to the front of
+// the range and copies them to `indices`, in decreasing order if `sorted`, and
+// in increasing column order otherwise.
+template <typename T>
+void SelectTopK(const T* row, int32* begin, int32* end, int k, bool sorted,
+                int32* indices) {
+  const TopKGreater<T> greater(row);
+  if (end - begin > k) std::nth_element(begin, begin + k, end, greater);
+  if (sorted) {
+    std::sort(begin, begin + k, greater);
+  } else {
+    std::sort(begin, begin + k);
+  }
+  std::copy(begin, begin + k, indices);
+}
+
+// Appends the top `k` columns in `[begin, end)` of `row` to `top_k`, in no
+// particular order. Blocks of columns none of which exceeds the smallest of the
+// current top k are skipped after a vectorizable scan of their keys.
+template <typename T>
+void HeapTopK(const T* row, int64_t begin, int64_t end, int k,
+              std::vector<int32>* top_k) {
+  typedef typename TopKKey<T>::Key Key;
+  const TopKGreater<T> greater(row);
+  // A heap whose front is the smallest of the elements seen so far.
+  std::vector<int32> heap;
+  heap.reserve(k);
+  for (int64_t block = begin; block < end; block += kTopKFilterBlockSize) {
+    const int64_t block_end = std::min(end, block + kTopKFilterBlockSize);
+    if (heap.size() == static_cast<size_t>(k)) {
+      const Key threshold = TopKKey<T>::Of(row[heap.front()]);
+      Key block_max = 0;
+      for (int64_t c = block; c < block_end; ++c) {
+        block_max = std::max(block_max, TopKKey<T>::Of(row[c]));
+      }
+      // Equal values rank below the heap elements, which have lower columns.
+      if (block_max <= threshold) continue;
+    }
+    for (int64_t c = block; c < block_end; ++c) {
+      if (heap.size() < static_cast<size_t>(k)) {
+        heap.push_back(c);
+        std::push_heap(heap.begin(), heap.end(), greater);
+      } else if (greater(c, heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), greater);
+        heap.back() = c;
+        std::push_heap(heap.begin(), heap.end(), greater);
+      }
+    }
+  }
+  top_k->insert(top_k->end(), heap.begin(), heap.end());
+}
+
+// Sorts `data[0, n)` by `comp` on up to `num_chunks` threads: chunks are sorted
+// in parallel and then merged pairwise.
+template <typename Comp>
+void ParallelSort(thread::ThreadPool* workers, int num_chunks, int32* data,
+                  int64_t n, Comp comp) {
+  if (num_chunks <= 1 || n < 2 * kTopKMinColsPerSegment) {
+    std::sort(data, data + n, comp);
+    return;
+  }
+  const int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+  workers->ParallelFor(num_chunks, chunk_size * 64,
+                       [&](int64_t begin_chunk, int64_t end_chunk) {
+                         for (int64_t c = begin_chunk; c < end_chunk; ++c) {
+                           const int64_t lo = std::min(n, c * chunk_size);
+                           const int64_t hi = std::min(n, lo + chunk_size);
+                           std::sort(data + lo, data + hi, comp);
+                         }
+                       });
+  std::vector<int32> buffer(n);
+  int32* src = data;
+  int32* dst = buffer.data();
+  for (int64_t width = chunk_size; width < n; width *= 2) {
+    const int64_t num_merges = (n + 2 * width - 1) / (2 * width);
+    workers->ParallelFor(
+        num_merges, 2 * width * 8, [&](int64_t begin_merge, int64_t end_merge) {
+          for (int64_t m = begin_merge; m < end_merge; ++m) {
+            const int64_t lo = m * 2 * width;
+            const int64_t mid = std::min(n, lo + width);
+            const int64_t hi = std::min(n, lo + 2 * width);
+            std::merge(src + lo, src + mid, src + mid, src + hi, dst + lo,
+                       comp);
+          }
+        });
+    std::swap(src, dst);
+  }
+  if (src != data) std::copy(src, src + n, data);
+}
+
+// Computes the top `k` columns of a single wide `row` on `num_segments`
+// threads of `workers` and stores them in `indices`, in decreasing order if
+// `sorted`, and in no particular order otherwise.
+//
+// For small k every thread keeps a heap of the top k of its columns and the
+// candidates are merged. For large k the k-th largest key is found by radix
+// selection, one byte per pass, with per-thread histograms, and the columns
+// above it (plus as many equal ones as needed, lowest columns first) are
+// gathered in parallel.
+template <typename T>
+void WideRowTopK(thread::ThreadPool* workers, int num_segments, const T* row,
+                 int64_t num_cols, int k, bool sorted, int32* indices) {
+  typedef typename TopKKey<T>::Key Key;
+  const int64_t segment_size = (num_cols + num_segments - 1) / num_segments;
+  auto for_each_segment = [&](const std::function<void(int, int64_t, int64_t)>&
+                                  fn) {
+    workers->ParallelFor(num_segments, segment_size * 16,
+                         [&](int64_t begin_segment, int64_t end_segment) {
+                           for (int64_t s = begin_segment; s < end_segment;
+                                ++s) {
+                             const int64_t begin =
+                                 std::min(num_cols, s * segment_size);
+                             fn(s, begin,
+                                std::min(num_cols, begin + segment_size));
+                           }
+                         });
+  };
+
+  if (k * kTopKHeapMinColsPerK <= segment_size) {
+    std::vector<std::vector<int32>> top_k(num_segments);
+    for_each_segment([&](int s, int64_t begin, int64_t end) {
+      HeapTopK(row, begin, end, k, &top_k[s]);
+    });
+    std::vector<int32> candidates;
+    candidates.reserve(num_segments * k);
+    for (const auto& segment_top_k : top_k) {
+      candidates.insert(candidates.end(), segment_top_k.begin(),
+                        segment_top_k.end());
+    }
+    SelectTopK(row, candidates.data(), candidates.data() + candidates.size(), k,
+               sorted, indices);
+    return;
+  }
+
+  // Radix selection of the key of the k-th largest column. `remaining` is the
+  // number of columns still to select among those whose key starts with
+  // `prefix`.
+  constexpr int kRadixBits = 8;
+  constexpr int kNumBuckets = 1 << kRadixBits;
+  std::vector<int64_t> histograms(num_segments * kNumBuckets);
+  Key prefix = 0;
+  Key prefix_mask = 0;
+  int64_t remaining = k;
+  for (int shift = 8 * sizeof(Key) - kRadixBits; shift >= 0;
+       shift -= kRadixBits) {
+    for_each_segment([&](int s, int64_t begin, int64_t end) {
+      int64_t* histogram = &histograms[s * kNumBuckets];
+      std::fill_n(histogram, kNumBuckets, 0);
+      for (int64_t c = begin; c < end; ++c) {
+        const Key key = TopKKey<T>::Of(row[c]);
+        if ((key & prefix_mask) == prefix) {
+          ++histogram[(key >> shift) & (kNumBuckets - 1)];
+        }
+      }
+    });
+    int bucket = kNumBuckets - 1;
+    for (;; --bucket) {
+      int64_t count = 0;
+      for (int s = 0; s < num_segments; ++s) {
+        count += histograms[s * kNumBuckets + bucket];
+      }
+      if (count >= remaining || bucket == 0) break;
+      remaining -= count;
+    }
+    prefix |= static_cast<Key>(static_cast<Key>(bucket) << shift);
+    prefix_mask |= static_cast<Key>(static_cast<Key>(kNumBuckets - 1) << shift);
+  }
+  const Key kth_key = prefix;
+
+  // Gather the columns with larger keys, followed by the first `remaining`
+  // columns with the k-th key. Both are in increasing column order.
+  std::vector<int64_t> num_greater(num_segments);
+  std::vector<int64_t> num_equal(num_segments);
+  for_each_segment([&](int s, int64_t begin, int64_t end) {
+    int64_t greater = 0;
+    int64_t equal = 0;
+    for (int64_t c = begin; c < end; ++c) {
+      const Key key = TopKKey<T>::Of(row[c]);
+      greater += key > kth_key;
+      equal += key == kth_key;
+    }
+    num_greater[s] = greater;
+    num_equal[s] = equal;
+  });
+  const int64_t total_greater = k - remaining;
+  std::vector<int64_t> greater_offsets(num_segments);
+  std::vector<int64_t> equal_offsets(num_segments);
+  int64_t greater_offset = 0;
+  int64_t equal_offset = total_greater;
+  for (int s = 0; s < num_segments; ++s) {
+    greater_offsets[s] = greater_offset;
+    greater_offset += num_greater[s];
+    equal_offsets[s] = equal_offset;
+    num_equal[s] = std::min(num_equal[s], k - equal_offset);
+    equal_offset += num_equal[s];
+  }
+  DCHECK_EQ(greater_offset, total_greater);
+  DCHECK_EQ(equal_offset, k);
+  for_each_segment([&](int s, int64_t begin, int64_t end) {
+    int32* greater_out = indices + greater_offsets[s];
+    int32* equal_out = indices + equal_offsets[s];
+    int64_t equal_left = num_equal[s];
+    for (int64_t c = begin; c < end; ++c) {
+      const Key key = TopKKey<T>::Of(row[c]);
+      if (key > kth_key) {
+        *greater_out++ = c;
+      } else if (key == kth_key && equal_left > 0) {
+        *equal_out++ = c;
+        --equal_left;
+      }
+    }
+  });
+  if (sorted) {
+    ParallelSort(workers, num_segments, indices, k, TopKGreater<T>(row));
+  }
+}
+
+}  // namespace
+
 namespace functor {
 
 template <typename T>
@@ -141,52 +440,51 @@ struct TopKFunctor<CPUDevice, T> {
       return Status::OK();
     }
 
+    auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
+
+    // Too few rows to keep all threads busy: split each row across threads.
+    if (num_cols >= kTopKWideRowMinCols &&
+        num_rows < worker_threads.num_threads && k < num_cols) {
+      const int num_segments = static_cast<int>(
+          std::min<int64_t>(worker_threads.num_threads,
+                            num_cols / kTopKMinColsPerSegment));
+      for (int64_t b = 0; b < num_rows; ++b) {
+        WideRowTopK(worker_threads.workers, num_segments, &input(b, 0),
+                    num_cols, k, sorted, &indices(b, 0));
+        std::transform(
+            &indices(b, 0), &indices(b, k), &values(b, 0),
+            [b, &input](const int32_t loc) { return input(b, loc); });
+      }
+      return Status::OK();
+    }
+
     auto SortIndices = [&](int64_t start_batch, int64_t limit_batch) {
+      // Column indices of a row, for selecting large k.
+      std::vector<int32> scratch;
       for (int32_t b = start_batch; b < limit_batch; ++b) {
         const T* input_data = &input(b, 0);
-        const auto stable_comp = [input_data](const int32_t a,
-                                              const int32_t b) {
-          if (input_data[b] < input_data[a]) {
-            return true;
-          } else if (input_data[b] > input_data[a]) {
-            return false;
-          } else {
-            return a < b;
-          }
-        };
-        const auto comp = [input_data](const int32_t a, const int32_t b) {
-          return input_data[b] < input_data[a];
-        };
-        // TODO(ebrevdo): For large k < num_cols, instead of using
-        // TopN, it may be faster to create a temporary vector of
-        // values 0..num_cols - 1 and then use std::partial_sort_copy
-        // of this into indices. Choosing the appropriate minimum k or
-        // ratio of k/num_cols will require some experimentation.
+        // Every path orders the columns by TopKGreater, so signed zeros and
+        // NaNs rank the same whatever the shape of the input.
+        const TopKGreater<T> stable_comp(input_data);
         if (k == num_cols) {
           auto* begin = &indices(b, 0);
           auto* end = &indices(b, k);
           // Set the initial array of indices 0 ... k - 1.
           std::iota(begin, end, 0);
-          // We want an in-place sort, but we can cheat because we're sorting
-          // indices that started out sorted.  First, do a std::sort, which
-          // is notably faster than std::stable_sort.
-          std::sort(begin, end, comp);
-          // Then, for runs of adjacent elements that were equal, sort the
-          // indices in those runs in increasing order.
-          for (auto* run_begin = begin; run_begin != end;) {
-            auto* run_end = run_begin + 1;
-            if (run_end == end) break;
-            if (input_data[*run_begin] == input_data[*run_end]) {
-              while (++run_end != end) {
-                if (input_data[*run_begin] != input_data[*run_end]) break;
-              }
-              std::sort(run_begin, run_end);
-            }
-            run_begin = run_end;
-          }
+          // Equal values are ordered by increasing column, so std::sort is
+          // stable here.
+          std::sort(begin, end, stable_comp);
+        } else if (k * kTopKHeapMinColsPerK > num_cols) {
+          // For large k < num_cols, selecting the top k in linear time and
+          // sorting only those is cheaper than pushing every column through
+          // a heap of k elements.
+          scratch.resize(num_cols);
+          std::iota(scratch.begin(), scratch.end(), 0);
+          SelectTopK(input_data, scratch.data(), scratch.data() + num_cols, k,
+                     sorted, &indices(b, 0));
         } else {
           // Use the TopN heap object to sort.
-          gtl::TopN<int32, decltype(stable_comp)> filter(k, stable_comp);
+          gtl::TopN<int32, TopKGreater<T>> filter(k, stable_comp);
           filter.reserve(num_cols);
           for (int32_t c = 0; c < num_cols; ++c) {
             filter.push(c);
@@ -228,7 +526,6 @@ struct TopKFunctor<CPUDevice, T> {
     const int64_t final_cost = (total_cost >= static_cast<double>(kint64max))
                                    ? kint64max
                                    : static_cast<int64_t>(total_cost);
-    auto worker_threads = *(context->device()->tensorflow_cpu_worker_threads());
     Shard(worker_threads.num_threads, worker_threads.workers, num_rows,
           final_cost, SortIndices);
 
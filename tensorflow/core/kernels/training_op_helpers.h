@@ -16,6 +16,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_TRAINING_OP_HELPERS_H_
 #define TENSORFLOW_CORE_KERNELS_TRAINING_OP_HELPERS_H_
 
+#include <initializer_list>
+#include <type_traits>
+
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/variant_op_registry.h"
@@ -188,6 +191,39 @@ VariableInputLockHolder MaybeLockVariableInputMutexesInOrder(
 void MaybeForwardRefInputToRefOutput(OpKernelContext* ctx, int input,
                                      int output);
 
+// Returns whether a sparse training op with the `use_locking` attribute locks
+// the variables exclusively, per the sparse update mode of the resource
+// variable passed as input `input` (see Var::SparseUpdateMode), and sets
+// `*row_mutexes` to the mutexes to update its rows under, or nullptr.  The row
+// mutexes are owned by the variable, which the locks of
+// MaybeLockVariableInputMutexesInOrder keep alive.  Only the CPU functors lock
+// rows, so the mode does not apply to the other devices.
+template <typename Device>
+bool UseExclusiveLockForSparseUpdate(OpKernelContext* ctx, int input,
+                                     bool use_locking,
+                                     RowMutexes** row_mutexes) {
+  *row_mutexes = nullptr;
+  if (!std::is_same<Device, Eigen::ThreadPoolDevice>::value ||
+      ctx->input_dtype(input) != DT_RESOURCE) {
+    return use_locking;
+  }
+  core::RefCountPtr<Var> var;
+  if (!LookupResource(ctx, HandleFromInput(ctx, input), &var).ok()) {
+    // GetInputTensorFromVariable reports the invalid reference.
+    return use_locking;
+  }
+  switch (var->sparse_update_mode()) {
+    case Var::SparseUpdateMode::kDefault:
+      return use_locking;
+    case Var::SparseUpdateMode::kRowLocks:
+      *row_mutexes = var->row_mutexes();
+      return false;
+    case Var::SparseUpdateMode::kLockFree:
+      return false;
+  }
+  return use_locking;
+}
+
 // This is for use with ResourceVariables to ensure *tensor has a
 // reference count of 1 before you update it.
 // REQUIRES: If you pass in variable->tensor(), *variable->mu() must be held.
@@ -245,6 +281,8 @@ Status GetInputTensorFromVariable(OpKernelContext* ctx, int input,
     }
     TF_RETURN_IF_ERROR(PrepareToUpdateVariable<Device, T>(
         ctx, var->tensor(), var->copy_on_read_mode.load()));
+    // Dense updates may change every row.
+    var->MarkAllRowsDirty();
     *out = *var->tensor();
     return Status::OK();
   }
@@ -252,6 +290,28 @@ Status GetInputTensorFromVariable(OpKernelContext* ctx, int input,
   return Status::OK();
 }
 
+// Records that the rows "indices" of the resource variables passed as input
+// indices "inputs" were updated, for the variables that track dirty rows (see
+// Var::TakeDirtyRows()).  Reference variables are not tracked.
+template <typename Device, typename Index>
+Status MarkVariableRowsDirty(OpKernelContext* ctx,
+                             std::initializer_list<int> inputs,
+                             const Tensor& indices) {
+  if (Var::NumTrackingDirtyRows() == 0) return Status::OK();
+  for (int input : inputs) {
+    if (ctx->input_dtype(input) != DT_RESOURCE) continue;
+    core::RefCountPtr<Var> var;
+    TF_RETURN_IF_ERROR(LookupResource(ctx, HandleFromInput(ctx, input), &var));
+    if (std::is_same<Device, Eigen::ThreadPoolDevice>::value) {
+      var->MarkRowsDirty(indices.flat<Index>().data(), indices.NumElements());
+    } else {
+      // The indices are in device memory.
+      var->MarkAllRowsDirty();
+    }
+  }
+  return Status::OK();
+}
+
 }  // end namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_KERNELS_TRAINING_OP_HELPERS_H_
@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/kernels/training_op_helpers.h"
+#include "tensorflow/core/kernels/training_ops_sparse_apply.h"
 #include "tensorflow/core/kernels/variable_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/platform/bfloat16.h"
@@ -170,7 +171,8 @@ struct SparseApplyAdagrad<CPUDevice, T, Tindex, has_epsilon> {
                     typename TTypes<T>::ConstScalar epsilon,
                     typename TTypes<T>::ConstMatrix grad,
                     typename TTypes<Tindex>::ConstVec indices,
-                    int64_t inner_dim, bool update_slots) {
+                    int64_t inner_dim, bool update_slots,
+                    RowMutexes* row_mutexes) {
     const Tindex N = static_cast<Tindex>(indices.dimension(0));
     if (N == 0) return Status::OK();
     const Tindex first_dim_size = static_cast<Tindex>(var.dimension(0));
@@ -182,46 +184,26 @@ struct SparseApplyAdagrad<CPUDevice, T, Tindex, has_epsilon> {
     const Eigen::TensorOpCost cost(in_bytes, out_bytes, cycles);
 
     if (inner_dim > 1) {
-      for (Tindex i = 0; i < N; ++i) {
-        const Tindex index = internal::SubtleMustCopy(indices(i));
-        if (!FastBoundsCheck(index, first_dim_size)) {
-          return errors::InvalidArgument(
-              strings::StrCat("Index ", index, " at offset ", i,
-                              " in indices is out of range"));
-        }
-      }
-
-      const auto shard = [&](Tindex start_idx, Tindex end_idx) -> void {
-        for (Tindex i = start_idx; i < end_idx; ++i) {
-          const Tindex index = internal::SubtleMustCopy(indices(i));
-          auto a = accum.template chip<0>(index);
-          auto g = grad.template chip<0>(i);
-          auto v = var.template chip<0>(index);
-          if (update_slots) {
-            a += g.square();
-          }
-          if (has_epsilon) {
-            v -= g.constant(lr_scalar) * g / (a.sqrt() + a.constant(epsilon()));
-          } else {
-            v -= g.constant(lr_scalar) * g * a.rsqrt();
-          }
-        }
-      };
-
-      d.parallelFor(N, cost, shard);
-    } else {
-      for (Tindex i = 0; i < N; ++i) {
-        const Tindex index = internal::SubtleMustCopy(indices(i));
-        if (!FastBoundsCheck(index, first_dim_size)) {
-          return errors::InvalidArgument(
-              strings::StrCat("Index ", index, " at offset ", i,
-                              " in indices is out of range"));
-        }
-      }
-
-      const auto shard = [&](Tindex start_idx, Tindex end_idx) -> void {
-        for (Tindex i = start_idx; i < end_idx; ++i) {
-          const Tindex index = internal::SubtleMustCopy(indices(i));
+      return ApplySparseRowUpdates<Tindex>(
+          d, indices, first_dim_size, cost, row_mutexes,
+          [&](Tindex i, Tindex index) {
+            auto a = accum.template chip<0>(index);
+            auto g = grad.template chip<0>(i);
+            auto v = var.template chip<0>(index);
+            if (update_slots) {
+              a += g.square();
+            }
+            if (has_epsilon) {
+              v -= g.constant(lr_scalar) * g /
+                   (a.sqrt() + a.constant(epsilon()));
+            } else {
+              v -= g.constant(lr_scalar) * g * a.rsqrt();
+            }
+          });
+    }
+    return ApplySparseRowUpdates<Tindex>(
+        d, indices, first_dim_size, cost, row_mutexes,
+        [&](Tindex i, Tindex index) {
           T& a = accum(index);
           const T& g = grad(i);
           if (update_slots) {
@@ -232,13 +214,7 @@ struct SparseApplyAdagrad<CPUDevice, T, Tindex, has_epsilon> {
           } else {
             var(index) -= lr_scalar * g / Eigen::numext::sqrt(a);
           }
-        }
-      };
-
-      d.parallelFor(N, cost, shard);
-    }
-
-    return Status::OK();
+        });
   }
 };
 
@@ -597,62 +573,59 @@ struct SparseApplyFtrl<CPUDevice, T, Tindex, has_l2_shrinkage> {
                     typename TTypes<T>::ConstScalar lr_power,
                     typename TTypes<T>::ConstMatrix grad_flat,
                     typename TTypes<Tindex>::ConstVec indices_vec,
-                    int64_t inner_dim, bool multiply_linear_by_lr) {
+                    int64_t inner_dim, bool multiply_linear_by_lr,
+                    RowMutexes* row_mutexes) {
     const Tindex N = static_cast<Tindex>(indices_vec.dimension(0));
-    if (N > 0) {
-      T lr_scalar = lr();
-      T l1_scalar = l1();
-      T l2_scalar = l2();
-      T l2_shrinkage_scalar;
-      if (has_l2_shrinkage) {
-        l2_shrinkage_scalar = l2_shrinkage();
-      }
-      T lr_power_scalar = lr_power();
-      if (inner_dim > 1) {
-        const Tindex first_dim_size =
-            static_cast<Tindex>(var_flat.dimension(0));
-
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          if (!FastBoundsCheck(index, first_dim_size)) {
-            return errors::InvalidArgument(
-                strings::StrCat("Index ", index, " at offset ", i,
-                                " in indices is out of range"));
-          }
-          auto accum = accum_flat.template chip<0>(index);
-          auto linear = linear_flat.template chip<0>(index);
-          auto grad = grad_flat.template chip<0>(i);
-          auto var = var_flat.template chip<0>(index);
-
-          if (has_l2_shrinkage) {
-            auto grad_with_shrinkage =
-                grad + static_cast<T>(2) * l2_shrinkage_scalar * var;
-            ComputeFtrl(/*grad=*/grad,
-                        /*grad_maybe_with_shrinkage=*/grad_with_shrinkage,
-                        /*accum=*/accum, /*linear=*/linear, /*var=*/var,
-                        /*l1_scalar=*/l1_scalar, /*l2_scalar=*/l2_scalar,
-                        /*multiply_linear_by_lr=*/multiply_linear_by_lr,
-                        /*lr_power_scalar=*/lr_power_scalar,
-                        /*lr_scalar=*/lr_scalar);
-          } else {
-            ComputeFtrl(/*grad=*/grad, /*grad_maybe_with_shrinkage=*/grad,
-                        /*accum=*/accum, /*linear=*/linear, /*var=*/var,
-                        /*l1_scalar=*/l1_scalar, /*l2_scalar=*/l2_scalar,
-                        /*multiply_linear_by_lr=*/multiply_linear_by_lr,
-                        /*lr_power_scalar=*/lr_power_scalar,
-                        /*lr_scalar=*/lr_scalar);
-          }
-        }
-      } else {
-        const Tindex first_dim_size = accum_flat.size();
+    if (N == 0) return Status::OK();
+    const T lr_scalar = lr();
+    const T l1_scalar = l1();
+    const T l2_scalar = l2();
+    T l2_shrinkage_scalar;
+    if (has_l2_shrinkage) {
+      l2_shrinkage_scalar = l2_shrinkage();
+    }
+    const T lr_power_scalar = lr_power();
+    const int bytes = inner_dim * sizeof(T) * 4;
+    const int cycles = inner_dim * (Eigen::TensorOpCost::AddCost<T>() * 8 +
+                                    Eigen::TensorOpCost::MulCost<T>() * 6 +
+                                    Eigen::TensorOpCost::DivCost<T>() * 2);
+    const Eigen::TensorOpCost cost(bytes, bytes - inner_dim * sizeof(T),
+                                   cycles);
 
-        for (Tindex i = 0; i < N; i++) {
-          const Tindex index = internal::SubtleMustCopy(indices_vec(i));
-          if (!FastBoundsCheck(index, first_dim_size)) {
-            return errors::InvalidArgument(
-                strings::StrCat("Index ", index, " at offset ", i,
-                                " in indices is out of range"));
-          }
+    if (inner_dim > 1) {
+      const Tindex first_dim_size = static_cast<Tindex>(var_flat.dimension(0));
+      return ApplySparseRowUpdates<Tindex>(
+          d, indices_vec, first_dim_size, cost, row_mutexes,
+          [&](Tindex i, Tindex index) {
+            auto accum = accum_flat.template chip<0>(index);
+            auto linear = linear_flat.template chip<0>(index);
+            auto grad = grad_flat.template chip<0>(i);
+            auto var = var_flat.template chip<0>(index);
+
+            if (has_l2_shrinkage) {
+              auto grad_with_shrinkage =
+                  grad + static_cast<T>(2) * l2_shrinkage_scalar * var;
+              ComputeFtrl(/*grad=*/grad,
+                          /*grad_maybe_with_shrinkage=*/grad_with_shrinkage,
+                          /*accum=*/accum, /*linear=*/linear, /*var=*/var,
+                          /*l1_scalar=*/l1_scalar, /*l2_scalar=*/l2_scalar,
+                          /*multiply_linear_by_lr=*/multiply_linear_by_lr,
+                          /*lr_power_scalar=*/lr_power_scalar,
+                          /*lr_scalar=*/lr_scalar);
+            } else {
+              ComputeFtrl(/*grad=*/grad, /*grad_maybe_with_shrinkage=*/grad,
+                          /*accum=*/accum, /*linear=*/linear, /*var=*/var,
+                          /*l1_scalar=*/l1_scalar, /*l2_scalar=*/l2_scalar,
+                          /*multiply_linear_by_lr=*/multiply_linear_by_lr,
+                          /*lr_power_scalar=*/lr_power_scalar,
+                          /*lr_scalar=*/lr_scalar);
+            }
+          });
+    }
+    const Tindex first_dim_size = accum_flat.size();
+    return ApplySparseRowUpdates<Tindex>(
+        d, indices_vec, first_dim_size, cost, row_mutexes,
+        [&](Tindex i, Tindex index) {
           T& a = accum_flat(index);
           T& l = linear_flat(index);
           T& v = var_flat(index);
@@ -676,10 +649,7 @@ struct SparseApplyFtrl<CPUDevice, T, Tindex, has_l2_shrinkage> {
                           lr_power_scalar, multiply_linear_by_lr);
           a = updated_a;
           l = updated_l;
-        }
-      }
-    }
-    return Status::OK();
+        });
   }
 };
 
@@ -1285,6 +1255,8 @@ class SparseApplyAdadeltaOp : public OpKernel {
           epsilon.scalar<T>(), grad.flat_outer_dims<T>(), indices_vec);
     }
 
+    OP_REQUIRES_OK(ctx, (MarkVariableRowsDirty<Device, Tindex>(
+                            ctx, {0, 1, 2}, indices)));
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -1544,6 +1516,8 @@ class SparseApplyProximalGradientDescentOp : public OpKernel {
       }
     }
 
+    OP_REQUIRES_OK(ctx, (MarkVariableRowsDirty<CPUDevice, Tindex>(
+                            ctx, {0}, indices)));
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -1888,14 +1862,17 @@ class SparseApplyAdagradOp : public OpKernel {
 
   void Compute(OpKernelContext* ctx) override TF_NO_THREAD_SAFETY_ANALYSIS {
     const bool sparse = true;
+    RowMutexes* row_mutexes;
+    const bool use_exclusive_lock = UseExclusiveLockForSparseUpdate<Device>(
+        ctx, 0, use_exclusive_lock_, &row_mutexes);
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
-        ctx, use_exclusive_lock_, sparse, {0, 1});
+        ctx, use_exclusive_lock, sparse, {0, 1});
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
-                            ctx, 0, use_exclusive_lock_, sparse, &var));
+                            ctx, 0, use_exclusive_lock, sparse, &var));
     Tensor accum;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
-                            ctx, 1, use_exclusive_lock_, sparse, &accum));
+                            ctx, 1, use_exclusive_lock, sparse, &accum));
     OP_REQUIRES(
         ctx, var.IsInitialized(),
         errors::FailedPrecondition(
@@ -1945,8 +1922,11 @@ class SparseApplyAdagradOp : public OpKernel {
                  device, var.flat_outer_dims<T>(), accum.flat_outer_dims<T>(),
                  // Note: Passing lr as a placeholder for unused epsilon.
                  lr.scalar<T>(), lr.scalar<T>(), grad.flat_outer_dims<T>(),
-                 indices.vec<Tindex>(), inner_dim, update_slots_));
+                 indices.vec<Tindex>(), inner_dim, update_slots_,
+                 row_mutexes));
 
+    OP_REQUIRES_OK(ctx, (MarkVariableRowsDirty<Device, Tindex>(
+                            ctx, {0, 1}, indices)));
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -1987,7 +1967,7 @@ namespace functor {
       typename TTypes<T>::ConstScalar epsilon,                                 \
       typename TTypes<T>::ConstMatrix grad,                                    \
       typename TTypes<Tindex>::ConstVec indices, int64_t inner_dim,            \
-      bool update_slots);                                                      \
+      bool update_slots, RowMutexes* row_mutexes);                             \
   extern template struct SparseApplyAdagrad<GPUDevice, T, Tindex,              \
                                             /*has_epsilon=*/false>;
 DECLARE_GPU_SPEC(Eigen::half, int32);
@@ -2018,14 +1998,17 @@ class SparseApplyAdagradV2Op : public OpKernel {
 
   void Compute(OpKernelContext* ctx) override TF_NO_THREAD_SAFETY_ANALYSIS {
     const bool sparse = true;
+    RowMutexes* row_mutexes;
+    const bool use_exclusive_lock = UseExclusiveLockForSparseUpdate<Device>(
+        ctx, 0, use_exclusive_lock_, &row_mutexes);
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
-        ctx, use_exclusive_lock_, sparse, {0, 1});
+        ctx, use_exclusive_lock, sparse, {0, 1});
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
-                            ctx, 0, use_exclusive_lock_, sparse, &var));
+                            ctx, 0, use_exclusive_lock, sparse, &var));
     Tensor accum;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
-                            ctx, 1, use_exclusive_lock_, sparse, &accum));
+                            ctx, 1, use_exclusive_lock, sparse, &accum));
     OP_REQUIRES(
         ctx, var.IsInitialized(),
         errors::FailedPrecondition(
@@ -2078,8 +2061,11 @@ class SparseApplyAdagradV2Op : public OpKernel {
                                          /*has_epsilon = */ true>()(
                  device, var.flat_outer_dims<T>(), accum.flat_outer_dims<T>(),
                  lr.scalar<T>(), epsilon.scalar<T>(), grad.flat_outer_dims<T>(),
-                 indices.vec<Tindex>(), inner_dim, update_slots_));
+                 indices.vec<Tindex>(), inner_dim, update_slots_,
+                 row_mutexes));
 
+    OP_REQUIRES_OK(ctx, (MarkVariableRowsDirty<Device, Tindex>(
+                            ctx, {0, 1}, indices)));
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -2120,7 +2106,7 @@ namespace functor {
       typename TTypes<T>::ConstScalar epsilon,                                \
       typename TTypes<T>::ConstMatrix grad,                                   \
       typename TTypes<Tindex>::ConstVec indices, int64_t inner_dim,           \
-      bool update_slots);                                                     \
+      bool update_slots, RowMutexes* row_mutexes);                            \
   extern template struct SparseApplyAdagrad<GPUDevice, T, Tindex,             \
                                             /*has_epsilon=*/true>;
 DECLARE_GPU_SPEC(Eigen::half, int32);
@@ -2228,6 +2214,8 @@ class SparseApplyProximalAdagradOp : public OpKernel {
                  lr.scalar<T>(), l1.scalar<T>(), l2.scalar<T>(),
                  grad.flat_outer_dims<T>(), indices.vec<Tindex>(), inner_dim));
 
+    OP_REQUIRES_OK(ctx, (MarkVariableRowsDirty<Device, Tindex>(
+                            ctx, {0, 1}, indices)));
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -2557,6 +2545,8 @@ class SparseApplyAdagradDAOp : public OpKernel {
       }
     }
 
+    OP_REQUIRES_OK(ctx, (MarkVariableRowsDirty<CPUDevice, Tindex>(
+                            ctx, {0, 1, 2}, indices)));
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -2806,17 +2796,20 @@ class SparseApplyFtrlOp : public OpKernel {
 
   void Compute(OpKernelContext* ctx) override TF_NO_THREAD_SAFETY_ANALYSIS {
     const bool sparse = true;
+    RowMutexes* row_mutexes;
+    const bool use_exclusive_lock = UseExclusiveLockForSparseUpdate<Device>(
+        ctx, 0, use_exclusive_lock_, &row_mutexes);
     auto locks = MaybeLockVariableInputMutexesInOrder<Device, T>(
-        ctx, use_exclusive_lock_, sparse, {0, 1, 2});
+        ctx, use_exclusive_lock, sparse, {0, 1, 2});
     Tensor var;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
-                            ctx, 0, use_exclusive_lock_, sparse, &var));
+                            ctx, 0, use_exclusive_lock, sparse, &var));
     Tensor accum;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
-                            ctx, 1, use_exclusive_lock_, sparse, &accum));
+                            ctx, 1, use_exclusive_lock, sparse, &accum));
     Tensor linear;
     OP_REQUIRES_OK(ctx, GetInputTensorFromVariable<Device, T>(
-                            ctx, 2, use_exclusive_lock_, sparse, &linear));
+                            ctx, 2, use_exclusive_lock, sparse, &linear));
     OP_REQUIRES(
         ctx, var.IsInitialized(),
         errors::FailedPrecondition(
@@ -2928,8 +2921,10 @@ class SparseApplyFtrlOp : public OpKernel {
                  // (it will not be used).
                  has_l2_shrinkage ? l2_shrinkage->scalar<T>() : l2.scalar<T>(),
                  lr_power.scalar<T>(), grad.flat_outer_dims<T>(), indices_vec,
-                 inner_dim, multiply_linear_by_lr_));
+                 inner_dim, multiply_linear_by_lr_, row_mutexes));
 
+    OP_REQUIRES_OK(ctx, (MarkVariableRowsDirty<Device, Tindex>(
+                            ctx, {0, 1, 2}, indices)));
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -2977,7 +2972,7 @@ namespace functor {
       typename TTypes<T>::ConstScalar lr_power,                               \
       typename TTypes<T>::ConstMatrix grad,                                   \
       typename TTypes<Tindex>::ConstVec indices, int64_t inner_dim,           \
-      bool multiply_linear_by_lr);                                            \
+      bool multiply_linear_by_lr, RowMutexes* row_mutexes);                   \
   extern template struct SparseApplyFtrl<GPUDevice, T, Tindex,                \
                                          /*has_l2_shrinkage=*/false>;
 DECLARE_GPU_SPEC(Eigen::half, int32);
@@ -3037,7 +3032,7 @@ namespace functor {
       typename TTypes<T>::ConstScalar lr_power,                               \
       typename TTypes<T>::ConstMatrix grad,                                   \
       typename TTypes<Tindex>::ConstVec indices, int64_t inner_dim,           \
-      bool multiply_linear_by_lr);                                            \
+      bool multiply_linear_by_lr, RowMutexes* row_mutexes);                   \
   extern template struct SparseApplyFtrl<GPUDevice, T, Tindex,                \
                                          /*has_l2_shrinkage=*/true>;
 DECLARE_GPU_SPEC(Eigen::half, int32);
@@ -3250,6 +3245,8 @@ class SparseApplyMomentumOp : public OpKernel {
       }
     }
 
+    OP_REQUIRES_OK(ctx, (MarkVariableRowsDirty<CPUDevice, Tindex>(
+                            ctx, {0, 1}, indices)));
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -3453,6 +3450,8 @@ class SparseApplyKerasMomentumOp : public OpKernel {
             "indices", SliceDebugString(indices.shape(), bad_i), " = ",
             indices_flat(bad_i), " is not in [0, ", var.dim_size(0), ")"));
 
+    OP_REQUIRES_OK(ctx, (MarkVariableRowsDirty<Device, Tindex>(
+                            ctx, {0, 1}, indices)));
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -4291,6 +4290,8 @@ class SparseApplyRMSPropOp : public OpKernel {
       }
     }
 
+    OP_REQUIRES_OK(ctx, (MarkVariableRowsDirty<CPUDevice, Tindex>(
+                            ctx, {0, 1, 2}, indices)));
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
@@ -4433,6 +4434,8 @@ class SparseApplyCenteredRMSPropOp : public OpKernel {
       }
     }
 
+    OP_REQUIRES_OK(ctx, (MarkVariableRowsDirty<CPUDevice, Tindex>(
+                            ctx, {0, 1, 2, 3}, indices)));
     MaybeForwardRefInputToRefOutput(ctx, 0, 0);
   }
 
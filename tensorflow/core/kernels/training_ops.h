@@ -22,6 +22,9 @@ limitations under the License.
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
+
+class RowMutexes;
+
 namespace functor {
 
 // Each training algorithm has a ApplyXYZ functor struct declared in
@@ -104,6 +107,9 @@ struct ApplyAdagradDA {
                   typename TTypes<T>::ConstFlat grad);
 };
 
+// The sparse functors update every row under the row mutex of the variable,
+// when "row_mutexes" is not null (see Var::SparseUpdateMode).  The GPU
+// functors ignore it.
 template <typename Device, typename T, typename Tindex, bool has_epsilon>
 struct SparseApplyAdagrad {
   // Note that epsilon is ignored if has_epsilon is false.
@@ -113,7 +119,8 @@ struct SparseApplyAdagrad {
                     typename TTypes<T>::ConstScalar epsilon,
                     typename TTypes<T>::ConstMatrix grad,
                     typename TTypes<Tindex>::ConstVec indices,
-                    int64_t inner_dim, bool update_slots);
+                    int64_t inner_dim, bool update_slots,
+                    RowMutexes* row_mutexes);
 };
 
 template <typename Device, typename T>
@@ -200,7 +207,8 @@ struct SparseApplyFtrl {
                     typename TTypes<T>::ConstScalar lr_power,
                     typename TTypes<T>::ConstMatrix grad_flat,
                     typename TTypes<Tindex>::ConstVec indices_vec,
-                    int64_t inner_dim, bool multiply_linear_by_lr);
+                    int64_t inner_dim, bool multiply_linear_by_lr,
+                    RowMutexes* row_mutexes);
 };
 
 template <typename Device, typename T>
@@ -0,0 +1,118 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_TRAINING_OPS_SPARSE_APPLY_H_
+#define TENSORFLOW_CORE_KERNELS_TRAINING_OPS_SPARSE_APPLY_H_
+
+// The engine of the sparse training ops on CPU.
+
+#define EIGEN_USE_THREADS
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
+#include "tensorflow/core/framework/bounds_check.h"
+#include "tensorflow/core/framework/resource_var.h"
+#include "tensorflow/core/framework/tensor_types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace functor {
+
+// Calls update_row(i, index) for every position i of "indices", with
+// index = indices(i), on the threads of "d".  "row_cost" is the cost of a
+// call.  Returns InvalidArgument, and updates nothing, if an index is not in
+// [0, first_dim_size).
+//
+// Small updates are applied sequentially.  Larger ones are deduplicated: the
+// positions are grouped by index, in order, and the groups are partitioned
+// across the threads.  So a row is updated by a single thread, in the order
+// of the positions, which keeps the result of duplicate indices deterministic
+// and the same as a sequential update.  With "row_mutexes", the updates of a
+// row are applied under its row mutex, which serializes them with the
+// concurrent updates of the row by other ops.
+template <typename Tindex, typename UpdateRow>
+Status ApplySparseRowUpdates(const Eigen::ThreadPoolDevice& d,
+                             typename TTypes<Tindex>::ConstVec indices,
+                             Tindex first_dim_size,
+                             const Eigen::TensorOpCost& row_cost,
+                             RowMutexes* row_mutexes, UpdateRow update_row) {
+  const Tindex N = static_cast<Tindex>(indices.dimension(0));
+  // (index, position) pairs, sorted by index then position when grouping.
+  std::vector<std::pair<Tindex, Tindex>> rows(N);
+  for (Tindex i = 0; i < N; ++i) {
+    const Tindex index = internal::SubtleMustCopy(indices(i));
+    if (!FastBoundsCheck(index, first_dim_size)) {
+      return errors::InvalidArgument(strings::StrCat(
+          "Index ", index, " at offset ", i, " in indices is out of range"));
+    }
+    rows[i] = {index, i};
+  }
+
+  // Updates too small to be worth a second thread are applied in order.
+  if (Eigen::TensorCostModel<Eigen::ThreadPoolDevice>::numThreads(
+          N, row_cost, d.numThreads()) <= 1) {
+    for (const auto& row : rows) {
+      if (row_mutexes == nullptr) {
+        update_row(row.second, row.first);
+      } else {
+        mutex_lock l(*row_mutexes->ForRow(row.first));
+        update_row(row.second, row.first);
+      }
+    }
+    return Status::OK();
+  }
+
+  std::sort(rows.begin(), rows.end());
+  // The group of index rows[group_starts[g]].first spans positions
+  // [group_starts[g], group_starts[g + 1]) of "rows".
+  std::vector<Tindex> group_starts;
+  for (Tindex i = 0; i < N; ++i) {
+    if (i == 0 || rows[i].first != rows[i - 1].first) {
+      group_starts.push_back(i);
+    }
+  }
+  const int64_t num_groups = group_starts.size();
+  group_starts.push_back(N);
+
+  const auto apply_group = [&](int64_t g) {
+    for (Tindex k = group_starts[g]; k < group_starts[g + 1]; ++k) {
+      update_row(rows[k].second, rows[k].first);
+    }
+  };
+  const auto shard = [&](int64_t begin, int64_t end) {
+    for (int64_t g = begin; g < end; ++g) {
+      if (row_mutexes == nullptr) {
+        apply_group(g);
+      } else {
+        mutex_lock l(*row_mutexes->ForRow(rows[group_starts[g]].first));
+        apply_group(g);
+      }
+    }
+  };
+  d.parallelFor(num_groups, row_cost * (static_cast<double>(N) / num_groups),
+                shard);
+  return Status::OK();
+}
+
+}  // namespace functor
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_TRAINING_OPS_SPARSE_APPLY_H_
@@ -0,0 +1,119 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/training_ops_sparse_apply.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/resource_var.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace functor {
+namespace {
+
+constexpr int kNumThreads = 4;
+
+class SparseApplyTest : public ::testing::Test {
+ protected:
+  SparseApplyTest()
+      : pool_(Env::Default(), "sparse_apply_test", kNumThreads),
+        device_(pool_.AsEigenThreadPool(), kNumThreads) {}
+
+  // Records the positions applied to every row of a variable of "num_rows"
+  // rows.
+  Status Apply(const std::vector<int64_t>& indices, int64_t num_rows,
+               double row_cycles, RowMutexes* row_mutexes,
+               std::vector<std::vector<int64_t>>* positions) {
+    positions->assign(num_rows, {});
+    TTypes<int64_t>::ConstVec indices_vec(indices.data(), indices.size());
+    return ApplySparseRowUpdates<int64_t>(
+        device_, indices_vec, num_rows, Eigen::TensorOpCost(0, 0, row_cycles),
+        row_mutexes, [&](int64_t i, int64_t index) {
+          EXPECT_EQ(indices[i], index);
+          (*positions)[index].push_back(i);
+        });
+  }
+
+  thread::ThreadPool pool_;
+  Eigen::ThreadPoolDevice device_;
+};
+
+TEST_F(SparseApplyTest, AppliesDuplicatesInOrder) {
+  random::PhiloxRandom philox(23, 5);
+  random::SimplePhilox rnd(&philox);
+  std::vector<int64_t> indices(5000);
+  for (int64_t& index : indices) index = rnd.Uniform(300);
+  std::vector<std::vector<int64_t>> expected(300);
+  for (int64_t i = 0; i < indices.size(); ++i) {
+    expected[indices[i]].push_back(i);
+  }
+
+  // Sequentially, then deduplicated across the threads.
+  for (double row_cycles : {1.0, 1e6}) {
+    std::vector<std::vector<int64_t>> positions;
+    TF_EXPECT_OK(Apply(indices, 300, row_cycles, nullptr, &positions));
+    EXPECT_EQ(positions, expected);
+  }
+}
+
+TEST_F(SparseApplyTest, RejectsIndicesOutOfRange) {
+  for (double row_cycles : {1.0, 1e6}) {
+    std::vector<std::vector<int64_t>> positions;
+    const Status status =
+        Apply({3, 0, 7, 3}, 5, row_cycles, nullptr, &positions);
+    EXPECT_TRUE(errors::IsInvalidArgument(status));
+    EXPECT_EQ(status.error_message(),
+              "Index 7 at offset 2 in indices is out of range");
+    EXPECT_EQ(positions, std::vector<std::vector<int64_t>>(5));
+  }
+}
+
+TEST_F(SparseApplyTest, RowMutexesSerializeConcurrentUpdates) {
+  RowMutexes row_mutexes;
+  std::vector<int64_t> counts(64, 0);
+  std::vector<int64_t> indices(1024);
+  for (int64_t i = 0; i < indices.size(); ++i) indices[i] = i % counts.size();
+  TTypes<int64_t>::ConstVec indices_vec(indices.data(), indices.size());
+
+  // Concurrent updates of the same rows, as by parameter server workers.
+  const int kNumWorkers = 8;
+  {
+    thread::ThreadPool workers(Env::Default(), "workers", kNumWorkers);
+    for (int w = 0; w < kNumWorkers; ++w) {
+      workers.Schedule([&]() {
+        TF_EXPECT_OK(ApplySparseRowUpdates<int64_t>(
+            device_, indices_vec, counts.size(),
+            Eigen::TensorOpCost(0, 0, 1e6), &row_mutexes,
+            [&](int64_t i, int64_t index) {
+              const int64_t count = counts[index];
+              counts[index] = count + 1;
+            }));
+      });
+    }
+  }
+  for (int64_t count : counts) {
+    EXPECT_EQ(count, kNumWorkers * indices.size() / counts.size());
+  }
+}
+
+}  // namespace
+}  // namespace functor
+}  // namespace tensorflow
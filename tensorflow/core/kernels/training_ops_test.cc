@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
@@ -199,6 +200,99 @@ BENCHMARK(BM_SparseAdagrad)
     ->ArgPair(128, 32 << 10)
     ->ArgPair(128, 128 << 10);
 
+static Node* ResourceVar(Graph* g, const string& name, int m, int n) {
+  Node* ret;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "VarHandleOp")
+                  .Attr("dtype", DT_FLOAT)
+                  .Attr("shape", TensorShape({m, n}))
+                  .Attr("shared_name", name)
+                  .Finalize(g, &ret));
+  return ret;
+}
+
+static Node* AssignVariable(Graph* g, Node* var, Node* value) {
+  Node* ret;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "AssignVariableOp")
+                  .Input(var)
+                  .Input(value)
+                  .Attr("dtype", DT_FLOAT)
+                  .Finalize(g, &ret));
+  return ret;
+}
+
+static const char* const kSparseUpdateModes[] = {"default", "row_locks",
+                                                 "lock_free"};
+
+// "num_workers" concurrent ResourceSparseApplyAdagrad updates of "k" rows of
+// the same m x n variable, as by the workers of a parameter server, in the
+// sparse update mode "kSparseUpdateModes[mode]".  The default mode locks the
+// variable (use_locking=true).
+static void ContendedSparseAdagrad(int mode, int num_workers, int m, int n,
+                                   int k, Graph** init_g, Graph** train_g) {
+  {
+    Graph* g = new Graph(OpRegistry::Global());
+    auto var = ResourceVar(g, "var", m, n);
+    auto accum = ResourceVar(g, "accum", m, n);
+    Tensor ones(DT_FLOAT, TensorShape({m, n}));
+    ones.flat<float>().setConstant(1.0f);
+    AssignVariable(g, var, Zeros(g, m, n));
+    AssignVariable(g, accum, test::graph::Constant(g, ones));
+    Node* set_mode;
+    TF_CHECK_OK(NodeBuilder(g->NewName("n"), "_SetVariableSparseUpdateMode")
+                    .Input(var)
+                    .Attr("mode", kSparseUpdateModes[mode])
+                    .Finalize(g, &set_mode));
+    *init_g = g;
+  }
+  {
+    Graph* g = new Graph(OpRegistry::Global());
+    auto var = ResourceVar(g, "var", m, n);
+    auto accum = ResourceVar(g, "accum", m, n);
+    auto lr = Scalar(g, 0.01);
+    for (int w = 0; w < num_workers; ++w) {
+      // Every worker updates its own pseudo-random rows.
+      Tensor indices(DT_INT32, TensorShape({k}));
+      int32* base = indices.flat<int32>().data();
+      for (int i = 0; i < k; ++i) {
+        base[i] = (static_cast<int64_t>(i) * 7919 + w * 104729) % m;
+      }
+      Node* apply;
+      TF_CHECK_OK(NodeBuilder(g->NewName("n"), "ResourceSparseApplyAdagrad")
+                      .Input(var)
+                      .Input(accum)
+                      .Input(lr)
+                      .Input(Random(g, k, n))
+                      .Input(test::graph::Constant(g, indices))
+                      .Attr("use_locking", true)
+                      .Finalize(g, &apply));
+    }
+    *train_g = g;
+  }
+}
+
+static void BM_ContendedSparseAdagrad(::testing::benchmark::State& state) {
+  const int mode = state.range(0);
+  const int num_workers = state.range(1);
+  const int m = 4 << 10;
+  const int n = 64;
+  const int k = 512;
+
+  Graph* init;
+  Graph* train;
+  ContendedSparseAdagrad(mode, num_workers, m, n, k, &init, &train);
+  test::Benchmark("cpu", train, GetOptions(), init, nullptr, "",
+                  /*old_benchmark_api*/ false)
+      .Run(state);
+  state.SetLabel(kSparseUpdateModes[mode]);
+  const int64_t tot =
+      static_cast<int64_t>(state.iterations()) * num_workers * k * n;
+  state.SetItemsProcessed(tot);
+  state.SetBytesProcessed(tot * sizeof(float));
+}
+BENCHMARK(BM_ContendedSparseAdagrad)
+    ->UseRealTime()
+    ->ArgsProduct({{0, 1, 2}, {1, 8, 32}});
+
 static void Momentum(int32_t n, Graph** init_g, Graph** train_g) {
   TensorShape shape({n});
   {
@@ -16,12 +16,15 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 
 #include <complex>
+#include <memory>
+#include <type_traits>
 
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/kernels/transpose_functor.h"
+#include "tensorflow/core/kernels/transpose_plan.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
@@ -68,12 +71,37 @@ void TransposeSimple(const CPUDevice& device, const Tensor& in,
   device.parallelFor(in.NumElements(), cost, std::move(transpose_fn));
 }
 
+// Transposes with a cached TransposePlan, executing its work items in
+// parallel.
+template <typename T>
+void TransposeUsingPlan(const CPUDevice& device, const Tensor& in,
+                        const gtl::ArraySlice<int32> perm, Tensor* out) {
+  const auto dims = in.shape().dim_sizes();
+  std::shared_ptr<const TransposePlan> plan =
+      GetTransposePlan(sizeof(T), dims, perm);
+  const char* p = in.tensor_data().data();
+  char* q = const_cast<char*>(out->tensor_data().data());
+  const int64_t elems_per_work_item = plan->ElementsPerWorkItem();
+  Eigen::TensorOpCost cost(/*bytes_loaded=*/elems_per_work_item * sizeof(T),
+                           /*bytes_stored=*/elems_per_work_item * sizeof(T),
+                           /*compute_cycles=*/elems_per_work_item);
+  device.parallelFor(plan->NumWorkItems(), cost,
+                     [&plan, p, q](int64_t begin, int64_t end) {
+                       plan->Execute(p, q, begin, end);
+                     });
+}
+
 }  // namespace
 
 template <typename T, bool conjugate>
 struct Transpose<CPUDevice, T, conjugate> {
   static void run(const CPUDevice& d, const Tensor& in,
                   const gtl::ArraySlice<int32> perm, Tensor* out) {
+    // Plans move bits, so they neither conjugate nor copy strings.
+    if (!conjugate && std::is_trivially_copyable<T>::value) {
+      TransposeUsingPlan<T>(d, in, perm, out);
+      return;
+    }
     switch (in.dims()) {
       case 2:
         internal::TransposeUsingEigen<CPUDevice, T, 2>(d, in, perm, conjugate,
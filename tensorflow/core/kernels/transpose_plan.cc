@@ -0,0 +1,398 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/transpose_plan.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_join.h"
+#include "third_party/eigen3/Eigen/Core"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace {
+
+// The number of cached plans.  The cache is cleared when full: the plans of a
+// model are few and quickly computed again.
+constexpr size_t kMaxCachedTransposePlans = 1024;
+
+// The maximum number of bytes copied by a work item of a copy plan.
+constexpr int64_t kCopyChunkBytes = 64 * 1024;
+
+// Copy plans whose contiguous runs are shorter than this copy whole rows of
+// runs per work item, rather than one run.
+constexpr int64_t kShortRunBytes = 256;
+
+// The edges of the tiles of tiled plans, in bytes.  A tile reads one cache
+// line of each of its input rows, and writes long runs of its output rows:
+// scattering the writes over many rows is what limits large transposes.
+constexpr int64_t kTileInputRowBytes = 64;
+constexpr int64_t kTileOutputRowBytes = 2048;
+
+// An element of 16 bytes, such as complex128, moved bitwise.
+struct alignas(8) Element16 {
+  uint64 lo;
+  uint64 hi;
+};
+
+// Transposes the "kBlock" by "kBlock" block of "a", whose rows are "lda"
+// elements apart, into "b", whose rows are "ldb" elements apart:
+// b[i * ldb + j] = a[j * lda + i].
+template <typename T, int kBlock>
+struct TransposeMicroKernel {
+  static void Apply(const T* __restrict a, int64_t lda, T* __restrict b,
+                    int64_t ldb) {
+    for (int i = 0; i < kBlock; ++i) {
+      for (int j = 0; j < kBlock; ++j) {
+        b[i * ldb + j] = a[j * lda + i];
+      }
+    }
+  }
+};
+
+// Transposes blocks of packets with Eigen's packet transposes.  Floating-point
+// packets only move the bits of the 4- and 8-byte elements.
+template <typename T, typename Packet, typename Scalar, int kBlock>
+struct PacketTransposeMicroKernel {
+  static void Apply(const T* __restrict a, int64_t lda, T* __restrict b,
+                    int64_t ldb) {
+    Eigen::internal::PacketBlock<Packet, kBlock> block;
+    for (int j = 0; j < kBlock; ++j) {
+      block.packet[j] = Eigen::internal::ploadu<Packet>(
+          reinterpret_cast<const Scalar*>(a + j * lda));
+    }
+    Eigen::internal::ptranspose(block);
+    for (int i = 0; i < kBlock; ++i) {
+      Eigen::internal::pstoreu<Scalar>(reinterpret_cast<Scalar*>(b + i * ldb),
+                                       block.packet[i]);
+    }
+  }
+};
+
+// The block size of the micro-kernel of each element type.
+template <typename T>
+struct MicroKernelBlock {
+  static constexpr int kValue = 8;
+};
+
+template <>
+struct MicroKernelBlock<Element16> {
+  static constexpr int kValue = 2;
+};
+
+#ifdef EIGEN_VECTORIZE_AVX
+
+template <>
+struct MicroKernelBlock<uint32> {
+  static constexpr int kValue = 8;
+};
+
+template <>
+struct MicroKernelBlock<uint64> {
+  static constexpr int kValue = 4;
+};
+
+template <>
+struct TransposeMicroKernel<uint32, 8>
+    : PacketTransposeMicroKernel<uint32, Eigen::internal::Packet8f, float, 8> {
+};
+
+template <>
+struct TransposeMicroKernel<uint64, 4>
+    : PacketTransposeMicroKernel<uint64, Eigen::internal::Packet4d, double,
+                                 4> {};
+
+#elif defined(EIGEN_VECTORIZE_SSE2) || defined(EIGEN_VECTORIZE_NEON)
+
+template <>
+struct MicroKernelBlock<uint32> {
+  static constexpr int kValue = 4;
+};
+
+template <>
+struct TransposeMicroKernel<uint32, 4>
+    : PacketTransposeMicroKernel<uint32, Eigen::internal::Packet4f, float, 4> {
+};
+
+#ifdef EIGEN_VECTORIZE_SSE2
+
+template <>
+struct MicroKernelBlock<uint64> {
+  static constexpr int kValue = 2;
+};
+
+template <>
+struct TransposeMicroKernel<uint64, 2>
+    : PacketTransposeMicroKernel<uint64, Eigen::internal::Packet2d, double,
+                                 2> {};
+
+#endif  // EIGEN_VECTORIZE_SSE2
+#endif  // EIGEN_VECTORIZE_AVX
+
+// Transposes the "num_a" by "num_b" tile of "a" into "b", where a row of "a"
+// holds "num_a" elements and a row of "b" holds "num_b" elements.
+template <typename T>
+void TransposeTile(const T* a, int64_t lda, int64_t num_a, int64_t num_b,
+                   T* b, int64_t ldb) {
+  constexpr int kBlock = MicroKernelBlock<T>::kValue;
+  const int64_t full_a = num_a - num_a % kBlock;
+  const int64_t full_b = num_b - num_b % kBlock;
+  for (int64_t i = 0; i < full_a; i += kBlock) {
+    for (int64_t j = 0; j < full_b; j += kBlock) {
+      TransposeMicroKernel<T, kBlock>::Apply(a + j * lda + i, lda,
+                                             b + i * ldb + j, ldb);
+    }
+  }
+  // The remainders of the blocks are transposed one element at a time.
+  for (int64_t i = 0; i < num_a; ++i) {
+    for (int64_t j = i < full_a ? full_b : 0; j < num_b; ++j) {
+      b[i * ldb + j] = a[j * lda + i];
+    }
+  }
+}
+
+// (element size, number of dimensions, dimensions..., permutation...).
+using TransposePlanKey = std::vector<int64_t>;
+
+struct TransposePlanCache {
+  mutex mu;
+  absl::flat_hash_map<TransposePlanKey, std::shared_ptr<const TransposePlan>>
+      plans TF_GUARDED_BY(mu);
+};
+
+TransposePlanCache* GetTransposePlanCache() {
+  static TransposePlanCache* cache = new TransposePlanCache;
+  return cache;
+}
+
+}  // namespace
+
+TransposePlan::TransposePlan(int64_t elem_size, gtl::ArraySlice<int64_t> dims,
+                             gtl::ArraySlice<int32> perm)
+    : elem_size_(elem_size) {
+  CHECK(elem_size == 1 || elem_size == 2 || elem_size == 4 ||
+        elem_size == 8 || elem_size == 16)
+      << "Unsupported element size " << elem_size;
+  CHECK_EQ(dims.size(), perm.size());
+  const int ndims = dims.size();
+  gtl::InlinedVector<int64_t, 8> in_strides(ndims);
+  int64_t num_elements = 1;
+  for (int i = ndims - 1; i >= 0; --i) {
+    in_strides[i] = num_elements;
+    num_elements *= dims[i];
+  }
+  if (num_elements == 0) return;
+
+  // The output dimensions, without those of size 1, and merged when they are
+  // also adjacent in the input.
+  struct Dim {
+    int64_t size;
+    int64_t in_stride;
+    int64_t out_stride;
+  };
+  gtl::InlinedVector<Dim, 8> out_dims;
+  for (int i = 0; i < ndims; ++i) {
+    const int64_t size = dims[perm[i]];
+    const int64_t in_stride = in_strides[perm[i]];
+    if (size == 1) continue;
+    if (!out_dims.empty() &&
+        out_dims.back().in_stride == in_stride * size) {
+      out_dims.back().size *= size;
+      out_dims.back().in_stride = in_stride;
+    } else {
+      out_dims.push_back({size, in_stride, 0});
+    }
+  }
+  int64_t out_stride = 1;
+  for (int i = static_cast<int>(out_dims.size()) - 1; i >= 0; --i) {
+    out_dims[i].out_stride = out_stride;
+    out_stride *= out_dims[i].size;
+  }
+
+  if (out_dims.empty() || out_dims.back().in_stride == 1) {
+    // The innermost dimension stays innermost.
+    is_copy_ = true;
+    if (!out_dims.empty()) {
+      inner_size_ = out_dims.back().size;
+      out_dims.pop_back();
+    }
+    chunk_size_ = std::min(inner_size_, kCopyChunkBytes / elem_size);
+    num_chunks_ = (inner_size_ + chunk_size_ - 1) / chunk_size_;
+    if (!out_dims.empty() && inner_size_ * elem_size < kShortRunBytes) {
+      rows_ = out_dims.back().size;
+      row_in_stride_ = out_dims.back().in_stride;
+      row_out_stride_ = out_dims.back().out_stride;
+      out_dims.pop_back();
+    }
+    for (const Dim& dim : out_dims) {
+      loops_.push_back({dim.size, dim.in_stride, dim.out_stride});
+    }
+    num_work_items_ = num_elements / (inner_size_ * rows_) * num_chunks_;
+    elems_per_work_item_ = chunk_size_ * rows_;
+    return;
+  }
+
+  // Dimension "a" is innermost in the input, dimension "b" in the output.
+  int a = 0;
+  while (out_dims[a].in_stride != 1) ++a;
+  const int b = out_dims.size() - 1;
+  a_size_ = out_dims[a].size;
+  a_out_stride_ = out_dims[a].out_stride;
+  b_size_ = out_dims[b].size;
+  b_in_stride_ = out_dims[b].in_stride;
+  a_tile_ = kTileInputRowBytes / elem_size;
+  b_tile_ = kTileOutputRowBytes / elem_size;
+  num_a_tiles_ = (a_size_ + a_tile_ - 1) / a_tile_;
+  num_b_tiles_ = (b_size_ + b_tile_ - 1) / b_tile_;
+  for (int i = 0; i < b; ++i) {
+    if (i == a) continue;
+    loops_.push_back(
+        {out_dims[i].size, out_dims[i].in_stride, out_dims[i].out_stride});
+  }
+  num_work_items_ =
+      num_elements / (a_size_ * b_size_) * num_a_tiles_ * num_b_tiles_;
+  elems_per_work_item_ =
+      std::min(a_tile_, a_size_) * std::min(b_tile_, b_size_);
+}
+
+template <typename T>
+void TransposePlan::ExecuteTyped(const T* in, T* out, int64_t begin,
+                                 int64_t end) const {
+  if (begin >= end) return;
+  const int64_t items_per_outer_index =
+      is_copy_ ? num_chunks_ : num_a_tiles_ * num_b_tiles_;
+  // Finds the outer index of the first work item and its offsets, then steps
+  // through the following ones.
+  const int num_loops = loops_.size();
+  gtl::InlinedVector<int64_t, 8> index(num_loops);
+  int64_t outer = begin / items_per_outer_index;
+  int64_t inner = begin % items_per_outer_index;
+  int64_t in_offset = 0;
+  int64_t out_offset = 0;
+  for (int i = num_loops - 1; i >= 0; --i) {
+    index[i] = outer % loops_[i].size;
+    outer /= loops_[i].size;
+    in_offset += index[i] * loops_[i].in_stride;
+    out_offset += index[i] * loops_[i].out_stride;
+  }
+  for (int64_t item = begin; item < end; ++item) {
+    if (is_copy_ && rows_ > 1) {
+      const T* in_row = in + in_offset;
+      T* out_row = out + out_offset;
+      for (int64_t row = 0; row < rows_; ++row) {
+        for (int64_t i = 0; i < inner_size_; ++i) out_row[i] = in_row[i];
+        in_row += row_in_stride_;
+        out_row += row_out_stride_;
+      }
+    } else if (is_copy_) {
+      const int64_t start = inner * chunk_size_;
+      const int64_t size = std::min(chunk_size_, inner_size_ - start);
+      std::copy_n(in + in_offset + start, size, out + out_offset + start);
+    } else {
+      const int64_t a_start = (inner % num_a_tiles_) * a_tile_;
+      const int64_t b_start = (inner / num_a_tiles_) * b_tile_;
+      TransposeTile(in + in_offset + b_start * b_in_stride_ + a_start,
+                    b_in_stride_, std::min(a_tile_, a_size_ - a_start),
+                    std::min(b_tile_, b_size_ - b_start),
+                    out + out_offset + a_start * a_out_stride_ + b_start,
+                    a_out_stride_);
+    }
+    if (++inner < items_per_outer_index) continue;
+    inner = 0;
+    for (int i = num_loops - 1; i >= 0; --i) {
+      in_offset += loops_[i].in_stride;
+      out_offset += loops_[i].out_stride;
+      if (++index[i] < loops_[i].size) break;
+      in_offset -= loops_[i].size * loops_[i].in_stride;
+      out_offset -= loops_[i].size * loops_[i].out_stride;
+      index[i] = 0;
+    }
+  }
+}
+
+void TransposePlan::Execute(const void* in, void* out, int64_t begin,
+                            int64_t end) const {
+  switch (elem_size_) {
+    case 1:
+      ExecuteTyped(static_cast<const uint8*>(in), static_cast<uint8*>(out),
+                   begin, end);
+      break;
+    case 2:
+      ExecuteTyped(static_cast<const uint16*>(in), static_cast<uint16*>(out),
+                   begin, end);
+      break;
+    case 4:
+      ExecuteTyped(static_cast<const uint32*>(in), static_cast<uint32*>(out),
+                   begin, end);
+      break;
+    case 8:
+      ExecuteTyped(static_cast<const uint64*>(in), static_cast<uint64*>(out),
+                   begin, end);
+      break;
+    case 16:
+      ExecuteTyped(static_cast<const Element16*>(in),
+                   static_cast<Element16*>(out), begin, end);
+      break;
+  }
+}
+
+string TransposePlan::DebugString() const {
+  std::vector<string> loops;
+  for (const Loop& loop : loops_) {
+    loops.push_back(strings::StrCat(loop.size, ":", loop.in_stride, "/",
+                                    loop.out_stride));
+  }
+  if (is_copy_) {
+    return strings::StrCat("copy elem_size=", elem_size_, " loops=[",
+                           absl::StrJoin(loops, ","), "] rows=", rows_, "/",
+                           row_in_stride_, " inner=", inner_size_,
+                           " chunk=", chunk_size_);
+  }
+  return strings::StrCat("tiled elem_size=", elem_size_, " loops=[",
+                         absl::StrJoin(loops, ","), "] a=", a_size_, "/",
+                         a_out_stride_, " b=", b_size_, "/", b_in_stride_,
+                         " tile=", a_tile_, "x", b_tile_);
+}
+
+std::shared_ptr<const TransposePlan> GetTransposePlan(
+    int64_t elem_size, gtl::ArraySlice<int64_t> dims,
+    gtl::ArraySlice<int32> perm) {
+  TransposePlanKey key;
+  key.reserve(2 + dims.size() + perm.size());
+  key.push_back(elem_size);
+  key.push_back(dims.size());
+  key.insert(key.end(), dims.begin(), dims.end());
+  key.insert(key.end(), perm.begin(), perm.end());
+  TransposePlanCache* cache = GetTransposePlanCache();
+  {
+    mutex_lock l(cache->mu);
+    auto it = cache->plans.find(key);
+    if (it != cache->plans.end()) return it->second;
+  }
+  auto plan = std::make_shared<const TransposePlan>(elem_size, dims, perm);
+  mutex_lock l(cache->mu);
+  if (cache->plans.size() >= kMaxCachedTransposePlans) {
+    cache->plans.clear();
+  }
+  cache->plans.emplace(std::move(key), plan);
+  return plan;
+}
+
+}  // namespace tensorflow
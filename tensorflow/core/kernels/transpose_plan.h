@@ -0,0 +1,110 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_TRANSPOSE_PLAN_H_
+#define TENSORFLOW_CORE_KERNELS_TRANSPOSE_PLAN_H_
+
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/lib/gtl/array_slice.h"
+#include "tensorflow/core/lib/gtl/inlined_vector.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A plan to transpose dense row-major arrays of a given shape, permutation
+// and element size on CPU, in the manner of xla::TransposePlan.
+//
+// Planning removes the dimensions of size 1 and merges the dimensions that
+// stay adjacent in the output.  Then:
+//  - When the innermost dimension stays innermost, the output is copied one
+//    contiguous run of elements at a time.
+//  - Otherwise, the innermost input dimension and the innermost output
+//    dimension are cut into tiles, transposed by vectorized micro-kernels,
+//    that read whole cache lines and write long contiguous runs.
+// The work is split into independent items (runs or tiles, for every index of
+// the other dimensions), that callers execute in parallel.
+class TransposePlan {
+ public:
+  // Plans transposing an array of "dims", with elements of "elem_size" bytes,
+  // to the array whose dimension i is dimension perm[i] of the input.
+  // REQUIRES: "perm" is a permutation of [0, dims.size()).
+  TransposePlan(int64_t elem_size, gtl::ArraySlice<int64_t> dims,
+                gtl::ArraySlice<int32> perm);
+
+  // The number of independent work items.
+  int64_t NumWorkItems() const { return num_work_items_; }
+
+  // The number of elements moved by a work item.
+  int64_t ElementsPerWorkItem() const { return elems_per_work_item_; }
+
+  // Transposes "in" into "out", for the work items in [begin, end).  "in" and
+  // "out" must not overlap.
+  void Execute(const void* in, void* out, int64_t begin, int64_t end) const;
+
+  // Returns a description of the plan, for debugging.
+  string DebugString() const;
+
+ private:
+  // An outer dimension, iterated over by the work items.
+  struct Loop {
+    int64_t size;
+    // The strides of the dimension, in elements.
+    int64_t in_stride;
+    int64_t out_stride;
+  };
+
+  template <typename T>
+  void ExecuteTyped(const T* in, T* out, int64_t begin, int64_t end) const;
+
+  int64_t elem_size_;
+  // The outer dimensions, from outermost to innermost output dimension.
+  gtl::InlinedVector<Loop, 8> loops_;
+  // True when the innermost dimension stays innermost.  Work items then copy
+  // chunks of up to "chunk_size_" of the "inner_size_" contiguous elements.
+  // Short runs are copied "rows_" at a time, along the innermost of the
+  // other output dimensions.
+  bool is_copy_ = false;
+  int64_t inner_size_ = 1;
+  int64_t chunk_size_ = 1;
+  int64_t num_chunks_ = 1;
+  int64_t rows_ = 1;
+  int64_t row_in_stride_ = 0;
+  int64_t row_out_stride_ = 0;
+  // For tiled plans, the sizes of the innermost input dimension "a" and of
+  // the innermost output dimension "b", their output and input strides, and
+  // the tile edges along them, in elements.
+  int64_t a_size_ = 1;
+  int64_t b_size_ = 1;
+  int64_t a_out_stride_ = 1;
+  int64_t b_in_stride_ = 1;
+  int64_t a_tile_ = 1;
+  int64_t b_tile_ = 1;
+  int64_t num_a_tiles_ = 1;
+  int64_t num_b_tiles_ = 1;
+  int64_t num_work_items_ = 0;
+  int64_t elems_per_work_item_ = 0;
+};
+
+// Returns the plan of TransposePlan(elem_size, dims, perm), from a cache of
+// the recently used plans.  Thread-safe.
+std::shared_ptr<const TransposePlan> GetTransposePlan(
+    int64_t elem_size, gtl::ArraySlice<int64_t> dims,
+    gtl::ArraySlice<int32> perm);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_TRANSPOSE_PLAN_H_
@@ -0,0 +1,148 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/transpose_plan.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "tensorflow/core/framework/numeric_types.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Transposes "in" one element at a time.
+template <typename T>
+std::vector<T> TransposeBaseline(const std::vector<T>& in,
+                                 const std::vector<int64_t>& dims,
+                                 const std::vector<int32>& perm) {
+  const int ndims = dims.size();
+  std::vector<int64_t> in_strides(ndims);
+  std::vector<int64_t> out_dims(ndims);
+  int64_t stride = 1;
+  for (int i = ndims - 1; i >= 0; --i) {
+    in_strides[i] = stride;
+    stride *= dims[i];
+  }
+  for (int i = 0; i < ndims; ++i) out_dims[i] = dims[perm[i]];
+  std::vector<T> out(in.size());
+  std::vector<int64_t> index(ndims, 0);
+  for (int64_t o = 0; o < out.size(); ++o) {
+    int64_t i_offset = 0;
+    for (int d = 0; d < ndims; ++d) i_offset += index[d] * in_strides[perm[d]];
+    out[o] = in[i_offset];
+    for (int d = ndims - 1; d >= 0; --d) {
+      if (++index[d] < out_dims[d]) break;
+      index[d] = 0;
+    }
+  }
+  return out;
+}
+
+template <typename T>
+void TestTranspose(const std::vector<int64_t>& dims,
+                   const std::vector<int32>& perm) {
+  const int64_t num_elements = std::accumulate(
+      dims.begin(), dims.end(), int64_t{1}, std::multiplies<int64_t>());
+  std::vector<T> in(num_elements);
+  for (int64_t i = 0; i < num_elements; ++i) in[i] = static_cast<T>(i * 7 + 1);
+  const std::vector<T> expected = TransposeBaseline(in, dims, perm);
+
+  TransposePlan plan(sizeof(T), dims, perm);
+  std::vector<T> out(num_elements);
+  // Executes the work items in a few ranges, as when sharded.
+  const int64_t n = plan.NumWorkItems();
+  plan.Execute(in.data(), out.data(), 0, n / 3);
+  plan.Execute(in.data(), out.data(), n / 3, n);
+  EXPECT_EQ(out, expected) << plan.DebugString();
+}
+
+TEST(TransposePlanTest, Copies) {
+  TestTranspose<uint32>({}, {});
+  TestTranspose<uint32>({7}, {0});
+  TestTranspose<uint8>({3, 5, 100000}, {1, 0, 2});
+  TestTranspose<uint64>({2, 1, 3, 4}, {2, 1, 0, 3});
+  TestTranspose<uint16>({5, 0, 3}, {2, 1, 0});
+}
+
+TEST(TransposePlanTest, Matrices) {
+  for (int64_t rows : {1, 3, 16, 33, 128, 200}) {
+    for (int64_t cols : {1, 5, 32, 64, 77}) {
+      TestTranspose<uint8>({rows, cols}, {1, 0});
+      TestTranspose<uint16>({rows, cols}, {1, 0});
+      TestTranspose<uint32>({rows, cols}, {1, 0});
+      TestTranspose<uint64>({rows, cols}, {1, 0});
+    }
+  }
+}
+
+TEST(TransposePlanTest, Complex128) {
+  const std::vector<int64_t> dims = {9, 20, 3};
+  const std::vector<int32> perm = {2, 0, 1};
+  std::vector<complex128> in(9 * 20 * 3);
+  for (int i = 0; i < in.size(); ++i) in[i] = complex128(i, -i);
+  TransposePlan plan(sizeof(complex128), dims, perm);
+  std::vector<complex128> out(in.size());
+  plan.Execute(in.data(), out.data(), 0, plan.NumWorkItems());
+  EXPECT_EQ(out, TransposeBaseline(in, dims, perm));
+}
+
+TEST(TransposePlanTest, RandomPermutations) {
+  random::PhiloxRandom philox(17, 3);
+  random::SimplePhilox rnd(&philox);
+  for (int ndims = 2; ndims <= 9; ++ndims) {
+    for (int trial = 0; trial < 10; ++trial) {
+      std::vector<int64_t> dims(ndims);
+      int64_t num_elements = 1;
+      for (int64_t& dim : dims) {
+        dim = 1 + rnd.Uniform(num_elements > 20000 ? 2 : 40);
+        num_elements *= dim;
+      }
+      std::vector<int32> perm(ndims);
+      std::iota(perm.begin(), perm.end(), 0);
+      for (int i = ndims - 1; i > 0; --i) {
+        std::swap(perm[i], perm[rnd.Uniform(i + 1)]);
+      }
+      TestTranspose<uint32>(dims, perm);
+      TestTranspose<uint16>(dims, perm);
+    }
+  }
+}
+
+TEST(TransposePlanTest, MergesDimensions) {
+  // {2, 3, 4, 5, 120} with {0, 4, 1, 2, 3} is {2, 60, 120} with {0, 2, 1}.
+  TransposePlan plan(4, {2, 3, 4, 5, 120}, {0, 4, 1, 2, 3});
+  EXPECT_EQ(plan.DebugString(),
+            "tiled elem_size=4 loops=[2:7200/7200] a=120/60 b=60/120 tile=16x512");
+  EXPECT_EQ(plan.NumWorkItems(), 2 * 1 * 8);
+}
+
+TEST(TransposePlanTest, PlansAreCached) {
+  std::shared_ptr<const TransposePlan> plan1 =
+      GetTransposePlan(4, {64, 3, 64}, {2, 1, 0});
+  std::shared_ptr<const TransposePlan> plan2 =
+      GetTransposePlan(4, {64, 3, 64}, {2, 1, 0});
+  EXPECT_EQ(plan1.get(), plan2.get());
+  std::shared_ptr<const TransposePlan> plan3 =
+      GetTransposePlan(2, {64, 3, 64}, {2, 1, 0});
+  EXPECT_NE(plan1.get(), plan3.get());
+}
+
+}  // namespace
+}  // namespace tensorflow
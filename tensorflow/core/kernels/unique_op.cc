@@ -13,9 +13,12 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
 #include <functional>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "tensorflow/core/framework/bounds_check.h"
@@ -26,6 +29,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/platform/bfloat16.h"
+#include "tensorflow/core/platform/threadpool.h"
 
 namespace tensorflow {
 namespace {
@@ -68,6 +72,223 @@ struct UniqueOpHashMap<bfloat16, TIndex> {
   using map_type = std::unordered_map<bfloat16, TIndex>;
 };
 
+// 1-D inputs with at least this many elements are uniquified in parallel.
+constexpr int64_t kParallelUniqueMinElements = 64 * 1024;
+// Upper bound on the number of hash partitions of a parallel unique.
+constexpr int kMaxUniquePartitions = 64;
+// Integer inputs with fewer elements are always hashed, which is cheap enough
+// that the extra pass to find their range does not pay off.
+constexpr int64_t kDenseUniqueMinElements = 1024;
+// Integer inputs whose values span a range of at most this many times their
+// number of elements are uniquified with a direct-indexed table.
+constexpr uint64 kMaxDenseUniqueRangeFactor = 2;
+
+// `DenseUnique` uniquifies integer inputs whose values fall into a small range
+// by indexing a table with `value - min_value` instead of hashing. Walking the
+// input in order assigns indices by first occurrence, like the hash maps do.
+//
+// Both `DenseUnique` and `ParallelUnique` call `allocate(num_unique, &values,
+// &counts)` once the number of unique elements is known. `counts` is null
+// unless the op also returns the number of occurrences of every element.
+template <typename T, typename TIndex, typename Enable = void>
+struct DenseUnique {
+  static bool CanRun(typename TTypes<T>::ConstFlat Tin, T* min_value,
+                     uint64* range) {
+    return false;
+  }
+  template <typename AllocateFn>
+  static Status Run(typename TTypes<T>::ConstFlat Tin, T min_value,
+                    uint64 range, typename TTypes<TIndex>::Vec idx_vec,
+                    AllocateFn allocate) {
+    return errors::Internal("Dense unique is only supported for integers");
+  }
+};
+
+template <typename T, typename TIndex>
+struct DenseUnique<T, TIndex,
+                   typename std::enable_if<std::is_integral<T>::value>::type> {
+  static bool CanRun(typename TTypes<T>::ConstFlat Tin, T* min_value,
+                     uint64* range) {
+    const int64_t N = Tin.size();
+    if (N < kDenseUniqueMinElements) return false;
+    T lo = Tin(0);
+    T hi = Tin(0);
+    for (int64_t i = 1; i < N; ++i) {
+      lo = std::min(lo, Tin(i));
+      hi = std::max(hi, Tin(i));
+    }
+    // Computed modulo 2^64, which is exact because hi >= lo.
+    *range = static_cast<uint64>(hi) - static_cast<uint64>(lo);
+    *min_value = lo;
+    return *range < kMaxDenseUniqueRangeFactor * static_cast<uint64>(N);
+  }
+
+  template <typename AllocateFn>
+  static Status Run(typename TTypes<T>::ConstFlat Tin, T min_value,
+                    uint64 range, typename TTypes<TIndex>::Vec idx_vec,
+                    AllocateFn allocate) {
+    const uint64 base = static_cast<uint64>(min_value);
+    std::vector<TIndex> table(range + 1, -1);
+    TIndex num_unique = 0;
+    for (int64_t i = 0; i < Tin.size(); ++i) {
+      TIndex& id = table[static_cast<uint64>(Tin(i)) - base];
+      if (id < 0) id = num_unique++;
+      idx_vec(i) = id;
+    }
+
+    T* unique_values = nullptr;
+    TIndex* unique_counts = nullptr;
+    TF_RETURN_IF_ERROR(allocate(num_unique, &unique_values, &unique_counts));
+    for (uint64 offset = 0; offset <= range; ++offset) {
+      if (table[offset] >= 0) {
+        unique_values[table[offset]] = static_cast<T>(base + offset);
+      }
+    }
+    if (unique_counts != nullptr) {
+      std::fill_n(unique_counts, num_unique, 0);
+      for (int64_t i = 0; i < Tin.size(); ++i) ++unique_counts[idx_vec(i)];
+    }
+    return Status::OK();
+  }
+};
+
+// Uniquifies the 1-D input `Tin` on `num_partitions` threads of `workers`.
+//
+// Elements are first partitioned by hash, keeping the positions of each
+// partition in increasing order. Every partition is then uniquified with its
+// own map, which records the position where each of its unique elements first
+// occurs. Numbering those first positions in increasing order yields the same
+// indices as a sequential pass over the input, so the output is ordered by
+// first occurrence.
+//
+// Positions are kept as int32, which holds since UniqueOp rejects inputs of
+// more than 2^31 - 1 elements.
+template <typename T, typename TIndex, typename AllocateFn>
+Status ParallelUnique(thread::ThreadPool* workers, int num_partitions,
+                      typename TTypes<T>::ConstFlat Tin,
+                      typename TTypes<TIndex>::Vec idx_vec,
+                      AllocateFn allocate) {
+  using MapType = typename UniqueOpHashMap<T, int32>::map_type;
+  using KeyType = typename MapType::key_type;
+  const int64_t N = Tin.size();
+  DCHECK_LE(N, std::numeric_limits<int32>::max());
+  const int64_t chunk_size = (N + num_partitions - 1) / num_partitions;
+  // Runs `fn(p)` for every partition (or chunk) `p` in parallel.
+  auto for_each_partition = [&](const std::function<void(int)>& fn) {
+    workers->ParallelFor(num_partitions, chunk_size * 32,
+                         [&fn](int64_t begin, int64_t end) {
+                           for (int64_t p = begin; p < end; ++p) fn(p);
+                         });
+  };
+  auto chunk_limits = [&](int c, int64_t* begin, int64_t* end) {
+    *begin = std::min(N, c * chunk_size);
+    *end = std::min(N, *begin + chunk_size);
+  };
+
+  // Partition element positions by hash. `offsets[c * num_partitions + p]`
+  // first counts the elements of chunk `c` in partition `p`, and then holds
+  // where they are written to `positions`.
+  std::vector<uint8> partition_of(N);
+  std::vector<int64_t> offsets(num_partitions * num_partitions, 0);
+  const typename MapType::hasher hasher;
+  for_each_partition([&](int c) {
+    int64_t begin, end;
+    chunk_limits(c, &begin, &end);
+    int64_t* counts = &offsets[c * num_partitions];
+    for (int64_t i = begin; i < end; ++i) {
+      const uint64 h = static_cast<uint64>(hasher(KeyType(Tin(i))));
+      const int p = ((h * uint64{0x9E3779B97F4A7C15}) >> 32) % num_partitions;
+      partition_of[i] = p;
+      ++counts[p];
+    }
+  });
+  std::vector<int64_t> partition_starts(num_partitions + 1);
+  int64_t total = 0;
+  for (int p = 0; p < num_partitions; ++p) {
+    partition_starts[p] = total;
+    for (int c = 0; c < num_partitions; ++c) {
+      const int64_t count = offsets[c * num_partitions + p];
+      offsets[c * num_partitions + p] = total;
+      total += count;
+    }
+  }
+  partition_starts[num_partitions] = total;
+  std::vector<int32> positions(N);
+  for_each_partition([&](int c) {
+    int64_t begin, end;
+    chunk_limits(c, &begin, &end);
+    int64_t* next = &offsets[c * num_partitions];
+    for (int64_t i = begin; i < end; ++i) {
+      positions[next[partition_of[i]]++] = i;
+    }
+  });
+
+  // Uniquify every partition. `idx_vec` temporarily holds indices local to
+  // each partition.
+  std::vector<uint8> is_first(N, 0);
+  std::vector<std::vector<int32>> first_positions(num_partitions);
+  std::vector<std::vector<int32>> counts(num_partitions);
+  for_each_partition([&](int p) {
+    std::vector<int32>& first = first_positions[p];
+    std::vector<int32>& count = counts[p];
+    MapType uniq;
+    uniq.reserve(partition_starts[p + 1] - partition_starts[p]);
+    for (int64_t k = partition_starts[p]; k < partition_starts[p + 1]; ++k) {
+      const int32 i = positions[k];
+      auto it = uniq.emplace(Tin(i), static_cast<int32>(first.size()));
+      if (it.second) {
+        first.push_back(i);
+        count.push_back(0);
+        is_first[i] = 1;
+      }
+      idx_vec(i) = it.first->second;
+      ++count[it.first->second];
+    }
+  });
+
+  // Number the first occurrences in input order.
+  std::vector<int64_t> chunk_starts(num_partitions);
+  for_each_partition([&](int c) {
+    int64_t begin, end;
+    chunk_limits(c, &begin, &end);
+    chunk_starts[c] = std::count(is_first.begin() + begin,
+                                 is_first.begin() + end, 1);
+  });
+  int64_t num_unique = 0;
+  for (int c = 0; c < num_partitions; ++c) {
+    const int64_t count = chunk_starts[c];
+    chunk_starts[c] = num_unique;
+    num_unique += count;
+  }
+  T* unique_values = nullptr;
+  TIndex* unique_counts = nullptr;
+  TF_RETURN_IF_ERROR(allocate(num_unique, &unique_values, &unique_counts));
+  for_each_partition([&](int c) {
+    int64_t begin, end;
+    chunk_limits(c, &begin, &end);
+    TIndex next = chunk_starts[c];
+    for (int64_t i = begin; i < end; ++i) {
+      if (is_first[i]) idx_vec(i) = next++;
+    }
+  });
+
+  // Translate local indices to global ones and write the outputs.
+  for_each_partition([&](int p) {
+    const std::vector<int32>& first = first_positions[p];
+    std::vector<TIndex> global(first.size());
+    for (size_t u = 0; u < first.size(); ++u) {
+      global[u] = idx_vec(first[u]);
+      unique_values[global[u]] = Tin(first[u]);
+      if (unique_counts != nullptr) unique_counts[global[u]] = counts[p][u];
+    }
+    for (int64_t k = partition_starts[p]; k < partition_starts[p + 1]; ++k) {
+      const int32 i = positions[k];
+      if (!is_first[i]) idx_vec(i) = global[idx_vec(i)];
+    }
+  });
+  return Status::OK();
+}
+
 // `UniqueOp` computes the unique elements in the input tensor.
 //
 // * `T` is the element type.
@@ -150,6 +371,42 @@ class UniqueOp : public OpKernel {
       auto Tin = input.flat<T>();
       const int64_t N = static_cast<int64_t>(Tin.size());
 
+      auto allocate = [&](int64_t num_unique, T** values,
+                          TIndex** counts) -> Status {
+        uniq_size = num_unique;
+        TensorShape output_shape(input.shape());
+        output_shape.set_dim(axis, uniq_size);
+        Tensor* output = nullptr;
+        TF_RETURN_IF_ERROR(context->allocate_output(0, output_shape, &output));
+        *values = output->flat<T>().data();
+        *counts = nullptr;
+        if (num_outputs() > 2) {
+          Tensor* count_output = nullptr;
+          TF_RETURN_IF_ERROR(context->allocate_output(
+              2, TensorShape({uniq_size}), &count_output));
+          *counts = count_output->flat<TIndex>().data();
+        }
+        return Status::OK();
+      };
+
+      T min_value = T();
+      uint64 range = 0;
+      if (DenseUnique<T, TIndex>::CanRun(Tin, &min_value, &range)) {
+        OP_REQUIRES_OK(context, DenseUnique<T, TIndex>::Run(
+                                    Tin, min_value, range, idx_vec, allocate));
+        return;
+      }
+      const auto* worker_threads =
+          context->device()->tensorflow_cpu_worker_threads();
+      const int num_partitions =
+          std::min(worker_threads->num_threads, kMaxUniquePartitions);
+      if (N >= kParallelUniqueMinElements && num_partitions > 1) {
+        OP_REQUIRES_OK(context, ParallelUnique<T, TIndex>(
+                                    worker_threads->workers, num_partitions,
+                                    Tin, idx_vec, allocate));
+        return;
+      }
+
       typename UniqueOpHashMap<T, TIndex>::map_type uniq;
       uniq.reserve(2 * N);
       for (Eigen::Index i = 0, j = 0; i < N; ++i) {
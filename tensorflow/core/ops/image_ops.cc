@@ -511,6 +511,78 @@ REGISTER_OP("DecodeAndCropJpeg")
       return Status::OK();
     });
 
+// --------------------------------------------------------------------------
+REGISTER_OP("_DecodeCropAndResizeImage")
+    .Input("contents: string")
+    .Input("crop_window: int32")
+    .Input("size: int32")
+    .Attr("channels: int = 3")
+    .Attr("dct_method: string = ''")
+    .Output("image: float")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &unused));
+      int32_t channels;
+      TF_RETURN_IF_ERROR(c->GetAttr("channels", &channels));
+      TF_RETURN_IF_ERROR(SetOutputToSizedImage(c, c->MakeDim(1),
+                                               2 /* size_input_idx */,
+                                               c->MakeDim(channels)));
+      ShapeHandle image;
+      TF_RETURN_IF_ERROR(c->Subshape(c->output(0), 1, &image));
+      c->set_output(0, image);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Decodes a JPEG or PNG image, crops it and resizes it bilinearly in one pass.
+
+JPEG images are decoded at 1/2, 1/4 or 1/8 scale when the crop is still at
+least as large as `size` at that scale, and only the rows and columns of the
+crop are decoded.  The image is then sampled with half-pixel centers, like
+ResizeBilinear with `half_pixel_centers` set.
+
+contents: The JPEG or PNG-encoded image.
+crop_window: `[crop_y, crop_x, crop_height, crop_width]` in pixels of the
+  image, or empty to decode the whole image.
+size: `[new_height, new_width]`, the size of the output image.
+channels: The number of color channels of the output image.
+dct_method: The JPEG decompression method, as in DecodeJpeg.
+image: The resized crop, of shape `[new_height, new_width, channels]` and with
+  values in `[0, 255]`.
+)doc");
+
+REGISTER_OP("_BatchDecodeCropAndResizeImage")
+    .Input("contents: string")
+    .Input("crop_windows: int32")
+    .Input("size: int32")
+    .Attr("channels: int = 3")
+    .Attr("dct_method: string = ''")
+    .Output("images: float")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle contents;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 1, &contents));
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 2, &unused));
+      int32_t channels;
+      TF_RETURN_IF_ERROR(c->GetAttr("channels", &channels));
+      return SetOutputToSizedImage(c, c->Dim(contents, 0),
+                                   2 /* size_input_idx */,
+                                   c->MakeDim(channels));
+    })
+    .Doc(R"doc(
+Decodes, crops and resizes a batch of JPEG or PNG images, like
+_DecodeCropAndResizeImage, decoding the images in parallel.
+
+contents: The encoded images, a vector.
+crop_windows: The crop window of each image, of shape `[batch_size, 4]`, or
+  empty to decode the whole images.
+size: `[new_height, new_width]`, the size of the output images.
+channels: The number of color channels of the output images.
+dct_method: The JPEG decompression method, as in DecodeJpeg.
+images: The resized crops, of shape
+  `[batch_size, new_height, new_width, channels]`.
+)doc");
+
 // --------------------------------------------------------------------------
 REGISTER_OP("EncodeJpeg")
     .Input("image: uint8")
@@ -146,6 +146,78 @@ REGISTER_OP("MergeV2Checkpoints")
       return Status::OK();
     });
 
+REGISTER_OP("_LazyRestoredTensorHandle")
+    .Output("resource: resource")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .SetIsStateful()
+    .SetShapeFn(shape_inference::ScalarShape)
+    .Doc(R"doc(
+Creates a handle to a tensor restored lazily from a checkpoint, whose rows are
+read on first access by _LazyRestoredTensorGather.
+
+container: The container of the tensor.
+shared_name: The name of the tensor in its container.
+)doc");
+
+REGISTER_OP("_InitializeLazyRestoredTensor")
+    .Input("resource: resource")
+    .Input("prefix: string")
+    .Attr("tensor_name: string")
+    .Attr("dtype: type")
+    .Attr("max_resident_rows: int >= 1")
+    .Attr("use_mmap: bool = false")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Backs a lazily restored tensor by the tensor `tensor_name` of the V2 checkpoint
+`prefix`, instead of restoring it.
+
+The checkpoint is only opened: rows are read when gathered, and the
+`max_resident_rows` most recently gathered rows are kept in memory. The
+checkpoint must not be modified while the tensor is in use. Initializing the
+tensor again drops the rows it holds.
+
+resource: The handle of the tensor.
+prefix: The prefix of the V2 checkpoint.
+tensor_name: The name of the tensor in the checkpoint. It must have at least one
+  dimension and may only be partitioned along its first one.
+dtype: The dtype of the tensor, which must be of a fixed size.
+max_resident_rows: The maximum number of rows kept in memory.
+use_mmap: Whether to read the data files of the checkpoint through memory
+  mappings, where the file system supports them.
+)doc");
+
+REGISTER_OP("_LazyRestoredTensorGather")
+    .Input("resource: resource")
+    .Input("indices: Tindices")
+    .Output("output: dtype")
+    .Attr("dtype: type")
+    .Attr("Tindices: {int32,int64}")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &unused));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(
+          c->Concatenate(c->input(1), c->UnknownShape(), &out));
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Gathers rows of a lazily restored tensor, like ResourceGather, reading the rows
+that are not in memory from the checkpoint.
+
+resource: The handle of the tensor.
+indices: The rows to gather, indices in the first dimension of the tensor.
+output: The rows, of shape `indices.shape + tensor.shape[1:]`.
+)doc");
+
 REGISTER_OP("Save")
     .Input("filename: string")
     .Input("tensor_names: string")
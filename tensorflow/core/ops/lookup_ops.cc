@@ -481,6 +481,41 @@ REGISTER_OP("AnonymousMutableDenseHashTable")
     .SetIsStateful()
     .SetShapeFn(MutableDenseHashTableShapeFn);
 
+REGISTER_OP("MemoryMappedHashTable")
+    .Output("table_handle: resource")
+    .Attr("filename: string")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .Attr("use_node_name_sharing: bool = false")
+    .Attr("key_dtype: {int64, string}")
+    .Attr("value_dtype: {int64}")
+    .SetIsStateful()
+    .SetShapeFn(ScalarOutput);
+
+REGISTER_OP("AnonymousMemoryMappedHashTable")
+    .Output("table_handle: resource")
+    .Attr("filename: string")
+    .Attr("key_dtype: {int64, string}")
+    .Attr("value_dtype: {int64}")
+    .SetIsStateful()
+    .SetShapeFn(ScalarOutput);
+
+REGISTER_OP("WriteMemoryMappedHashTableFile")
+    .Input("filename: string")
+    .Input("keys: Tkey")
+    .Input("values: int64")
+    .Attr("Tkey: {int64, string}")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle handle;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 0, &handle));
+      ShapeHandle keys;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &keys));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &handle));
+      TF_RETURN_IF_ERROR(c->Merge(keys, handle, &handle));
+      return Status::OK();
+    });
+
 REGISTER_OP("InitializeTable")
     .Input("table_handle: Ref(string)")
     .Input("keys: Tkey")
@@ -1445,6 +1445,64 @@ REGISTER_OP("SparseSegmentSqrtNGrad")
     .Attr("Tsegmentids: {int32, int64} = DT_INT32")
     .SetShapeFn(SparseSegmentReductionGradShapeFn);
 
+REGISTER_OP("_FusedEmbeddingLookupSparse")
+    .Input("params: T")
+    .Input("ids: Tidx")
+    .Input("indices: Tidx")
+    .Input("segment_ids: Tsegmentids")
+    .Input("weights: num_weights * T")
+    .Output("output: T")
+    .Attr("T: {float, double}")
+    .Attr("Tidx: {int32, int64} = DT_INT32")
+    .Attr("Tsegmentids: {int32, int64} = DT_INT32")
+    .Attr("num_weights: int >= 0 = 0")
+    .Attr("combiner: {'sum', 'mean', 'sqrtn'} = 'sum'")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle params_shape;
+      TF_RETURN_IF_ERROR(c->WithRankAtLeast(c->input(0), 1, &params_shape));
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 1, &unused));
+
+      ShapeHandle indices_shape;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &indices_shape));
+      ShapeHandle segment_ids_shape;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 1, &segment_ids_shape));
+      TF_RETURN_IF_ERROR(c->Merge(indices_shape, segment_ids_shape, &unused));
+      int num_weights;
+      TF_RETURN_IF_ERROR(c->GetAttr("num_weights", &num_weights));
+      if (num_weights > 1) {
+        return errors::InvalidArgument("Expected at most one weights input.");
+      }
+      if (num_weights == 1) {
+        ShapeHandle weights_shape;
+        TF_RETURN_IF_ERROR(c->WithRank(c->input(4), 1, &weights_shape));
+        TF_RETURN_IF_ERROR(c->Merge(indices_shape, weights_shape, &unused));
+      }
+
+      ShapeHandle subshape;
+      TF_RETURN_IF_ERROR(c->Subshape(params_shape, 1, &subshape));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->Concatenate(
+          c->Vector(InferenceContext::kUnknownDim), subshape, &out));
+      c->set_output(0, out);
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Internal operation which is a composition of gathering embedding rows
+(GatherV2), optionally scaling them by per-row weights, and combining them per
+segment (SparseSegmentSum, SparseSegmentMean or SparseSegmentSqrtN): reserved
+for internal use.
+
+Row `i` of the combination is `params[ids[indices[i]]]`, scaled by
+`weights[i]` if a weights input is given, and is combined into output row
+`segment_ids[i]`. With weights, the "mean" and "sqrtn" combiners divide by the
+sum of the weights and the square root of the sum of the squared weights of
+each segment.
+
+Do not invoke this operator directly in Python. A fusion optimization is
+expected to create these operators.
+)doc");
+
 REGISTER_OP("All")
     .Input("input: bool")
     .Input("reduction_indices: Tidx")
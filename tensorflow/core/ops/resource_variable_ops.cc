@@ -160,6 +160,47 @@ Status ReadGrad(const AttrSlice& attrs, FunctionDef* g) {
 }
 REGISTER_OP_GRADIENT("ReadVariableOp", ReadGrad);
 
+REGISTER_OP("_TakeVariableDirtyRows")
+    .Input("resource: resource")
+    .Output("rows: int64")
+    .Output("all_rows: bool")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      c->set_output(0, c->Vector(c->UnknownDim()));
+      c->set_output(1, c->Scalar());
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Returns the rows of a resource variable updated since the last call, for delta
+checkpoints, and starts tracking anew.
+
+The first call starts the tracking of the variable and reports every row as
+updated. Rows are indices in the first dimension, updated by the sparse
+training and scatter ops on CPU.
+
+rows: The sorted indices of the updated rows, if not `all_rows`.
+all_rows: Whether every row may have been updated.
+)doc");
+
+REGISTER_OP("_SetVariableSparseUpdateMode")
+    .Input("resource: resource")
+    .Attr("mode: {'default', 'row_locks', 'lock_free'}")
+    .SetIsStateful()
+    .SetShapeFn(shape_inference::NoOutputs)
+    .Doc(R"doc(
+Sets how the sparse training ops, like `ResourceSparseApplyAdagrad`, lock a
+resource variable on CPU.
+
+With `default` they lock the variable for the whole update when `use_locking`
+is true, and update it "hogwild" otherwise. With `row_locks` concurrent updates
+run in parallel but lock each updated row, so that a row is never updated by
+two of them at a time. With `lock_free` they update it "hogwild", regardless of
+`use_locking`. The mode applies to the slots updated with the variable. Only
+`default` is supported for variables on other devices.
+
+mode: The sparse update mode.
+)doc");
+
 REGISTER_OP("DestroyResourceOp")
     .Input("resource: resource")
     .Attr("ignore_lookup_error: bool = true")
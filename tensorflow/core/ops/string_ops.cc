@@ -74,6 +74,27 @@ REGISTER_OP("StaticRegexFullMatch")
     .Output("output: bool")
     .SetShapeFn(shape_inference::UnchangedShape);
 
+REGISTER_OP("_StaticRegexFullMatchSet")
+    .Input("input: string")
+    .Output("output: num_patterns * bool")
+    .Attr("patterns: list(string)")
+    .Attr("num_patterns: int >= 1")
+    .SetShapeFn([](InferenceContext* c) {
+      for (int i = 0; i < c->num_outputs(); ++i) {
+        c->set_output(i, c->input(0));
+      }
+      return Status::OK();
+    })
+    .Doc(R"doc(
+Internal operation which full-matches the input against every pattern in one
+pass, and is equivalent to one StaticRegexFullMatch per pattern: reserved for
+internal use.
+
+input: A string tensor of the text to be processed.
+output: For every pattern, a bool tensor with the same shape as `input`.
+patterns: The regular expressions to match the input against.
+)doc");
+
 REGISTER_OP("StringToHashBucketFast")
     .Input("input: string")
     .Output("output: int64")
@@ -40,6 +40,13 @@ inline uint64 StrongKeyedHash(const tensorflow::uint64 (&key)[2],
       {key[0], key[1]}, s);
 }
 
+// Same as above, for the `n` bytes at `data`. Avoids copying the input into a
+// string.
+inline uint64 StrongKeyedHash(const tensorflow::uint64 (&key)[2],
+                              const char* data, size_t n) {
+  return highwayhash::SipHash({key[0], key[1]}, data, n);
+}
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_PLATFORM_STRONG_HASH_H_
@@ -0,0 +1,230 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/tensor_bundle/delta_bundle.h"
+
+#include <cstring>
+#include <set>
+#include <utility>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+
+const char* const kDeltaBaseKey = ".DELTA/base";
+
+namespace {
+
+const char kDeltaRowsSuffix[] = "/.DELTA/rows";
+const char kDeltaValuesSuffix[] = "/.DELTA/values";
+
+// Chains longer than this are assumed to be cyclic.
+constexpr size_t kMaxChainLength = 10000;
+
+// Copies the rows "rows" of "values" into the corresponding rows of "val".
+Status ApplyDeltaRows(StringPiece key, const Tensor& rows,
+                      const Tensor& values, Tensor* val) {
+  if (rows.dtype() != DT_INT64 || rows.dims() != 1) {
+    return errors::DataLoss("Invalid delta rows of ", key, ": ",
+                            rows.DebugString());
+  }
+  bool compatible = val->dims() > 0 && values.dtype() == val->dtype() &&
+                    values.dims() == val->dims() &&
+                    values.dim_size(0) == rows.NumElements();
+  for (int d = 1; compatible && d < val->dims(); ++d) {
+    compatible = values.dim_size(d) == val->dim_size(d);
+  }
+  if (!compatible) {
+    return errors::DataLoss("Delta of ", key, " has values ",
+                            values.DebugString(), " for ", rows.NumElements(),
+                            " rows, incompatible with ", val->DebugString());
+  }
+
+  const int64_t num_rows = val->dim_size(0);
+  const auto rows_flat = rows.flat<int64_t>();
+  for (int64_t i = 0; i < rows_flat.size(); ++i) {
+    if (rows_flat(i) < 0 || rows_flat(i) >= num_rows) {
+      return errors::DataLoss("Delta of ", key, " updates row ", rows_flat(i),
+                              ", not in [0, ", num_rows, ")");
+    }
+  }
+  if (DataTypeCanUseMemcpy(val->dtype())) {
+    const int64_t row_bytes = num_rows == 0 ? 0 : val->TotalBytes() / num_rows;
+    char* dst = const_cast<char*>(val->tensor_data().data());
+    const char* src = values.tensor_data().data();
+    for (int64_t i = 0; i < rows_flat.size(); ++i) {
+      memcpy(dst + rows_flat(i) * row_bytes, src + i * row_bytes, row_bytes);
+    }
+  } else if (val->dtype() == DT_STRING) {
+    auto dst = val->flat_outer_dims<tstring>();
+    const auto src = values.flat_outer_dims<tstring>();
+    for (int64_t i = 0; i < rows_flat.size(); ++i) {
+      for (int64_t j = 0; j < dst.dimension(1); ++j) {
+        dst(rows_flat(i), j) = src(i, j);
+      }
+    }
+  } else {
+    return errors::Unimplemented("Delta of ", key, " has unsupported dtype ",
+                                 DataTypeString(val->dtype()));
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+string DeltaRowsKey(StringPiece key) {
+  return strings::StrCat(key, kDeltaRowsSuffix);
+}
+
+string DeltaValuesKey(StringPiece key) {
+  return strings::StrCat(key, kDeltaValuesSuffix);
+}
+
+DeltaBundleWriter::DeltaBundleWriter(Env* env, StringPiece prefix,
+                                     StringPiece base_prefix,
+                                     const BundleWriter::Options& options)
+    : base_prefix_(base_prefix), writer_(env, prefix, options) {}
+
+Status DeltaBundleWriter::AddRows(StringPiece key, const Tensor& rows,
+                                  const Tensor& values) {
+  if (rows.dtype() != DT_INT64 || rows.dims() != 1) {
+    return errors::InvalidArgument("Rows of ", key,
+                                   " must be an int64 vector, got ",
+                                   rows.DebugString());
+  }
+  if (values.dims() < 1 || values.dim_size(0) != rows.NumElements()) {
+    return errors::InvalidArgument("Values of ", key, " must have ",
+                                   rows.NumElements(), " rows, got ",
+                                   values.DebugString());
+  }
+  TF_RETURN_IF_ERROR(writer_.Add(DeltaRowsKey(key), rows));
+  return writer_.Add(DeltaValuesKey(key), values);
+}
+
+Status DeltaBundleWriter::Finish() {
+  Tensor base(DT_STRING, TensorShape({}));
+  base.scalar<tstring>()() = base_prefix_;
+  TF_RETURN_IF_ERROR(writer_.Add(kDeltaBaseKey, base));
+  return writer_.Finish();
+}
+
+DeltaBundleReader::DeltaBundleReader(Env* env, StringPiece prefix)
+    : prefix_(prefix) {
+  string current = prefix_;
+  while (true) {
+    if (chain_.size() >= kMaxChainLength) {
+      status_ = errors::InvalidArgument(
+          "The chain of delta bundles ending at ", prefix_, " is longer than ",
+          kMaxChainLength, " bundles, or is cyclic");
+      return;
+    }
+    std::unique_ptr<BundleReader> reader(new BundleReader(env, current));
+    status_ = reader->status();
+    if (!status_.ok()) return;
+    const bool is_delta = reader->Contains(kDeltaBaseKey);
+    Tensor base;
+    if (is_delta) {
+      status_ = reader->Lookup(kDeltaBaseKey, &base);
+      if (!status_.ok()) return;
+      if (base.dtype() != DT_STRING || base.NumElements() != 1) {
+        status_ = errors::DataLoss("Invalid base of delta bundle ", current,
+                                   ": ", base.DebugString());
+        return;
+      }
+    }
+    chain_.push_back(std::move(reader));
+    if (!is_delta) return;
+
+    string base_prefix(base.flat<tstring>()(0));
+    if (!io::IsAbsolutePath(base_prefix)) {
+      base_prefix = io::JoinPath(io::Dirname(current), base_prefix);
+    }
+    current = std::move(base_prefix);
+  }
+}
+
+Status DeltaBundleReader::ListKeys(std::vector<string>* keys) {
+  std::set<string> all_keys;
+  for (const auto& reader : chain_) {
+    for (reader->Seek(kHeaderEntryKey); reader->Valid(); reader->Next()) {
+      StringPiece key = reader->key();
+      // Skips the header, the base, the values of deltas and the slices of
+      // partitioned tensors, whose encoded keys start with '\0'.
+      if (key.empty() || key == kDeltaBaseKey || key[0] == '\0' ||
+          absl::EndsWith(key, kDeltaValuesSuffix)) {
+        continue;
+      }
+      absl::ConsumeSuffix(&key, kDeltaRowsSuffix);
+      all_keys.emplace(key);
+    }
+  }
+  keys->assign(all_keys.begin(), all_keys.end());
+  return Status::OK();
+}
+
+Status DeltaBundleReader::Lookup(StringPiece key, Tensor* val) {
+  // Finds the newest full value.
+  size_t full = 0;
+  while (full < chain_.size() && !chain_[full]->Contains(key)) ++full;
+  if (full == chain_.size()) {
+    return errors::NotFound("Key ", key, " not found in checkpoint ", prefix_);
+  }
+  BundleReader* full_reader = chain_[full].get();
+  if (val->NumElements() == 0) {
+    // Also allocates partitioned tensors, which BundleReader does not.
+    DataType dtype;
+    TensorShape shape;
+    TF_RETURN_IF_ERROR(full_reader->LookupDtypeAndShape(key, &dtype, &shape));
+    *val = Tensor(dtype, shape);
+  }
+  TF_RETURN_IF_ERROR(full_reader->Lookup(key, val));
+
+  // Applies the newer deltas, oldest first.
+  const string rows_key = DeltaRowsKey(key);
+  for (size_t i = full; i-- > 0;) {
+    BundleReader* reader = chain_[i].get();
+    if (!reader->Contains(rows_key)) continue;
+    Tensor rows;
+    Tensor values;
+    TF_RETURN_IF_ERROR(reader->Lookup(rows_key, &rows));
+    TF_RETURN_IF_ERROR(reader->Lookup(DeltaValuesKey(key), &values));
+    TF_RETURN_IF_ERROR(ApplyDeltaRows(key, rows, values, val));
+  }
+  return Status::OK();
+}
+
+Status CompactDeltaBundles(Env* env, StringPiece prefix,
+                           StringPiece output_prefix) {
+  DeltaBundleReader reader(env, prefix);
+  TF_RETURN_IF_ERROR(reader.status());
+  std::vector<string> keys;
+  TF_RETURN_IF_ERROR(reader.ListKeys(&keys));
+
+  BundleWriter writer(env, output_prefix);
+  TF_RETURN_IF_ERROR(writer.status());
+  for (const string& key : keys) {
+    Tensor val;
+    TF_RETURN_IF_ERROR(reader.Lookup(key, &val));
+    TF_RETURN_IF_ERROR(writer.Add(key, val));
+  }
+  return writer.Finish();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,133 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Delta checkpoints: tensor bundles that only store what changed since a base
+// checkpoint, such as the updated rows of large embedding tables.
+//
+// A delta bundle is a regular tensor bundle with these entries:
+//
+//   kDeltaBaseKey        -> scalar string, the prefix of the base bundle,
+//                           which may itself be a delta bundle.  A relative
+//                           prefix is relative to the directory of the delta.
+//   key                  -> the full value of "key", which replaces the value
+//                           in the base, as in a regular bundle.
+//   DeltaRowsKey(key)    -> int64 vector, rows (indices in the first
+//                           dimension) of "key" updated since the base.
+//   DeltaValuesKey(key)  -> the values of these rows, in the same order.
+//
+// Tensors without any entry are unchanged since the base.  Reading a tensor
+// starts from its newest full value in the chain of bundles, then applies the
+// rows of the newer deltas, oldest first.
+//
+// The chain of a delta bundle must remain unmodified while it is in use.
+// CompactDeltaBundles() turns a chain into a regular bundle.
+
+#ifndef TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_DELTA_BUNDLE_H_
+#define TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_DELTA_BUNDLE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+
+// The key of the base prefix of a delta bundle.  Also used to tell delta
+// bundles from regular ones.
+extern const char* const kDeltaBaseKey;
+
+// Returns the keys of the updated rows of "key" and of their values.
+string DeltaRowsKey(StringPiece key);
+string DeltaValuesKey(StringPiece key);
+
+// Builds a delta bundle of the bundle at "base_prefix".
+//
+// All threads accessing the same DeltaBundleWriter must synchronize.
+class DeltaBundleWriter {
+ public:
+  DeltaBundleWriter(Env* env, StringPiece prefix, StringPiece base_prefix,
+                    const BundleWriter::Options& options =
+                        BundleWriter::Options());
+
+  Status status() const { return writer_.status(); }
+
+  // Adds the full value of "key", which replaces its value in the base.
+  Status Add(StringPiece key, const Tensor& val) {
+    return writer_.Add(key, val);
+  }
+
+  // Adds the new values of the rows "rows" of "key", an int64 vector, with
+  // "values" holding the rows in the same order.  The other rows keep their
+  // values in the base.
+  Status AddRows(StringPiece key, const Tensor& rows, const Tensor& values);
+
+  // Finishes the writer and flushes.
+  Status Finish() TF_MUST_USE_RESULT;
+
+ private:
+  const string base_prefix_;
+  BundleWriter writer_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(DeltaBundleWriter);
+};
+
+// Reads the tensors of a bundle, merging the chain of deltas it ends if it is
+// a delta bundle.  Also reads regular bundles, as chains of length 1.
+//
+// All threads accessing the same DeltaBundleReader must synchronize.
+class DeltaBundleReader {
+ public:
+  DeltaBundleReader(Env* env, StringPiece prefix);
+
+  // Is ok() iff all the bundles of the chain were opened.
+  Status status() const { return status_; }
+
+  // The number of bundles in the chain, including the base.
+  int chain_length() const { return chain_.size(); }
+
+  // Returns the sorted keys of all the tensors of the chain.
+  // REQUIRES: status().ok()
+  Status ListKeys(std::vector<string>* keys) TF_MUST_USE_RESULT;
+
+  // Looks up the merged value of "key".  As with BundleReader::Lookup(), a
+  // "val" with elements must already have the stored shape and dtype and is
+  // filled in place, while an empty "val" is assigned a new tensor.
+  // REQUIRES: status().ok()
+  Status Lookup(StringPiece key, Tensor* val) TF_MUST_USE_RESULT;
+
+ private:
+  const string prefix_;
+  Status status_;
+  // The bundles of the chain, newest first.
+  std::vector<std::unique_ptr<BundleReader>> chain_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(DeltaBundleReader);
+};
+
+// Writes the merged tensors of the bundle at "prefix", a delta bundle or a
+// regular one, as a regular bundle at "output_prefix".  Partitioned tensors
+// are written in full.  Reads one tensor at a time.
+Status CompactDeltaBundles(Env* env, StringPiece prefix,
+                           StringPiece output_prefix);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_DELTA_BUNDLE_H_
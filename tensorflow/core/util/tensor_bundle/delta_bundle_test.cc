@@ -0,0 +1,180 @@
+/* Copyright 2021 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/util/tensor_bundle/delta_bundle.h"
+
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+namespace {
+
+string Prefix(const string& prefix) {
+  return strings::StrCat(testing::TmpDir(), "/", prefix);
+}
+
+// Writes the base bundle: a 4x2 float "embedding", a 3-element string
+// "vocab" and a scalar "step".
+void WriteBase(const string& prefix) {
+  BundleWriter writer(Env::Default(), Prefix(prefix));
+  TF_ASSERT_OK(writer.Add("embedding",
+                          test::AsTensor<float>({0, 0, 1, 1, 2, 2, 3, 3},
+                                                TensorShape({4, 2}))));
+  TF_ASSERT_OK(writer.Add("vocab", test::AsTensor<tstring>({"a", "b", "c"})));
+  TF_ASSERT_OK(writer.Add("step", test::AsScalar<int64_t>(0)));
+  TF_ASSERT_OK(writer.Finish());
+}
+
+// Writes a chain of two deltas on top of the base, "delta_1" updating row 1
+// of "embedding" and "delta_2" updating rows 1 and 3 of "embedding", row 0 of
+// "vocab" and all of "step".
+void WriteChain() {
+  WriteBase("base");
+  {
+    // A relative base, in the same directory.
+    DeltaBundleWriter writer(Env::Default(), Prefix("delta_1"), "base");
+    TF_ASSERT_OK(
+        writer.AddRows("embedding", test::AsTensor<int64_t>({1}),
+                       test::AsTensor<float>({10, 10}, TensorShape({1, 2}))));
+    TF_ASSERT_OK(writer.Add("step", test::AsScalar<int64_t>(1)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  {
+    DeltaBundleWriter writer(Env::Default(), Prefix("delta_2"),
+                             Prefix("delta_1"));
+    TF_ASSERT_OK(writer.AddRows(
+        "embedding", test::AsTensor<int64_t>({3, 1}),
+        test::AsTensor<float>({30, 30, 11, 11}, TensorShape({2, 2}))));
+    TF_ASSERT_OK(writer.AddRows("vocab", test::AsTensor<int64_t>({0}),
+                                test::AsTensor<tstring>({"z"})));
+    TF_ASSERT_OK(writer.Add("step", test::AsScalar<int64_t>(2)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+}
+
+void ExpectMergedChain(DeltaBundleReader* reader) {
+  Tensor embedding;
+  TF_ASSERT_OK(reader->Lookup("embedding", &embedding));
+  test::ExpectTensorEqual<float>(
+      embedding, test::AsTensor<float>({0, 0, 11, 11, 2, 2, 30, 30},
+                                       TensorShape({4, 2})));
+  Tensor vocab;
+  TF_ASSERT_OK(reader->Lookup("vocab", &vocab));
+  test::ExpectTensorEqual<tstring>(vocab,
+                                   test::AsTensor<tstring>({"z", "b", "c"}));
+  // Preallocated.
+  Tensor step(DT_INT64, TensorShape({}));
+  TF_ASSERT_OK(reader->Lookup("step", &step));
+  test::ExpectTensorEqual<int64_t>(step, test::AsScalar<int64_t>(2));
+}
+
+TEST(DeltaBundleTest, MergesChain) {
+  WriteChain();
+  DeltaBundleReader reader(Env::Default(), Prefix("delta_2"));
+  TF_ASSERT_OK(reader.status());
+  EXPECT_EQ(3, reader.chain_length());
+  ExpectMergedChain(&reader);
+
+  std::vector<string> keys;
+  TF_ASSERT_OK(reader.ListKeys(&keys));
+  EXPECT_EQ(keys, std::vector<string>({"embedding", "step", "vocab"}));
+
+  Tensor missing;
+  EXPECT_TRUE(errors::IsNotFound(reader.Lookup("missing", &missing)));
+}
+
+TEST(DeltaBundleTest, ReadsIntermediateDelta) {
+  WriteChain();
+  DeltaBundleReader reader(Env::Default(), Prefix("delta_1"));
+  TF_ASSERT_OK(reader.status());
+  EXPECT_EQ(2, reader.chain_length());
+  Tensor embedding;
+  TF_ASSERT_OK(reader.Lookup("embedding", &embedding));
+  test::ExpectTensorEqual<float>(
+      embedding, test::AsTensor<float>({0, 0, 10, 10, 2, 2, 3, 3},
+                                       TensorShape({4, 2})));
+}
+
+TEST(DeltaBundleTest, ReadsRegularBundle) {
+  WriteBase("regular");
+  DeltaBundleReader reader(Env::Default(), Prefix("regular"));
+  TF_ASSERT_OK(reader.status());
+  EXPECT_EQ(1, reader.chain_length());
+  Tensor step;
+  TF_ASSERT_OK(reader.Lookup("step", &step));
+  test::ExpectTensorEqual<int64_t>(step, test::AsScalar<int64_t>(0));
+}
+
+TEST(DeltaBundleTest, Compacts) {
+  WriteChain();
+  TF_ASSERT_OK(CompactDeltaBundles(Env::Default(), Prefix("delta_2"),
+                                   Prefix("compacted")));
+  // A regular bundle.
+  BundleReader bundle_reader(Env::Default(), Prefix("compacted"));
+  TF_ASSERT_OK(bundle_reader.status());
+  EXPECT_FALSE(bundle_reader.Contains(kDeltaBaseKey));
+
+  DeltaBundleReader reader(Env::Default(), Prefix("compacted"));
+  TF_ASSERT_OK(reader.status());
+  EXPECT_EQ(1, reader.chain_length());
+  ExpectMergedChain(&reader);
+}
+
+TEST(DeltaBundleTest, InvalidRows) {
+  WriteBase("invalid_rows_base");
+  {
+    DeltaBundleWriter writer(Env::Default(), Prefix("invalid_rows"),
+                             "invalid_rows_base");
+    const Tensor row_values =
+        test::AsTensor<float>({1, 1}, TensorShape({1, 2}));
+    // The rows must be int64.
+    EXPECT_FALSE(
+        writer.AddRows("embedding", test::AsTensor<int32>({1}), row_values)
+            .ok());
+    // Out of range.
+    TF_ASSERT_OK(writer.AddRows("embedding", test::AsTensor<int64_t>({4}),
+                                row_values));
+    // Rows of the wrong shape.
+    TF_ASSERT_OK(writer.AddRows(
+        "vocab", test::AsTensor<int64_t>({0}),
+        test::AsTensor<tstring>({"x", "y"}, TensorShape({1, 2}))));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  DeltaBundleReader reader(Env::Default(), Prefix("invalid_rows"));
+  TF_ASSERT_OK(reader.status());
+  Tensor embedding;
+  EXPECT_TRUE(errors::IsDataLoss(reader.Lookup("embedding", &embedding)));
+  Tensor vocab;
+  EXPECT_TRUE(errors::IsDataLoss(reader.Lookup("vocab", &vocab)));
+}
+
+TEST(DeltaBundleTest, MissingBase) {
+  {
+    DeltaBundleWriter writer(Env::Default(), Prefix("orphan"), "nonexistent");
+    TF_ASSERT_OK(writer.Add("step", test::AsScalar<int64_t>(1)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  DeltaBundleReader reader(Env::Default(), Prefix("orphan"));
+  EXPECT_TRUE(errors::IsNotFound(reader.status()));
+}
+
+}  // namespace
+}  // namespace tensorflow
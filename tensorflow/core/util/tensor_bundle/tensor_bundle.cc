@@ -16,11 +16,16 @@ limitations under the License.
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <map>
 #include <memory>
 #include <utility>
 
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
@@ -33,10 +38,13 @@ limitations under the License.
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/lib/core/coding.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/lib/hash/crc32c.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/io/table_builder.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/lib/monitoring/sampler.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
@@ -44,6 +52,7 @@ limitations under the License.
 #include "tensorflow/core/platform/cord.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
 #include "tensorflow/core/util/tensor_bundle/byte_swap.h"
@@ -63,6 +72,17 @@ const int kTensorBundleVersion = 1;
 // Size of our input buffer for streaming reads
 static const int kBufferSize = 1024 * 1024;
 
+// BundleReader::LookupTensors() reads the data of memcpy-able tensors in chunks
+// of at most this many bytes, so that the chunks of a large tensor are read
+// concurrently.
+static const int64_t kReadChunkBytes = 64 << 20;
+
+// Memory-mapped tensor data is faulted in by touching one byte per page.
+static const int64_t kPageBytes = 4096;
+
+// Size of the write buffer of the data file.
+static const size_t kWriteBufferBytes = 8 << 20;
+
 // Key to the special BundleHeaderProto entry.  Do not change this, as clients
 // can make the assumption that the header is always the first entry in the
 // bundle.
@@ -383,6 +403,96 @@ Status CorruptFileError(const Status& in_status, const string& filename,
                       detail, "): ", in_status.error_message()));
 }
 
+// Validates the "size" field of "entry" against the tensor "val" that its data
+// is read into.
+Status CheckEntrySize(StringPiece key, const BundleEntryProto& entry,
+                      const Tensor& val) {
+  if (entry.dtype() != DT_STRING && entry.dtype() != DT_VARIANT) {
+    if (entry.size() != val.TotalBytes()) {
+      return errors::DataLoss("Invalid size in bundle entry: key ", key,
+                              "; stored size ", entry.size(),
+                              "; expected size ", val.TotalBytes());
+    }
+  } else if (entry.dtype() == DT_STRING) {
+    // Relaxes the check for string tensors as follows:
+    //   entry.size() == bytes(varint lengths) + bytes(data)
+    //                >= NumElems + bytes(data), since size bytes(varint) >= 1.
+    //   TotalBytes() == sizeof(tstring) * NumElems + bytes(data)
+    // Since we don't know bytes(varint lengths), we just check an inequality.
+    const size_t lower_bound = val.NumElements() + val.TotalBytes() -
+                               sizeof(tstring) * val.NumElements();
+    if (entry.size() < lower_bound) {
+      return errors::DataLoss("Invalid size in bundle entry: key ", key,
+                              "; stored size ", entry.size(),
+                              "; expected size is at least ", lower_bound);
+    }
+  }
+  return Status::OK();
+}
+
+// Compares the checksum stored in "entry" with the one of the restored bytes.
+Status CheckEntryChecksum(const string& prefix, const BundleEntryProto& entry,
+                          uint32 actual_crc32c) {
+  if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+    return errors::DataLoss(
+        "TensorBundle at ", prefix, " shard ", entry.shard_id(), " (",
+        entry.size(), " bytes): Checksum does not match: stored ",
+        strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+        " vs. calculated on the restored bytes ", actual_crc32c);
+  }
+  return Status::OK();
+}
+
+// Returns in "data" the bytes of "entry" in the mapped data file "file".
+Status GetMappedData(ReadOnlyMemoryRegion* file, const BundleEntryProto& entry,
+                     const char** data) {
+  if (entry.offset() < 0 || entry.size() < 0 ||
+      static_cast<uint64>(entry.offset() + entry.size()) > file->length()) {
+    return errors::DataLoss("Bundle entry [", entry.offset(), ", ",
+                            entry.offset() + entry.size(),
+                            ") is past the end of data file shard ",
+                            entry.shard_id(), " of ", file->length(),
+                            " bytes");
+  }
+  *data = static_cast<const char*>(file->data()) + entry.offset();
+  return Status::OK();
+}
+
+// A TensorBuffer aliasing tensor data in a memory-mapped data file.  Keeps the
+// mapping alive.
+class MappedTensorBuffer : public TensorBuffer {
+ public:
+  MappedTensorBuffer(std::shared_ptr<ReadOnlyMemoryRegion> file,
+                     const char* data, size_t size)
+      : TensorBuffer(const_cast<char*>(data)),
+        file_(std::move(file)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("mmap");
+  }
+  // The mapping is read-only, so the buffer must never be forwarded to an op
+  // that writes its output in place.
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<ReadOnlyMemoryRegion> file_;
+  const size_t size_;
+};
+
+auto* checkpoint_read_bytes = monitoring::Counter<0>::New(
+    "/tensorflow/core/checkpoint/read/bytes",
+    "The number of tensor bytes read by BundleReader::LookupTensors().");
+
+auto* checkpoint_read_bandwidth = monitoring::Sampler<0>::New(
+    {"/tensorflow/core/checkpoint/read/bandwidth",
+     "The bandwidth, in MB/s, of BundleReader::LookupTensors() calls."},
+    // Power of 2 with bucket count 20 (> 500 GB/s)
+    {monitoring::Buckets::Exponential(1, 2, 20)});
+
 table::Options TableBuilderOptions() {
   table::Options o;
   // Compressed tables cannot be read by TensorFlow releases prior to 1.1.
@@ -433,11 +543,20 @@ BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
   status_ = env_->NewWritableFile(data_path_, &wrapper);
   if (!status_.ok()) return;
   out_ = std::unique_ptr<FileOutputBuffer>(
-      new FileOutputBuffer(wrapper.release(), 8 << 20 /* 8MB write buffer */));
+      new FileOutputBuffer(wrapper.release(), kWriteBufferBytes));
+
+  if (options_.num_threads > 0) {
+    checksum_pool_.reset(new thread::ThreadPool(env_, "bundle_writer_checksum",
+                                                options_.num_threads));
+    write_thread_.reset(env_->StartThread(ThreadOptions(), "bundle_writer",
+                                          [this]() { WriteLoop(); }));
+  }
 
   VLOG(1) << "Writing to file " << data_path_;
 }
 
+BundleWriter::~BundleWriter() { StopPipeline(); }
+
 Status BundleWriter::Add(StringPiece key, const Tensor& val) {
   if (!status_.ok()) return status_;
   CHECK_NE(key, kHeaderEntryKey);
@@ -453,6 +572,17 @@ Status BundleWriter::Add(StringPiece key, const Tensor& val) {
   entry->set_shard_id(0);
   entry->set_offset(size_);
 
+  if (write_thread_ != nullptr) {
+    if (DataTypeCanUseMemcpy(val.dtype())) {
+      status_ = AddPipelined(val, entry);
+      return status_;
+    }
+    // Strings and variants are serialized straight into the data file, after
+    // the queued tensors.
+    status_ = WaitForPendingWrites();
+    if (!status_.ok()) return status_;
+  }
+
   // Updates the data file.
   size_t data_bytes_written = 0;
   uint32 crc32c = 0;
@@ -475,6 +605,108 @@ Status BundleWriter::Add(StringPiece key, const Tensor& val) {
   return status_;
 }
 
+Status BundleWriter::AddPipelined(const Tensor& val, BundleEntryProto* entry) {
+  const size_t size = val.TotalBytes();
+  {
+    mutex_lock l(mu_);
+    while (write_status_.ok() && pending_bytes_ > 0 &&
+           pending_bytes_ + static_cast<int64_t>(size) >
+               options_.max_pending_bytes) {
+      cv_.wait(l);
+    }
+    TF_RETURN_IF_ERROR(write_status_);
+    pending_bytes_ += size;
+    ++num_pending_writes_;
+  }
+
+  // The snapshot is shared by the checksum and the write, and released once
+  // both are done.
+  char* buffer = static_cast<char*>(port::AlignedMalloc(
+      std::max<size_t>(size, 1), Allocator::kAllocatorAlignment));
+  if (size > 0) memcpy(buffer, val.tensor_data().data(), size);
+  std::shared_ptr<const char> snapshot(buffer, [this, size](const char* p) {
+    port::AlignedFree(const_cast<char*>(p));
+    mutex_lock l(mu_);
+    pending_bytes_ -= size;
+    cv_.notify_all();
+  });
+
+  entry->set_size(size);
+  size_ += size;
+  const int bytes_over = size_ % options_.data_alignment;
+  const int padding =
+      bytes_over == 0 ? 0 : options_.data_alignment - bytes_over;
+  size_ += padding;
+
+  // Small tensors are batched in the write buffer, which checksums them as
+  // they are appended.  Large ones are handed to the file as is, rather than
+  // copied once more, and checksummed meanwhile.
+  const bool buffered = size < kWriteBufferBytes;
+  if (!buffered) {
+    checksum_pool_->Schedule([entry, snapshot, size]() {
+      entry->set_crc32c(crc32c::Mask(crc32c::Value(snapshot.get(), size)));
+    });
+  }
+  mutex_lock l(mu_);
+  writes_.push_back([this, entry, snapshot, size, padding,
+                     buffered]() -> Status {
+    const StringPiece data(snapshot.get(), size);
+    if (buffered) {
+      out_->clear_crc32c();
+      TF_RETURN_IF_ERROR(out_->Append(data));
+      entry->set_crc32c(crc32c::Mask(out_->crc32c()));
+    } else {
+      TF_RETURN_IF_ERROR(out_->AppendUnbuffered(data));
+    }
+    if (padding > 0) {
+      TF_RETURN_IF_ERROR(out_->Append(string(padding, '\0')));
+    }
+    return Status::OK();
+  });
+  cv_.notify_all();
+  return Status::OK();
+}
+
+Status BundleWriter::WaitForPendingWrites() {
+  mutex_lock l(mu_);
+  while (num_pending_writes_ > 0) cv_.wait(l);
+  return write_status_;
+}
+
+void BundleWriter::StopPipeline() {
+  if (write_thread_ == nullptr) return;
+  {
+    mutex_lock l(mu_);
+    stopping_ = true;
+    cv_.notify_all();
+  }
+  // Joins the threads.  The write thread drains the queue first.
+  write_thread_.reset();
+  checksum_pool_.reset();
+}
+
+void BundleWriter::WriteLoop() {
+  while (true) {
+    std::function<Status()> write;
+    bool failed;
+    {
+      mutex_lock l(mu_);
+      while (writes_.empty() && !stopping_) cv_.wait(l);
+      if (writes_.empty()) return;
+      write = std::move(writes_.front());
+      writes_.pop_front();
+      failed = !write_status_.ok();
+    }
+    // After an error, the remaining writes only release their snapshots.
+    Status s = failed ? Status::OK() : write();
+    write = nullptr;
+    mutex_lock l(mu_);
+    write_status_.Update(s);
+    --num_pending_writes_;
+    cv_.notify_all();
+  }
+}
+
 Status BundleWriter::AddSlice(StringPiece full_tensor_key,
                               const TensorShape& full_tensor_shape,
                               const TensorSlice& slice_spec,
@@ -519,6 +751,11 @@ Status BundleWriter::AddSlice(StringPiece full_tensor_key,
 // TODO(zongheng): on metadata write failure or !status_.ok(), consider removing
 // the orphaned data file.
 Status BundleWriter::Finish() {
+  if (write_thread_ != nullptr) {
+    StopPipeline();
+    mutex_lock l(mu_);
+    status_.Update(write_status_);
+  }
   if (out_) {
     status_.Update(out_->Close());
     out_ = nullptr;
@@ -743,9 +980,11 @@ Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
 
 // Interface for reading a tensor bundle.
 
-BundleReader::BundleReader(Env* env, StringPiece prefix)
+BundleReader::BundleReader(Env* env, StringPiece prefix,
+                           const Options& options)
     : env_(env),
       prefix_(prefix),
+      options_(options),
       metadata_(nullptr),
       table_(nullptr),
       index_cache_(nullptr),
@@ -818,6 +1057,7 @@ BundleReader::~BundleReader() {
     delete temp.second;
   }
   data_.clear();
+  mapped_data_.clear();
   tensor_slices_.clear();
 }
 
@@ -842,6 +1082,39 @@ Status BundleReader::GetBundleEntryProto(StringPiece key,
   return Status::OK();
 }
 
+Status BundleReader::GetDataFile(int32 shard_id,
+                                 io::InputBuffer** buffered_file) {
+  // Open the data file if it has not been opened.
+  io::InputBuffer*& file_buffer = data_[shard_id];
+  if (file_buffer == nullptr) {
+    std::unique_ptr<RandomAccessFile> file = nullptr;
+    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
+        DataFilename(prefix_, shard_id, num_shards_), &file));
+    file_buffer = new io::InputBuffer(file.release(), kBufferSize);
+    // The InputBuffer and RandomAccessFile objects are both released in dtor.
+  }
+  *buffered_file = file_buffer;
+  return Status::OK();
+}
+
+std::shared_ptr<ReadOnlyMemoryRegion> BundleReader::GetMappedDataFile(
+    int32 shard_id) {
+  if (!options_.use_mmap) return nullptr;
+  auto it = mapped_data_.find(shard_id);
+  if (it != mapped_data_.end()) return it->second;
+  const string filename = DataFilename(prefix_, shard_id, num_shards_);
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  Status s = env_->NewReadOnlyMemoryRegionFromFile(filename, &region);
+  if (!s.ok()) {
+    // Not all file systems support mapping files; read those normally.
+    VLOG(1) << "Reading " << filename << " without mmap: " << s;
+    region.reset();
+  }
+  std::shared_ptr<ReadOnlyMemoryRegion> mapped_file(region.release());
+  mapped_data_[shard_id] = mapped_file;
+  return mapped_file;
+}
+
 Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
   Tensor* ret = val;
   const TensorShape stored_shape(TensorShape(entry.shape()));
@@ -850,55 +1123,34 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
   }
 
   // Validates the "size" field.
-  if (entry.dtype() != DT_STRING && entry.dtype() != DT_VARIANT) {
-    if (entry.size() != ret->TotalBytes()) {
-      return errors::DataLoss("Invalid size in bundle entry: key ", key(),
-                              "; stored size ", entry.size(),
-                              "; expected size ", ret->TotalBytes());
-    }
-  } else if (entry.dtype() == DT_STRING) {
-    // Relaxes the check for string tensors as follows:
-    //   entry.size() == bytes(varint lengths) + bytes(data)
-    //                >= NumElems + bytes(data), since size bytes(varint) >= 1.
-    //   TotalBytes() == sizeof(tstring) * NumElems + bytes(data)
-    // Since we don't know bytes(varint lengths), we just check an inequality.
-    const size_t lower_bound = ret->NumElements() + ret->TotalBytes() -
-                               sizeof(tstring) * ret->NumElements();
-    if (entry.size() < lower_bound) {
-      return errors::DataLoss("Invalid size in bundle entry: key ", key(),
-                              "; stored size ", entry.size(),
-                              "; expected size is at least ", lower_bound);
-    }
-  }
-
-  // Open the data file if it has not been opened.
-  io::InputBuffer* buffered_file = data_[entry.shard_id()];
-  if (buffered_file == nullptr) {
-    std::unique_ptr<RandomAccessFile> file = nullptr;
-    TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
-        DataFilename(prefix_, entry.shard_id(), num_shards_), &file));
-    buffered_file = new io::InputBuffer(file.release(), kBufferSize);
-    // The InputBuffer and RandomAccessFile objects are both released in dtor.
-    data_[entry.shard_id()] = buffered_file;
-  }
-  CHECK(buffered_file != nullptr);
+  TF_RETURN_IF_ERROR(CheckEntrySize(key(), entry, *ret));
 
-  TF_RETURN_IF_ERROR(buffered_file->Seek(entry.offset()));
   uint32 actual_crc32c = 0;
 
   if (DataTypeCanUseMemcpy(entry.dtype())) {
     char* backing_buffer = const_cast<char*>((ret->tensor_data().data()));
-    size_t unused_bytes_read;
-    if (entry.size() > kBufferSize) {
-      StringPiece sp;
-      TF_RETURN_IF_ERROR(buffered_file->file()->Read(
-          entry.offset(), entry.size(), &sp, backing_buffer));
-      if (sp.data() != backing_buffer) {
-        memmove(backing_buffer, sp.data(), entry.size());
-      }
+    std::shared_ptr<ReadOnlyMemoryRegion> mapped_file =
+        GetMappedDataFile(entry.shard_id());
+    if (mapped_file != nullptr) {
+      const char* data;
+      TF_RETURN_IF_ERROR(GetMappedData(mapped_file.get(), entry, &data));
+      memcpy(backing_buffer, data, entry.size());
     } else {
-      TF_RETURN_IF_ERROR(buffered_file->ReadNBytes(entry.size(), backing_buffer,
-                                                   &unused_bytes_read));
+      io::InputBuffer* buffered_file;
+      TF_RETURN_IF_ERROR(GetDataFile(entry.shard_id(), &buffered_file));
+      TF_RETURN_IF_ERROR(buffered_file->Seek(entry.offset()));
+      size_t unused_bytes_read;
+      if (entry.size() > kBufferSize) {
+        StringPiece sp;
+        TF_RETURN_IF_ERROR(buffered_file->file()->Read(
+            entry.offset(), entry.size(), &sp, backing_buffer));
+        if (sp.data() != backing_buffer) {
+          memmove(backing_buffer, sp.data(), entry.size());
+        }
+      } else {
+        TF_RETURN_IF_ERROR(buffered_file->ReadNBytes(
+            entry.size(), backing_buffer, &unused_bytes_read));
+      }
     }
     // Note that we compute the checksum *before* byte-swapping. The checksum
     // should be on the bytes in the order they appear in the file.
@@ -916,22 +1168,20 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
     }
     // Relies on io::InputBuffer's buffering, because we issue many neighboring
     // reads for a single string tensor.
+    io::InputBuffer* buffered_file;
+    TF_RETURN_IF_ERROR(GetDataFile(entry.shard_id(), &buffered_file));
     TF_RETURN_IF_ERROR(ReadVariantTensor(buffered_file, ret, entry.offset(),
                                          entry.size(), &actual_crc32c));
   } else {
     // Relies on io::InputBuffer's buffering, because we issue many neighboring
     // reads for a single string tensor.
+    io::InputBuffer* buffered_file;
+    TF_RETURN_IF_ERROR(GetDataFile(entry.shard_id(), &buffered_file));
     TF_RETURN_IF_ERROR(ReadStringTensor(
         buffered_file, ret->NumElements(), entry.offset(), entry.size(),
         GetStringBackingBuffer(*ret), &actual_crc32c, need_to_swap_bytes_));
   }
-  if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
-    return errors::DataLoss(
-        "TensorBundle at ", prefix_, " shard ", entry.shard_id(), " (",
-        entry.size(), " bytes): Checksum does not match: stored ",
-        strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
-        " vs. calculated on the restored bytes ", actual_crc32c);
-  }
+  TF_RETURN_IF_ERROR(CheckEntryChecksum(prefix_, entry, actual_crc32c));
 
   *val = *ret;
   if (ret != val) delete ret;
@@ -952,6 +1202,231 @@ Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   }
 }
 
+Status BundleReader::LookupTensors(gtl::ArraySlice<string> keys,
+                                   gtl::ArraySlice<Tensor*> vals,
+                                   int num_threads) {
+  CHECK_EQ(keys.size(), vals.size());
+  const uint64 start_micros = env_->NowMicros();
+
+  // The data of one unpartitioned tensor, read as one or more chunks.
+  struct TensorRead {
+    Tensor* val = nullptr;
+    BundleEntryProto entry;
+    // The tensor that the data is read into, or that aliases it.
+    Tensor tensor;
+    // Exactly one of "file" and "mapped_data" is set.
+    RandomAccessFile* file = nullptr;
+    const char* mapped_data = nullptr;
+    bool aliased = false;
+    std::atomic<int64_t> remaining_chunks{0};
+  };
+  struct Chunk {
+    TensorRead* read;
+    int64_t begin;
+    int64_t end;
+  };
+
+  // Resolves every entry, opens every data file and allocates every tensor up
+  // front.  The reads below then only share the data files, through
+  // RandomAccessFiles and mappings that are safe to read concurrently.
+  std::vector<TensorRead> reads(keys.size());
+  std::vector<int> partitioned;
+  std::vector<TensorRead*> unpartitioned;
+  int64_t total_bytes = 0;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    TensorRead& read = reads[i];
+    read.val = vals[i];
+    TF_RETURN_IF_ERROR(GetBundleEntryProto(keys[i], &read.entry));
+    const BundleEntryProto& entry = read.entry;
+    if (!entry.slices().empty()) {
+      // The slices are copied into the full tensor, which must be allocated.
+      if (vals[i]->NumElements() == 0) {
+        *vals[i] = Tensor(entry.dtype(), TensorShape(entry.shape()));
+      }
+      partitioned.push_back(i);
+      continue;
+    }
+    if (entry.dtype() == DT_VARIANT && need_to_swap_bytes_) {
+      return errors::Unimplemented(
+          "TensorBundle at ", prefix_,
+          "is of a different endianness than this machine's hardware, and "
+          "the bundle contains a variant (arbitrary C++ type) tensor. "
+          "Byte-swapping of variant tensors is not currently implemented.");
+    }
+
+    const TensorShape stored_shape(entry.shape());
+    std::shared_ptr<ReadOnlyMemoryRegion> mapped_file;
+    if (DataTypeCanUseMemcpy(entry.dtype())) {
+      mapped_file = GetMappedDataFile(entry.shard_id());
+    }
+    if (mapped_file != nullptr) {
+      TF_RETURN_IF_ERROR(
+          GetMappedData(mapped_file.get(), entry, &read.mapped_data));
+      read.aliased =
+          options_.alias_mapped_data && !need_to_swap_bytes_ &&
+          vals[i]->NumElements() == 0 && entry.size() > 0 &&
+          entry.size() ==
+              stored_shape.num_elements() * DataTypeSize(entry.dtype()) &&
+          reinterpret_cast<uintptr_t>(read.mapped_data) %
+                  Allocator::kAllocatorAlignment ==
+              0;
+    } else {
+      io::InputBuffer* buffered_file;
+      TF_RETURN_IF_ERROR(GetDataFile(entry.shard_id(), &buffered_file));
+      read.file = buffered_file->file();
+    }
+
+    if (read.aliased) {
+      auto* buffer =
+          new MappedTensorBuffer(mapped_file, read.mapped_data, entry.size());
+      read.tensor = Tensor(entry.dtype(), stored_shape, buffer);
+      buffer->Unref();
+    } else if (vals[i]->NumElements() == 0) {
+      read.tensor = Tensor(entry.dtype(), stored_shape);
+    } else {
+      // Shares the buffer of "val", which is filled in place.
+      read.tensor = *vals[i];
+    }
+    TF_RETURN_IF_ERROR(CheckEntrySize(keys[i], entry, read.tensor));
+    total_bytes += entry.size();
+    unpartitioned.push_back(&read);
+  }
+  std::stable_sort(unpartitioned.begin(), unpartitioned.end(),
+                   [](const TensorRead* a, const TensorRead* b) {
+                     if (a->entry.shard_id() != b->entry.shard_id()) {
+                       return a->entry.shard_id() < b->entry.shard_id();
+                     }
+                     return a->entry.offset() < b->entry.offset();
+                   });
+
+  // Splits the reads into chunks, in file order within every data file, and
+  // interleaves the data files so that concurrent reads are spread over all
+  // of them.
+  std::map<int32, std::deque<Chunk>> chunks_by_shard;
+  for (TensorRead* read : unpartitioned) {
+    const int64_t size = read->entry.size();
+    const int64_t chunk_bytes = DataTypeCanUseMemcpy(read->entry.dtype())
+                                    ? kReadChunkBytes
+                                    : std::max<int64_t>(size, 1);
+    std::deque<Chunk>& chunks = chunks_by_shard[read->entry.shard_id()];
+    int64_t begin = 0;
+    do {
+      const int64_t end = std::min(begin + chunk_bytes, size);
+      chunks.push_back({read, begin, end});
+      read->remaining_chunks.fetch_add(1, std::memory_order_relaxed);
+      begin = end;
+    } while (begin < size);
+  }
+  std::vector<Chunk> chunks;
+  while (!chunks_by_shard.empty()) {
+    for (auto it = chunks_by_shard.begin(); it != chunks_by_shard.end();) {
+      chunks.push_back(it->second.front());
+      it->second.pop_front();
+      it = it->second.empty() ? chunks_by_shard.erase(it) : std::next(it);
+    }
+  }
+
+  // Reads one chunk.  The thread that reads the last chunk of a tensor also
+  // verifies its checksum and hands it over to the caller.
+  auto read_chunk = [this](const Chunk& chunk) -> Status {
+    TensorRead* read = chunk.read;
+    const BundleEntryProto& entry = read->entry;
+    const int64_t length = chunk.end - chunk.begin;
+    uint32 actual_crc32c = 0;
+    if (DataTypeCanUseMemcpy(entry.dtype())) {
+      char* backing_buffer = GetBackingBuffer(read->tensor);
+      if (read->aliased) {
+        // Faults the chunk in, so that the chunks of a tensor are paged in
+        // concurrently rather than by the checksum below.
+        const volatile char* data = read->mapped_data;
+        char touched = 0;
+        for (int64_t i = chunk.begin; i < chunk.end; i += kPageBytes) {
+          touched ^= data[i];
+        }
+        (void)touched;
+      } else if (read->mapped_data != nullptr && length > 0) {
+        memcpy(backing_buffer + chunk.begin, read->mapped_data + chunk.begin,
+               length);
+      } else if (length > 0) {
+        StringPiece sp;
+        TF_RETURN_IF_ERROR(read->file->Read(entry.offset() + chunk.begin,
+                                            length, &sp,
+                                            backing_buffer + chunk.begin));
+        if (sp.data() != backing_buffer + chunk.begin) {
+          memmove(backing_buffer + chunk.begin, sp.data(), length);
+        }
+      }
+      if (read->remaining_chunks.fetch_sub(1) != 1) return Status::OK();
+      // Note that we compute the checksum *before* byte-swapping.
+      actual_crc32c = crc32c::Value(
+          read->aliased ? read->mapped_data : backing_buffer, entry.size());
+      if (need_to_swap_bytes_) {
+        TF_RETURN_IF_ERROR(ByteSwapTensor(&read->tensor));
+      }
+    } else {
+      io::InputBuffer buffered_file(read->file, kBufferSize);
+      if (entry.dtype() == DT_VARIANT) {
+        TF_RETURN_IF_ERROR(ReadVariantTensor(&buffered_file, &read->tensor,
+                                             entry.offset(), entry.size(),
+                                             &actual_crc32c));
+      } else {
+        TF_RETURN_IF_ERROR(ReadStringTensor(
+            &buffered_file, read->tensor.NumElements(), entry.offset(),
+            entry.size(), GetStringBackingBuffer(read->tensor),
+            &actual_crc32c, need_to_swap_bytes_));
+      }
+    }
+    TF_RETURN_IF_ERROR(CheckEntryChecksum(prefix_, entry, actual_crc32c));
+    *read->val = read->tensor;
+    return Status::OK();
+  };
+
+  mutex mu;
+  Status status;
+  Status partitioned_status;
+  {
+    std::unique_ptr<thread::ThreadPool> pool;
+    if (num_threads > 1 && chunks.size() > 1) {
+      pool.reset(new thread::ThreadPool(
+          env_, "restore_tensors",
+          static_cast<int>(std::min<size_t>(num_threads, chunks.size()))));
+      for (const Chunk& chunk : chunks) {
+        pool->Schedule([&read_chunk, &mu, &status, chunk]() {
+          Status s = read_chunk(chunk);
+          if (!s.ok()) {
+            mutex_lock l(mu);
+            status.Update(s);
+          }
+        });
+      }
+    } else {
+      for (const Chunk& chunk : chunks) {
+        status.Update(read_chunk(chunk));
+      }
+    }
+
+    // Partitioned tensors are assembled from their slices on this thread, while
+    // the pool reads the other tensors.  Only the pool touches "reads".
+    for (int i : partitioned) {
+      partitioned_status.Update(Lookup(keys[i], vals[i]));
+    }
+  }
+  TF_RETURN_IF_ERROR(status);
+  TF_RETURN_IF_ERROR(partitioned_status);
+
+  const uint64 elapsed_micros =
+      std::max<uint64>(env_->NowMicros() - start_micros, 1);
+  const double megabytes_per_second =
+      static_cast<double>(total_bytes) / elapsed_micros;
+  checkpoint_read_bytes->GetCell()->IncrementBy(total_bytes);
+  checkpoint_read_bandwidth->GetCell()->Add(megabytes_per_second);
+  VLOG(1) << "Read " << total_bytes << " bytes of " << reads.size()
+          << " tensors from " << prefix_ << " in " << elapsed_micros
+          << " us (" << megabytes_per_second << " MB/s, " << chunks.size()
+          << " reads)";
+  return Status::OK();
+}
+
 Status BundleReader::ReadCurrent(Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
@@ -1105,6 +1580,137 @@ Status BundleReader::GetSliceValue(StringPiece full_tensor_key,
   return Status::OK();
 }
 
+Status BundleReader::ReadData(int32 shard_id, int64_t offset, int64_t length,
+                              char* data) {
+  std::shared_ptr<ReadOnlyMemoryRegion> mapped_file =
+      GetMappedDataFile(shard_id);
+  if (mapped_file != nullptr) {
+    if (offset < 0 || static_cast<uint64>(offset + length) >
+                          mapped_file->length()) {
+      return errors::DataLoss("Bundle data [", offset, ", ", offset + length,
+                              ") is past the end of data file shard ",
+                              shard_id, " of ", mapped_file->length(),
+                              " bytes");
+    }
+    memcpy(data, static_cast<const char*>(mapped_file->data()) + offset,
+           length);
+    return Status::OK();
+  }
+  io::InputBuffer* buffered_file;
+  TF_RETURN_IF_ERROR(GetDataFile(shard_id, &buffered_file));
+  StringPiece sp;
+  TF_RETURN_IF_ERROR(buffered_file->file()->Read(offset, length, &sp, data));
+  if (static_cast<int64_t>(sp.size()) != length) {
+    return errors::DataLoss("Read ", sp.size(), " bytes instead of ", length,
+                            " at offset ", offset, " of data file shard ",
+                            shard_id);
+  }
+  if (sp.data() != data) memmove(data, sp.data(), length);
+  return Status::OK();
+}
+
+Status BundleReader::LookupRows(StringPiece key, gtl::ArraySlice<int64_t> rows,
+                                Tensor* val) {
+  BundleEntryProto entry;
+  TF_RETURN_IF_ERROR(GetBundleEntryProto(key, &entry));
+  const TensorShape full_shape(entry.shape());
+  if (!DataTypeCanUseMemcpy(entry.dtype()) || full_shape.dims() < 1) {
+    return errors::InvalidArgument(
+        "Cannot look up rows of ", key, ", of dtype ",
+        DataTypeString(entry.dtype()), " and shape ", full_shape.DebugString(),
+        ": rows are only read from tensors of memcpy-able dtypes with at "
+        "least one dimension");
+  }
+  TensorShape rows_shape(full_shape);
+  rows_shape.set_dim(0, rows.size());
+  if (val->dtype() != entry.dtype() || val->shape() != rows_shape) {
+    return errors::InvalidArgument(
+        "Rows of ", key, " must be read into a ", DataTypeString(entry.dtype()),
+        " tensor of shape ", rows_shape.DebugString(), ", got ",
+        val->DebugString());
+  }
+  const int64_t num_rows = full_shape.dim_size(0);
+  if (num_rows == 0 || rows.empty()) return Status::OK();
+  const int64_t row_bytes = full_shape.num_elements() / num_rows *
+                            DataTypeSize(entry.dtype());
+
+  // The stored parts of the tensor, each holding the rows [begin, end).
+  struct Part {
+    int64_t begin;
+    int64_t end;
+    BundleEntryProto entry;
+  };
+  std::vector<Part> parts;
+  if (entry.slices().empty()) {
+    parts.push_back({0, num_rows, entry});
+  } else {
+    const string full_tensor_key(key);
+    for (const TensorSliceProto& slice_proto : entry.slices()) {
+      const TensorSlice slice(slice_proto);
+      for (int d = 1; d < slice.dims(); ++d) {
+        if (!slice.IsFullAt(d)) {
+          return errors::Unimplemented("Cannot look up rows of ", key,
+                                       ", which is partitioned along "
+                                       "dimension ",
+                                       d);
+        }
+      }
+      Part part;
+      part.begin = slice.IsFullAt(0) ? 0 : slice.start(0);
+      part.end = slice.IsFullAt(0) ? num_rows : slice.end(0);
+      TF_RETURN_IF_ERROR(GetBundleEntryProto(
+          checkpoint::EncodeTensorNameSlice(full_tensor_key, slice),
+          &part.entry));
+      parts.push_back(std::move(part));
+    }
+    std::sort(parts.begin(), parts.end(), [](const Part& a, const Part& b) {
+      return a.begin < b.begin;
+    });
+  }
+  for (const Part& part : parts) {
+    if (part.entry.size() != (part.end - part.begin) * row_bytes) {
+      return errors::DataLoss("Invalid size of the rows [", part.begin, ", ",
+                              part.end, ") of ", key, ": ", part.entry.size(),
+                              " bytes instead of ",
+                              (part.end - part.begin) * row_bytes);
+    }
+  }
+
+  // Reads runs of consecutive rows of the same part at once.
+  char* backing_buffer = GetBackingBuffer(*val);
+  size_t i = 0;
+  while (i < rows.size()) {
+    const int64_t row = rows[i];
+    if (row < 0 || row >= num_rows) {
+      return errors::InvalidArgument("Row ", row, " of ", key,
+                                     " is not in [0, ", num_rows, ")");
+    }
+    auto part = std::upper_bound(
+        parts.begin(), parts.end(), row,
+        [](int64_t r, const Part& p) { return r < p.begin; });
+    if (part == parts.begin() || row >= std::prev(part)->end) {
+      return errors::DataLoss("Row ", row, " of ", key,
+                              " is not in any of its stored slices");
+    }
+    --part;
+    size_t run_end = i + 1;
+    while (run_end < rows.size() &&
+           rows[run_end] == rows[run_end - 1] + 1 &&
+           rows[run_end] < part->end) {
+      ++run_end;
+    }
+    TF_RETURN_IF_ERROR(
+        ReadData(part->entry.shard_id(),
+                 part->entry.offset() + (row - part->begin) * row_bytes,
+                 (run_end - i) * row_bytes, backing_buffer + i * row_bytes));
+    i = run_end;
+  }
+  if (need_to_swap_bytes_) {
+    TF_RETURN_IF_ERROR(ByteSwapTensor(val));
+  }
+  return Status::OK();
+}
+
 bool BundleReader::Contains(StringPiece key) {
   Seek(key);
   return Valid() && (this->key() == key);
@@ -1189,6 +1795,11 @@ Status FileOutputBuffer::Append(StringPiece data) {
   return Status::OK();
 }
 
+Status FileOutputBuffer::AppendUnbuffered(StringPiece data) {
+  TF_RETURN_IF_ERROR(FlushBuffer(false));
+  return file_->Append(data);
+}
+
 Status FileOutputBuffer::Close() {
   TF_RETURN_IF_ERROR(FlushBuffer(true));
   return file_->Close();
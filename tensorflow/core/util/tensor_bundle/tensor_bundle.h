@@ -61,7 +61,10 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_TENSOR_BUNDLE_H_
 #define TENSORFLOW_CORE_UTIL_TENSOR_BUNDLE_TENSOR_BUNDLE_H_
 
+#include <deque>
+#include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -72,6 +75,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_slice.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/io/cache.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
@@ -80,6 +84,8 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/file_system.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/protobuf/tensor_bundle.pb.h"
 #include "tensorflow/core/util/tensor_bundle/naming.h"
@@ -116,12 +122,24 @@ class BundleWriter {
     // Alignment, in bytes, for tensor data.
     // Must be >= 1. The default size of 1 densely packs tensors.
     int data_alignment{1};
+    // If > 0, pipelines the writes: Add() only snapshots the data of
+    // fixed-size tensors and returns, while their checksums are computed by
+    // up to "num_threads" background threads and a background thread
+    // appends them to the data file, in order.  Finish() waits for all of
+    // them.  Errors are returned by the next Add() or by Finish().
+    int num_threads{0};
+    // With "num_threads", the maximum number of bytes held by snapshots that
+    // are not written yet.  Add() blocks until its snapshot fits, except
+    // that a larger tensor is accepted once nothing else is pending.
+    int64_t max_pending_bytes{256 << 20};
   };
   BundleWriter(Env* env, StringPiece prefix,
                const Options& options = Options());
+  ~BundleWriter();
 
   // Adds the tensor "val" under key "key".
   // Across calls "key" must be unique but can be added in any order.
+  // "val" may be modified as soon as this returns.
   Status Add(StringPiece key, const Tensor& val);
 
   // Partitioned variables support.
@@ -150,6 +168,15 @@ class BundleWriter {
   Status status() const { return status_; }
 
  private:
+  // Snapshots "val", whose metadata is "entry", and queues its write.
+  Status AddPipelined(const Tensor& val, BundleEntryProto* entry);
+  // Waits until all the queued writes are done, and returns their status.
+  Status WaitForPendingWrites();
+  // Stops the background threads, once all the queued writes are done.
+  void StopPipeline();
+  // Runs the queued writes, on the write thread.
+  void WriteLoop();
+
   Env* const env_;  // Not owned.
   const Options options_;
   const string prefix_;
@@ -157,10 +184,24 @@ class BundleWriter {
   string data_path_;
   bool use_temp_file_;
   std::unique_ptr<FileOutputBuffer> out_;
-  int64_t size_;  // Number of bytes written into out_.
+  int64_t size_;  // Number of bytes written, or queued, into out_.
   std::map<string, BundleEntryProto> entries_;
   Status status_;
 
+  // With options_.num_threads > 0.  While the pipeline runs, out_ is only
+  // accessed by the write thread.  The crc32c of the entries of the queued
+  // tensors is set by the write thread for small tensors, and by the checksum
+  // threads for large ones.
+  std::unique_ptr<thread::ThreadPool> checksum_pool_;
+  std::unique_ptr<Thread> write_thread_;
+  mutex mu_;
+  condition_variable cv_;
+  std::deque<std::function<Status()>> writes_ TF_GUARDED_BY(mu_);
+  int64_t num_pending_writes_ TF_GUARDED_BY(mu_) = 0;
+  int64_t pending_bytes_ TF_GUARDED_BY(mu_) = 0;
+  Status write_status_ TF_GUARDED_BY(mu_);
+  bool stopping_ TF_GUARDED_BY(mu_) = false;
+
   TF_DISALLOW_COPY_AND_ASSIGN(BundleWriter);
 };
 
@@ -186,7 +227,21 @@ Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
 // All threads accessing the same BundleReader must synchronize.
 class BundleReader {
  public:
-  BundleReader(Env* const env, StringPiece prefix);
+  struct Options {
+    Options() {}
+    // Memory-maps the data files that are on file systems supporting it, such
+    // as local disks, and copies tensor data out of the mappings instead of
+    // reading it through buffered RandomAccessFiles.
+    bool use_mmap{false};
+    // With "use_mmap", lets LookupTensors() return tensors that alias their
+    // data in the mapped files instead of copying it, when the data needs no
+    // byte swapping and is aligned for Eigen.  Such tensors keep the mapping
+    // alive and are never forwarded to ops that write in place, but the data
+    // files must not be modified while they are in use.
+    bool alias_mapped_data{false};
+  };
+  BundleReader(Env* const env, StringPiece prefix,
+               const Options& options = Options());
   ~BundleReader();
 
   // Is ok() iff the reader construction is successful (completed the read of
@@ -235,6 +290,21 @@ class BundleReader {
   // REQUIRES: status().ok()
   Status Lookup(StringPiece key, Tensor* val) TF_MUST_USE_RESULT;
 
+  // Looks up the tensors keyed by "keys" into the corresponding "vals", like
+  // calling Lookup() on each of them, but resolves all the entries first and
+  // then reads their data with up to "num_threads" concurrent reads, spread
+  // across the data files.  Large tensors are read in several chunks at once.
+  //
+  // As with Lookup(), a "val" with elements must already have the stored
+  // shape and dtype and is filled in place.  An empty "val" is assigned a new
+  // tensor, which may alias a mapped data file (see Options).
+  //
+  // Records the number of bytes read and the read bandwidth.
+  // REQUIRES: status().ok() && keys.size() == vals.size()
+  Status LookupTensors(gtl::ArraySlice<string> keys,
+                       gtl::ArraySlice<Tensor*> vals,
+                       int num_threads) TF_MUST_USE_RESULT;
+
   // Looks up the tensor pointed to by the internal iterator.
   //
   // On error, "val" may contain nonsense data.
@@ -260,6 +330,17 @@ class BundleReader {
   Status LookupSlice(StringPiece full_tensor_key, const TensorSlice& slice_spec,
                      Tensor* val) TF_MUST_USE_RESULT;
 
+  // Looks up the rows "rows" (indices in the first dimension) of the tensor
+  // keyed by "key" into "val", reading only their bytes.  The tensor must have
+  // a memcpy-able dtype and at least one dimension, and may be partitioned
+  // along its first dimension only.  "val" must have the stored dtype and the
+  // stored shape, with a first dimension of rows.size().
+  //
+  // As only part of the data is read, its checksum is not validated.
+  // REQUIRES: status().ok()
+  Status LookupRows(StringPiece key, gtl::ArraySlice<int64_t> rows,
+                    Tensor* val) TF_MUST_USE_RESULT;
+
   // Seeks to the first position in the bundle whose key is no less than "key".
   // REQUIRES: status().ok()
   void Seek(StringPiece key) { return iter_->Seek(key); }
@@ -286,6 +367,20 @@ class BundleReader {
   Status GetBundleEntryProto(StringPiece key,
                              BundleEntryProto* entry) TF_MUST_USE_RESULT;
 
+  // Returns the buffered data file of shard "shard_id" in "buffered_file",
+  // opening it on first use.  The reader keeps ownership.
+  Status GetDataFile(int32 shard_id,
+                     io::InputBuffer** buffered_file) TF_MUST_USE_RESULT;
+
+  // Returns the mapping of the data file of shard "shard_id", or nullptr if
+  // the reader does not use mmap or the file system does not support it.
+  std::shared_ptr<ReadOnlyMemoryRegion> GetMappedDataFile(int32 shard_id);
+
+  // Reads "length" bytes at "offset" in the data file of shard "shard_id"
+  // into "data".
+  Status ReadData(int32 shard_id, int64_t offset, int64_t length,
+                  char* data) TF_MUST_USE_RESULT;
+
   // Reads the tensor value described by the metadata proto "entry".
   // Usage for "val" follows the comment of "Lookup()".
   Status GetValue(const BundleEntryProto& entry,
@@ -301,6 +396,7 @@ class BundleReader {
 
   Env* env_;  // Not owned.
   const string prefix_;
+  const Options options_;
 
   Status status_;
   RandomAccessFile* metadata_;  // Owned.
@@ -309,6 +405,10 @@ class BundleReader {
   table::Iterator* iter_;
   // Owned the InputBuffer objects and their underlying RandomAccessFile's.
   std::unordered_map<int32, io::InputBuffer*> data_;
+  // Mappings of the data files, when using mmap.  Null for the files that
+  // could not be mapped.
+  std::unordered_map<int32, std::shared_ptr<ReadOnlyMemoryRegion>>
+      mapped_data_;
 
   // Maps each partitioned tensor's key to its stored slices (represented in a
   // TensorSliceSet).  Populated on-demand.
@@ -343,6 +443,10 @@ class FileOutputBuffer {
   // Clears the running crc32c checksum.
   void clear_crc32c() { crc32c_ = 0; }
 
+  // Appends the buffered data, then "data" directly to the underlying file,
+  // without copying it or adding it to the checksum.
+  Status AppendUnbuffered(StringPiece data);
+
   // Appends the buffered data, then closes the underlying file.
   Status Close();
 
@@ -19,6 +19,7 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "tensorflow/core/framework/tensor_description.pb.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.pb.h"
@@ -1013,6 +1014,168 @@ TEST(TensorBundleTest, Checksum) {
   }
 }
 
+// Writes a bundle with a few tensors of different types and sizes, including
+// a partitioned one, and looks them all up at once.
+void TestLookupTensors(const BundleReader::Options& options) {
+  const TensorShape kFullShape({5, 10});
+  {
+    BundleWriter::Options writer_options;
+    writer_options.data_alignment = 64;
+    BundleWriter writer(Env::Default(), Prefix("lookup_tensors"),
+                        writer_options);
+    TF_EXPECT_OK(writer.Add("float", Constant_2x3<float>(1.5)));
+    TF_EXPECT_OK(writer.Add("int64", Constant<int64_t>(7, TensorShape({100}))));
+    TF_EXPECT_OK(writer.Add("empty", Constant<int32>(0, TensorShape({0, 3}))));
+    TF_EXPECT_OK(
+        writer.Add("string", test::AsTensor<tstring>({"hello", "world"})));
+    TF_EXPECT_OK(writer.AddSlice("partitioned", kFullShape,
+                                 TensorSlice::ParseOrDie("-:0,1"),
+                                 Constant<float>(0., TensorShape({5, 1}))));
+    TF_EXPECT_OK(writer.AddSlice("partitioned", kFullShape,
+                                 TensorSlice::ParseOrDie("-:1,9"),
+                                 Constant<float>(1., TensorShape({5, 9}))));
+    TF_ASSERT_OK(writer.Finish());
+  }
+
+  BundleReader reader(Env::Default(), Prefix("lookup_tensors"), options);
+  TF_ASSERT_OK(reader.status());
+  // "float" is preallocated and filled in place; the others are assigned.
+  Tensor float_val(DT_FLOAT, TensorShape({2, 3}));
+  std::vector<Tensor> vals(4);
+  const std::vector<string> keys = {"string", "float", "partitioned", "int64",
+                                    "empty"};
+  TF_ASSERT_OK(reader.LookupTensors(
+      keys, {&vals[0], &float_val, &vals[1], &vals[2], &vals[3]},
+      /*num_threads=*/4));
+
+  test::ExpectTensorEqual<tstring>(vals[0],
+                                   test::AsTensor<tstring>({"hello", "world"}));
+  test::ExpectTensorEqual<float>(float_val, Constant_2x3<float>(1.5));
+  Tensor expected_partitioned(DT_FLOAT, kFullShape);
+  test::FillFn<float>(&expected_partitioned, [](int offset) -> float {
+    return offset % 10 == 0 ? 0 : 1;
+  });
+  test::ExpectTensorEqual<float>(vals[1], expected_partitioned);
+  test::ExpectTensorEqual<int64_t>(vals[2],
+                                   Constant<int64_t>(7, TensorShape({100})));
+  test::ExpectTensorEqual<int32>(vals[3],
+                                 Constant<int32>(0, TensorShape({0, 3})));
+
+  // Only tensors that were not preallocated may alias the mapped data file.
+  TensorDescription description;
+  vals[2].FillDescription(&description);
+  EXPECT_EQ(options.use_mmap && options.alias_mapped_data,
+            description.allocation_description().allocator_name() == "mmap");
+  float_val.FillDescription(&description);
+  EXPECT_NE(description.allocation_description().allocator_name(), "mmap");
+}
+
+TEST(TensorBundleTest, LookupTensors) {
+  TestLookupTensors(BundleReader::Options());
+}
+
+TEST(TensorBundleTest, LookupTensorsMmap) {
+  BundleReader::Options options;
+  options.use_mmap = true;
+  TestLookupTensors(options);
+}
+
+TEST(TensorBundleTest, LookupTensorsAliasMmap) {
+  BundleReader::Options options;
+  options.use_mmap = true;
+  options.alias_mapped_data = true;
+  TestLookupTensors(options);
+}
+
+TEST(TensorBundleTest, LookupTensorsChecksum) {
+  {
+    BundleWriter writer(Env::Default(), Prefix("lookup_tensors_checksum"));
+    TF_EXPECT_OK(writer.Add("bar", Constant_2x3(2.f)));
+    TF_EXPECT_OK(writer.Add("foo", Constant_2x3(1.f)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  // Corrupts the first byte of "bar".
+  const string datafile =
+      DataFilename(Prefix("lookup_tensors_checksum"), 0, 1);
+  string data;
+  TF_ASSERT_OK(ReadFileToString(Env::Default(), datafile, &data));
+  data[0] = ~data[0];
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), datafile, data));
+
+  for (bool use_mmap : {false, true}) {
+    BundleReader::Options options;
+    options.use_mmap = use_mmap;
+    BundleReader reader(Env::Default(), Prefix("lookup_tensors_checksum"),
+                        options);
+    TF_ASSERT_OK(reader.status());
+    Tensor foo, bar;
+    Status status = reader.LookupTensors({"foo", "bar"}, {&foo, &bar},
+                                         /*num_threads=*/2);
+    EXPECT_TRUE(errors::IsDataLoss(status)) << status;
+    EXPECT_TRUE(absl::StrContains(status.ToString(), "Checksum does not match"))
+        << status;
+  }
+}
+
+TEST(TensorBundleTest, LookupRows) {
+  // Row r of "full" and "partitioned" holds {r, r + 0.5}.
+  Tensor full(DT_FLOAT, TensorShape({6, 2}));
+  test::FillFn<float>(&full, [](int offset) -> float {
+    return offset / 2 + (offset % 2) * 0.5f;
+  });
+  {
+    BundleWriter writer(Env::Default(), Prefix("lookup_rows"));
+    TF_EXPECT_OK(writer.Add("full", full));
+    TF_EXPECT_OK(writer.AddSlice("partitioned", full.shape(),
+                                 TensorSlice::ParseOrDie("0,4:-"),
+                                 full.Slice(0, 4)));
+    TF_EXPECT_OK(writer.AddSlice("partitioned", full.shape(),
+                                 TensorSlice::ParseOrDie("4,2:-"),
+                                 full.Slice(4, 6)));
+    TF_EXPECT_OK(writer.AddSlice("columns", full.shape(),
+                                 TensorSlice::ParseOrDie("-:0,1"),
+                                 Constant<float>(0, TensorShape({6, 1}))));
+    TF_EXPECT_OK(writer.AddSlice("columns", full.shape(),
+                                 TensorSlice::ParseOrDie("-:1,1"),
+                                 Constant<float>(0, TensorShape({6, 1}))));
+    TF_EXPECT_OK(
+        writer.Add("string", test::AsTensor<tstring>({"hello", "world"})));
+    TF_ASSERT_OK(writer.Finish());
+  }
+
+  for (bool use_mmap : {false, true}) {
+    BundleReader::Options options;
+    options.use_mmap = use_mmap;
+    BundleReader reader(Env::Default(), Prefix("lookup_rows"), options);
+    TF_ASSERT_OK(reader.status());
+    // Rows 3 to 5 are read at once, across the slices of "partitioned".
+    const std::vector<int64_t> rows = {1, 3, 4, 5, 0, 1};
+    for (const char* key : {"full", "partitioned"}) {
+      Tensor val(DT_FLOAT, TensorShape({6, 2}));
+      TF_ASSERT_OK(reader.LookupRows(key, rows, &val));
+      test::ExpectTensorEqual<float>(
+          val, test::AsTensor<float>({1, 1.5, 3, 3.5, 4, 4.5, 5, 5.5, 0, 0.5,
+                                      1, 1.5},
+                                     TensorShape({6, 2})));
+    }
+
+    Tensor val(DT_FLOAT, TensorShape({1, 2}));
+    EXPECT_TRUE(
+        errors::IsInvalidArgument(reader.LookupRows("full", {6}, &val)));
+    EXPECT_TRUE(
+        errors::IsInvalidArgument(reader.LookupRows("full", {-1}, &val)));
+    EXPECT_TRUE(
+        errors::IsUnimplemented(reader.LookupRows("columns", {0}, &val)));
+    EXPECT_TRUE(errors::IsNotFound(reader.LookupRows("missing", {0}, &val)));
+    Tensor wrong_shape(DT_FLOAT, TensorShape({2, 2}));
+    EXPECT_TRUE(errors::IsInvalidArgument(
+        reader.LookupRows("full", {0}, &wrong_shape)));
+    Tensor string_val(DT_STRING, TensorShape({1}));
+    EXPECT_TRUE(errors::IsInvalidArgument(
+        reader.LookupRows("string", {0}, &string_val)));
+  }
+}
+
 TEST(TensorBundleTest, TruncatedTensorContents) {
   Env* env = Env::Default();
   BundleWriter writer(env, Prefix("end"));
@@ -1153,6 +1316,59 @@ TEST_F(TensorBundleAlignmentTest, AlignmentTest) {
   }
 }
 
+TEST_F(TensorBundleAlignmentTest, PipelinedWrites) {
+  BundleWriter::Options options;
+  options.num_threads = 4;
+  options.data_alignment = 64;
+  // Small enough that Add() has to wait for earlier writes.
+  options.max_pending_bytes = 1024;
+  {
+    BundleWriter writer(Env::Default(), Prefix("pipelined"), options);
+    Tensor big = Constant<float>(2, TensorShape({1000}));
+    for (int i = 0; i < 10; ++i) {
+      TF_EXPECT_OK(writer.Add(strings::StrCat("float_", i),
+                              Constant<float>(i, TensorShape({20}))));
+    }
+    TF_EXPECT_OK(writer.Add("big", big));
+    // Snapshotted, so overwriting it does not change what is saved.
+    big.flat<float>().setConstant(-1);
+    TF_EXPECT_OK(
+        writer.Add("string", test::AsTensor<tstring>({"hello", "world"})));
+    TF_EXPECT_OK(writer.Add("empty", Constant<int32>(0, TensorShape({0}))));
+    TF_EXPECT_OK(writer.AddSlice("partitioned", TensorShape({5, 10}),
+                                 TensorSlice::ParseOrDie("-:1,9"),
+                                 Constant<int64_t>(1, TensorShape({5, 9}))));
+    TF_ASSERT_OK(writer.Finish());
+  }
+
+  BundleReader reader(Env::Default(), Prefix("pipelined"));
+  TF_ASSERT_OK(reader.status());
+  for (int i = 0; i < 10; ++i) {
+    Expect<float>(&reader, strings::StrCat("float_", i),
+                  Constant<float>(i, TensorShape({20})));
+  }
+  Expect<float>(&reader, "big", Constant<float>(2, TensorShape({1000})));
+  Expect<tstring>(&reader, "string",
+                  test::AsTensor<tstring>({"hello", "world"}));
+  Expect<int32>(&reader, "empty", Constant<int32>(0, TensorShape({0})));
+  Tensor slice(DT_INT64, TensorShape({5, 9}));
+  TF_ASSERT_OK(reader.LookupSlice(
+      "partitioned", TensorSlice::ParseOrDie("-:1,9"), &slice));
+  test::ExpectTensorEqual<int64_t>(slice,
+                                   Constant<int64_t>(1, TensorShape({5, 9})));
+  ExpectAlignment<float>(&reader, "big", 64);
+  ExpectAlignment<tstring>(&reader, "string", 64);
+}
+
+TEST(TensorBundleTest, PipelinedWritesNotFinished) {
+  BundleWriter::Options options;
+  options.num_threads = 2;
+  BundleWriter writer(Env::Default(), Prefix("pipelined_unfinished"),
+                      options);
+  TF_EXPECT_OK(writer.Add("foo", Constant_2x3<float>(1)));
+  // The destructor stops the background threads.
+}
+
 static void BM_BundleAlignment(::testing::benchmark::State& state) {
   {
     const int alignment = state.range(0);
@@ -1204,4 +1420,27 @@ static void BM_BundleWriterLargeTensor(::testing::benchmark::State& state) {
 BENCHMARK(BM_BundleWriterLargeTensor)->Arg(1 << 10);
 BENCHMARK(BM_BundleWriterLargeTensor)->Arg(4 << 10);
 
+// Writes a bundle of 64 tensors of "mb" MB each, with the synchronous writer
+// (num_threads = 0) or the pipelined one.
+static void BM_BundleWriterThreads(::testing::benchmark::State& state) {
+  const int num_threads = state.range(0);
+  const int mb = state.range(1);
+  const int64_t bytes = static_cast<int64_t>(mb) * (1 << 20);
+  Tensor t = Constant(static_cast<int8>('a'), TensorShape{bytes});
+  BundleWriter::Options options;
+  options.num_threads = num_threads;
+  for (auto s : state) {
+    BundleWriter writer(Env::Default(), Prefix("threads"), options);
+    for (int i = 0; i < 64; ++i) {
+      TF_CHECK_OK(writer.Add(strings::StrCat("tensor_", i), t));
+    }
+    TF_CHECK_OK(writer.Finish());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * 64 *
+                          bytes);
+}
+
+BENCHMARK(BM_BundleWriterThreads)->ArgPair(0, 1)->ArgPair(4, 1);
+BENCHMARK(BM_BundleWriterThreads)->ArgPair(0, 16)->ArgPair(4, 16);
+
 }  // namespace tensorflow
@@ -23,6 +23,16 @@ from tensorflow.python.ops import gen_array_ops
 from tensorflow.python.platform import test
 
 
+def _unique_by_appearance(x):
+  """Returns numpy's unique elements, indices and counts in appearance order."""
+  _, first, inverse, counts = np.unique(
+      x, return_index=True, return_inverse=True, return_counts=True)
+  order = np.argsort(first)
+  rank = np.empty_like(order)
+  rank[order] = np.arange(len(order))
+  return x[first[order]], rank[inverse.reshape(-1)], counts[order]
+
+
 class UniqueTest(test.TestCase):
 
   def testInt32(self):
@@ -166,6 +176,26 @@ class UniqueTest(test.TestCase):
     self.assertAllEqual(tf_y, true_y)
     self.assertAllEqual(tf_idx, true_idx)
 
+  def testLargeInputOrderedByAppearance(self):
+    # Large inputs are uniquified in parallel, or with a direct-indexed table
+    # when their values span a small range.
+    for high in [1000, 2**40]:
+      with self.subTest(high=high):
+        x = np.random.randint(-high, high=high, size=200000, dtype=np.int64)
+        true_y, true_idx, _ = _unique_by_appearance(x)
+        y, idx = array_ops.unique(x)
+        tf_y, tf_idx = self.evaluate([y, idx])
+        self.assertAllEqual(tf_y, true_y)
+        self.assertAllEqual(tf_idx, true_idx)
+
+  def testLargeStringInputOrderedByAppearance(self):
+    x = np.array([b'%d' % i for i in np.random.randint(50000, size=200000)])
+    true_y, true_idx, _ = _unique_by_appearance(x)
+    y, idx = array_ops.unique(x)
+    tf_y, tf_idx = self.evaluate([y, idx])
+    self.assertAllEqual(tf_y, true_y)
+    self.assertAllEqual(tf_idx, true_idx)
+
 
 class UniqueWithCountsTest(test.TestCase):
 
@@ -313,6 +343,17 @@ class UniqueWithCountsTest(test.TestCase):
     self.assertAllEqual(tf_idx, true_idx)
     self.assertAllEqual(tf_count, true_count)
 
+  def testLargeInputOrderedByAppearance(self):
+    for high in [1000, 2**40]:
+      with self.subTest(high=high):
+        x = np.random.randint(-high, high=high, size=200000, dtype=np.int64)
+        true_y, true_idx, true_count = _unique_by_appearance(x)
+        y, idx, count = array_ops.unique_with_counts(x)
+        tf_y, tf_idx, tf_count = self.evaluate([y, idx, count])
+        self.assertAllEqual(tf_y, true_y)
+        self.assertAllEqual(tf_idx, true_idx)
+        self.assertAllEqual(tf_count, true_count)
+
 
 if __name__ == '__main__':
   test.main()
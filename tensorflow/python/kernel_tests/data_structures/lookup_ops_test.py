@@ -39,6 +39,7 @@ from tensorflow.python.framework import test_ops
 from tensorflow.python.framework import test_util
 from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import control_flow_ops
+from tensorflow.python.ops import gen_lookup_ops
 from tensorflow.python.ops import lookup_ops
 from tensorflow.python.ops import map_fn
 from tensorflow.python.ops import variables
@@ -4186,6 +4187,51 @@ class MutableHashTableOpTest(test.TestCase):
     self.assertTrue(inferred_shapes[1].is_compatible_with(actual_shapes[1]))
 
 
+class MemoryMappedHashTableTest(test.TestCase):
+
+  def _writeTable(self, keys, values):
+    filename = os.path.join(self.get_temp_dir(), "table")
+    self.evaluate(
+        gen_lookup_ops.write_memory_mapped_hash_table_file(
+            filename, keys, constant_op.constant(values, dtypes.int64)))
+    return filename
+
+  def _lookup(self, filename, key_dtype, keys):
+    table = gen_lookup_ops.memory_mapped_hash_table(
+        filename=filename, key_dtype=key_dtype, value_dtype=dtypes.int64)
+    values = gen_lookup_ops.lookup_table_find_v2(
+        table, constant_op.constant(keys, key_dtype),
+        constant_op.constant(-1, dtypes.int64))
+    size = gen_lookup_ops.lookup_table_size_v2(table)
+    return self.evaluate([values, size])
+
+  def testInt64Keys(self):
+    keys = constant_op.constant([7, -3, 100], dtypes.int64)
+    filename = self._writeTable(keys, [0, 1, 2])
+    values, size = self._lookup(filename, dtypes.int64, [100, 5, 7, -3])
+    self.assertAllEqual([2, -1, 0, 1], values)
+    self.assertEqual(3, size)
+
+  def testStringKeys(self):
+    keys = constant_op.constant(["brain", "salad", "surgery"])
+    filename = self._writeTable(keys, [0, 1, 2])
+    values, size = self._lookup(filename, dtypes.string,
+                                ["surgery", "tank", "brain"])
+    self.assertAllEqual([2, -1, 0], values)
+    self.assertEqual(3, size)
+
+  def testDuplicateKeys(self):
+    keys = constant_op.constant([1, 2, 1], dtypes.int64)
+    with self.assertRaisesOpError("Duplicate key"):
+      self._writeTable(keys, [0, 1, 2])
+
+  def testWrongKeyType(self):
+    keys = constant_op.constant([1, 2], dtypes.int64)
+    filename = self._writeTable(keys, [0, 1])
+    with self.assertRaisesOpError("has keys of type int64"):
+      self._lookup(filename, dtypes.string, ["1"])
+
+
 class MutableHashTableBenchmark(test.Benchmark):
 
   def _create_table(self):
@@ -128,6 +128,28 @@ class SegmentReductionOpTest(SegmentReductionHelper):
               # and may therefore vary dynamically.
               self.assertAllEqual(np_ans.shape[1:], tf_ans.shape[1:])
 
+  def testLargeSkewedSegments(self):
+    # Large enough for the CPU kernel to split the rows across threads, with
+    # one segment spanning most of the rows and a gap in the segment ids.
+    np.random.seed(0)
+    indices = np.concatenate([
+        np.zeros(15000, dtype=np.int32),
+        np.repeat(np.arange(2, 1002, dtype=np.int32), 5)
+    ])
+    np_x = np.random.uniform(1, 2, size=(indices.size, 8))
+    num_segments = indices[-1] + 1
+    ops_list = [(np.sum, math_ops.segment_sum),
+                (np.mean, math_ops.segment_mean),
+                (np.min, math_ops.segment_min),
+                (np.max, math_ops.segment_max)]
+    with self.cached_session(use_gpu=False):
+      for np_op, tf_op in ops_list:
+        np_ans = np.zeros((num_segments, np_x.shape[1]))
+        for segment in np.unique(indices):
+          np_ans[segment] = np_op(np_x[indices == segment], axis=0)
+        tf_ans = self.evaluate(tf_op(data=np_x, segment_ids=indices))
+        self.assertAllClose(np_ans, tf_ans)
+
   @test_util.run_deprecated_v1
   def testSegmentIdsShape(self):
     shape = [4, 4]
@@ -346,6 +368,49 @@ class UnsortedSegmentTest(SegmentReductionHelper):
                 self.assertAllCloseAccordingToType(np_ans, tf_ans)
                 self.assertShapeEqual(np_ans, s)
 
+  def testLargeSkewedSegments(self):
+    # Large enough for the CPU kernel to reduce rows into per-thread buffers,
+    # with one segment holding most of the rows.
+    np.random.seed(0)
+    indices = np.concatenate([
+        np.zeros(15000, dtype=np.int32),
+        np.repeat(np.arange(1, 50, dtype=np.int32), 100)
+    ])
+    np.random.shuffle(indices)
+    np_x = np.random.uniform(1, 2, size=(indices.size, 8))
+    num_segments = 50
+    ops_list = [(np.sum, math_ops.unsorted_segment_sum),
+                (np.mean, math_ops.unsorted_segment_mean),
+                (np.min, math_ops.unsorted_segment_min),
+                (np.max, math_ops.unsorted_segment_max)]
+    with self.cached_session(use_gpu=False):
+      for np_op, tf_op in ops_list:
+        np_ans = np.stack([
+            np_op(np_x[indices == segment], axis=0)
+            for segment in range(num_segments)
+        ])
+        tf_ans = self.evaluate(
+            tf_op(np_x, segment_ids=indices, num_segments=num_segments))
+        self.assertAllClose(np_ans, tf_ans)
+
+  def testLargeSkewedSegmentsAreRepeatable(self):
+    # The per-block partial sums of the CPU kernel are combined in a fixed
+    # order, so repeated runs give bitwise equal results.
+    np.random.seed(0)
+    indices = np.concatenate([
+        np.zeros(15000, dtype=np.int32),
+        np.repeat(np.arange(1, 50, dtype=np.int32), 100)
+    ])
+    np.random.shuffle(indices)
+    np_x = np.random.uniform(-1, 1, size=(indices.size, 8)).astype(np.float32)
+    with self.cached_session(use_gpu=False):
+      expected = self.evaluate(
+          math_ops.unsorted_segment_sum(np_x, indices, num_segments=50))
+      for _ in range(10):
+        tf_ans = self.evaluate(
+            math_ops.unsorted_segment_sum(np_x, indices, num_segments=50))
+        self.assertAllEqual(expected, tf_ans)
+
   def testNumSegmentsTypes(self):
     dtypes = [dtypes_lib.int32, dtypes_lib.int64]
     indices_flat = np.array([0, 4, 0, 8, 3, 8, 4, 7, 7, 3])
@@ -151,6 +151,46 @@ class TopKTest(test.TestCase):
     self._testMediumTopK(np.float32)
     self._testMediumTopK(np.float16)
 
+  def testWideRowTopK(self):
+    # Rows this wide are split across threads; small k uses per-thread heaps
+    # and large k uses radix selection.
+    b = 2
+    n = 300000
+    inputs = np.random.permutation(np.arange(b * n, dtype=np.float32)).reshape(
+        b, n)
+    for k in [10, 5000, 100000]:
+      indices = np.argsort(-inputs, axis=1)[:, :k]
+      values = -np.sort(-inputs, axis=1)[:, :k]
+      self._validateTopK(inputs, k, values, indices)
+      if k < 10000:
+        self._validateTopK(inputs, k, values, indices, sorted=False)
+
+  def testWideRowStableSort(self):
+    n = 300000
+    for k in [10, 100000]:
+      inputs = np.random.randint(4, size=(1, n)).astype(np.int32)
+      indices = np.argsort(-inputs, axis=1, kind="mergesort")[:, :k]
+      values = -np.sort(-inputs, axis=1)[:, :k]
+      self._validateTopK(inputs, k, values, indices)
+
+  def testSignedZerosAndNans(self):
+    # NaNs rank above every other value and -0.0 ties with 0.0, on the full
+    # sort, selection, heap and wide row paths alike.
+    np.random.seed(0)
+    for n, ks in [(20, [20, 10, 1]), (300000, [10, 100000])]:
+      inputs = np.random.choice(
+          np.array([-1.0, -0.0, 0.0, 1.0, np.nan, -np.nan], dtype=np.float32),
+          size=(1, n))
+
+      def rank(c, row=inputs[0]):
+        return (0, 0, c) if np.isnan(row[c]) else (1, -row[c], c)
+
+      order = sorted(range(n), key=rank)
+      for k in ks:
+        with self.cached_session(use_gpu=False):
+          _, indices = self.evaluate(nn_ops.top_k(inputs, k))
+        self.assertAllEqual([order[:k]], indices)
+
   def testStableSort(self):
     b = 5
     n = 500
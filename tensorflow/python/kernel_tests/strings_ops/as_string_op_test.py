@@ -136,6 +136,29 @@ class AsStringOpTest(test.TestCase):
       result = output.eval(feed_dict={input_: int_inputs_})
       self.assertAllEqual(s(result), ["%d" % x for x in int_inputs_])
 
+  @test_util.run_deprecated_v1
+  def testWideOutput(self):
+    # Outputs longer than the inline formatting buffer.
+    s = lambda strs: [x.decode("ascii") for x in strs]
+    float_inputs_ = [0, 1.5, -1e30]
+
+    with self.cached_session():
+      input_ = array_ops.placeholder(dtypes.float64)
+      output = string_ops.as_string(input_, width=100, precision=20)
+      result = output.eval(feed_dict={input_: float_inputs_})
+      self.assertAllEqual(s(result), ["%100.20f" % x for x in float_inputs_])
+
+  @test_util.run_deprecated_v1
+  def testManyElements(self):
+    s = lambda strs: [x.decode("ascii") for x in strs]
+    int_inputs_ = list(range(-5000, 5000))
+
+    with self.cached_session():
+      input_ = array_ops.placeholder(dtypes.int64)
+      output = string_ops.as_string(input_, width=8, fill="0")
+      result = output.eval(feed_dict={input_: int_inputs_})
+      self.assertAllEqual(s(result), ["%08d" % x for x in int_inputs_])
+
   @test_util.run_deprecated_v1
   def testHalfInt(self):
     s = lambda strs: [x.decode("ascii") for x in strs]
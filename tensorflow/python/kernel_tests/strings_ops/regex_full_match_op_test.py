@@ -53,6 +53,20 @@ class RegexFullMatchOpVariantsTest(test.TestCase, parameterized.TestCase):
       matched = op(input_tensor, "").eval()
       self.assertAllEqual([False, False], matched)
 
+  def testManyElements(self, op):
+    # Large enough to be split across threads.
+    values = ["a%db" % i if i % 3 else "%d" % i for i in range(10000)]
+    input_tensor = constant_op.constant(values, dtypes.string)
+    matched = self.evaluate(op(input_tensor, "a[0-9]+b"))
+    self.assertAllEqual([i % 3 != 0 for i in range(10000)], matched)
+
+  def testSamePatternManyTimes(self, op):
+    input_tensor = constant_op.constant(["abc", "abd"], dtypes.string)
+    for pattern, expected in [("ab.", [True, True]), ("abc", [True, False]),
+                              ("ab.", [True, True])]:
+      matched = self.evaluate(op(input_tensor, pattern))
+      self.assertAllEqual(expected, matched)
+
   @test_util.run_deprecated_v1
   def testInvalidPattern(self, op):
     values = ["abc", "1"]
@@ -86,6 +86,16 @@ class RegexReplaceOpVariantsTest(test.TestCase, parameterized.TestCase):
       stripped = op(input_vector, "ab", "abc", True)
       self.assertAllEqual([b"abcabcabcabcabc", b"abccabccabcc", b""], stripped)
 
+  @test_util.run_deprecated_v1
+  def testUnmatchedLongStrings(self, op):
+    # Strings longer than the inline tstring buffer, only some of which match.
+    values = ["x" * 40 + str(i) if i % 3 else "a" * 40 for i in range(100)]
+    expected = [v.replace("a", "b").encode() for v in values]
+    with self.cached_session():
+      input_vector = constant_op.constant(values, dtypes.string)
+      replaced = op(input_vector, "a", "b")
+      self.assertAllEqual(expected, replaced)
+
 
 def as_string(s):
   return s
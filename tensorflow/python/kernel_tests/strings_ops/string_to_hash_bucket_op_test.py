@@ -91,6 +91,32 @@ class StringToHashBucketOpTest(test.TestCase):
         string_ops.string_to_hash_bucket_strong(
             input_string, 10, key=[98765]).eval()
 
+  def _assertLargeInputMatchesSlices(self, hash_fn):
+    # Long strings are stored out of line, short ones inline.
+    strings = [('long_feature_%d_' % i) * (i % 7) if i % 3 else str(i)
+               for i in range(4000)]
+    with self.cached_session():
+      expected = []
+      for start in range(0, len(strings), 10):
+        expected.extend(
+            self.evaluate(hash_fn(constant_op.constant(
+                strings[start:start + 10]))))
+      result = self.evaluate(hash_fn(constant_op.constant(strings)))
+      self.assertAllEqual(expected, result)
+
+  def testLargeInputFast(self):
+    self._assertLargeInputMatchesSlices(
+        lambda s: string_ops.string_to_hash_bucket_fast(s, 1000))
+
+  def testLargeInputLegacyHash(self):
+    self._assertLargeInputMatchesSlices(
+        lambda s: string_ops.string_to_hash_bucket(s, 1000))
+
+  def testLargeInputStrong(self):
+    self._assertLargeInputMatchesSlices(
+        lambda s: string_ops.string_to_hash_bucket_strong(
+            s, 1000, key=[98765, 132]))
+
 
 if __name__ == '__main__':
   test.main()